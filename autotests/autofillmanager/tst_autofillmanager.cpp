@@ -0,0 +1,131 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <QtTest/QtTest>
+
+#include <autofillmanager.h>
+
+class tst_AutoFillManager : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void javaScriptString_data();
+    void javaScriptString();
+    void formsScript_data();
+    void formsScript();
+};
+
+// Subclass that exposes the protected functions.
+class SubAutoFillManager : public AutoFillManager
+{
+public:
+    static QString call_javaScriptString(const QString &string)
+        { return SubAutoFillManager::javaScriptString(string); }
+
+    static QString call_formsScript(const QList<Form> &forms)
+        { return SubAutoFillManager::formsScript(forms); }
+};
+
+typedef QList<AutoFillManager::Form> FormList;
+Q_DECLARE_METATYPE(FormList)
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_AutoFillManager::initTestCase()
+{
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_AutoFillManager::cleanupTestCase()
+{
+}
+
+// This will be called before each test function is executed.
+void tst_AutoFillManager::init()
+{
+}
+
+// This will be called after every test function.
+void tst_AutoFillManager::cleanup()
+{
+}
+
+void tst_AutoFillManager::javaScriptString_data()
+{
+    QTest::addColumn<QString>("string");
+    QTest::addColumn<QString>("quoted");
+    QTest::newRow("empty") << QString() << QString("\"\"");
+    QTest::newRow("plain") << QString("user") << QString("\"user\"");
+    QTest::newRow("quote") << QString("a\"b") << QString("\"a\\\"b\"");
+    QTest::newRow("backslash") << QString("a\\\"") << QString("\"a\\\\\\\"\"");
+    QTest::newRow("newlines") << QString("a\nb\rc") << QString("\"a\\nb\\rc\"");
+    QTest::newRow("line separators") << (QString("a") + QChar(0x2028) + QChar(0x2029))
+        << QString("\"a\\u2028\\u2029\"");
+    QTest::newRow("arg markers") << QString("%1%2") << QString("\"%1%2\"");
+}
+
+// protected static QString javaScriptString(QString const &string)
+void tst_AutoFillManager::javaScriptString()
+{
+    QFETCH(QString, string);
+    QFETCH(QString, quoted);
+    QCOMPARE(SubAutoFillManager::call_javaScriptString(string), quoted);
+}
+
+static AutoFillManager::Form form(const QString &name, const QString &element, const QString &value)
+{
+    AutoFillManager::Form form;
+    form.name = name;
+    form.hasAPassword = false;
+    form.elements.append(AutoFillManager::Element(element, value));
+    return form;
+}
+
+void tst_AutoFillManager::formsScript_data()
+{
+    QTest::addColumn<FormList>("forms");
+    QTest::addColumn<QString>("script");
+    QTest::newRow("none") << FormList() << QString("[]");
+    QTest::newRow("unnamed") << (FormList() << form(QString(), "user", "joe"))
+        << QString("[{name:0,elements:[[\"user\",\"joe\"]]}]");
+    QTest::newRow("named") << (FormList() << form("login", "user", "joe") << form("search", "q", "a\"b"))
+        << QString("[{name:\"login\",elements:[[\"user\",\"joe\"]]},"
+                   "{name:\"search\",elements:[[\"q\",\"a\\\"b\"]]}]");
+    QTest::newRow("arg markers") << (FormList() << form("%1%2", "%1", "%2"))
+        << QString("[{name:\"%1%2\",elements:[[\"%1\",\"%2\"]]}]");
+}
+
+// protected static QString formsScript(QList<Form> const &forms)
+void tst_AutoFillManager::formsScript()
+{
+    QFETCH(FormList, forms);
+    QFETCH(QString, script);
+    QCOMPARE(SubAutoFillManager::call_formsScript(forms), script);
+}
+
+QTEST_MAIN(tst_AutoFillManager)
+#include "tst_autofillmanager.moc"
@@ -2,16 +2,29 @@ TEMPLATE = subdirs
 SUBDIRS  = \
     adblock \
     addbookmarkdialog \
+    autofillmanager \
     autosaver \
+    bookmarknode \
+    bookmarkstore \
+    browserapplication \
     cookiejar \
+    cookiestore \
+    dnsprefetcher \
+    downloadchecksum \
+    downloadjournal \
+    downloadwriter \
     historyfiltermodel \
     historymanager \
+    idlescheduler \
     modeltoolbar \
+    networkcookiejar \
     opensearchengine \
     opensearchmanager \
     opensearchreader \
     opensearchwriter \
+    recentlyclosedstore \
     searchlineedit \
+    sessionjournal \
     tabbar \
     tabwidget \
     utils \
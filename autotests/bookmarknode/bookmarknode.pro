@@ -0,0 +1,16 @@
+TEMPLATE = app
+TARGET =
+DEPENDPATH += .
+INCLUDEPATH += .
+
+include(../autotests.pri)
+
+# Input
+SOURCES = \
+    tst_bookmarknode.cpp \
+    bookmarks/bookmarknode.cpp \
+    bookmarks/bookmarkstore.cpp
+
+HEADERS = \
+    bookmarks/bookmarknode.h \
+    bookmarks/bookmarkstore.h
@@ -0,0 +1,179 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <QtTest/QtTest>
+
+#include "bookmarknode.h"
+
+class tst_BookmarkNode : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void bookmarkNode();
+    void add();
+    void remove();
+    void move();
+    void largeFolder();
+};
+
+// Checks that every cached row matches the position in the parent
+static bool rowsMatch(const BookmarkNode *folder)
+{
+    const QList<BookmarkNode*> &children = folder->children();
+    for (int i = 0; i < children.count(); ++i) {
+        if (children.at(i)->row() != i || children.at(i)->parent() != folder)
+            return false;
+    }
+    return true;
+}
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_BookmarkNode::initTestCase()
+{
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_BookmarkNode::cleanupTestCase()
+{
+}
+
+// This will be called before each test function is executed.
+void tst_BookmarkNode::init()
+{
+}
+
+// This will be called after every test function.
+void tst_BookmarkNode::cleanup()
+{
+}
+
+void tst_BookmarkNode::bookmarkNode()
+{
+    BookmarkNode root;
+    QCOMPARE(root.type(), BookmarkNode::Root);
+    QCOMPARE(root.parent(), (BookmarkNode*)0);
+    QCOMPARE(root.row(), -1);
+    QCOMPARE(root.children().count(), 0);
+
+    BookmarkNode *child = new BookmarkNode(BookmarkNode::Bookmark, &root);
+    QCOMPARE(child->parent(), &root);
+    QCOMPARE(child->row(), 0);
+    QCOMPARE(root.children().count(), 1);
+}
+
+void tst_BookmarkNode::add()
+{
+    BookmarkNode root;
+    BookmarkNode *a = new BookmarkNode(BookmarkNode::Bookmark, &root);
+    BookmarkNode *b = new BookmarkNode(BookmarkNode::Bookmark, &root);
+    QCOMPARE(b->row(), 1);
+
+    BookmarkNode *c = new BookmarkNode(BookmarkNode::Bookmark);
+    root.add(c, 0);
+    QCOMPARE(c->row(), 0);
+    QCOMPARE(a->row(), 1);
+    QCOMPARE(b->row(), 2);
+
+    BookmarkNode *d = new BookmarkNode(BookmarkNode::Bookmark);
+    root.add(d, 2);
+    QCOMPARE(b->row(), 3);
+    QCOMPARE(d->row(), 2);
+    QVERIFY(rowsMatch(&root));
+}
+
+void tst_BookmarkNode::remove()
+{
+    BookmarkNode root;
+    QList<BookmarkNode*> nodes;
+    for (int i = 0; i < 5; ++i)
+        nodes.append(new BookmarkNode(BookmarkNode::Bookmark, &root));
+
+    root.remove(nodes.at(1));
+    QCOMPARE(nodes.at(1)->parent(), (BookmarkNode*)0);
+    QCOMPARE(nodes.at(1)->row(), -1);
+    QCOMPARE(nodes.at(0)->row(), 0);
+    QCOMPARE(nodes.at(4)->row(), 3);
+    QVERIFY(rowsMatch(&root));
+
+    // Removing a node that isn't a child does nothing
+    root.remove(nodes.at(1));
+    QCOMPARE(root.children().count(), 4);
+    delete nodes.at(1);
+
+    delete nodes.at(2);
+    QCOMPARE(root.children().count(), 3);
+    QCOMPARE(nodes.at(3)->row(), 1);
+    QVERIFY(rowsMatch(&root));
+}
+
+void tst_BookmarkNode::move()
+{
+    BookmarkNode root;
+    BookmarkNode *folder = new BookmarkNode(BookmarkNode::Folder, &root);
+    BookmarkNode *a = new BookmarkNode(BookmarkNode::Bookmark, &root);
+    BookmarkNode *b = new BookmarkNode(BookmarkNode::Bookmark, &root);
+
+    folder->add(a);
+    QCOMPARE(a->parent(), folder);
+    QCOMPARE(a->row(), 0);
+    QCOMPARE(b->row(), 1);
+
+    // Within the same parent
+    root.add(folder, 1);
+    QCOMPARE(b->row(), 0);
+    QCOMPARE(folder->row(), 1);
+    QVERIFY(rowsMatch(&root));
+    QVERIFY(rowsMatch(folder));
+}
+
+void tst_BookmarkNode::largeFolder()
+{
+    BookmarkNode *root = new BookmarkNode(BookmarkNode::Root);
+    BookmarkNode *folder = new BookmarkNode(BookmarkNode::Folder, root);
+    for (int i = 0; i < 10000; ++i)
+        new BookmarkNode(BookmarkNode::Bookmark, folder);
+    QVERIFY(rowsMatch(folder));
+
+    BookmarkNode *first = new BookmarkNode(BookmarkNode::Bookmark);
+    folder->add(first, 0);
+    QCOMPARE(folder->children().last()->row(), 10000);
+    folder->remove(first);
+    delete first;
+    QCOMPARE(folder->children().last()->row(), 9999);
+    QVERIFY(rowsMatch(folder));
+
+    // Removing from the end keeps the other rows
+    while (folder->children().count() > 5000)
+        delete folder->children().last();
+    QCOMPARE(folder->children().at(4999)->row(), 4999);
+
+    delete root;
+}
+
+QTEST_MAIN(tst_BookmarkNode)
+#include "tst_bookmarknode.moc"
@@ -0,0 +1,326 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <QtTest/QtTest>
+
+#include <bookmarknode.h>
+#include <bookmarkstore.h>
+
+class tst_BookmarkStore : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void bookmarkStore();
+    void saveAndLoad();
+    void lazyLoad();
+    void incremental();
+    void unopenedFolder();
+    void truncatedRecord();
+    void compact();
+
+private:
+    QString m_fileName;
+};
+
+static BookmarkNode *makeTree(int bookmarks)
+{
+    BookmarkNode *root = new BookmarkNode(BookmarkNode::Root);
+    BookmarkNode *toolbar = new BookmarkNode(BookmarkNode::Folder, root);
+    toolbar->title = QLatin1String("Bookmarks Bar");
+    BookmarkNode *menu = new BookmarkNode(BookmarkNode::Folder, root);
+    menu->title = QLatin1String("Bookmarks Menu");
+    menu->expanded = true;
+
+    for (int i = 0; i < bookmarks; ++i) {
+        BookmarkNode *bookmark = new BookmarkNode(BookmarkNode::Bookmark, menu);
+        bookmark->title = QString(QLatin1String("Bookmark %1")).arg(i);
+        bookmark->url = QString(QLatin1String("http://%1.com/")).arg(i);
+    }
+    new BookmarkNode(BookmarkNode::Separator, menu);
+    BookmarkNode *folder = new BookmarkNode(BookmarkNode::Folder, menu);
+    folder->title = QLatin1String("Folder");
+    BookmarkNode *bookmark = new BookmarkNode(BookmarkNode::Bookmark, folder);
+    bookmark->title = QLatin1String("Arora");
+    bookmark->url = QLatin1String("http://arora-browser.org/");
+    bookmark->desc = QLatin1String("description");
+    return root;
+}
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_BookmarkStore::initTestCase()
+{
+    m_fileName = QDir::tempPath() + QLatin1String("/tst_bookmarkstore.dat");
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_BookmarkStore::cleanupTestCase()
+{
+}
+
+// This will be called before each test function is executed.
+void tst_BookmarkStore::init()
+{
+    QFile::remove(m_fileName);
+    QFile::remove(m_fileName + QLatin1String(".new"));
+}
+
+// This will be called after every test function.
+void tst_BookmarkStore::cleanup()
+{
+    QFile::remove(m_fileName);
+    QFile::remove(m_fileName + QLatin1String(".new"));
+}
+
+void tst_BookmarkStore::bookmarkStore()
+{
+    BookmarkStore store;
+    QCOMPARE(store.fileName(), QString());
+    QCOMPARE(store.exists(), false);
+    QCOMPARE(store.records(), 0);
+    QVERIFY(!store.load());
+
+    BookmarkNode root;
+    QCOMPARE(store.save(&root), false);
+    QCOMPARE(store.save(0), false);
+}
+
+void tst_BookmarkStore::saveAndLoad()
+{
+    BookmarkNode *tree = makeTree(10);
+    {
+        BookmarkStore store;
+        store.setFileName(m_fileName);
+        QVERIFY(store.save(tree));
+        QVERIFY(store.exists());
+    }
+
+    BookmarkStore store;
+    store.setFileName(m_fileName);
+    BookmarkNode *root = store.load();
+    QVERIFY(root);
+    QCOMPARE(root->type(), BookmarkNode::Root);
+    QVERIFY(*root == *tree);
+    delete root;
+    delete tree;
+}
+
+void tst_BookmarkStore::lazyLoad()
+{
+    BookmarkNode *tree = makeTree(10);
+    {
+        BookmarkStore store;
+        store.setFileName(m_fileName);
+        QVERIFY(store.save(tree));
+    }
+    delete tree;
+
+    BookmarkStore store;
+    store.setFileName(m_fileName);
+    BookmarkNode *root = store.load();
+    QVERIFY(root);
+    QVERIFY(!store.isLoaded(root));
+
+    QCOMPARE(root->children().count(), 2);
+    QVERIFY(store.isLoaded(root));
+    BookmarkNode *toolbar = root->children().at(0);
+    BookmarkNode *menu = root->children().at(1);
+    QCOMPARE(menu->title, QString(QLatin1String("Bookmarks Menu")));
+    QCOMPARE(menu->expanded, true);
+    QVERIFY(!store.isLoaded(menu));
+    QCOMPARE(toolbar->children().count(), 0);
+
+    QCOMPARE(menu->children().count(), 12);
+    BookmarkNode *folder = menu->children().at(11);
+    QCOMPARE(folder->type(), BookmarkNode::Folder);
+    QVERIFY(!store.isLoaded(folder));
+    QCOMPARE(menu->children().at(10)->type(), BookmarkNode::Separator);
+    QCOMPARE(menu->children().at(3)->url, QString(QLatin1String("http://3.com/")));
+
+    // Adding to a folder loads it first
+    BookmarkNode *bookmark = new BookmarkNode(BookmarkNode::Bookmark);
+    folder->add(bookmark, 0);
+    QVERIFY(store.isLoaded(folder));
+    QCOMPARE(folder->children().count(), 2);
+    QCOMPARE(folder->children().at(1)->desc, QString(QLatin1String("description")));
+    delete root;
+}
+
+void tst_BookmarkStore::incremental()
+{
+    BookmarkNode *tree = makeTree(100);
+    BookmarkStore store;
+    store.setFileName(m_fileName);
+    QVERIFY(store.save(tree));
+    int records = store.records();
+    qint64 size = QFileInfo(m_fileName).size();
+
+    // Nothing changed
+    QVERIFY(store.save(tree));
+    QCOMPARE(store.records(), records);
+
+    BookmarkNode *menu = tree->children().at(1);
+    menu->children().at(50)->title = QLatin1String("changed");
+    QVERIFY(store.save(tree));
+    QCOMPARE(store.records(), records + 1);
+    QVERIFY(QFileInfo(m_fileName).size() - size < 100);
+
+    // The new bookmark and the children of the menu
+    BookmarkNode *bookmark = new BookmarkNode(BookmarkNode::Bookmark);
+    bookmark->url = QLatin1String("http://new.com/");
+    menu->add(bookmark, 0);
+    QVERIFY(store.save(tree));
+    QCOMPARE(store.records(), records + 3);
+
+    menu->remove(bookmark);
+    delete bookmark;
+    QVERIFY(store.save(tree));
+    QCOMPARE(store.records(), records + 4);
+
+    BookmarkStore otherStore;
+    otherStore.setFileName(m_fileName);
+    BookmarkNode *root = otherStore.load();
+    QVERIFY(root);
+    QVERIFY(*root == *tree);
+    delete root;
+    delete tree;
+}
+
+void tst_BookmarkStore::unopenedFolder()
+{
+    BookmarkNode *tree = makeTree(10);
+    {
+        BookmarkStore store;
+        store.setFileName(m_fileName);
+        QVERIFY(store.save(tree));
+    }
+
+    {
+        BookmarkStore store;
+        store.setFileName(m_fileName);
+        BookmarkNode *root = store.load();
+        BookmarkNode *menu = root->children().at(1);
+        menu->title = QLatin1String("renamed");
+        QVERIFY(!store.isLoaded(menu));
+        QVERIFY(store.save(root));
+        QVERIFY(!store.isLoaded(menu));
+        delete root;
+    }
+
+    BookmarkStore store;
+    store.setFileName(m_fileName);
+    BookmarkNode *root = store.load();
+    tree->children().at(1)->title = QLatin1String("renamed");
+    QVERIFY(*root == *tree);
+    delete root;
+    delete tree;
+}
+
+void tst_BookmarkStore::truncatedRecord()
+{
+    BookmarkNode *tree = makeTree(10);
+    {
+        BookmarkStore store;
+        store.setFileName(m_fileName);
+        QVERIFY(store.save(tree));
+    }
+    QFile file(m_fileName);
+    QVERIFY(file.open(QFile::WriteOnly | QFile::Append));
+    file.write("\0\0\1", 3);
+    file.close();
+
+    BookmarkStore store;
+    store.setFileName(m_fileName);
+    BookmarkNode *root = store.load();
+    QVERIFY(root);
+    QVERIFY(*root == *tree);
+
+    // The file is rewritten on the next save
+    QVERIFY(store.save(root));
+    BookmarkStore otherStore;
+    otherStore.setFileName(m_fileName);
+    BookmarkNode *otherRoot = otherStore.load();
+    QVERIFY(otherRoot);
+    QVERIFY(*otherRoot == *tree);
+    delete otherRoot;
+    delete root;
+    delete tree;
+}
+
+void tst_BookmarkStore::compact()
+{
+    BookmarkNode *tree = makeTree(10);
+    {
+        BookmarkStore store;
+        store.setFileName(m_fileName);
+        QVERIFY(store.save(tree));
+    }
+    delete tree;
+
+    BookmarkStore store;
+    store.setFileName(m_fileName);
+    BookmarkNode *root = store.load();
+    BookmarkNode *menu = root->children().at(1);
+    BookmarkNode *folder = menu->children().at(11);
+    QVERIFY(!store.isLoaded(folder));
+
+    // Removing a folder opens it so it can be added back after compacting
+    menu->remove(folder);
+    QVERIFY(store.isLoaded(folder));
+    BookmarkNode *bookmark = menu->children().at(0);
+    for (int i = 0; i < 1000; ++i) {
+        bookmark->title = QString::number(i);
+        QVERIFY(store.save(root));
+    }
+    // Without compacting there would be a record for every save
+    QVERIFY(store.records() <= 256);
+
+    // The removed folder and its bookmark are not stored anymore
+    BookmarkStore compactedStore;
+    compactedStore.setFileName(m_fileName);
+    BookmarkNode *compactedRoot = compactedStore.load();
+    QVERIFY(compactedRoot);
+    QCOMPARE(compactedRoot->children().at(1)->children().count(), 11);
+    QCOMPARE(compactedStore.records(), store.records());
+    delete compactedRoot;
+
+    menu->add(folder);
+    QCOMPARE(folder->children().count(), 1);
+    QCOMPARE(folder->children().at(0)->title, QString(QLatin1String("Arora")));
+    QVERIFY(store.save(root));
+
+    BookmarkStore otherStore;
+    otherStore.setFileName(m_fileName);
+    BookmarkNode *otherRoot = otherStore.load();
+    QVERIFY(otherRoot);
+    QVERIFY(*otherRoot == *root);
+    delete otherRoot;
+    delete root;
+}
+
+QTEST_MAIN(tst_BookmarkStore)
+#include "tst_bookmarkstore.moc"
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <QtTest/QtTest>
+
+#include <browserapplication.h>
+
+class tst_BrowserApplication : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void argumentUrls_data();
+    void argumentUrls();
+};
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_BrowserApplication::initTestCase()
+{
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_BrowserApplication::cleanupTestCase()
+{
+}
+
+// This will be called before each test function is executed.
+void tst_BrowserApplication::init()
+{
+}
+
+// This will be called after every test function.
+void tst_BrowserApplication::cleanup()
+{
+}
+
+void tst_BrowserApplication::argumentUrls_data()
+{
+    QTest::addColumn<QStringList>("arguments");
+    QTest::addColumn<QStringList>("urls");
+
+    QStringList program = QStringList() << QLatin1String("arora");
+    QTest::newRow("none") << program << QStringList();
+    QTest::newRow("url") << (QStringList(program) << "http://foo.com/")
+        << (QStringList() << "http://foo.com/");
+    QTest::newRow("urls") << (QStringList(program) << "http://foo.com/" << "bar.com")
+        << (QStringList() << "http://foo.com/" << "bar.com");
+    QTest::newRow("flag") << (QStringList(program) << "--profile-startup" << "http://foo.com/")
+        << (QStringList() << "http://foo.com/");
+    QTest::newRow("option=value") << (QStringList(program) << "--profile-startup=trace.json" << "http://foo.com/")
+        << (QStringList() << "http://foo.com/");
+    QTest::newRow("option value") << (QStringList(program) << "-style" << "plastique" << "http://foo.com/")
+        << (QStringList() << "http://foo.com/");
+    QTest::newRow("options") << (QStringList(program) << "-reverse" << "-style" << "plastique" << "http://foo.com/")
+        << (QStringList() << "http://foo.com/");
+    QTest::newRow("option last") << (QStringList(program) << "http://foo.com/" << "-style")
+        << (QStringList() << "http://foo.com/");
+    QTest::newRow("only options") << (QStringList(program) << "-style" << "plastique" << "-x")
+        << QStringList();
+    QTest::newRow("flag url") << (QStringList(program) << "-reverse" << "http://foo.com/")
+        << (QStringList() << "http://foo.com/");
+    QTest::newRow("unknown option url") << (QStringList(program) << "-psn_0_12345" << "http://foo.com/")
+        << (QStringList() << "http://foo.com/");
+}
+
+// public static QStringList argumentUrls(QStringList const &arguments)
+void tst_BrowserApplication::argumentUrls()
+{
+    QFETCH(QStringList, arguments);
+    QFETCH(QStringList, urls);
+
+    QCOMPARE(BrowserApplication::argumentUrls(arguments), urls);
+}
+
+QTEST_MAIN(tst_BrowserApplication)
+#include "tst_browserapplication.moc"
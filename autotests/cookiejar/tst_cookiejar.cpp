@@ -66,6 +66,9 @@ private slots:
     void cookiesChanged();
     void isOnDomainList_data();
     void isOnDomainList();
+    void exceptionRules_data();
+    void exceptionRules();
+    void exceptionRulesChanged();
 };
 
 // Subclass that exposes the protected functions.
@@ -551,6 +554,88 @@ void tst_CookieJar::isOnDomainList()
     QCOMPARE(jar.call_isOnDomainList(list, domain), isOnDomainList);
 }
 
+void tst_CookieJar::exceptionRules_data()
+{
+    QTest::addColumn<CookieJar::AcceptPolicy>("policy");
+    QTest::addColumn<QStringList>("block");
+    QTest::addColumn<QStringList>("allow");
+    QTest::addColumn<QString>("host");
+    QTest::addColumn<bool>("accepted");
+
+    QTest::newRow("no-rules") << CookieJar::AcceptAlways
+        << QStringList() << QStringList() << "foo.com" << true;
+    QTest::newRow("block-exact") << CookieJar::AcceptAlways
+        << (QStringList() << "foo.com") << QStringList() << "foo.com" << false;
+    QTest::newRow("block-subdomain") << CookieJar::AcceptAlways
+        << (QStringList() << "foo.com") << QStringList() << "www.foo.com" << false;
+    QTest::newRow("block-dot-exact") << CookieJar::AcceptAlways
+        << (QStringList() << ".foo.com") << QStringList() << "foo.com" << false;
+    QTest::newRow("block-dot-subdomain") << CookieJar::AcceptAlways
+        << (QStringList() << ".foo.com") << QStringList() << "a.b.foo.com" << false;
+    QTest::newRow("block-other") << CookieJar::AcceptAlways
+        << (QStringList() << "foo.com") << QStringList() << "abcfoo.com" << true;
+    QTest::newRow("block-parent") << CookieJar::AcceptAlways
+        << (QStringList() << "www.foo.com") << QStringList() << "foo.com" << true;
+    QTest::newRow("allow-exact") << CookieJar::AcceptNever
+        << QStringList() << (QStringList() << "foo.com") << "foo.com" << true;
+    QTest::newRow("allow-subdomain") << CookieJar::AcceptNever
+        << QStringList() << (QStringList() << "foo.com") << "www.foo.com" << true;
+    QTest::newRow("allow-other") << CookieJar::AcceptNever
+        << QStringList() << (QStringList() << "foo.com") << "bar.com" << false;
+    QTest::newRow("block-wins") << CookieJar::AcceptNever
+        << (QStringList() << "www.foo.com") << (QStringList() << "foo.com") << "www.foo.com" << false;
+}
+
+// Cookies from hosts on the exception lists are blocked or allowed
+void tst_CookieJar::exceptionRules()
+{
+    QFETCH(CookieJar::AcceptPolicy, policy);
+    QFETCH(QStringList, block);
+    QFETCH(QStringList, allow);
+    QFETCH(QString, host);
+    QFETCH(bool, accepted);
+
+    SubCookieJar jar;
+    jar.setPrivate(true);
+    jar.setAcceptPolicy(policy);
+    jar.setBlockedCookies(block);
+    jar.setAllowedCookies(allow);
+    jar.setAllowForSessionCookies(QStringList());
+
+    QUrl url(QLatin1String("http://") + host + QLatin1String("/"));
+    QList<QNetworkCookie> cookies;
+    cookies.append(QNetworkCookie("name", "value"));
+    jar.setCookiesFromUrl(cookies, url);
+    QCOMPARE(jar.cookiesForUrl(url).count(), accepted ? 1 : 0);
+}
+
+// The rules follow the lists when they are changed
+void tst_CookieJar::exceptionRulesChanged()
+{
+    SubCookieJar jar;
+    jar.setPrivate(true);
+    jar.setAcceptPolicy(CookieJar::AcceptAlways);
+    jar.setAllowedCookies(QStringList());
+    jar.setAllowForSessionCookies(QStringList());
+    jar.setBlockedCookies(QStringList() << QLatin1String("foo.com"));
+
+    QUrl url(QLatin1String("http://www.foo.com/"));
+    QList<QNetworkCookie> cookies;
+    cookies.append(QNetworkCookie("name", "value"));
+    jar.setCookiesFromUrl(cookies, url);
+    QCOMPARE(jar.cookiesForUrl(url).count(), 0);
+
+    jar.setBlockedCookies(QStringList() << QLatin1String("bar.com"));
+    jar.setCookiesFromUrl(cookies, url);
+    QCOMPARE(jar.cookiesForUrl(url).count(), 1);
+
+    // Blocking the domain removes the cookies it already set
+    QSignalSpy spy(&jar, SIGNAL(cookiesChanged()));
+    jar.setBlockedCookies(QStringList() << QLatin1String(".foo.com"));
+    QCOMPARE(jar.cookiesForUrl(url).count(), 0);
+    QCOMPARE(spy.count(), 1);
+}
+
 QTEST_MAIN(tst_CookieJar)
 #include "tst_cookiejar.moc"
 
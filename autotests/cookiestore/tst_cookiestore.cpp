@@ -0,0 +1,243 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include <QtTest/QtTest>
+#include <cookiestore.h>
+
+class tst_CookieStore : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void load_empty();
+    void insert_data();
+    void insert();
+    void remove();
+    void sessionCookies();
+    void truncated();
+    void saveFailed();
+    void compact();
+    void needsCompaction();
+
+private:
+    QNetworkCookie cookie(const QString &name, const QString &value, int days = 1) const;
+    QString m_fileName;
+};
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_CookieStore::initTestCase()
+{
+    m_fileName = QDir::tempPath() + QLatin1String("/tst_cookiestore.dat");
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_CookieStore::cleanupTestCase()
+{
+}
+
+// This will be called before each test function is executed.
+void tst_CookieStore::init()
+{
+    QFile::remove(m_fileName);
+    QFile::remove(m_fileName + QLatin1String(".new"));
+}
+
+// This will be called after every test function.
+void tst_CookieStore::cleanup()
+{
+    QFile::remove(m_fileName);
+    QFile::remove(m_fileName + QLatin1String(".new"));
+}
+
+QNetworkCookie tst_CookieStore::cookie(const QString &name, const QString &value, int days) const
+{
+    QNetworkCookie cookie(name.toUtf8(), value.toUtf8());
+    cookie.setDomain(QLatin1String(".foo.com"));
+    cookie.setPath(QLatin1String("/"));
+    if (days != 0)
+        cookie.setExpirationDate(QDateTime::currentDateTime().addDays(days));
+    return cookie;
+}
+
+void tst_CookieStore::load_empty()
+{
+    CookieStore store(m_fileName);
+    QVERIFY(!store.exists());
+    QVERIFY(store.load().isEmpty());
+    QVERIFY(!store.hasPendingChanges());
+    QVERIFY(store.save());
+    QVERIFY(!store.exists());
+}
+
+void tst_CookieStore::insert_data()
+{
+    QTest::addColumn<QStringList>("names");
+    QTest::addColumn<int>("count");
+    QTest::newRow("one") << (QStringList() << "a") << 1;
+    QTest::newRow("two") << (QStringList() << "a" << "b") << 2;
+    QTest::newRow("replaced") << (QStringList() << "a" << "b" << "a") << 2;
+}
+
+// public void insert(QNetworkCookie const &cookie)
+void tst_CookieStore::insert()
+{
+    QFETCH(QStringList, names);
+    QFETCH(int, count);
+
+    CookieStore store(m_fileName);
+    store.load();
+    for (int i = 0; i < names.count(); ++i)
+        store.insert(cookie(names.at(i), QString::number(i)));
+    QVERIFY(store.hasPendingChanges());
+    QVERIFY(store.save());
+    QVERIFY(!store.hasPendingChanges());
+
+    CookieStore reloaded(m_fileName);
+    QList<QNetworkCookie> cookies = reloaded.load();
+    QCOMPARE(cookies.count(), count);
+
+    // The last value written wins
+    foreach (const QNetworkCookie &c, cookies)
+        QCOMPARE(QString::fromUtf8(c.value()),
+                 QString::number(names.lastIndexOf(QString::fromUtf8(c.name()))));
+}
+
+// public void remove(QNetworkCookie const &cookie)
+void tst_CookieStore::remove()
+{
+    CookieStore store(m_fileName);
+    store.load();
+    store.insert(cookie("a", "1"));
+    store.insert(cookie("b", "2"));
+    QVERIFY(store.save());
+
+    // Appending to an existing journal
+    store.remove(cookie("a", "1"));
+    QVERIFY(store.save());
+
+    CookieStore reloaded(m_fileName);
+    QList<QNetworkCookie> cookies = reloaded.load();
+    QCOMPARE(cookies.count(), 1);
+    QCOMPARE(cookies.first().name(), QByteArray("b"));
+}
+
+void tst_CookieStore::sessionCookies()
+{
+    CookieStore store(m_fileName);
+    store.load();
+    store.insert(cookie("session", "1", 0));
+    QVERIFY(!store.hasPendingChanges());
+    store.insert(cookie("expired", "1", -1));
+    QVERIFY(store.save());
+
+    CookieStore reloaded(m_fileName);
+    QVERIFY(reloaded.load().isEmpty());
+}
+
+void tst_CookieStore::truncated()
+{
+    CookieStore store(m_fileName);
+    store.load();
+    store.insert(cookie("a", "1"));
+    store.insert(cookie("b", "2"));
+    QVERIFY(store.save());
+
+    QFile file(m_fileName);
+    QVERIFY(file.open(QFile::ReadWrite));
+    file.resize(file.size() - 3);
+    file.close();
+
+    CookieStore reloaded(m_fileName);
+    QList<QNetworkCookie> cookies = reloaded.load();
+    QCOMPARE(cookies.count(), 1);
+    QCOMPARE(cookies.first().name(), QByteArray("a"));
+    QVERIFY(reloaded.needsCompaction());
+}
+
+// public bool save()
+void tst_CookieStore::saveFailed()
+{
+    CookieStore store(m_fileName);
+    store.load();
+    store.insert(cookie("a", "1"));
+    QVERIFY(store.save());
+
+    // Appending to a file that can't be written
+    store.setFileName(QDir::tempPath() + QLatin1String("/tst_cookiestore/missing.dat"));
+    store.insert(cookie("b", "2"));
+    QVERIFY(!store.save());
+    QVERIFY(store.needsCompaction());
+    QVERIFY(!store.save());
+
+    store.setFileName(m_fileName);
+    QVERIFY(store.compact(QList<QNetworkCookie>() << cookie("a", "1") << cookie("b", "2")));
+    QVERIFY(!store.needsCompaction());
+    store.insert(cookie("c", "3"));
+    QVERIFY(store.save());
+
+    CookieStore reloaded(m_fileName);
+    QCOMPARE(reloaded.load().count(), 3);
+    QVERIFY(!reloaded.needsCompaction());
+}
+
+// public bool compact(QList<QNetworkCookie> const &cookies)
+void tst_CookieStore::compact()
+{
+    CookieStore store(m_fileName);
+    store.load();
+    for (int i = 0; i < 10; ++i)
+        store.insert(cookie("a", QString::number(i)));
+    QVERIFY(store.save());
+    qint64 journalSize = QFileInfo(m_fileName).size();
+
+    store.setNeedsCompaction();
+    QVERIFY(store.needsCompaction());
+    QVERIFY(!store.save());
+    QVERIFY(store.compact(QList<QNetworkCookie>() << cookie("a", "9")));
+    QVERIFY(!store.needsCompaction());
+    QVERIFY(QFileInfo(m_fileName).size() < journalSize);
+    QVERIFY(!QFile::exists(m_fileName + QLatin1String(".new")));
+
+    CookieStore reloaded(m_fileName);
+    QList<QNetworkCookie> cookies = reloaded.load();
+    QCOMPARE(cookies.count(), 1);
+    QCOMPARE(cookies.first().value(), QByteArray("9"));
+}
+
+void tst_CookieStore::needsCompaction()
+{
+    CookieStore store(m_fileName);
+    store.load();
+    QVERIFY(!store.needsCompaction());
+    for (int i = 0; i < 1000; ++i)
+        store.insert(cookie("a", QString::number(i)));
+    for (int i = 0; i < 999; ++i)
+        store.remove(cookie("a", QString::number(i)));
+    QVERIFY(store.needsCompaction());
+}
+
+QTEST_MAIN(tst_CookieStore)
+#include "tst_cookiestore.moc"
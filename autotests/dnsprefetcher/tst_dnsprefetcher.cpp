@@ -0,0 +1,177 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "qtest_arora.h"
+
+#include <dnsprefetcher.h>
+
+#include <qsettings.h>
+
+class tst_DnsPrefetcher : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void dnsPrefetcher();
+    void prefetch_data();
+    void prefetch();
+    void rateLimit();
+    void disabled();
+    void privateBrowsing();
+    void clear();
+
+private:
+    void setSetting(const QString &key, const QVariant &value);
+};
+
+void tst_DnsPrefetcher::setSetting(const QString &key, const QVariant &value)
+{
+    QSettings settings;
+    settings.beginGroup(QLatin1String("network"));
+    settings.setValue(key, value);
+}
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_DnsPrefetcher::initTestCase()
+{
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_DnsPrefetcher::cleanupTestCase()
+{
+}
+
+// This will be called before each test function is executed.
+void tst_DnsPrefetcher::init()
+{
+    QSettings settings;
+    settings.remove(QLatin1String("network"));
+    BrowserApplication::setPrivate(false);
+}
+
+// This will be called after every test function.
+void tst_DnsPrefetcher::cleanup()
+{
+    QSettings settings;
+    settings.remove(QLatin1String("network"));
+    BrowserApplication::setPrivate(false);
+}
+
+void tst_DnsPrefetcher::dnsPrefetcher()
+{
+    DnsPrefetcher prefetcher;
+    QVERIFY(prefetcher.isEnabled());
+    QVERIFY(!prefetcher.isCached(QLatin1String("example.com")));
+    prefetcher.prefetch(QString());
+    prefetcher.prefetch(QUrl());
+    prefetcher.clear();
+}
+
+void tst_DnsPrefetcher::prefetch_data()
+{
+    QTest::addColumn<QString>("url");
+    QTest::addColumn<QString>("host");
+    QTest::addColumn<bool>("cached");
+    QTest::newRow("http") << "http://www.example.com/a" << "www.example.com" << true;
+    QTest::newRow("https") << "https://www.example.com/" << "www.example.com" << true;
+    QTest::newRow("upper case") << "http://WWW.Example.COM/" << "www.example.com" << true;
+    QTest::newRow("ftp") << "ftp://ftp.example.com/" << "ftp.example.com" << false;
+    QTest::newRow("file") << "file:///tmp/a.html" << "" << false;
+    QTest::newRow("ip address") << "http://127.0.0.1/" << "127.0.0.1" << false;
+    QTest::newRow("no host") << "http:///" << "" << false;
+}
+
+// The host is remembered as soon as the lookup is started
+void tst_DnsPrefetcher::prefetch()
+{
+    QFETCH(QString, url);
+    QFETCH(QString, host);
+    QFETCH(bool, cached);
+
+    DnsPrefetcher prefetcher;
+    prefetcher.prefetch(url);
+    QCOMPARE(prefetcher.isCached(host), cached);
+}
+
+void tst_DnsPrefetcher::rateLimit()
+{
+    setSetting(QLatin1String("dnsPrefetchRate"), 2);
+    DnsPrefetcher prefetcher;
+    prefetcher.prefetch(QLatin1String("http://a.example.com/"));
+    prefetcher.prefetch(QLatin1String("http://b.example.com/"));
+    prefetcher.prefetch(QLatin1String("http://c.example.com/"));
+    QVERIFY(prefetcher.isCached(QLatin1String("a.example.com")));
+    QVERIFY(prefetcher.isCached(QLatin1String("b.example.com")));
+    QVERIFY(!prefetcher.isCached(QLatin1String("c.example.com")));
+
+    // A host that is already known doesn't count
+    prefetcher.prefetch(QLatin1String("http://a.example.com/other"));
+    QVERIFY(!prefetcher.isCached(QLatin1String("c.example.com")));
+}
+
+void tst_DnsPrefetcher::disabled()
+{
+    setSetting(QLatin1String("dnsPrefetch"), false);
+    DnsPrefetcher prefetcher;
+    QVERIFY(!prefetcher.isEnabled());
+    prefetcher.prefetch(QLatin1String("http://www.example.com/"));
+    QVERIFY(!prefetcher.isCached(QLatin1String("www.example.com")));
+
+    setSetting(QLatin1String("dnsPrefetch"), true);
+    prefetcher.loadSettings();
+    QVERIFY(prefetcher.isEnabled());
+    prefetcher.prefetch(QLatin1String("http://www.example.com/"));
+    QVERIFY(prefetcher.isCached(QLatin1String("www.example.com")));
+}
+
+void tst_DnsPrefetcher::privateBrowsing()
+{
+    DnsPrefetcher prefetcher;
+    prefetcher.prefetch(QLatin1String("http://www.example.com/"));
+    QVERIFY(prefetcher.isCached(QLatin1String("www.example.com")));
+
+    // Nothing is kept from before and nothing is looked up
+    BrowserApplication::setPrivate(true);
+    QVERIFY(!prefetcher.isEnabled());
+    QVERIFY(!prefetcher.isCached(QLatin1String("www.example.com")));
+    prefetcher.prefetch(QLatin1String("http://www.example.org/"));
+    QVERIFY(!prefetcher.isCached(QLatin1String("www.example.org")));
+
+    BrowserApplication::setPrivate(false);
+    QVERIFY(prefetcher.isEnabled());
+}
+
+void tst_DnsPrefetcher::clear()
+{
+    DnsPrefetcher prefetcher;
+    prefetcher.prefetch(QLatin1String("http://www.example.com/"));
+    prefetcher.clear();
+    QVERIFY(!prefetcher.isCached(QLatin1String("www.example.com")));
+}
+
+QTEST_MAIN(tst_DnsPrefetcher)
+#include "tst_dnsprefetcher.moc"
@@ -0,0 +1,192 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <QtTest/QtTest>
+#include "qtry.h"
+
+#include <downloadchecksum.h>
+#include <downloadwriter.h>
+
+class tst_DownloadChecksum : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void hash_data();
+    void hash();
+    void incremental();
+    void algorithmForDigest_data();
+    void algorithmForDigest();
+    void parseChecksumFile_data();
+    void parseChecksumFile();
+    void writer();
+
+private:
+    QString m_fileName;
+};
+
+Q_DECLARE_METATYPE(DownloadChecksum::Algorithm)
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_DownloadChecksum::initTestCase()
+{
+    m_fileName = QDir::tempPath() + QLatin1String("/tst_downloadchecksum.dat");
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_DownloadChecksum::cleanupTestCase()
+{
+}
+
+// This will be called before each test function is executed.
+void tst_DownloadChecksum::init()
+{
+    QFile::remove(m_fileName);
+}
+
+// This will be called after every test function.
+void tst_DownloadChecksum::cleanup()
+{
+    QFile::remove(m_fileName);
+}
+
+void tst_DownloadChecksum::hash_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<DownloadChecksum::Algorithm>("algorithm");
+    QTest::addColumn<QByteArray>("digest");
+    QTest::newRow("sha256 empty") << QByteArray() << DownloadChecksum::Sha256
+        << QByteArray("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    QTest::newRow("sha256 abc") << QByteArray("abc") << DownloadChecksum::Sha256
+        << QByteArray("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    QTest::newRow("sha256 two blocks") << QByteArray("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq")
+        << DownloadChecksum::Sha256
+        << QByteArray("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    QTest::newRow("md5 abc") << QByteArray("abc") << DownloadChecksum::Md5
+        << QByteArray("900150983cd24fb0d6963f7d28e17f72");
+}
+
+// public static QByteArray hash(QByteArray const &data, DownloadChecksum::Algorithm algorithm)
+void tst_DownloadChecksum::hash()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(DownloadChecksum::Algorithm, algorithm);
+    QFETCH(QByteArray, digest);
+    QCOMPARE(DownloadChecksum::hash(data, algorithm), digest);
+}
+
+void tst_DownloadChecksum::incremental()
+{
+    QByteArray data(1000000, 'a');
+    DownloadChecksum checksum(DownloadChecksum::Sha256);
+    for (int i = 0; i < data.size(); i += 7)
+        checksum.addData(data.constData() + i, qMin(7, data.size() - i));
+    QCOMPARE(checksum.result(), QByteArray("cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"));
+
+    // result() doesn't end the hash
+    checksum.reset();
+    checksum.addData("a", 1);
+    checksum.result();
+    checksum.addData("bc", 2);
+    QCOMPARE(checksum.result(), DownloadChecksum::hash("abc", DownloadChecksum::Sha256));
+}
+
+void tst_DownloadChecksum::algorithmForDigest_data()
+{
+    QTest::addColumn<QByteArray>("digest");
+    QTest::addColumn<bool>("valid");
+    QTest::addColumn<DownloadChecksum::Algorithm>("algorithm");
+    QTest::newRow("empty") << QByteArray() << false << DownloadChecksum::Sha256;
+    QTest::newRow("md5") << QByteArray(32, 'a') << true << DownloadChecksum::Md5;
+    QTest::newRow("sha256") << QByteArray(64, 'F') << true << DownloadChecksum::Sha256;
+    QTest::newRow("sha1") << QByteArray(40, 'a') << false << DownloadChecksum::Sha256;
+    QTest::newRow("not hex") << QByteArray(32, 'g') << false << DownloadChecksum::Sha256;
+}
+
+// public static bool algorithmForDigest(QByteArray const &hexDigest, DownloadChecksum::Algorithm *algorithm)
+void tst_DownloadChecksum::algorithmForDigest()
+{
+    QFETCH(QByteArray, digest);
+    QFETCH(bool, valid);
+    QFETCH(DownloadChecksum::Algorithm, algorithm);
+    DownloadChecksum::Algorithm result = DownloadChecksum::Sha256;
+    QCOMPARE(DownloadChecksum::algorithmForDigest(digest, &result), valid);
+    QCOMPARE(result, algorithm);
+}
+
+void tst_DownloadChecksum::parseChecksumFile_data()
+{
+    QByteArray a(64, 'a');
+    QByteArray b(64, 'b');
+    QTest::addColumn<QByteArray>("contents");
+    QTest::addColumn<QByteArray>("digest");
+    QTest::newRow("empty") << QByteArray() << QByteArray();
+    QTest::newRow("digest only") << a + '\n' << a;
+    QTest::newRow("upper case") << a.toUpper() << a;
+    QTest::newRow("sha256sum") << a + "  file.iso\n" << a;
+    QTest::newRow("binary") << a + " *file.iso\n" << a;
+    QTest::newRow("several") << a + "  other.iso\n" + b + "  file.iso\n" << b;
+    QTest::newRow("not listed") << a + "  other.iso\n" + b + "  another.iso\n" << QByteArray();
+    QTest::newRow("md5") << QByteArray(32, 'a') + "  file.iso" << QByteArray();
+    QTest::newRow("html") << QByteArray("<html><body>Not Found</body></html>") << QByteArray();
+}
+
+// public static QByteArray parseChecksumFile(QByteArray const &contents, QString const &fileName)
+void tst_DownloadChecksum::parseChecksumFile()
+{
+    QFETCH(QByteArray, contents);
+    QFETCH(QByteArray, digest);
+    QCOMPARE(DownloadChecksum::parseChecksumFile(contents, QLatin1String("file.iso")), digest);
+}
+
+void tst_DownloadChecksum::writer()
+{
+    QByteArray data;
+    for (int i = 0; i < 100000; ++i)
+        data += char(i % 251);
+
+    // The second half is written first like a later segment would
+    DownloadWriter writer;
+    QSignalSpy spy(&writer, SIGNAL(closed()));
+    writer.open(m_fileName, QIODevice::ReadWrite, data.size());
+    writer.write(50000, data.mid(50000));
+    writer.write(0, data.left(50000));
+    writer.close(true);
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(writer.checksum(DownloadChecksum::Sha256), DownloadChecksum::hash(data, DownloadChecksum::Sha256));
+    QCOMPARE(writer.checksum(DownloadChecksum::Md5), DownloadChecksum::hash(data, DownloadChecksum::Md5));
+
+    // Without close(true) nothing is read back
+    writer.open(m_fileName, QIODevice::WriteOnly, data.size());
+    writer.write(0, data);
+    writer.close();
+    QTRY_COMPARE(spy.count(), 2);
+    QCOMPARE(writer.checksum(DownloadChecksum::Sha256), QByteArray());
+}
+
+QTEST_MAIN(tst_DownloadChecksum)
+#include "tst_downloadchecksum.moc"
@@ -0,0 +1,259 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <QtTest/QtTest>
+
+#include <downloadjournal.h>
+
+class tst_DownloadJournal : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void downloadJournal();
+    void addEntry();
+    void setEntry();
+    void removeEntry();
+    void lazyLoad();
+    void truncatedRecord();
+    void compact();
+    void clear();
+
+private:
+    QString m_fileName;
+};
+
+static DownloadJournal::Entry makeEntry(int i)
+{
+    DownloadJournal::Entry entry;
+    entry.url = QUrl(QString(QLatin1String("http://%1.com/file.iso")).arg(i));
+    entry.fileName = QString(QLatin1String("/tmp/file-%1.iso")).arg(i);
+    entry.bytesReceived = 1000 * i;
+    entry.bytesTotal = 100000;
+    entry.entityTag = "\"abc\"";
+    entry.lastModified = "Mon, 05 Oct 2009 10:00:00 GMT";
+    entry.acceptRanges = true;
+    DownloadJournal::Segment segment;
+    segment.start = 0;
+    segment.position = 1000 * i;
+    segment.end = 99999;
+    entry.segments.append(segment);
+    return entry;
+}
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_DownloadJournal::initTestCase()
+{
+    m_fileName = QDir::tempPath() + QLatin1String("/tst_downloadjournal.dat");
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_DownloadJournal::cleanupTestCase()
+{
+}
+
+// This will be called before each test function is executed.
+void tst_DownloadJournal::init()
+{
+    QFile::remove(m_fileName);
+    QFile::remove(m_fileName + QLatin1String(".new"));
+}
+
+// This will be called after every test function.
+void tst_DownloadJournal::cleanup()
+{
+    QFile::remove(m_fileName);
+    QFile::remove(m_fileName + QLatin1String(".new"));
+}
+
+void tst_DownloadJournal::downloadJournal()
+{
+    DownloadJournal journal;
+    QCOMPARE(journal.fileName(), QString());
+    QCOMPARE(journal.isLoaded(), false);
+    QCOMPARE(journal.entries(), QList<int>());
+    QCOMPARE(journal.isLoaded(), true);
+    QCOMPARE(journal.entry(1).url, QUrl());
+    QCOMPARE(journal.flush(), false);
+}
+
+void tst_DownloadJournal::addEntry()
+{
+    {
+        DownloadJournal journal;
+        journal.setFileName(m_fileName);
+        QCOMPARE(journal.exists(), false);
+        int first = journal.addEntry(makeEntry(1));
+        int second = journal.addEntry(makeEntry(2));
+        QVERIFY(first != second);
+        QCOMPARE(journal.entries(), QList<int>() << first << second);
+        QVERIFY(journal.flush());
+        QCOMPARE(journal.exists(), true);
+    }
+
+    DownloadJournal journal;
+    journal.setFileName(m_fileName);
+    QList<int> ids = journal.entries();
+    QCOMPARE(ids.count(), 2);
+    DownloadJournal::Entry entry = journal.entry(ids.at(1));
+    DownloadJournal::Entry expected = makeEntry(2);
+    QCOMPARE(entry.url, expected.url);
+    QCOMPARE(entry.fileName, expected.fileName);
+    QCOMPARE(entry.done, false);
+    QCOMPARE(entry.bytesReceived, expected.bytesReceived);
+    QCOMPARE(entry.bytesTotal, expected.bytesTotal);
+    QCOMPARE(entry.entityTag, expected.entityTag);
+    QCOMPARE(entry.lastModified, expected.lastModified);
+    QCOMPARE(entry.acceptRanges, true);
+    QCOMPARE(entry.segments.count(), 1);
+    QCOMPARE(entry.segments.at(0).position, qint64(2000));
+    QCOMPARE(entry.segments.at(0).end, qint64(99999));
+
+    // ids are not reused
+    int third = journal.addEntry(makeEntry(3));
+    QVERIFY(!ids.contains(third));
+}
+
+void tst_DownloadJournal::setEntry()
+{
+    DownloadJournal journal;
+    journal.setFileName(m_fileName);
+    int id = journal.addEntry(makeEntry(1));
+    QVERIFY(journal.flush());
+    qint64 size = QFileInfo(m_fileName).size();
+
+    // nothing is written for an entry that didn't change
+    journal.setEntry(id, makeEntry(1));
+    QVERIFY(journal.flush());
+    QCOMPARE(QFileInfo(m_fileName).size(), size);
+
+    DownloadJournal::Entry entry = makeEntry(1);
+    entry.done = true;
+    journal.setEntry(id, entry);
+    QVERIFY(journal.flush());
+    QVERIFY(QFileInfo(m_fileName).size() > size);
+
+    DownloadJournal other;
+    other.setFileName(m_fileName);
+    QCOMPARE(other.entries().count(), 1);
+    QCOMPARE(other.entry(id).done, true);
+}
+
+void tst_DownloadJournal::removeEntry()
+{
+    {
+        DownloadJournal journal;
+        journal.setFileName(m_fileName);
+        int first = journal.addEntry(makeEntry(1));
+        int second = journal.addEntry(makeEntry(2));
+        journal.removeEntry(first);
+        journal.removeEntry(12345);
+        QCOMPARE(journal.entries(), QList<int>() << second);
+    }
+
+    DownloadJournal journal;
+    journal.setFileName(m_fileName);
+    QCOMPARE(journal.entries().count(), 1);
+    QCOMPARE(journal.entry(journal.entries().first()).url, makeEntry(2).url);
+}
+
+void tst_DownloadJournal::lazyLoad()
+{
+    {
+        DownloadJournal journal;
+        journal.setFileName(m_fileName);
+        journal.addEntry(makeEntry(1));
+    }
+
+    DownloadJournal journal;
+    journal.setFileName(m_fileName);
+    QCOMPARE(journal.isLoaded(), false);
+    // nothing to write before it was read
+    QCOMPARE(journal.flush(), false);
+    QCOMPARE(journal.entries().count(), 1);
+    QCOMPARE(journal.isLoaded(), true);
+}
+
+void tst_DownloadJournal::truncatedRecord()
+{
+    {
+        DownloadJournal journal;
+        journal.setFileName(m_fileName);
+        journal.addEntry(makeEntry(1));
+        journal.addEntry(makeEntry(2));
+    }
+
+    QFile file(m_fileName);
+    QVERIFY(file.open(QFile::ReadWrite));
+    QVERIFY(file.resize(file.size() - 10));
+    file.close();
+
+    DownloadJournal journal;
+    journal.setFileName(m_fileName);
+    QCOMPARE(journal.entries().count(), 1);
+    // the broken record is dropped from the file
+    QVERIFY(journal.flush());
+    DownloadJournal other;
+    other.setFileName(m_fileName);
+    QCOMPARE(other.entries().count(), 1);
+}
+
+void tst_DownloadJournal::compact()
+{
+    DownloadJournal journal;
+    journal.setFileName(m_fileName);
+    int id = journal.addEntry(makeEntry(0));
+    QVERIFY(journal.flush());
+    qint64 size = QFileInfo(m_fileName).size();
+    for (int i = 1; i < 1000; ++i) {
+        journal.setEntry(id, makeEntry(i));
+        QVERIFY(journal.flush());
+    }
+    QVERIFY(QFileInfo(m_fileName).size() < size * 300);
+
+    DownloadJournal other;
+    other.setFileName(m_fileName);
+    QCOMPARE(other.entries(), QList<int>() << id);
+    QCOMPARE(other.entry(id).bytesReceived, qint64(999000));
+}
+
+void tst_DownloadJournal::clear()
+{
+    DownloadJournal journal;
+    journal.setFileName(m_fileName);
+    journal.addEntry(makeEntry(1));
+    QVERIFY(journal.flush());
+    QVERIFY(journal.exists());
+
+    journal.clear();
+    QCOMPARE(journal.entries(), QList<int>());
+    QVERIFY(journal.flush());
+    QVERIFY(!journal.exists());
+}
+
+QTEST_MAIN(tst_DownloadJournal)
+#include "tst_downloadjournal.moc"
@@ -20,12 +20,136 @@
 #include <QtTest/QtTest>
 #include <QtNetwork/QtNetwork>
 #include <QtGui/QtGui>
+#include "bandwidthgraph.h"
+#include "browserapplication.h"
 #include "downloadmanager.h"
+#include "qtry.h"
 
 #define BIGFILE "http://10.0.0.3/~ben/distccKNOPPIX-1.3-2004-08-20-gcc-3.3.iso"
 #define BIGFILENAME "distccKNOPPIX-1.3-2004-08-20-gcc-3.3.iso"
 #define BIGFILENAME2 "distccKNOPPIX-1.3-2004-08-20-gcc-3.3-1.iso"
 
+#define RANGEFILENAME "tst_downloadmanager.bin"
+#define RANGEFILENAME2 "tst_downloadmanager-1.bin"
+#define RANGEETAG "\"arora\""
+
+/*
+    Serves one file over HTTP from the local host and answers Range
+    requests like a server that supports resuming.
+ */
+class RangeServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    RangeServer(const QByteArray &body, QObject *parent = 0)
+        : QTcpServer(parent)
+        , dropAfter(-1)
+        , m_body(body)
+    {
+        listen(QHostAddress::LocalHost);
+    }
+
+    QUrl url() const
+    {
+        return QUrl(QString(QLatin1String("http://127.0.0.1:%1/" RANGEFILENAME)).arg(serverPort()));
+    }
+
+    // The Range and If-Range headers of every request for the file
+    QList<QByteArray> ranges;
+    QList<QByteArray> ifRanges;
+
+    // The next response is cut off after this many bytes of the body
+    qint64 dropAfter;
+
+protected:
+    void incomingConnection(int socketDescriptor)
+    {
+        QTcpSocket *socket = new QTcpSocket(this);
+        socket->setSocketDescriptor(socketDescriptor);
+        connect(socket, SIGNAL(readyRead()), this, SLOT(readRequest()));
+        connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+    }
+
+private slots:
+    void readRequest()
+    {
+        QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+        QByteArray request = socket->property("request").toByteArray() + socket->readAll();
+        int headerEnd = request.indexOf("\r\n\r\n");
+        if (headerEnd == -1) {
+            socket->setProperty("request", request);
+            return;
+        }
+        disconnect(socket, SIGNAL(readyRead()), this, SLOT(readRequest()));
+
+        QList<QByteArray> lines = request.left(headerEnd).split('\n');
+        if (!lines.first().contains("/" RANGEFILENAME " ")) {
+            socket->write("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+            socket->disconnectFromHost();
+            return;
+        }
+        QByteArray range;
+        QByteArray ifRange;
+        for (int i = 1; i < lines.count(); ++i) {
+            int colon = lines.at(i).indexOf(':');
+            QByteArray name = lines.at(i).left(colon).trimmed().toLower();
+            QByteArray value = lines.at(i).mid(colon + 1).trimmed();
+            if (name == "range")
+                range = value;
+            else if (name == "if-range")
+                ifRange = value;
+        }
+        ranges.append(range);
+        ifRanges.append(ifRange);
+
+        qint64 start = 0;
+        qint64 end = m_body.size() - 1;
+        bool partial = range.startsWith("bytes=") && (ifRange.isEmpty() || ifRange == RANGEETAG);
+        if (partial) {
+            QList<QByteArray> bounds = range.mid(6).split('-');
+            start = bounds.value(0).toLongLong();
+            if (!bounds.value(1).isEmpty())
+                end = qMin(end, bounds.value(1).toLongLong());
+        }
+
+        QByteArray header = partial ? "HTTP/1.1 206 Partial Content\r\n" : "HTTP/1.1 200 OK\r\n";
+        header += "ETag: " RANGEETAG "\r\n";
+        header += "Accept-Ranges: bytes\r\n";
+        header += "Cache-Control: no-store\r\n";
+        header += "Connection: close\r\n";
+        header += "Content-Type: application/octet-stream\r\n";
+        header += "Content-Length: " + QByteArray::number(end - start + 1) + "\r\n";
+        if (partial) {
+            header += "Content-Range: bytes " + QByteArray::number(start) + '-' + QByteArray::number(end)
+                   + '/' + QByteArray::number(m_body.size()) + "\r\n";
+        }
+        header += "\r\n";
+        socket->write(header);
+
+        if (dropAfter >= 0) {
+            socket->write(m_body.mid(start, dropAfter));
+            dropAfter = -1;
+            // Give the client time to read what was sent before the connection breaks
+            QTimer::singleShot(500, socket, SLOT(deleteLater()));
+            return;
+        }
+        socket->write(m_body.mid(start, end - start + 1));
+        socket->disconnectFromHost();
+    }
+
+private:
+    QByteArray m_body;
+};
+
+static QByteArray makeBody(int size)
+{
+    QByteArray body(size, 0);
+    for (int i = 0; i < size; ++i)
+        body[i] = char(i % 251);
+    return body;
+}
+
 class tst_DownloadManager : public QObject
 {
     Q_OBJECT
@@ -45,6 +169,13 @@ private slots:
     void download();
     void removePolicy_data();
     void removePolicy();
+    void limits();
+    void queue();
+    void parseContentRange_data();
+    void parseContentRange();
+    void resume();
+    void segments();
+    void bandwidthGraph();
 };
 
 // Subclass that exposes the protected functions.
@@ -75,14 +206,19 @@ void tst_DownloadManager::init()
 {
     QSettings settings;
     settings.clear();
+    QFile::remove(BrowserApplication::dataFilePath(QLatin1String("downloads.dat")));
 
     QFile file(QDesktopServices::storageLocation(QDesktopServices::DesktopLocation) + '/' + BIGFILENAME);
     file.remove();
+    QFile::remove(QDesktopServices::storageLocation(QDesktopServices::DesktopLocation) + '/' + RANGEFILENAME);
+    QFile::remove(QDesktopServices::storageLocation(QDesktopServices::DesktopLocation) + '/' + RANGEFILENAME2);
 }
 
 // This will be called after every test function.
 void tst_DownloadManager::cleanup()
 {
+    QFile::remove(QDesktopServices::storageLocation(QDesktopServices::DesktopLocation) + '/' + RANGEFILENAME);
+    QFile::remove(QDesktopServices::storageLocation(QDesktopServices::DesktopLocation) + '/' + RANGEFILENAME2);
 }
 
 void tst_DownloadManager::downloadmanager_data()
@@ -240,12 +376,204 @@ void tst_DownloadManager::removePolicy()
     QFile file(QDesktopServices::storageLocation(QDesktopServices::DesktopLocation) + '/' + BIGFILENAME);
     file.remove();
 
+    // Earlier downloads are loaded once the manager is shown
     SubDownloadManager manager;
     QTableView *view = manager.findChild<QTableView*>();
     QVERIFY(view);
+    QCOMPARE(view->model()->rowCount(), 0);
+    manager.show();
     QCOMPARE(view->model()->rowCount(), removePolicy == DownloadManager::Never ? 1 : 0);
 }
 
+// public int maximumActiveDownloads() const, public qint64 maximumRate() const
+void tst_DownloadManager::limits()
+{
+    {
+        SubDownloadManager manager;
+        QCOMPARE(manager.maximumActiveDownloads(), 3);
+        QCOMPARE(manager.maximumRate(), qint64(0));
+        QCOMPARE(manager.runningDownloads(), 0);
+
+        manager.setMaximumActiveDownloads(0);
+        QCOMPARE(manager.maximumActiveDownloads(), 1);
+        manager.setMaximumRate(-1);
+        QCOMPARE(manager.maximumRate(), qint64(0));
+        manager.setMaximumActiveDownloads(5);
+        manager.setMaximumRate(64 * 1024);
+    }
+
+    // Kept for the next session
+    SubDownloadManager manager;
+    QCOMPARE(manager.maximumActiveDownloads(), 5);
+    QCOMPARE(manager.maximumRate(), qint64(64 * 1024));
+}
+
+void tst_DownloadManager::queue()
+{
+    QByteArray body = makeBody(64 * 1024);
+    RangeServer server(body);
+    QVERIFY(server.isListening());
+
+    SubDownloadManager manager;
+    manager.setMaximumActiveDownloads(1);
+    manager.download(server.url());
+    manager.download(server.url());
+    QList<DownloadItem*> items = manager.findChildren<DownloadItem*>();
+    QCOMPARE(items.count(), 2);
+    DownloadItem *running = items.at(0)->isQueued() ? items.at(1) : items.at(0);
+    DownloadItem *queued = items.at(0)->isQueued() ? items.at(0) : items.at(1);
+    QVERIFY(!running->isQueued());
+    QVERIFY(queued->isQueued());
+    QCOMPARE(manager.runningDownloads(), 1);
+
+    // The queued download doesn't hold a connection while the other one
+    // is slowed down
+    manager.setMaximumRate(16 * 1024);
+    QTRY_COMPARE(server.ranges.count(), 1);
+    QTest::qWait(500);
+    QVERIFY(!running->downloadedSuccessfully());
+    QVERIFY(queued->isQueued());
+    QVERIFY(!queued->m_reply);
+    QCOMPARE(server.ranges.count(), 1);
+
+    // and sends its request once it is started
+    manager.setMaximumRate(0);
+    QTRY_VERIFY(running->downloadedSuccessfully());
+    QTRY_VERIFY(queued->downloadedSuccessfully());
+    QCOMPARE(server.ranges.count(), 2);
+    QFile file(queued->m_output.fileName());
+    QVERIFY(file.open(QFile::ReadOnly));
+    QVERIFY(file.readAll() == body);
+}
+
+void tst_DownloadManager::parseContentRange_data()
+{
+    QTest::addColumn<QByteArray>("value");
+    QTest::addColumn<bool>("valid");
+    QTest::addColumn<qint64>("start");
+    QTest::addColumn<qint64>("end");
+    QTest::addColumn<qint64>("total");
+    QTest::newRow("null") << QByteArray() << false << qint64(0) << qint64(0) << qint64(0);
+    QTest::newRow("range") << QByteArray("bytes 100-199/1000") << true << qint64(100) << qint64(199) << qint64(1000);
+    QTest::newRow("unknown total") << QByteArray("bytes 0-9/*") << true << qint64(0) << qint64(9) << qint64(-1);
+    QTest::newRow("large") << QByteArray("bytes 4294967296-4294967395/8589934592") << true
+        << qint64(Q_INT64_C(4294967296)) << qint64(Q_INT64_C(4294967395)) << qint64(Q_INT64_C(8589934592));
+    QTest::newRow("unsatisfiable") << QByteArray("bytes */1000") << false << qint64(0) << qint64(0) << qint64(0);
+    QTest::newRow("past end") << QByteArray("bytes 0-1000/1000") << false << qint64(0) << qint64(0) << qint64(0);
+    QTest::newRow("reversed") << QByteArray("bytes 10-5/1000") << false << qint64(0) << qint64(0) << qint64(0);
+    QTest::newRow("other unit") << QByteArray("items 0-5/10") << false << qint64(0) << qint64(0) << qint64(0);
+}
+
+// public static bool parseContentRange(QByteArray const &value, qint64 *start, qint64 *end, qint64 *total)
+void tst_DownloadManager::parseContentRange()
+{
+    QFETCH(QByteArray, value);
+    QFETCH(bool, valid);
+    QFETCH(qint64, start);
+    QFETCH(qint64, end);
+    QFETCH(qint64, total);
+
+    qint64 parsedStart = 0;
+    qint64 parsedEnd = 0;
+    qint64 parsedTotal = 0;
+    QCOMPARE(DownloadItem::parseContentRange(value, &parsedStart, &parsedEnd, &parsedTotal), valid);
+    QCOMPARE(parsedStart, start);
+    QCOMPARE(parsedEnd, end);
+    QCOMPARE(parsedTotal, total);
+}
+
+void tst_DownloadManager::resume()
+{
+    QByteArray body = makeBody(256 * 1024);
+    RangeServer server(body);
+    QVERIFY(server.isListening());
+    server.dropAfter = 100 * 1024;
+
+    SubDownloadManager manager;
+    manager.download(server.url());
+    DownloadItem *item = manager.findChild<DownloadItem*>();
+    QVERIFY(item);
+
+    // The connection breaks part way through
+    QTRY_VERIFY(item->tryAgainButton->isEnabled() && item->stopButton->isHidden());
+    qint64 received = item->bytesReceived();
+    QVERIFY(received > 0);
+    QVERIFY(received < body.size());
+
+    // Only the rest is asked for, if the file didn't change
+    item->tryAgainButton->click();
+    QTRY_VERIFY(item->downloadedSuccessfully());
+    QCOMPARE(server.ranges.count(), 2);
+    QCOMPARE(server.ranges.at(0), QByteArray());
+    QCOMPARE(server.ranges.at(1), "bytes=" + QByteArray::number(received) + '-');
+    QCOMPARE(server.ifRanges.at(1), QByteArray(RANGEETAG));
+    QCOMPARE(item->bytesReceived(), qint64(body.size()));
+
+    QFile file(item->m_output.fileName());
+    QVERIFY(file.open(QFile::ReadOnly));
+    QVERIFY(file.readAll() == body);
+}
+
+void tst_DownloadManager::segments()
+{
+    // More segments than connections to a host are not used
+    QSettings settings;
+    settings.setValue(QLatin1String("downloadmanager/segments"), 10);
+
+    QByteArray body = makeBody(8 * 1024 * 1024);
+    RangeServer server(body);
+    QVERIFY(server.isListening());
+
+    SubDownloadManager manager;
+    manager.download(server.url());
+    DownloadItem *item = manager.findChild<DownloadItem*>();
+    QVERIFY(item);
+    QTRY_VERIFY(item->downloadedSuccessfully());
+
+    // The request for the whole file is replaced by one per segment
+    QCOMPARE(server.ranges.count(), 7);
+    QCOMPARE(server.ranges.at(0), QByteArray());
+    QList<QByteArray> ranges = server.ranges.mid(1);
+    QList<QByteArray> expected;
+    qint64 size = body.size() / 6;
+    for (int i = 0; i < 6; ++i) {
+        qint64 end = (i == 5) ? body.size() - 1 : (i + 1) * size - 1;
+        expected.append("bytes=" + QByteArray::number(i * size) + '-' + QByteArray::number(end));
+        QCOMPARE(server.ifRanges.at(i + 1), QByteArray(RANGEETAG));
+    }
+    qSort(ranges);
+    qSort(expected);
+    QCOMPARE(ranges, expected);
+
+    QFile file(item->m_output.fileName());
+    QVERIFY(file.open(QFile::ReadOnly));
+    QCOMPARE(file.size(), qint64(body.size()));
+    QVERIFY(file.readAll() == body);
+}
+
+void tst_DownloadManager::bandwidthGraph()
+{
+    BandwidthGraph graph;
+    QCOMPARE(graph.samples(), QList<qint64>());
+    QCOMPARE(graph.peak(), qint64(0));
+
+    graph.setMaximumSamples(3);
+    QCOMPARE(graph.maximumSamples(), 3);
+    graph.addSample(10);
+    graph.addSample(-5);
+    graph.addSample(30);
+    graph.addSample(20);
+    QCOMPARE(graph.samples(), QList<qint64>() << 0 << 30 << 20);
+    QCOMPARE(graph.peak(), qint64(30));
+
+    graph.setMaximumSamples(1);
+    QCOMPARE(graph.maximumSamples(), 2);
+    QCOMPARE(graph.samples(), QList<qint64>() << 30 << 20);
+
+    graph.clear();
+    QCOMPARE(graph.samples(), QList<qint64>());
+}
+
 QTEST_MAIN(tst_DownloadManager)
 #include "tst_downloadmanager.moc"
 
@@ -0,0 +1,245 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <QtTest/QtTest>
+#include "qtry.h"
+
+#include <downloadwriter.h>
+
+class tst_DownloadWriter : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void downloadWriter();
+    void preallocate();
+    void ordering();
+    void reopen();
+    void written();
+    void backpressure();
+    void openError();
+
+private:
+    QByteArray readFile() const;
+
+    QString m_fileName;
+};
+
+static QByteArray makeData(int size)
+{
+    QByteArray data(size, 0);
+    for (int i = 0; i < size; ++i)
+        data[i] = char(i % 251);
+    return data;
+}
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_DownloadWriter::initTestCase()
+{
+    m_fileName = QDir::tempPath() + QLatin1String("/tst_downloadwriter.dat");
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_DownloadWriter::cleanupTestCase()
+{
+}
+
+// This will be called before each test function is executed.
+void tst_DownloadWriter::init()
+{
+    QFile::remove(m_fileName);
+}
+
+// This will be called after every test function.
+void tst_DownloadWriter::cleanup()
+{
+    QFile::remove(m_fileName);
+}
+
+QByteArray tst_DownloadWriter::readFile() const
+{
+    QFile file(m_fileName);
+    if (!file.open(QFile::ReadOnly))
+        return QByteArray();
+    return file.readAll();
+}
+
+void tst_DownloadWriter::downloadWriter()
+{
+    DownloadWriter writer;
+    QCOMPARE(writer.isOpen(), false);
+    QCOMPARE(writer.isBusy(), false);
+    QCOMPARE(writer.isFull(), false);
+    QCOMPARE(writer.queuedBytes(), qint64(0));
+    QCOMPARE(writer.maximumQueuedBytes(), qint64(4 * 1024 * 1024));
+    writer.setMaximumQueuedBytes(0);
+    QCOMPARE(writer.maximumQueuedBytes(), qint64(1));
+
+    // Nothing is queued while no file is open
+    QVERIFY(writer.write(0, "data"));
+    writer.resize(10);
+    writer.close();
+    QCOMPARE(writer.queuedBytes(), qint64(0));
+    QCOMPARE(writer.isBusy(), false);
+    QVERIFY(!QFile::exists(m_fileName));
+}
+
+void tst_DownloadWriter::preallocate()
+{
+    DownloadWriter writer;
+    QSignalSpy spy(&writer, SIGNAL(closed()));
+    writer.open(m_fileName, QIODevice::WriteOnly, 100000);
+    QCOMPARE(writer.isOpen(), true);
+    writer.close();
+    QCOMPARE(writer.isOpen(), false);
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(writer.isBusy(), false);
+    QCOMPARE(QFileInfo(m_fileName).size(), qint64(100000));
+}
+
+void tst_DownloadWriter::ordering()
+{
+    QByteArray data = makeData(300000);
+
+    // Segments arrive interleaved and out of order
+    DownloadWriter writer;
+    QSignalSpy spy(&writer, SIGNAL(closed()));
+    writer.open(m_fileName, QIODevice::ReadWrite, data.size());
+    for (int i = 0; i < 10; ++i) {
+        writer.write(200000 + i * 10000, data.mid(200000 + i * 10000, 10000));
+        writer.write(i * 10000, data.mid(i * 10000, 10000));
+        writer.write(100000 + i * 10000, data.mid(100000 + i * 10000, 10000));
+    }
+    writer.close(true);
+    QTRY_COMPARE(spy.count(), 1);
+    QVERIFY(readFile() == data);
+    QCOMPARE(writer.checksum(DownloadChecksum::Sha256), DownloadChecksum::hash(data, DownloadChecksum::Sha256));
+
+    // A resize is done between the writes that were queued around it
+    writer.open(m_fileName, QIODevice::ReadWrite);
+    writer.write(0, "start");
+    writer.resize(0);
+    writer.write(0, "over");
+    writer.close();
+    QTRY_COMPARE(spy.count(), 2);
+    QCOMPARE(readFile(), QByteArray("over"));
+}
+
+void tst_DownloadWriter::reopen()
+{
+    QByteArray data = makeData(200000);
+
+    // Opening again doesn't wait for the first file to be closed
+    DownloadWriter writer;
+    QSignalSpy spy(&writer, SIGNAL(closed()));
+    writer.open(m_fileName, QIODevice::WriteOnly, data.size());
+    writer.write(0, data.left(100000));
+    writer.close();
+    writer.open(m_fileName, QIODevice::ReadWrite, data.size());
+    QCOMPARE(writer.isOpen(), true);
+    writer.write(100000, data.mid(100000));
+    writer.close(true);
+    QTRY_COMPARE(spy.count(), 2);
+    QCOMPARE(writer.isBusy(), false);
+    QVERIFY(readFile() == data);
+
+    // The digests carry on from the first file
+    QCOMPARE(writer.checksum(DownloadChecksum::Sha256), DownloadChecksum::hash(data, DownloadChecksum::Sha256));
+    QCOMPARE(writer.checksum(DownloadChecksum::Md5), DownloadChecksum::hash(data, DownloadChecksum::Md5));
+}
+
+void tst_DownloadWriter::written()
+{
+    DownloadWriter writer;
+    QSignalSpy spy(&writer, SIGNAL(written(int, qint64)));
+    writer.open(m_fileName, QIODevice::WriteOnly);
+    writer.write(100, "abc", 2);
+    writer.write(0, "0123456789", 1);
+    writer.write(10, "abcdefghij", 1);
+    writer.close();
+    QTRY_COMPARE(spy.count(), 3);
+
+    // Each write is reported with its tag and where it ended, in order
+    QCOMPARE(spy.at(0).at(0).toInt(), 2);
+    QCOMPARE(spy.at(0).at(1).toLongLong(), qint64(103));
+    QCOMPARE(spy.at(1).at(0).toInt(), 1);
+    QCOMPARE(spy.at(1).at(1).toLongLong(), qint64(10));
+    QCOMPARE(spy.at(2).at(0).toInt(), 1);
+    QCOMPARE(spy.at(2).at(1).toLongLong(), qint64(20));
+    QCOMPARE(QFileInfo(m_fileName).size(), qint64(103));
+}
+
+void tst_DownloadWriter::backpressure()
+{
+    QByteArray data = makeData(64 * 1024);
+
+    DownloadWriter writer;
+    writer.setMaximumQueuedBytes(128 * 1024);
+    QSignalSpy drainedSpy(&writer, SIGNAL(drained()));
+    QSignalSpy closedSpy(&writer, SIGNAL(closed()));
+    writer.open(m_fileName, QIODevice::WriteOnly);
+
+    // The queue is full once it holds the maximum
+    bool full = false;
+    int writes = 0;
+    while (!full && writes < 1000) {
+        full = !writer.write(writes * data.size(), data);
+        ++writes;
+    }
+    QVERIFY(full);
+
+    // and drained once the thread has written half of it
+    QTRY_VERIFY(drainedSpy.count() > 0);
+    QTRY_COMPARE(writer.queuedBytes(), qint64(0));
+    QCOMPARE(writer.isFull(), false);
+
+    writer.close();
+    QTRY_COMPARE(closedSpy.count(), 1);
+    QCOMPARE(QFileInfo(m_fileName).size(), qint64(writes * data.size()));
+}
+
+void tst_DownloadWriter::openError()
+{
+    DownloadWriter writer;
+    QSignalSpy errorSpy(&writer, SIGNAL(error(const QString &)));
+    QSignalSpy closedSpy(&writer, SIGNAL(closed()));
+    writer.open(QDir::tempPath() + QLatin1String("/tst_downloadwriter/missing/file.dat"), QIODevice::WriteOnly);
+    QTRY_COMPARE(errorSpy.count(), 1);
+    QTRY_COMPARE(closedSpy.count(), 1);
+    QCOMPARE(writer.isOpen(), false);
+    QVERIFY(!writer.errorString().isEmpty());
+
+    // What is written to the failed file is dropped
+    writer.write(0, "data");
+    writer.close();
+    QTRY_COMPARE(writer.isBusy(), false);
+    QCOMPARE(writer.queuedBytes(), qint64(0));
+    QCOMPARE(closedSpy.count(), 1);
+}
+
+QTEST_MAIN(tst_DownloadWriter)
+#include "tst_downloadwriter.moc"
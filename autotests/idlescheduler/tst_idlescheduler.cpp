@@ -0,0 +1,184 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <QtTest/QtTest>
+#include "qtry.h"
+
+#include <idlescheduler.h>
+
+class tst_IdleScheduler : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void idleScheduler();
+    void priority();
+    void dependencies();
+    void circularDependencies();
+    void deletedReceiver();
+    void addTaskWhenStarted();
+};
+
+class TaskRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    QStringList calls;
+
+public slots:
+    void a() { calls.append(QLatin1String("a")); }
+    void b() { calls.append(QLatin1String("b")); }
+    void c() { calls.append(QLatin1String("c")); }
+};
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_IdleScheduler::initTestCase()
+{
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_IdleScheduler::cleanupTestCase()
+{
+}
+
+// This will be called before each test function is executed.
+void tst_IdleScheduler::init()
+{
+}
+
+// This will be called after every test function.
+void tst_IdleScheduler::cleanup()
+{
+}
+
+void tst_IdleScheduler::idleScheduler()
+{
+    IdleScheduler scheduler;
+    QCOMPARE(scheduler.count(), 0);
+    QCOMPARE(scheduler.isStarted(), false);
+    QVERIFY(scheduler.timeSlice() > 0);
+    scheduler.setTimeSlice(-1);
+    QCOMPARE(scheduler.timeSlice(), 0);
+
+    TaskRecorder recorder;
+    scheduler.addTask(QLatin1String("a"), &recorder, "a");
+    QCOMPARE(scheduler.count(), 1);
+    QVERIFY(scheduler.isPending(QLatin1String("a")));
+    QVERIFY(!scheduler.isPending(QLatin1String("b")));
+
+    // Nothing runs before the scheduler is started
+    QTest::qWait(50);
+    QVERIFY(recorder.calls.isEmpty());
+
+    QSignalSpy spy(&scheduler, SIGNAL(finished()));
+    scheduler.start();
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(recorder.calls, QStringList() << QLatin1String("a"));
+    QCOMPARE(scheduler.count(), 0);
+}
+
+void tst_IdleScheduler::priority()
+{
+    IdleScheduler scheduler;
+    TaskRecorder recorder;
+    scheduler.addTask(QLatin1String("c"), &recorder, "c", IdleScheduler::LowPriority);
+    scheduler.addTask(QLatin1String("b"), &recorder, "b", IdleScheduler::NormalPriority);
+    scheduler.addTask(QLatin1String("a"), &recorder, "a", IdleScheduler::HighPriority);
+
+    QSignalSpy spy(&scheduler, SIGNAL(finished()));
+    scheduler.start();
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(recorder.calls, QStringList() << QLatin1String("a")
+                                           << QLatin1String("b")
+                                           << QLatin1String("c"));
+}
+
+void tst_IdleScheduler::dependencies()
+{
+    IdleScheduler scheduler;
+    TaskRecorder recorder;
+    scheduler.addTask(QLatin1String("a"), &recorder, "a", IdleScheduler::HighPriority,
+                      QStringList() << QLatin1String("b"));
+    scheduler.addTask(QLatin1String("b"), &recorder, "b", IdleScheduler::LowPriority,
+                      QStringList() << QLatin1String("c") << QLatin1String("unknown"));
+    scheduler.addTask(QLatin1String("c"), &recorder, "c", IdleScheduler::LowPriority);
+
+    QSignalSpy spy(&scheduler, SIGNAL(finished()));
+    scheduler.start();
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(recorder.calls, QStringList() << QLatin1String("c")
+                                           << QLatin1String("b")
+                                           << QLatin1String("a"));
+}
+
+void tst_IdleScheduler::circularDependencies()
+{
+    IdleScheduler scheduler;
+    TaskRecorder recorder;
+    scheduler.addTask(QLatin1String("a"), &recorder, "a", IdleScheduler::NormalPriority,
+                      QStringList() << QLatin1String("b"));
+    scheduler.addTask(QLatin1String("b"), &recorder, "b", IdleScheduler::NormalPriority,
+                      QStringList() << QLatin1String("a"));
+
+    QSignalSpy spy(&scheduler, SIGNAL(finished()));
+    scheduler.start();
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(recorder.calls.count(), 2);
+}
+
+void tst_IdleScheduler::deletedReceiver()
+{
+    IdleScheduler scheduler;
+    TaskRecorder recorder;
+    TaskRecorder *deleted = new TaskRecorder;
+    scheduler.addTask(QLatin1String("a"), deleted, "a");
+    scheduler.addTask(QLatin1String("b"), &recorder, "b", IdleScheduler::NormalPriority,
+                      QStringList() << QLatin1String("a"));
+    delete deleted;
+
+    QSignalSpy spy(&scheduler, SIGNAL(finished()));
+    scheduler.start();
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(recorder.calls, QStringList() << QLatin1String("b"));
+}
+
+void tst_IdleScheduler::addTaskWhenStarted()
+{
+    IdleScheduler scheduler;
+    TaskRecorder recorder;
+    QSignalSpy spy(&scheduler, SIGNAL(finished()));
+    scheduler.start();
+    QVERIFY(scheduler.isStarted());
+
+    scheduler.addTask(QString(), &recorder, "a");
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(recorder.calls, QStringList() << QLatin1String("a"));
+}
+
+QTEST_MAIN(tst_IdleScheduler)
+#include "tst_idlescheduler.moc"
@@ -0,0 +1,379 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include <QtTest/QtTest>
+#include <networkcookiejar.h>
+#include <trie_p.h>
+
+class tst_NetworkCookieJar : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void trie_insert_data();
+    void trie_insert();
+    void trie_remove();
+    void trie_findDomain_data();
+    void trie_findDomain();
+    void trie_stream();
+    void trie_labels();
+
+    void cookiesForUrl_data();
+    void cookiesForUrl();
+    void cookiesForUrl_cache();
+    void cookiesForUrl_benchmark_data();
+    void cookiesForUrl_benchmark();
+};
+
+// Subclass that exposes the protected functions.
+class SubNetworkCookieJar : public NetworkCookieJar
+{
+public:
+    QList<QNetworkCookie> call_allCookies() const
+        { return SubNetworkCookieJar::allCookies(); }
+
+    void call_setAllCookies(const QList<QNetworkCookie> &cookieList)
+        { SubNetworkCookieJar::setAllCookies(cookieList); }
+};
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_NetworkCookieJar::initTestCase()
+{
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_NetworkCookieJar::cleanupTestCase()
+{
+}
+
+// This will be called before each test function is executed.
+void tst_NetworkCookieJar::init()
+{
+}
+
+// This will be called after every test function.
+void tst_NetworkCookieJar::cleanup()
+{
+}
+
+static QStringList key(const QString &domain)
+{
+    return domain.split(QLatin1Char('.'), QString::SkipEmptyParts);
+}
+
+void tst_NetworkCookieJar::trie_insert_data()
+{
+    QTest::addColumn<QStringList>("domains");
+    QTest::addColumn<QString>("lookup");
+    QTest::addColumn<int>("found");
+    QTest::newRow("empty") << QStringList() << "foo.com" << 0;
+    QTest::newRow("exact") << (QStringList() << "foo.com") << "foo.com" << 1;
+    QTest::newRow("twice") << (QStringList() << "foo.com" << "foo.com") << "foo.com" << 2;
+    QTest::newRow("parent") << (QStringList() << "foo.com") << "com" << 0;
+    QTest::newRow("child") << (QStringList() << "foo.com") << "www.foo.com" << 0;
+    QTest::newRow("sibling") << (QStringList() << "a.foo.com" << "b.foo.com") << "b.foo.com" << 1;
+    QTest::newRow("shared label") << (QStringList() << "foo.foo.com" << "foo.com") << "foo.foo.com" << 1;
+}
+
+// public void insert(QStringList const &key, T const &value)
+void tst_NetworkCookieJar::trie_insert()
+{
+    QFETCH(QStringList, domains);
+    QFETCH(QString, lookup);
+    QFETCH(int, found);
+
+    Trie<int> trie;
+    QVERIFY(trie.isEmpty());
+    for (int i = 0; i < domains.count(); ++i)
+        trie.insert(key(domains.at(i)), i);
+    QCOMPARE(trie.isEmpty(), domains.isEmpty());
+    QCOMPARE(trie.find(key(lookup)).count(), found);
+    QCOMPARE(trie.all().count(), domains.count());
+}
+
+// public bool remove(QStringList const &key, T const &value)
+void tst_NetworkCookieJar::trie_remove()
+{
+    Trie<int> trie;
+    trie.insert(key("www.foo.com"), 1);
+    trie.insert(key("foo.com"), 2);
+    QVERIFY(!trie.remove(key("www.foo.com"), 2));
+    QVERIFY(!trie.remove(key("bar.com"), 1));
+
+    QVERIFY(trie.remove(key("www.foo.com"), 1));
+    QVERIFY(!trie.contains(key("www.foo.com")));
+    QVERIFY(trie.contains(key("foo.com")));
+
+    QVERIFY(trie.remove(key("foo.com"), 2));
+    QVERIFY(trie.isEmpty());
+    QVERIFY(trie.all().isEmpty());
+
+    // Nodes that were released are reused
+    trie.insert(key("bar.org"), 3);
+    QCOMPARE(trie.find(key("bar.org")), QList<int>() << 3);
+}
+
+typedef QList<int> IntList;
+Q_DECLARE_METATYPE(IntList)
+void tst_NetworkCookieJar::trie_findDomain_data()
+{
+    QTest::addColumn<QString>("domain");
+    QTest::addColumn<int>("minimumDepth");
+    QTest::addColumn<IntList>("found");
+    QTest::newRow("null") << QString() << 1 << QList<int>();
+    QTest::newRow("all") << "a.www.foo.com" << 1 << (QList<int>() << 1 << 2 << 3);
+    QTest::newRow("second level") << "a.www.foo.com" << 2 << (QList<int>() << 2 << 3);
+    QTest::newRow("too deep") << "www.foo.com" << 5 << (QList<int>() << 3);
+    QTest::newRow("dots") << ".www.foo.com." << 2 << (QList<int>() << 2 << 3);
+    QTest::newRow("unknown") << "bar.com" << 1 << (QList<int>() << 1);
+    QTest::newRow("unknown label") << "zzz" << 1 << QList<int>();
+}
+
+// public void findDomain(QString const &domain, QList<T> &result, int minimumDepth)
+void tst_NetworkCookieJar::trie_findDomain()
+{
+    QFETCH(QString, domain);
+    QFETCH(int, minimumDepth);
+    QFETCH(IntList, found);
+
+    Trie<int> trie;
+    trie.insert(key("com"), 1);
+    trie.insert(key("foo.com"), 2);
+    trie.insert(key("www.foo.com"), 3);
+    trie.insert(key("other.foo.com"), 4);
+
+    QList<int> result;
+    trie.findDomain(domain, result, minimumDepth);
+    QCOMPARE(result, found);
+}
+
+void tst_NetworkCookieJar::trie_stream()
+{
+    Trie<QString> trie;
+    trie.insert(key("foo.com"), QLatin1String("a"));
+    trie.insert(key("www.foo.com"), QLatin1String("b"));
+    trie.insert(key("bar.org"), QLatin1String("c"));
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out << trie;
+
+    Trie<QString> copy;
+    QDataStream in(&data, QIODevice::ReadOnly);
+    in >> copy;
+    QCOMPARE(copy.find(key("foo.com")), QStringList() << "a");
+    QCOMPARE(copy.find(key("www.foo.com")), QStringList() << "b");
+    QCOMPARE(copy.find(key("bar.org")), QStringList() << "c");
+    QCOMPARE(copy.all().count(), 3);
+}
+
+static int intern(TrieLabels &labels, const QString &label)
+{
+    return labels.intern(label.constData(), label.size());
+}
+
+static int find(const TrieLabels &labels, const QString &label)
+{
+    return labels.find(label.constData(), label.size());
+}
+
+// Labels are freed with the last node using them
+void tst_NetworkCookieJar::trie_labels()
+{
+    TrieLabels labels;
+    QCOMPARE(find(labels, QLatin1String("foo")), -1);
+    int foo = intern(labels, QLatin1String("foo"));
+    QCOMPARE(intern(labels, QLatin1String("foo")), foo);
+    int bar = intern(labels, QLatin1String("bar"));
+    QVERIFY(bar != foo);
+    QCOMPARE(labels.count(), 2);
+
+    labels.release(foo);
+    QCOMPARE(find(labels, QLatin1String("foo")), foo);
+    labels.release(foo);
+    QCOMPARE(labels.count(), 1);
+    QCOMPARE(find(labels, QLatin1String("foo")), -1);
+    QCOMPARE(find(labels, QLatin1String("bar")), bar);
+
+    // The id is handed out again
+    QCOMPARE(intern(labels, QLatin1String("baz")), foo);
+    QCOMPARE(labels.label(foo), QString(QLatin1String("baz")));
+
+    // Freed labels don't hide the ones stored after them
+    QList<int> ids;
+    for (int i = 0; i < 100; ++i)
+        ids.append(intern(labels, QString::number(i)));
+    for (int i = 0; i < 100; i += 2)
+        labels.release(ids.at(i));
+    QCOMPARE(labels.count(), 52);
+    for (int i = 0; i < 100; ++i)
+        QCOMPARE(find(labels, QString::number(i)), i % 2 ? ids.at(i) : -1);
+
+    // Buckets of freed labels are reclaimed when the table is rebuilt
+    for (int i = 0; i < 10000; ++i)
+        labels.release(intern(labels, QLatin1String("temporary")));
+    QCOMPARE(labels.count(), 52);
+    QCOMPARE(find(labels, QLatin1String("bar")), bar);
+}
+
+typedef QList<QNetworkCookie> CookieList;
+Q_DECLARE_METATYPE(CookieList)
+
+static QNetworkCookie cookie(const QString &domain, const QString &path = QLatin1String("/"))
+{
+    QNetworkCookie cookie("name", domain.toUtf8());
+    cookie.setDomain(domain);
+    cookie.setPath(path);
+    cookie.setExpirationDate(QDateTime::currentDateTime().addDays(1));
+    return cookie;
+}
+
+void tst_NetworkCookieJar::cookiesForUrl_data()
+{
+    QTest::addColumn<CookieList>("cookies");
+    QTest::addColumn<QUrl>("url");
+    QTest::addColumn<int>("found");
+
+    CookieList cookies;
+    cookies << cookie(QLatin1String("foo.com"))
+            << cookie(QLatin1String("www.foo.com"))
+            << cookie(QLatin1String("co.uk"))
+            << cookie(QLatin1String("bar.co.uk"))
+            << cookie(QLatin1String("www.bar.co.uk"))
+            << cookie(QLatin1String("foo.com"), QLatin1String("/path"));
+    QTest::newRow("null") << cookies << QUrl() << 0;
+    QTest::newRow("domain") << cookies << QUrl("http://foo.com/") << 1;
+    QTest::newRow("subdomain") << cookies << QUrl("http://www.foo.com/") << 2;
+    QTest::newRow("path") << cookies << QUrl("http://www.foo.com/path/file") << 3;
+    QTest::newRow("two level tld") << cookies << QUrl("http://www.bar.co.uk/") << 2;
+    QTest::newRow("trailing dot") << cookies << QUrl("http://www.foo.com./") << 2;
+    QTest::newRow("two level tld, trailing dot") << cookies << QUrl("http://www.bar.co.uk./") << 2;
+    QTest::newRow("unknown") << cookies << QUrl("http://bar.org/") << 0;
+}
+
+// public QList<QNetworkCookie> cookiesForUrl(QUrl const &url) const
+void tst_NetworkCookieJar::cookiesForUrl()
+{
+    QFETCH(CookieList, cookies);
+    QFETCH(QUrl, url);
+    QFETCH(int, found);
+
+    SubNetworkCookieJar jar;
+    jar.call_setAllCookies(cookies);
+    QCOMPARE(jar.cookiesForUrl(url).count(), found);
+}
+
+// Cached lookups must see cookies set and replaced afterwards
+void tst_NetworkCookieJar::cookiesForUrl_cache()
+{
+    SubNetworkCookieJar jar;
+    QUrl url(QLatin1String("http://www.foo.com/"));
+    QCOMPARE(jar.cookiesForUrl(url).count(), 0);
+
+    QList<QNetworkCookie> list;
+    list << cookie(QLatin1String(".foo.com"));
+    QVERIFY(jar.setCookiesFromUrl(list, url));
+    QCOMPARE(jar.cookiesForUrl(url).count(), 1);
+
+    QNetworkCookie secure = cookie(QLatin1String("www.foo.com"));
+    secure.setName("secure");
+    secure.setSecure(true);
+    list.clear();
+    list << secure;
+    QVERIFY(jar.setCookiesFromUrl(list, url));
+    QCOMPARE(jar.cookiesForUrl(url).count(), 1);
+    QCOMPARE(jar.cookiesForUrl(QUrl(QLatin1String("https://www.foo.com/"))).count(), 2);
+
+    QNetworkCookie expired = cookie(QLatin1String(".foo.com"));
+    expired.setExpirationDate(QDateTime::currentDateTime().addDays(-1));
+    list.clear();
+    list << expired;
+    QVERIFY(!jar.setCookiesFromUrl(list, url));
+    QCOMPARE(jar.cookiesForUrl(url).count(), 0);
+
+    jar.call_setAllCookies(QList<QNetworkCookie>());
+    QCOMPARE(jar.cookiesForUrl(QUrl(QLatin1String("https://www.foo.com/"))).count(), 0);
+}
+
+void tst_NetworkCookieJar::cookiesForUrl_benchmark_data()
+{
+    QTest::addColumn<int>("cookieCount");
+    QTest::addColumn<QUrl>("url");
+    QTest::addColumn<bool>("cached");
+    QTest::newRow("50k, hit") << 50000 << QUrl("http://www.site4242.com/index.html") << false;
+    QTest::newRow("50k, miss") << 50000 << QUrl("http://www.nosuchsite.com/index.html") << false;
+    QTest::newRow("50k, two level tld") << 50000 << QUrl("http://www.site4243.co.uk/index.html") << false;
+    QTest::newRow("50k, hit, cached") << 50000 << QUrl("http://www.site4242.com/index.html") << true;
+}
+
+void tst_NetworkCookieJar::cookiesForUrl_benchmark()
+{
+    QFETCH(int, cookieCount);
+    QFETCH(QUrl, url);
+    QFETCH(bool, cached);
+
+    // Ten cookies per site, half of them on the www subdomain
+    CookieList cookies;
+    for (int i = 0; i < cookieCount; ++i) {
+        int site = i / 10;
+        QString domain = QString(QLatin1String("site%1.%2"))
+            .arg(site).arg(site % 2 ? QLatin1String("co.uk") : QLatin1String("com"));
+        if (i % 2)
+            domain.prepend(QLatin1String("www."));
+        QNetworkCookie c(QString(QLatin1String("cookie%1")).arg(i).toUtf8(), "value");
+        c.setDomain(domain);
+        c.setPath(QLatin1String("/"));
+        c.setExpirationDate(QDateTime::currentDateTime().addDays(1));
+        cookies.append(c);
+    }
+
+    SubNetworkCookieJar jar;
+    jar.call_setAllCookies(cookies);
+    QCOMPARE(jar.call_allCookies().count(), cookieCount);
+
+    if (cached) {
+        QBENCHMARK {
+            jar.cookiesForUrl(url);
+        }
+        return;
+    }
+
+    // Every lookup is for a host that isn't among the last ones cached,
+    // so the tree is searched each time
+    QList<QUrl> urls;
+    for (int i = 0; i < 256; ++i) {
+        QUrl hostUrl = url;
+        hostUrl.setHost(QString(QLatin1String("host%1.")).arg(i) + url.host());
+        urls.append(hostUrl);
+    }
+    int i = 0;
+    QBENCHMARK {
+        jar.cookiesForUrl(urls.at(i++ % urls.count()));
+    }
+}
+
+QTEST_MAIN(tst_NetworkCookieJar)
+#include "tst_networkcookiejar.moc"
@@ -0,0 +1,207 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <QtTest/QtTest>
+
+#include <recentlyclosedstore.h>
+
+class tst_RecentlyClosedStore : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void recentlyClosedStore();
+    void addTab();
+    void spill();
+    void maximumCount();
+    void windows();
+    void privateBrowsing();
+    void clear();
+
+private:
+    QString m_fileName;
+};
+
+static QByteArray state(int i)
+{
+    return QByteArray(1000, 'a' + (i % 26)) + QByteArray::number(i);
+}
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_RecentlyClosedStore::initTestCase()
+{
+    m_fileName = QDir::tempPath() + QLatin1String("/tst_recentlyclosedstore.dat");
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_RecentlyClosedStore::cleanupTestCase()
+{
+}
+
+// This will be called before each test function is executed.
+void tst_RecentlyClosedStore::init()
+{
+    QFile::remove(m_fileName);
+}
+
+// This will be called after every test function.
+void tst_RecentlyClosedStore::cleanup()
+{
+    QFile::remove(m_fileName);
+}
+
+void tst_RecentlyClosedStore::recentlyClosedStore()
+{
+    RecentlyClosedStore store;
+    QCOMPARE(store.fileName(), QString());
+    QCOMPARE(store.count(RecentlyClosedStore::Tab), 0);
+    QCOMPARE(store.count(RecentlyClosedStore::Window), 0);
+    QCOMPARE(store.inMemoryCount(), 0);
+    QCOMPARE(store.memoryUsage(), 0);
+    QCOMPARE(store.isPrivate(), false);
+    QVERIFY(store.maximumInMemory() > 0);
+    QVERIFY(store.maximumCount() >= store.maximumInMemory());
+    QCOMPARE(store.take(RecentlyClosedStore::Tab), QByteArray());
+    QCOMPARE(store.url(RecentlyClosedStore::Tab, 0), QUrl());
+}
+
+void tst_RecentlyClosedStore::addTab()
+{
+    RecentlyClosedStore store;
+    QSignalSpy spy(&store, SIGNAL(changed()));
+    store.addTab(QUrl(QLatin1String("http://a.com/")), QLatin1String("a"), state(0));
+    store.addTab(QUrl(QLatin1String("http://b.com/")), QLatin1String("b"), state(1));
+    QCOMPARE(spy.count(), 2);
+    QCOMPARE(store.count(RecentlyClosedStore::Tab), 2);
+    QCOMPARE(store.memoryUsage(), state(0).size() + state(1).size());
+
+    // newest first
+    QCOMPARE(store.url(RecentlyClosedStore::Tab, 0), QUrl(QLatin1String("http://b.com/")));
+    QCOMPARE(store.title(RecentlyClosedStore::Tab, 1), QString(QLatin1String("a")));
+
+    QUrl url;
+    QCOMPARE(store.take(RecentlyClosedStore::Tab, 1, &url), state(0));
+    QCOMPARE(url, QUrl(QLatin1String("http://a.com/")));
+    QCOMPARE(store.take(RecentlyClosedStore::Tab), state(1));
+    QCOMPARE(store.count(RecentlyClosedStore::Tab), 0);
+    QCOMPARE(store.memoryUsage(), 0);
+    QCOMPARE(spy.count(), 4);
+}
+
+void tst_RecentlyClosedStore::spill()
+{
+    RecentlyClosedStore store;
+    store.setFileName(m_fileName);
+    store.setMaximumInMemory(3);
+
+    for (int i = 0; i < 10; ++i)
+        store.addTab(QUrl(QString(QLatin1String("http://%1.com/")).arg(i)), QString(), state(i));
+    QCOMPARE(store.count(RecentlyClosedStore::Tab), 10);
+    QCOMPARE(store.inMemoryCount(), 3);
+    QCOMPARE(store.memoryUsage(), state(9).size() + state(8).size() + state(7).size());
+    QVERIFY(QFile::exists(m_fileName));
+
+    // from memory and from the file
+    QCOMPARE(store.take(RecentlyClosedStore::Tab, 0), state(9));
+    QCOMPARE(store.take(RecentlyClosedStore::Tab, 5), state(3));
+    QCOMPARE(store.url(RecentlyClosedStore::Tab, 7), QUrl(QLatin1String("http://0.com/")));
+    QCOMPARE(store.take(RecentlyClosedStore::Tab, 7), state(0));
+
+    // limit by memory usage, the newest is always kept in memory
+    store.setMaximumMemoryUsage(0);
+    QCOMPARE(store.inMemoryCount(), 1);
+    QCOMPARE(store.memoryUsage(), state(8).size());
+
+    for (int i = 0; i < 7; ++i)
+        QVERIFY(!store.take(RecentlyClosedStore::Tab).isEmpty());
+    QCOMPARE(store.count(RecentlyClosedStore::Tab), 0);
+    QVERIFY(!QFile::exists(m_fileName));
+}
+
+void tst_RecentlyClosedStore::maximumCount()
+{
+    RecentlyClosedStore store;
+    store.setFileName(m_fileName);
+    store.setMaximumInMemory(2);
+    store.setMaximumCount(5);
+    for (int i = 0; i < 20; ++i)
+        store.addTab(QUrl(QString(QLatin1String("http://%1.com/")).arg(i)), QString(), state(i));
+    QCOMPARE(store.count(RecentlyClosedStore::Tab), 5);
+    QCOMPARE(store.inMemoryCount(), 2);
+    for (int i = 19; i >= 15; --i)
+        QCOMPARE(store.take(RecentlyClosedStore::Tab), state(i));
+
+    store.setMaximumCount(0);
+    QCOMPARE(store.maximumCount(), 1);
+}
+
+void tst_RecentlyClosedStore::windows()
+{
+    RecentlyClosedStore store;
+    store.addTab(QUrl(QLatin1String("http://a.com/")), QString(), state(0));
+    store.addWindow(QLatin1String("window"), state(1));
+    store.addTab(QUrl(QLatin1String("http://b.com/")), QString(), state(2));
+    QCOMPARE(store.count(RecentlyClosedStore::Tab), 2);
+    QCOMPARE(store.count(RecentlyClosedStore::Window), 1);
+    QCOMPARE(store.title(RecentlyClosedStore::Window, 0), QString(QLatin1String("window")));
+    QCOMPARE(store.take(RecentlyClosedStore::Window), state(1));
+    QCOMPARE(store.take(RecentlyClosedStore::Tab, 1), state(0));
+    QCOMPARE(store.count(RecentlyClosedStore::Window), 0);
+}
+
+void tst_RecentlyClosedStore::privateBrowsing()
+{
+    RecentlyClosedStore store;
+    store.setFileName(m_fileName);
+    store.setMaximumInMemory(2);
+    store.setPrivate(true);
+    for (int i = 0; i < 5; ++i)
+        store.addTab(QUrl(QString(QLatin1String("http://%1.com/")).arg(i)), QString(), state(i));
+    QCOMPARE(store.count(RecentlyClosedStore::Tab), 2);
+    QVERIFY(!QFile::exists(m_fileName));
+}
+
+void tst_RecentlyClosedStore::clear()
+{
+    RecentlyClosedStore store;
+    store.setFileName(m_fileName);
+    store.setMaximumInMemory(1);
+    store.addTab(QUrl(QLatin1String("http://a.com/")), QString(), state(0));
+    store.addWindow(QString(), state(1));
+    QVERIFY(QFile::exists(m_fileName));
+
+    QSignalSpy spy(&store, SIGNAL(changed()));
+    store.clear();
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(store.count(RecentlyClosedStore::Tab), 0);
+    QCOMPARE(store.count(RecentlyClosedStore::Window), 0);
+    QCOMPARE(store.memoryUsage(), 0);
+    QVERIFY(!QFile::exists(m_fileName));
+}
+
+QTEST_MAIN(tst_RecentlyClosedStore)
+#include "tst_recentlyclosedstore.moc"
@@ -0,0 +1,244 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <QtTest/QtTest>
+#include "qtest_arora.h"
+
+#include <browsermainwindow.h>
+#include <sessionjournal.h>
+#include <tabwidget.h>
+
+typedef QPair<QByteArray, QByteArray> WindowState;
+typedef QList<WindowState> Session;
+
+class tst_SessionJournal : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+private slots:
+    void sessionJournal();
+    void recordAndLoad();
+    void truncatedRecord();
+    void failedFlush();
+    void compact();
+
+private:
+    BrowserMainWindow *makeWindow(SessionJournal *journal);
+    QByteArray expectedTabs() const;
+    QString m_fileName;
+};
+
+// This will be called before the first test function is executed.
+// It is only called once.
+void tst_SessionJournal::initTestCase()
+{
+    m_fileName = QDir::tempPath() + QLatin1String("/tst_sessionjournal.dat");
+}
+
+// This will be called after the last test function is executed.
+// It is only called once.
+void tst_SessionJournal::cleanupTestCase()
+{
+}
+
+// This will be called before each test function is executed.
+void tst_SessionJournal::init()
+{
+    QDir().rmdir(m_fileName);
+    QFile::remove(m_fileName);
+    QFile::remove(m_fileName + QLatin1String(".new"));
+}
+
+// This will be called after every test function.
+void tst_SessionJournal::cleanup()
+{
+    QDir().rmdir(m_fileName);
+    QFile::remove(m_fileName);
+    QFile::remove(m_fileName + QLatin1String(".new"));
+}
+
+static QStringList urls()
+{
+    return QStringList() << QLatin1String("http://foo.com/")
+                         << QLatin1String("http://bar.com/")
+                         << QLatin1String("http://baz.com/");
+}
+
+static QStringList titles()
+{
+    return QStringList() << QLatin1String("Foo")
+                         << QLatin1String("Bar")
+                         << QLatin1String("Baz");
+}
+
+/*
+    A window recorded by journal with the three tabs above, the second one
+    current.  The tabs stay placeholders as long as no events are processed.
+ */
+BrowserMainWindow *tst_SessionJournal::makeWindow(SessionJournal *journal)
+{
+    BrowserMainWindow *window = new BrowserMainWindow;
+    journal->addWindow(window);
+    QList<QByteArray> historyStates;
+    for (int i = 0; i < urls().count(); ++i)
+        historyStates.append(QByteArray());
+    window->tabWidget()->restoreState(TabWidget::saveState(urls(), 1, historyStates, titles()));
+    journal->setWindowState(window, "window state");
+    return window;
+}
+
+QByteArray tst_SessionJournal::expectedTabs() const
+{
+    QList<QByteArray> historyStates;
+    for (int i = 0; i < urls().count(); ++i)
+        historyStates.append(QByteArray());
+    return TabWidget::saveState(urls(), 1, historyStates, titles());
+}
+
+void tst_SessionJournal::sessionJournal()
+{
+    SessionJournal journal;
+    QCOMPARE(journal.fileName(), QString());
+    QCOMPARE(journal.exists(), false);
+    QCOMPARE(journal.load(), Session());
+    QCOMPARE(journal.flush(), false);
+}
+
+void tst_SessionJournal::recordAndLoad()
+{
+    SessionJournal journal;
+    journal.setFileName(m_fileName);
+    BrowserMainWindow *window = makeWindow(&journal);
+    QVERIFY(journal.flush());
+    QVERIFY(journal.exists());
+
+    SessionJournal otherJournal;
+    otherJournal.setFileName(m_fileName);
+    Session session = otherJournal.load();
+    QCOMPARE(session.count(), 1);
+    QCOMPARE(session.at(0).first, QByteArray("window state"));
+    QCOMPARE(session.at(0).second, expectedTabs());
+
+    // Closing a tab only appends a record for it
+    qint64 size = QFileInfo(m_fileName).size();
+    window->tabWidget()->closeTab(2);
+    QVERIFY(journal.flush());
+    QVERIFY(QFileInfo(m_fileName).size() - size < 32);
+    session = otherJournal.load();
+    QCOMPARE(session.count(), 1);
+    QList<QByteArray> historyStates;
+    historyStates << QByteArray() << QByteArray();
+    QCOMPARE(session.at(0).second, TabWidget::saveState(urls().mid(0, 2), 1,
+                                                        historyStates, titles().mid(0, 2)));
+    delete window;
+}
+
+void tst_SessionJournal::truncatedRecord()
+{
+    {
+        SessionJournal journal;
+        journal.setFileName(m_fileName);
+        BrowserMainWindow *window = makeWindow(&journal);
+        QVERIFY(journal.flush());
+        delete window;
+    }
+    QFile file(m_fileName);
+    QVERIFY(file.open(QFile::WriteOnly | QFile::Append));
+    file.write("\0\0\1", 3);
+    file.close();
+    qint64 size = QFileInfo(m_fileName).size();
+
+    // The partial record is ignored
+    SessionJournal journal;
+    journal.setFileName(m_fileName);
+    Session session = journal.load();
+    QCOMPARE(session.count(), 1);
+    QCOMPARE(session.at(0).first, QByteArray("window state"));
+    QCOMPARE(session.at(0).second, expectedTabs());
+
+    // and the journal is rewritten on the next flush
+    QVERIFY(journal.flush());
+    QVERIFY(QFileInfo(m_fileName).size() < size);
+    SessionJournal otherJournal;
+    otherJournal.setFileName(m_fileName);
+    QCOMPARE(otherJournal.load(), session);
+}
+
+void tst_SessionJournal::failedFlush()
+{
+    SessionJournal journal;
+    journal.setFileName(m_fileName);
+    BrowserMainWindow *window = makeWindow(&journal);
+    QVERIFY(journal.flush());
+
+    // A directory in the way of the journal makes the append fail
+    QVERIFY(QFile::remove(m_fileName));
+    QVERIFY(QDir().mkdir(m_fileName));
+    journal.setWindowState(window, "failed state");
+    QVERIFY(!journal.flush());
+    QVERIFY(QDir().rmdir(m_fileName));
+
+    // The next flush writes the whole session and not only what failed
+    journal.setWindowState(window, "window state");
+    QVERIFY(journal.flush());
+    SessionJournal otherJournal;
+    otherJournal.setFileName(m_fileName);
+    Session session = otherJournal.load();
+    QCOMPARE(session.count(), 1);
+    QCOMPARE(session.at(0).first, QByteArray("window state"));
+    QCOMPARE(session.at(0).second, expectedTabs());
+    delete window;
+}
+
+void tst_SessionJournal::compact()
+{
+    SessionJournal journal;
+    journal.setFileName(m_fileName);
+    BrowserMainWindow *window = makeWindow(&journal);
+    QVERIFY(journal.flush());
+
+    SessionJournal otherJournal;
+    otherJournal.setFileName(m_fileName);
+    Session session = otherJournal.load();
+
+    int changes = 2000;
+    for (int i = 0; i < changes; ++i) {
+        journal.setWindowState(window, QByteArray::number(i));
+        QVERIFY(journal.flush());
+    }
+    journal.setWindowState(window, "window state");
+    QVERIFY(journal.flush());
+
+    // Without compacting there would be a record of at least 13 bytes for every change
+    QVERIFY(QFileInfo(m_fileName).size() < changes * 13);
+    QVERIFY(!QFile::exists(m_fileName + QLatin1String(".new")));
+
+    // The compacted journal replays to the same session
+    QCOMPARE(otherJournal.load(), session);
+    delete window;
+}
+
+QTEST_MAIN(tst_SessionJournal)
+#include "tst_sessionjournal.moc"
@@ -40,6 +40,7 @@ private slots:
 
     void tabSizeHint_data();
     void tabSizeHint();
+    void manyTabs();
 };
 
 // Subclass that exposes the protected functions.
@@ -171,6 +172,41 @@ void tst_TabBar::tabSizeHint()
     QVERIFY(bar.call_tabSizeHint(index).width() <= 250);
 }
 
+void tst_TabBar::manyTabs()
+{
+    SubTabBar bar;
+    bar.resize(400, bar.sizeHint().height());
+    bar.setManyTabsThreshold(10);
+    QCOMPARE(bar.manyTabsThreshold(), 10);
+    bar.addTab("short");
+    bar.addTab("a much longer title than the other tab has");
+    QVERIFY(!bar.hasManyTabs());
+    QVERIFY(bar.call_tabSizeHint(0).width() < bar.call_tabSizeHint(1).width());
+
+    for (int i = 0; i < 8; ++i)
+        bar.addTab(QString::number(i));
+    QVERIFY(bar.hasManyTabs());
+    QCOMPARE(bar.call_tabSizeHint(0), bar.call_tabSizeHint(1));
+
+    bar.show();
+    QCOMPARE(bar.firstVisibleTab(), 0);
+    QVERIFY(bar.lastVisibleTab() >= 0);
+    QVERIFY(bar.lastVisibleTab() < bar.count() - 1);
+    QVERIFY(bar.tabRect(bar.lastVisibleTab()).left() < bar.width());
+    bar.setCurrentIndex(bar.count() - 1);
+    QCOMPARE(bar.lastVisibleTab(), bar.count() - 1);
+    QVERIFY(bar.firstVisibleTab() > 0);
+    bar.repaint();
+
+    bar.removeTab(0);
+    QVERIFY(!bar.hasManyTabs());
+    QVERIFY(bar.call_tabSizeHint(0).width() > bar.call_tabSizeHint(1).width());
+
+    bar.setManyTabsThreshold(0);
+    QCOMPARE(bar.manyTabsThreshold(), 0);
+    QVERIFY(!bar.hasManyTabs());
+}
+
 QTEST_MAIN(tst_TabBar)
 #include "tst_tabbar.moc"
 
@@ -45,8 +45,6 @@ private slots:
     void currentLocationBar();
     void currentWebView_data();
     void currentWebView();
-    void locationBarStack_data();
-    void locationBarStack();
     void loadUrl_data();
     void loadUrl();
     void newTab_data();
@@ -69,6 +67,8 @@ private slots:
     void tabsChanged();
 
     void saveState();
+    void hibernateTab();
+    void sharedLocationBar();
 };
 
 // Subclass that exposes the protected functions.
@@ -124,7 +124,6 @@ void tst_TabWidget::tabwidget()
     widget.closeTab();
     QVERIFY(widget.closeTabAction());
     widget.currentWebView();
-    widget.locationBarStack();
     widget.loadUrl(QUrl());
     widget.newTab();
     QVERIFY(widget.newTabAction());
@@ -262,7 +261,7 @@ void tst_TabWidget::currentWebView_data()
     */
 }
 
-// public WebView *currentWebView() const
+// public WebView *currentWebView()
 void tst_TabWidget::currentWebView()
 {
     /*
@@ -289,42 +288,6 @@ void tst_TabWidget::currentWebView()
     QSKIP("Test is not implemented.", SkipAll);
 }
 
-Q_DECLARE_METATYPE(QWidget*)
-void tst_TabWidget::locationBarStack_data()
-{
-    /*
-    QTest::addColumn<QWidget*>("locationBarStack");
-    QTest::newRow("null") << QWidget*();
-    */
-}
-
-// public QWidget *locationBarStack() const
-void tst_TabWidget::locationBarStack()
-{
-    /*
-    QFETCH(QWidget*, locationBarStack);
-
-    SubTabWidget widget;
-
-    QSignalSpy spy0(&widget, SIGNAL(linkHovered(const QString &)));
-    QSignalSpy spy2(&widget, SIGNAL(loadProgress(int)));
-    QSignalSpy spy3(&widget, SIGNAL(setCurrentTitle(const QString &)));
-    QSignalSpy spy4(&widget, SIGNAL(showStatusBarMessage(const QString &)));
-    QSignalSpy spy5(&widget, SIGNAL(tabsChanged()));
-    QSignalSpy spy6(&widget, SIGNAL(lastTabClosed()));
-
-    QCOMPARE(widget.locationBarStack(), locationBarStack);
-
-    QCOMPARE(spy0.count(), 0);
-    QCOMPARE(spy2.count(), 0);
-    QCOMPARE(spy3.count(), 0);
-    QCOMPARE(spy4.count(), 0);
-    QCOMPARE(spy5.count(), 0);
-    QCOMPARE(spy6.count(), 0);
-    */
-    QSKIP("Test is not implemented.", SkipAll);
-}
-
 void tst_TabWidget::loadUrl_data()
 {
     QTest::addColumn<QUrl>("url");
@@ -672,6 +635,7 @@ void tst_TabWidget::saveState()
     QCOMPARE(widget.count(), 2);
     QCOMPARE(widget.webView(1)->url(), url);
 
+    widget.setCurrentIndex(1);
     QByteArray state = widget.saveState();
 
     widget.closeTab();
@@ -679,18 +643,85 @@ void tst_TabWidget::saveState()
     widget.closeTab();
     QCOMPARE(widget.count(), 0);
 
+    // only the tab that was current is loaded, it replaces the blank tab
     widget.newTab();
     widget.restoreState(state);
     QCOMPARE(widget.count(), 2);
-    QVERIFY(widget.webView(0));
+    QCOMPARE(widget.currentIndex(), 1);
+    QTRY_VERIFY(widget.webView(1));
+    QCOMPARE(widget.webView(1)->url(), url);
+
+    // background tabs are only created when they are shown
+    QVERIFY(!widget.webView(0));
+    widget.setCurrentIndex(0);
+    QTRY_VERIFY(widget.webView(0));
     QCOMPARE(widget.webView(0)->url(), url);
-    QVERIFY(widget.webView(1));
+
+    widget.closeTab();
+    widget.closeTab();
+}
+
+void tst_TabWidget::hibernateTab()
+{
+    SubTabWidget widget;
+    widget.newTab();
+    QUrl url = QUrl("data:text/html;base32,Hello%20World");
+    widget.loadUrl(url, TabWidget::CurrentTab);
+    widget.loadUrl(url, TabWidget::NewTab);
+    QCOMPARE(widget.count(), 2);
+    QCOMPARE(widget.hibernatedTabCount(), 0);
+
+    // the current tab is never hibernated
+    QVERIFY(!widget.hibernateTab(0));
+    QTRY_VERIFY(widget.hibernateTab(1));
+    QCOMPARE(widget.count(), 2);
+    QVERIFY(!widget.webView(1));
+    QCOMPARE(widget.hibernatedTabCount(), 1);
+    QCOMPARE(widget.hibernationCount(), 1);
+
+    widget.setCurrentIndex(1);
+    QTRY_VERIFY(widget.webView(1));
     QCOMPARE(widget.webView(1)->url(), url);
+    QCOMPARE(widget.hibernatedTabCount(), 0);
 
     widget.closeTab();
     widget.closeTab();
 }
 
+void tst_TabWidget::sharedLocationBar()
+{
+    SubTabWidget widget;
+    widget.newTab();
+    widget.newTab();
+    QCOMPARE(widget.count(), 2);
+    QLineEdit *locationBar = widget.currentLocationBar();
+    QVERIFY(locationBar);
+
+    // text typed in a tab is kept while another tab is current
+    widget.setCurrentIndex(0);
+    QCOMPARE(widget.currentLocationBar(), locationBar);
+    locationBar->setText(QLatin1String("typed"));
+    locationBar->setModified(true);
+    locationBar->setCursorPosition(2);
+    widget.setCurrentIndex(1);
+    QCOMPARE(widget.currentLocationBar(), locationBar);
+    QCOMPARE(locationBar->text(), QString());
+    QVERIFY(!locationBar->isModified());
+    widget.setCurrentIndex(0);
+    QCOMPARE(locationBar->text(), QString(QLatin1String("typed")));
+    QVERIFY(locationBar->isModified());
+    QCOMPARE(locationBar->cursorPosition(), 2);
+
+    // a background load sets the text of its tab only
+    QUrl url = QUrl("data:text/html;base32,Hello%20World");
+    widget.loadUrl(url, TabWidget::NewTab);
+    QCOMPARE(widget.currentIndex(), 0);
+    QCOMPARE(locationBar->text(), QString(QLatin1String("typed")));
+
+    widget.closeTab(2);
+    widget.closeTab(1);
+    widget.closeTab(0);
+}
 
 QTEST_MAIN(tst_TabWidget)
 #include "tst_tabwidget.moc"
@@ -54,6 +54,8 @@ private slots:
     void javaScriptObjects_data();
     void javaScriptObjects();
     void userAgent();
+    void resourceUsage();
+    void webPageForRequest();
 };
 
 // Subclass that exposes the protected functions.
@@ -74,6 +76,9 @@ public:
 
     QWebPage *call_createWindow(QWebPage::WebWindowType type)
         { return SubWebPage::createWindow(type); }
+
+    void call_populateNetworkRequest(QNetworkRequest &request)
+        { return SubWebPage::populateNetworkRequest(request); }
 };
 
 // This will be called before the first test function is executed.
@@ -390,6 +395,43 @@ void tst_WebPage::userAgent()
     QCOMPARE(customUserAgent, QString("ben"));
 }
 
+void tst_WebPage::resourceUsage()
+{
+    SubWebPage page;
+    WebPageResourceUsage usage = page.resourceUsage();
+    QCOMPARE(usage.requests, 0);
+    QCOMPARE(usage.blockedRequests, 0);
+    QCOMPARE(usage.bytesReceived, qint64(0));
+    QCOMPARE(usage.loads, 0);
+
+    page.addRequest(0);
+    page.addBlockedRequest();
+    usage = page.resourceUsage();
+    QCOMPARE(usage.requests, 1);
+    QCOMPARE(usage.blockedRequests, 1);
+
+    QSignalSpy spy(&page, SIGNAL(loadFinished(bool)));
+    page.mainFrame()->setHtml(QLatin1String("<html><body>resources</body></html>"));
+    QTRY_COMPARE(spy.count(), 1);
+    usage = page.resourceUsage();
+    QCOMPARE(usage.loads, 1);
+    QVERIFY(usage.totalLoadTime >= usage.lastLoadTime);
+    QVERIFY(usage.memoryUsage >= 0);
+}
+
+void tst_WebPage::webPageForRequest()
+{
+    QNetworkRequest request(QUrl("http://arora-browser.org/"));
+    QVERIFY(!WebPage::webPageForRequest(request));
+
+    SubWebPage *page = new SubWebPage;
+    page->call_populateNetworkRequest(request);
+    QCOMPARE(WebPage::webPageForRequest(request), static_cast<WebPage*>(page));
+
+    // A request can outlive the page that made it
+    delete page;
+    QVERIFY(!WebPage::webPageForRequest(request));
+}
 
 QTEST_MAIN(tst_WebPage)
 #include "tst_webpage.moc"
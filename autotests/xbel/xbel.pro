@@ -9,10 +9,12 @@ include(../autotests.pri)
 SOURCES = \
     tst_xbel.cpp \
     bookmarks/bookmarknode.cpp \
+    bookmarks/bookmarkstore.cpp \
     bookmarks/xbel/xbelreader.cpp \
     bookmarks/xbel/xbelwriter.cpp
 
 HEADERS = \
     bookmarks/bookmarknode.h \
+    bookmarks/bookmarkstore.h \
     bookmarks/xbel/xbelreader.h \
     bookmarks/xbel/xbelwriter.h
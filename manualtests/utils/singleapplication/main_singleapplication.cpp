@@ -29,7 +29,6 @@
 #include <qplaintextedit.h>
 #include <qdebug.h>
 #include <qlocalsocket.h>
-#include <qtextstream.h>
 
 #include <singleapplication.h>
 
@@ -41,11 +40,9 @@ public:
         : QPlainTextEdit(parent) { }
 
 public slots:
-    void messageReceived(QLocalSocket *socket) {
-        QString message;
-        QTextStream stream(socket);
-        stream >> message;
-        appendPlainText(message);
+    void messageReceived(const QByteArray &message, QLocalSocket *socket) {
+        Q_UNUSED(socket);
+        appendPlainText(QString::fromUtf8(message));
     }
 
 };
@@ -54,16 +51,18 @@ int main(int argc, char **argv)
 {
     SingleApplication app(argc, argv);
     app.setApplicationName("testapp");
-    if (app.arguments().count() > 1
-        && app.sendMessage(app.arguments().last().toUtf8()))
+    QList<QByteArray> messages;
+    for (int i = 1; i < app.arguments().count(); ++i)
+        messages.append(app.arguments().at(i).toUtf8());
+    if (!messages.isEmpty() && app.sendMessages(messages))
         return 0;
 
     PlainTextEdit plainTextEdit;
     plainTextEdit.show();
     if (!app.startSingleServer())
         qWarning() << "Error starting server";
-    app.connect(&app, SIGNAL(messageReceived(QLocalSocket *)),
-                &plainTextEdit, SLOT(messageReceived(QLocalSocket *)));
+    app.connect(&app, SIGNAL(messageReceived(const QByteArray &, QLocalSocket *)),
+                &plainTextEdit, SLOT(messageReceived(const QByteArray &, QLocalSocket *)));
     return app.exec();
 }
 
@@ -35,6 +35,7 @@
 #include "adblocksubscription.h"
 #include "browserapplication.h"
 #include "networkaccessmanager.h"
+#include "startupprofiler.h"
 
 #include <qstringlist.h>
 #include <qsettings.h>
@@ -66,6 +67,7 @@ AdBlockManager::~AdBlockManager()
 AdBlockManager *AdBlockManager::instance()
 {
     if (!s_adBlockManager) {
+        StartupProfilerSpan span("AdBlockManager");
         // Set a parent that will delete us before the application exits
         s_adBlockManager = new AdBlockManager(BrowserApplication::networkAccessManager());
     }
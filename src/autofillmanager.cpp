@@ -38,6 +38,7 @@
 #include <qfile.h>
 #include <qmessagebox.h>
 #include <qsettings.h>
+#include <qtimer.h>
 #include <qurl.h>
 #include <qwebframe.h>
 #include <qwebpage.h>
@@ -72,6 +73,7 @@ void AutoFillManager::save() const
 void AutoFillManager::setForms(const QList<Form> &forms)
 {
     m_forms = forms;
+    updateFormIndex();
     emit autoFillChanged();
 }
 
@@ -117,19 +119,62 @@ void AutoFillManager::loadFormData()
 
     QDataStream stream(&file);
     stream >> m_forms;
+    updateFormIndex();
 }
 
+/*
+    The forms are looked up by their stripped url for every page that
+    finished loading and every form that is submitted.
+ */
+void AutoFillManager::updateFormIndex()
+{
+    m_formIndex.clear();
+    for (int i = 0; i < m_forms.count(); ++i)
+        m_formIndex.insert(formKey(m_forms.at(i).url), i);
+}
+
+QByteArray AutoFillManager::formKey(const QUrl &url)
+{
+    return stripUrl(url).toEncoded();
+}
+
+/*
+    Called for the form submissions of the top level frame while the
+    request is created.  Only what is needed is kept, the page is looked
+    at once the request is on its way.
+ */
 void AutoFillManager::post(const QNetworkRequest &request, const QByteArray &outgoingData)
 {
+    // Don't even give the options to save this site user name & password.
+    if (QWebSettings::globalSettings()->testAttribute(QWebSettings::PrivateBrowsingEnabled))
+        return;
+    if (!m_savePasswordForms)
+        return;
+
+    Post post;
+    post.request = request;
+    post.outgoingData = outgoingData;
+    QVariant v = request.attribute((QNetworkRequest::Attribute)(QNetworkRequest::User + 100));
+    post.page = (QWebPage*)(v.value<void*>());
+    if (m_posts.isEmpty())
+        QTimer::singleShot(0, this, SLOT(inspectPosts()));
+    m_posts.append(post);
+}
+
+void AutoFillManager::inspectPosts()
+{
+    while (!m_posts.isEmpty())
+        inspectPost(m_posts.takeFirst());
+}
+
+void AutoFillManager::inspectPost(const Post &post)
+{
+    const QNetworkRequest &request = post.request;
+    const QByteArray &outgoingData = post.outgoingData;
 #ifdef AUTOFILL_DEBUG
     qDebug() << "AutoFillManager::" << __FUNCTION__ << outgoingData << request.url();
 #endif
 
-    // Don't even give the options to save this site user name & password.
-    if (QWebSettings::globalSettings()->testAttribute(QWebSettings::PrivateBrowsingEnabled)) {
-        return;
-    }
-
     // Determine the url
     QByteArray refererHeader = request.rawHeader("Referer");
     if (refererHeader.isEmpty()) {
@@ -139,35 +184,18 @@ void AutoFillManager::post(const QNetworkRequest &request, const QByteArray &out
     }
     QUrl url = QUrl::fromEncoded(refererHeader);
     url = stripUrl(url);
+    QByteArray key = formKey(url);
 
     // Check that the url isn't in m_never
-    if (m_never.contains(url))
-        return;
-
-    // Check the request type
-    QVariant typeVariant = request.attribute((QNetworkRequest::Attribute)(QNetworkRequest::User + 101));
-    QWebPage::NavigationType type = (QWebPage::NavigationType)typeVariant.toInt();
-    if (typeVariant.isValid() && type != QWebPage::NavigationTypeFormSubmitted) {
-        // XXX Does this occur normally?
-        qWarning() << "AutoFillManager:" << "Type is not FormSubmitted" << type
-                   << "expected:" << QWebPage::NavigationTypeFormSubmitted;
+    if (m_never.contains(key))
         return;
-    }
 
-    // Determine the QWebView
-    QVariant v = request.attribute((QNetworkRequest::Attribute)(QNetworkRequest::User + 100));
-    QWebPage *webPage = (QWebPage*)(v.value<void*>());
+    // Determine the QWebView, it might have gone away since the request was made
+    QWebPage *webPage = post.page;
     if (!webPage) {
-        qWarning() << "AutoFillManager:" << "QWebPage is not set in QNetworkRequest.";
-        return;
-    }
-#if 0
-    // TODO CHECK reply ownership
-    if (!NetworkAccessManagerProxy::exists(webPage)) {
-        qWarning() << "AutoFillManager:" << "QWebPage no longer exists.";
+        qWarning() << "AutoFillManager:" << "QWebPage is not set in QNetworkRequest or was deleted.";
         return;
     }
-#endif
 
     // Find the matching form on the webpage
     Form form = findForm(webPage, outgoingData);
@@ -184,14 +212,7 @@ void AutoFillManager::post(const QNetworkRequest &request, const QByteArray &out
         return;
 
     // Prompt if we have never seen this password
-    int alreadyAccepted = -1;
-    for (int i = 0; i < m_forms.count(); ++i) {
-        const Form &form = m_forms.at(i);
-        if (form.url == url) {
-            alreadyAccepted = i;
-            break;
-        }
-    }
+    int alreadyAccepted = m_formIndex.value(key, -1);
     if (form.hasAPassword && alreadyAccepted == -1) {
         QMessageBox messageBox;
         messageBox.setText(tr("<b>Would you like to save this password?</b><br> \
@@ -202,7 +223,7 @@ void AutoFillManager::post(const QNetworkRequest &request, const QByteArray &out
         messageBox.setDefaultButton(QMessageBox::Yes);
         switch (messageBox.exec()) {
         case QMessageBox::DestructiveRole:
-            m_never.append(url);
+            m_never.insert(key);
             return;
         case QMessageBox::RejectRole:
             return;
@@ -218,6 +239,7 @@ void AutoFillManager::post(const QNetworkRequest &request, const QByteArray &out
     if (alreadyAccepted != -1)
         m_forms.removeAt(alreadyAccepted);
     m_forms.append(form);
+    updateFormIndex();
     emit autoFillChanged();
 }
 
@@ -235,12 +257,15 @@ AutoFillManager::Form AutoFillManager::findForm(QWebPage *webPage, const QByteAr
         args.insert(p);
     }
 
-    QFile file(QLatin1String(":parseForms.js"));
-    if (!file.open(QFile::ReadOnly)) {
-        qWarning() << "AutoFillManager:" << "Unable to open js form parsing file";
-        return form;
+    static QString script;
+    if (script.isEmpty()) {
+        QFile file(QLatin1String(":parseForms.js"));
+        if (!file.open(QFile::ReadOnly)) {
+            qWarning() << "AutoFillManager:" << "Unable to open js form parsing file";
+            return form;
+        }
+        script = QLatin1String(file.readAll());
     }
-    QString script = QLatin1String(file.readAll());
 
     // XXX Do I need to do this on subframes?
     QVariant r = webPage->mainFrame()->evaluateJavaScript(script);
@@ -307,15 +332,64 @@ bool AutoFillManager::allowedToAutoFill(bool password) const
 QList<AutoFillManager::Form> AutoFillManager::fetchForms(const QUrl &url) const
 {
     QList<Form> forms;
-    foreach (const Form &form, m_forms)
-        if (form.url == url)
-            forms.append(form);
+    QList<int> indexes = m_formIndex.values(formKey(url));
+    // QMultiHash returns the most recently inserted first
+    for (int i = indexes.count() - 1; i >= 0; --i)
+        forms.append(m_forms.at(indexes.at(i)));
 #ifdef AUTOFILL_DEBUG
     qDebug() << "AutoFillManager::" << __FUNCTION__ << url << m_forms.count() << "found:" << forms.count();
 #endif
     return forms;
 }
 
+// Quotes \a string for use in a script
+QString AutoFillManager::javaScriptString(const QString &string)
+{
+    QString quoted;
+    quoted.reserve(string.size() + 2);
+    quoted += QLatin1Char('"');
+    for (int i = 0; i < string.size(); ++i) {
+        QChar c = string.at(i);
+        switch (c.unicode()) {
+        case '\\': quoted += QLatin1String("\\\\"); break;
+        case '"': quoted += QLatin1String("\\\""); break;
+        case '\n': quoted += QLatin1String("\\n"); break;
+        case '\r': quoted += QLatin1String("\\r"); break;
+        case 0x2028: quoted += QLatin1String("\\u2028"); break;
+        case 0x2029: quoted += QLatin1String("\\u2029"); break;
+        default: quoted += c; break;
+        }
+    }
+    quoted += QLatin1Char('"');
+    return quoted;
+}
+
+/*
+    The forms as the argument of the form filling script:
+    [{name: "login", elements: [["user", "value"], ...]}, ...]
+ */
+QString AutoFillManager::formsScript(const QList<Form> &forms)
+{
+    QStringList formList;
+    foreach (const Form &form, forms) {
+        QString formName = form.name.isEmpty() ? QLatin1String("0") : javaScriptString(form.name);
+        QStringList elementList;
+        foreach (const AutoFillManager::Element &element, form.elements) {
+            elementList.append(QLatin1Char('[') + javaScriptString(element.first)
+                               + QLatin1Char(',') + javaScriptString(element.second)
+                               + QLatin1Char(']'));
+        }
+        formList.append(QLatin1String("{name:") + formName
+                        + QLatin1String(",elements:[") + elementList.join(QLatin1String(","))
+                        + QLatin1String("]}"));
+    }
+    return QLatin1Char('[') + formList.join(QLatin1String(",")) + QLatin1Char(']');
+}
+
+/*
+    Fills in the saved forms of the page with one script that gets all of
+    them as its argument, instead of asking the page about every element.
+ */
 void AutoFillManager::fill(QWebPage *page) const
 {
 #ifdef AUTOFILL_DEBUG
@@ -331,59 +405,24 @@ void AutoFillManager::fill(QWebPage *page) const
     if (forms.isEmpty())
         return;
 
-    foreach (const Form &form, forms) {
-        QString formName = QString(QLatin1String("\"%1\"")).arg(form.name);
-        if (form.name.isEmpty())
-            formName = QLatin1String("0");
-        foreach (const AutoFillManager::Element &element, form.elements) {
-            const QString key = element.first;
-            const QString value = element.second;
+    static QString script;
+    if (script.isEmpty()) {
+        QFile file(QLatin1String(":fillForms.js"));
+        if (!file.open(QFile::ReadOnly)) {
+            qWarning() << "AutoFillManager:" << "Unable to open js form filling file";
+            return;
+        }
+        script = QLatin1String(file.readAll());
+    }
 
-            // When we drop 4.5 migrate this to the 4.6 dom API
-            bool disabled = page->mainFrame()->evaluateJavaScript(QString(QLatin1String("document.forms[%1].elements[\"%2\"].disabled")).arg(formName).arg(key)).toBool();
-            if (disabled) {
-#ifdef AUTOFILL_DEBUG
-                qDebug() << formName << "is disabled";
-#endif
-                continue;
-            }
-            bool readOnly = page->mainFrame()->evaluateJavaScript(QString(QLatin1String("document.forms[%1].elements[\"%2\"].readonly")).arg(formName).arg(key)).toBool();
-            if (readOnly) {
-#ifdef AUTOFILL_DEBUG
-                qDebug() << formName << "is readOnly";
-#endif
-                continue;
-            }
-
-            QString type = page->mainFrame()->evaluateJavaScript(QString(QLatin1String("document.forms[%1].elements[\"%2\"].type")).arg(formName).arg(key)).toString();
-            if (type.isEmpty()
-                || type == QLatin1String("hidden")
-                || type == QLatin1String("reset")
-                || type == QLatin1String("submit")) {
-#ifdef AUTOFILL_DEBUG
-                qDebug() << formName << key << "is hidden, reset or submit";
-#endif
-                continue;
-            }
+    QString payload = formsScript(forms);
+
+    QVariant filled = page->mainFrame()->evaluateJavaScript(script + QLatin1Char('(') + payload + QLatin1Char(')'));
 #ifdef AUTOFILL_DEBUG
-            qDebug() << "type:" << type << "readonly" << readOnly << "disabled" << disabled << key << value;
+    qDebug() << "AutoFillManager::" << __FUNCTION__ << "filled" << filled.toInt() << "elements";
+#else
+    Q_UNUSED(filled);
 #endif
-            QString setType = (type == QLatin1String("checkbox"))
-                                ? QLatin1String("checked")
-                                : QLatin1String("value");
-
-            // XXX is there a cleaner way to do this?
-            QString jsValue = value;
-            jsValue.replace(QLatin1Char('\\'), QLatin1String("\\\\"));
-            jsValue.replace(QLatin1Char('\"'), QLatin1String("\\\""));
-            QString javascript = QString(QLatin1String("document.forms[%1].elements[\"%2\"].%3=\"%4\";"))
-                    .arg(formName)
-                    .arg(key)
-                    .arg(setType)
-                    .arg(jsValue);
-            page->mainFrame()->evaluateJavaScript(javascript);
-        }
-    }
 }
 
 QDataStream &operator>>(QDataStream &in, AutoFillManager::Form &form)
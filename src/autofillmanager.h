@@ -31,7 +31,10 @@
 
 #include <qobject.h>
 
+#include <qhash.h>
 #include <qnetworkrequest.h>
+#include <qpointer.h>
+#include <qset.h>
 
 class QWebPage;
 class AutoSaver;
@@ -67,12 +70,26 @@ public:
     void setForms(const QList<Form> &forms);
     QList<Form> forms() const;
 
+protected:
+    static QString javaScriptString(const QString &string);
+    static QString formsScript(const QList<Form> &forms);
+
 private slots:
     void save() const;
+    void inspectPosts();
 
 private:
+    struct Post {
+        QNetworkRequest request;
+        QByteArray outgoingData;
+        QPointer<QWebPage> page;
+    };
+
+    void inspectPost(const Post &post);
     Form findForm(QWebPage *page, const QByteArray &outgoingData) const;
     static QUrl stripUrl(const QUrl &url);
+    static QByteArray formKey(const QUrl &url);
+    void updateFormIndex();
     static QString autoFillDataFile();
     bool allowedToAutoFill(bool password) const;
     QList<AutoFillManager::Form> fetchForms(const QUrl &url) const;
@@ -84,7 +101,9 @@ private:
     bool m_allowAutoCompleteOff;
 
     QList<Form> m_forms;
-    QList<QUrl> m_never;
+    QMultiHash<QByteArray, int> m_formIndex;
+    QSet<QByteArray> m_never;
+    QList<Post> m_posts;
     AutoSaver *m_saveTimer;
 };
 
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "bandwidthgraph.h"
+
+#include "downloadmanager.h"
+
+#include <qpainter.h>
+
+BandwidthGraph::BandwidthGraph(QWidget *parent)
+    : QWidget(parent)
+    , m_maximumSamples(120)
+{
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+}
+
+int BandwidthGraph::maximumSamples() const
+{
+    return m_maximumSamples;
+}
+
+void BandwidthGraph::setMaximumSamples(int count)
+{
+    m_maximumSamples = qMax(2, count);
+    while (m_samples.count() > m_maximumSamples)
+        m_samples.removeFirst();
+    update();
+}
+
+QList<qint64> BandwidthGraph::samples() const
+{
+    return m_samples;
+}
+
+qint64 BandwidthGraph::peak() const
+{
+    qint64 peak = 0;
+    for (int i = 0; i < m_samples.count(); ++i)
+        peak = qMax(peak, m_samples.at(i));
+    return peak;
+}
+
+QSize BandwidthGraph::sizeHint() const
+{
+    return QSize(m_maximumSamples * 2, fontMetrics().height() * 3);
+}
+
+void BandwidthGraph::addSample(qint64 bytesPerSecond)
+{
+    m_samples.append(qMax(qint64(0), bytesPerSecond));
+    if (m_samples.count() > m_maximumSamples)
+        m_samples.removeFirst();
+    update();
+}
+
+void BandwidthGraph::clear()
+{
+    if (m_samples.isEmpty())
+        return;
+    m_samples.clear();
+    update();
+}
+
+void BandwidthGraph::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().base());
+
+    qint64 peak = this->peak();
+    if (peak > 0 && m_samples.count() > 1) {
+        // The newest sample is at the right edge
+        qreal step = qreal(width() - 1) / (m_maximumSamples - 1);
+        qreal x = (width() - 1) - step * (m_samples.count() - 1);
+        QPolygonF polygon;
+        polygon << QPointF(x, height());
+        for (int i = 0; i < m_samples.count(); ++i) {
+            qreal y = (height() - 1) - qreal(m_samples.at(i)) * (height() - 1) / peak;
+            polygon << QPointF(x + step * i, y);
+        }
+        polygon << QPointF(width() - 1, height());
+
+        QColor color = palette().color(QPalette::Highlight);
+        painter.setPen(color);
+        color.setAlpha(96);
+        painter.setBrush(color);
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.drawPolygon(polygon);
+        painter.setRenderHint(QPainter::Antialiasing, false);
+    }
+
+    qint64 current = m_samples.isEmpty() ? 0 : m_samples.last();
+    painter.setPen(palette().color(QPalette::Text));
+    painter.drawText(rect().adjusted(4, 2, -4, -2), Qt::AlignLeft | Qt::AlignTop,
+                     tr("%1/sec").arg(DownloadManager::dataString(current)));
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#ifndef BANDWIDTHGRAPH_H
+#define BANDWIDTHGRAPH_H
+
+#include <qwidget.h>
+
+#include <qlist.h>
+
+/*
+    Plots the most recent download rates, one sample per update of the
+    download manager, newest on the right.
+ */
+class BandwidthGraph : public QWidget
+{
+    Q_OBJECT
+
+public:
+    BandwidthGraph(QWidget *parent = 0);
+
+    int maximumSamples() const;
+    void setMaximumSamples(int count);
+
+    QList<qint64> samples() const;
+    qint64 peak() const;
+
+    QSize sizeHint() const;
+
+public slots:
+    void addSample(qint64 bytesPerSecond);
+    void clear();
+
+protected:
+    void paintEvent(QPaintEvent *event);
+
+private:
+    QList<qint64> m_samples;
+    int m_maximumSamples;
+};
+
+#endif // BANDWIDTHGRAPH_H
@@ -62,10 +62,16 @@
 
 #include "bookmarknode.h"
 
+#include "bookmarkstore.h"
+
 BookmarkNode::BookmarkNode(BookmarkNode::Type type, BookmarkNode *parent) :
      expanded(false)
-   , m_parent(parent)
+   , m_parent(0)
    , m_type(type)
+   , m_row(-1)
+   , m_validRows(0)
+   , m_store(0)
+   , m_storeId(0)
 {
     if (parent)
         parent->add(this);
@@ -73,8 +79,13 @@ BookmarkNode::BookmarkNode(BookmarkNode::Type type, BookmarkNode *parent) :
 
 BookmarkNode::~BookmarkNode()
 {
+    if (m_store)
+        m_store->m_unloaded.remove(m_storeId);
     if (m_parent)
-        m_parent->remove(this);
+        m_parent->take(this);
+    // Don't let every child remove itself from the list
+    for (int i = 0; i < m_children.count(); ++i)
+        m_children.at(i)->m_parent = 0;
     qDeleteAll(m_children);
     m_parent = 0;
     m_type = BookmarkNode::Root;
@@ -87,7 +98,7 @@ bool BookmarkNode::operator==(const BookmarkNode &other)
         || desc != other.desc
         || expanded != other.expanded
         || m_type != other.m_type
-        || m_children.count() != other.m_children.count())
+        || children().count() != other.children().count())
         return false;
 
     for (int i = 0; i < m_children.count(); ++i)
@@ -106,30 +117,94 @@ void BookmarkNode::setType(Type type)
     m_type = type;
 }
 
-QList<BookmarkNode*> BookmarkNode::children() const
+const QList<BookmarkNode*> &BookmarkNode::children() const
 {
+    if (m_store)
+        loadChildren();
     return m_children;
 }
 
+void BookmarkNode::loadChildren() const
+{
+    m_store->loadChildren(const_cast<BookmarkNode*>(this));
+}
+
+/*
+    Creates every folder below this node that is still in the store.
+    A node that is removed can be added back later, after the store
+    dropped what is no longer below the root.
+ */
+void BookmarkNode::loadSubtree()
+{
+    if (m_store)
+        loadChildren();
+    for (int i = 0; i < m_children.count(); ++i)
+        m_children.at(i)->loadSubtree();
+}
+
 BookmarkNode *BookmarkNode::parent() const
 {
     return m_parent;
 }
 
+/*
+    Returns the position of this node in the children of its parent or
+    -1 if it has no parent.
+
+    Adding or removing a child only forgets the rows of the children
+    after it, they are counted again the next time one of them is asked
+    for.  Appending and looking up rows don't depend on the number of
+    children.
+ */
+int BookmarkNode::row() const
+{
+    if (!m_parent)
+        return -1;
+    // Children that moved can still have a row before m_validRows
+    if (m_row < 0 || m_row >= m_parent->m_validRows
+        || m_parent->m_children.at(m_row) != this)
+        m_parent->updateRows();
+    return m_row;
+}
+
+void BookmarkNode::updateRows() const
+{
+    for (int i = m_validRows; i < m_children.count(); ++i)
+        m_children.at(i)->m_row = i;
+    m_validRows = m_children.count();
+}
+
 void BookmarkNode::add(BookmarkNode *child, int offset)
 {
     Q_ASSERT(child->m_type != Root);
+    if (m_store)
+        loadChildren();
     if (child->m_parent)
-        child->m_parent->remove(child);
+        child->m_parent->take(child);
     child->m_parent = this;
     if (-1 == offset)
         offset = m_children.size();
     m_children.insert(offset, child);
+    child->m_row = offset;
+    m_validRows = (m_validRows >= offset) ? offset + 1 : m_validRows;
 }
 
 void BookmarkNode::remove(BookmarkNode *child)
 {
+    if (m_store)
+        loadChildren();
+    if (child->m_parent != this)
+        return;
+    take(child);
+    child->loadSubtree();
+}
+
+void BookmarkNode::take(BookmarkNode *child)
+{
+    int row = child->row();
+    m_children.removeAt(row);
+    m_validRows = qMin(m_validRows, row);
     child->m_parent = 0;
-    m_children.removeAll(child);
+    child->m_row = -1;
 }
 
@@ -66,6 +66,7 @@
 #include <qlist.h>
 #include <qstringlist.h>
 
+class BookmarkStore;
 class BookmarkNode
 {
 public:
@@ -82,8 +83,9 @@ public:
 
     Type type() const;
     void setType(Type type);
-    QList<BookmarkNode*> children() const;
+    const QList<BookmarkNode*> &children() const;
     BookmarkNode *parent() const;
+    int row() const;
 
     void add(BookmarkNode *child, int offset = -1);
     void remove(BookmarkNode *child);
@@ -94,10 +96,22 @@ public:
     bool expanded;
 
 private:
+    void loadChildren() const;
+    void loadSubtree();
+    void take(BookmarkNode *child);
+    void updateRows() const;
+
     BookmarkNode *m_parent;
     Type m_type;
     QList<BookmarkNode*> m_children;
+    // The children before m_validRows have the right m_row
+    mutable int m_row;
+    mutable int m_validRows;
+    // Set while the children are still in the store
+    BookmarkStore *m_store;
+    quint32 m_storeId;
 
+    friend class BookmarkStore;
 };
 
 #endif // BOOKMARKNODE_H
@@ -8,7 +8,8 @@ HEADERS += \
     bookmarksmenu.h \
     bookmarksmodel.h \
     bookmarkstoolbar.h \
-    bookmarknode.h
+    bookmarknode.h \
+    bookmarkstore.h
 
 SOURCES += \
     addbookmarkdialog.cpp \
@@ -17,7 +18,8 @@ SOURCES += \
     bookmarksmenu.cpp \
     bookmarksmodel.cpp \
     bookmarkstoolbar.cpp \
-    bookmarknode.cpp
+    bookmarknode.cpp \
+    bookmarkstore.cpp
 
 FORMS += \
     addbookmarkdialog.ui \
@@ -65,6 +65,7 @@
 #include "autosaver.h"
 #include "bookmarknode.h"
 #include "bookmarksmodel.h"
+#include "bookmarkstore.h"
 #include "browserapplication.h"
 #include "history.h"
 #include "xbelreader.h"
@@ -93,6 +94,7 @@ BookmarksManager::BookmarksManager(QObject *parent)
     : QObject(parent)
     , m_loaded(false)
     , m_saveTimer(new AutoSaver(this))
+    , m_store(new BookmarkStore(this))
     , m_bookmarkRootNode(0)
     , m_toolbar(0)
     , m_menu(0)
@@ -123,17 +125,23 @@ void BookmarksManager::load()
         return;
     m_loaded = true;
 
-    QString dir = QDesktopServices::storageLocation(QDesktopServices::DataLocation);
-    QString bookmarkFile = dir + QLatin1String("/bookmarks.xbel");
-    if (!QFile::exists(bookmarkFile))
-        bookmarkFile = QLatin1String(":defaultbookmarks.xbel");
-
-    XbelReader reader;
-    m_bookmarkRootNode = reader.read(bookmarkFile);
-    if (reader.error() != QXmlStreamReader::NoError) {
-        QMessageBox::warning(0, QLatin1String("Loading Bookmark"),
-            tr("Error when loading bookmarks on line %1, column %2:\n"
-               "%3").arg(reader.lineNumber()).arg(reader.columnNumber()).arg(reader.errorString()));
+    m_store->setFileName(BrowserApplication::dataFilePath(QLatin1String("bookmarks.dat")));
+    m_bookmarkRootNode = m_store->load();
+    if (!m_bookmarkRootNode) {
+        // Import the bookmarks from the file they were kept in before
+        QString dir = QDesktopServices::storageLocation(QDesktopServices::DataLocation);
+        QString bookmarkFile = dir + QLatin1String("/bookmarks.xbel");
+        if (!QFile::exists(bookmarkFile))
+            bookmarkFile = QLatin1String(":defaultbookmarks.xbel");
+
+        XbelReader reader;
+        m_bookmarkRootNode = reader.read(bookmarkFile);
+        if (reader.error() != QXmlStreamReader::NoError) {
+            QMessageBox::warning(0, QLatin1String("Loading Bookmark"),
+                tr("Error when loading bookmarks on line %1, column %2:\n"
+                   "%3").arg(reader.lineNumber()).arg(reader.columnNumber()).arg(reader.errorString()));
+        }
+        m_saveTimer->changeOccurred();
     }
 
     QList<BookmarkNode*> others;
@@ -183,14 +191,11 @@ void BookmarksManager::save() const
     if (!m_loaded)
         return;
 
-    XbelWriter writer;
-    QString dir = QDesktopServices::storageLocation(QDesktopServices::DataLocation);
-    QString bookmarkFile = dir + QLatin1String("/bookmarks.xbel");
     // Save root folder titles in English (i.e. not localized)
     m_menu->title = QLatin1String(BOOKMARKMENU);
     m_toolbar->title = QLatin1String(BOOKMARKBAR);
-    if (!writer.write(bookmarkFile, m_bookmarkRootNode))
-        qWarning() << "BookmarkManager: error saving to" << bookmarkFile;
+    if (!m_store->save(m_bookmarkRootNode))
+        qWarning() << "BookmarkManager: error saving to" << m_store->fileName();
     // Restore localized titles
     retranslate();
 }
@@ -219,7 +224,7 @@ void BookmarksManager::removeBookmark(BookmarkNode *node)
 
     Q_ASSERT(node);
     BookmarkNode *parent = node->parent();
-    int row = parent->children().indexOf(node);
+    int row = node->row();
     RemoveBookmarksCommand *command = new RemoveBookmarksCommand(this, parent, row);
     m_commands.push(command);
 }
@@ -29,6 +29,7 @@
 class AutoSaver;
 class BookmarkNode;
 class BookmarksModel;
+class BookmarkStore;
 class BookmarksManager : public QObject
 {
     Q_OBJECT
@@ -70,6 +71,7 @@ private:
 
     bool m_loaded;
     AutoSaver *m_saveTimer;
+    BookmarkStore *m_store;
     BookmarkNode *m_bookmarkRootNode;
     BookmarkNode *m_toolbar;
     BookmarkNode *m_menu;
@@ -87,16 +87,15 @@ BookmarksModel::BookmarksModel(BookmarksManager *bookmarkManager, QObject *paren
 
 QModelIndex BookmarksModel::index(BookmarkNode *node) const
 {
-    BookmarkNode *parent = node->parent();
-    if (!parent)
+    if (!node->parent())
         return QModelIndex();
-    return createIndex(parent->children().indexOf(node), 0, node);
+    return createIndex(node->row(), 0, node);
 }
 
 void BookmarksModel::entryAdded(BookmarkNode *item)
 {
     Q_ASSERT(item && item->parent());
-    int row = item->parent()->children().indexOf(item);
+    int row = item->row();
     BookmarkNode *parent = item->parent();
     // item was already added so remove beore beginInsertRows is called
     parent->remove(item);
@@ -234,8 +233,7 @@ QModelIndex BookmarksModel::parent(const QModelIndex &index) const
         return QModelIndex();
 
     // get the parent's row
-    BookmarkNode *grandParentNode = parentNode->parent();
-    int parentRow = grandParentNode->children().indexOf(parentNode);
+    int parentRow = parentNode->row();
     Q_ASSERT(parentRow >= 0);
     return createIndex(parentRow, 0, parentNode);
 }
@@ -355,9 +353,11 @@ bool BookmarksModel::dropMimeData(const QMimeData *data,
         XbelReader reader;
         BookmarkNode *rootNode = reader.read(&buffer);
         QList<BookmarkNode*> children = rootNode->children();
+        // Removing from the end keeps the rows of the others
+        for (int i = children.count() - 1; i >= 0; --i)
+            rootNode->remove(children.at(i));
         for (int i = 0; i < children.count(); ++i) {
             BookmarkNode *bookmarkNode = children.at(i);
-            rootNode->remove(bookmarkNode);
             row = qMax(0, row);
             m_bookmarksManager->addBookmark(parentNode, bookmarkNode, row);
             m_endMacro = true;
@@ -0,0 +1,412 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "bookmarkstore.h"
+
+#include "bookmarknode.h"
+
+#include <qdatastream.h>
+#include <qfile.h>
+
+#include <qdebug.h>
+
+// #define BOOKMARKSTORE_DEBUG
+
+static const quint32 BookmarkStoreMagic = 0xb00c;
+static const qint32 BookmarkStoreVersion = 1;
+
+// The root node always has this id
+static const quint32 RootId = 1;
+
+// Compact once this many records were appended and they
+// outnumber the entries four to one
+#define MINIMUM_RECORDS 256
+
+BookmarkStore::BookmarkStore(QObject *parent)
+    : QObject(parent)
+    , m_records(0)
+    , m_nextId(RootId + 1)
+    , m_loaded(false)
+    , m_needsCompaction(false)
+{
+}
+
+QString BookmarkStore::fileName() const
+{
+    return m_fileName;
+}
+
+void BookmarkStore::setFileName(const QString &fileName)
+{
+    if (m_fileName == fileName)
+        return;
+    m_fileName = fileName;
+    m_nodes.clear();
+    m_children.clear();
+    m_unloaded.clear();
+    m_pending.clear();
+    m_records = 0;
+    m_nextId = RootId + 1;
+    m_loaded = false;
+    m_needsCompaction = false;
+}
+
+bool BookmarkStore::exists() const
+{
+    return QFile::exists(m_fileName)
+        || QFile::exists(m_fileName + QLatin1String(".new"));
+}
+
+/*
+    Returns the root node of the stored bookmarks or 0 if there are none.
+    Only the root node is created, the children of every folder are read
+    from the store when they are first asked for.
+ */
+BookmarkNode *BookmarkStore::load()
+{
+    loadFile();
+    if (!m_nodes.contains(RootId))
+        return 0;
+
+    BookmarkNode *root = new BookmarkNode(BookmarkNode::Root);
+    fromData(m_nodes.value(RootId), root);
+    root->setType(BookmarkNode::Root);
+    root->m_storeId = RootId;
+    if (m_children.contains(RootId)) {
+        root->m_store = this;
+        m_unloaded.insert(RootId);
+    }
+    return root;
+}
+
+/*
+    Returns true if the children of \a folder were created.
+ */
+bool BookmarkStore::isLoaded(const BookmarkNode *folder) const
+{
+    return folder->m_store == 0;
+}
+
+/*
+    The number of records in the file.
+ */
+int BookmarkStore::records() const
+{
+    return m_records;
+}
+
+void BookmarkStore::loadChildren(BookmarkNode *folder)
+{
+    // Adding the children must not load them again
+    folder->m_store = 0;
+    m_unloaded.remove(folder->m_storeId);
+
+    QList<quint32> ids = childIds(m_children.value(folder->m_storeId));
+#ifdef BOOKMARKSTORE_DEBUG
+    qDebug() << "BookmarkStore::" << __FUNCTION__ << folder->title << ids.count();
+#endif
+    foreach (quint32 id, ids) {
+        if (id == folder->m_storeId || !m_nodes.contains(id)) {
+            qWarning() << "BookmarkStore: Ignoring unknown bookmark" << id << "in" << m_fileName;
+            continue;
+        }
+        BookmarkNode *node = new BookmarkNode(BookmarkNode::Bookmark);
+        fromData(m_nodes.value(id), node);
+        if (node->type() == BookmarkNode::Root)
+            node->setType(BookmarkNode::Folder);
+        node->m_storeId = id;
+        if (node->type() == BookmarkNode::Folder && m_children.contains(id)) {
+            node->m_store = this;
+            m_unloaded.insert(id);
+        }
+        folder->add(node);
+    }
+}
+
+void BookmarkStore::loadFile()
+{
+    if (m_loaded)
+        return;
+    m_loaded = true;
+
+    // A compaction was interrupted right before the new file was moved in place
+    QString tempFileName = m_fileName + QLatin1String(".new");
+    if (!QFile::exists(m_fileName) && QFile::exists(tempFileName))
+        QFile::rename(tempFileName, m_fileName);
+
+    QFile file(m_fileName);
+    if (!file.open(QFile::ReadOnly))
+        return;
+
+    QDataStream stream(&file);
+    quint32 magic;
+    qint32 version;
+    stream >> magic;
+    stream >> version;
+    if (magic != BookmarkStoreMagic || version != BookmarkStoreVersion) {
+        qWarning() << "BookmarkStore: Unknown file format" << m_fileName;
+        m_needsCompaction = true;
+        return;
+    }
+
+    while (!stream.atEnd()) {
+        QByteArray record;
+        stream >> record;
+        if (stream.status() != QDataStream::Ok || !apply(record)) {
+            qWarning() << "BookmarkStore: Ignoring truncated record in" << m_fileName;
+            m_needsCompaction = true;
+            break;
+        }
+        ++m_records;
+    }
+}
+
+/*
+    Stores the bookmarks below \a root, only the nodes that changed since
+    they were last saved are written.
+ */
+bool BookmarkStore::save(BookmarkNode *root)
+{
+    if (m_fileName.isEmpty() || !root)
+        return false;
+    loadFile();
+
+    root->m_storeId = RootId;
+    saveNode(root);
+
+    int records = m_records + m_pending.count();
+    int entries = m_nodes.count() + m_children.count();
+    if (m_needsCompaction
+        || (records > MINIMUM_RECORDS && records > 4 * entries))
+        return compact();
+
+    if (m_pending.isEmpty())
+        return true;
+
+    QFile file(m_fileName);
+    bool newFile = !file.exists() || file.size() == 0;
+    if (!file.open(QFile::WriteOnly | QFile::Append)) {
+        qWarning() << "BookmarkStore: Unable to open" << m_fileName << "for writing";
+        return false;
+    }
+
+    QDataStream stream(&file);
+    if (newFile) {
+        stream << BookmarkStoreMagic;
+        stream << BookmarkStoreVersion;
+    }
+    foreach (const QByteArray &record, m_pending)
+        stream << record;
+    file.close();
+    if (stream.status() != QDataStream::Ok || file.error() != QFile::NoError) {
+        // Part of a record might have been written, rewrite the file next time
+        qWarning() << "BookmarkStore: Unable to write to" << m_fileName;
+        m_needsCompaction = true;
+        return false;
+    }
+
+#ifdef BOOKMARKSTORE_DEBUG
+    qDebug() << "BookmarkStore::" << __FUNCTION__ << m_pending.count() << "records";
+#endif
+    m_records += m_pending.count();
+    m_pending.clear();
+    return true;
+}
+
+void BookmarkStore::saveNode(BookmarkNode *node)
+{
+    setEntry(NodeChanged, node->m_storeId, toData(node));
+
+    // Folders that were never opened can't have changed
+    if (node->m_store || node->type() == BookmarkNode::Bookmark
+        || node->type() == BookmarkNode::Separator)
+        return;
+
+    QList<quint32> ids;
+    foreach (BookmarkNode *child, node->m_children) {
+        if (!child->m_storeId)
+            child->m_storeId = m_nextId++;
+        ids.append(child->m_storeId);
+    }
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << ids;
+    setEntry(ChildrenChanged, node->m_storeId, data);
+
+    foreach (BookmarkNode *child, node->m_children)
+        saveNode(child);
+}
+
+void BookmarkStore::setEntry(Operation operation, quint32 id, const QByteArray &entryData)
+{
+    const QHash<quint32, QByteArray> &entries = (operation == NodeChanged) ? m_nodes : m_children;
+    QHash<quint32, QByteArray>::const_iterator it = entries.constFind(id);
+    if (it != entries.constEnd() && it.value() == entryData)
+        return;
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << quint8(operation) << id << entryData;
+    apply(data);
+    m_pending.append(data);
+}
+
+bool BookmarkStore::apply(const QByteArray &record)
+{
+    QDataStream stream(record);
+    quint8 operation;
+    quint32 id;
+    QByteArray data;
+    stream >> operation;
+    stream >> id;
+    stream >> data;
+    if (stream.status() != QDataStream::Ok)
+        return false;
+
+    switch (operation) {
+    case NodeChanged:
+        m_nodes.insert(id, data);
+        break;
+    case ChildrenChanged:
+        m_children.insert(id, data);
+        break;
+    default:
+        qWarning() << "BookmarkStore: Unknown record" << operation;
+        return true;
+    }
+    m_nextId = qMax(m_nextId, id + 1);
+    return true;
+}
+
+/*
+    Replace the journal with one record per entry that can be reached
+    from the root.  Folders that are removed from the tree are opened
+    first, so adding them back doesn't need the store.  The new file is
+    written next to the journal first so a crash never loses both.
+ */
+bool BookmarkStore::compact()
+{
+    QSet<quint32> reachable;
+    QList<quint32> queue;
+    queue.append(RootId);
+    while (!queue.isEmpty()) {
+        quint32 id = queue.takeLast();
+        if (reachable.contains(id) || !m_nodes.contains(id))
+            continue;
+        reachable.insert(id);
+        queue += childIds(m_children.value(id));
+    }
+
+    QHash<quint32, QByteArray>::iterator it = m_nodes.begin();
+    while (it != m_nodes.end()) {
+        if (reachable.contains(it.key()))
+            ++it;
+        else
+            it = m_nodes.erase(it);
+    }
+    it = m_children.begin();
+    while (it != m_children.end()) {
+        if (reachable.contains(it.key()))
+            ++it;
+        else
+            it = m_children.erase(it);
+    }
+
+    if (m_nodes.isEmpty()) {
+        QFile::remove(m_fileName);
+        m_pending.clear();
+        m_records = 0;
+        m_needsCompaction = false;
+        return true;
+    }
+
+    QString tempFileName = m_fileName + QLatin1String(".new");
+    QFile file(tempFileName);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+        qWarning() << "BookmarkStore: Unable to open" << tempFileName << "for writing";
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream << BookmarkStoreMagic;
+    stream << BookmarkStoreVersion;
+    int records = 0;
+    for (int i = NodeChanged; i <= ChildrenChanged; ++i) {
+        const QHash<quint32, QByteArray> &entries = (i == NodeChanged) ? m_nodes : m_children;
+        QHash<quint32, QByteArray>::const_iterator entry = entries.constBegin();
+        for (; entry != entries.constEnd(); ++entry) {
+            QByteArray data;
+            QDataStream recordStream(&data, QIODevice::WriteOnly);
+            recordStream << quint8(i) << entry.key() << entry.value();
+            stream << data;
+            ++records;
+        }
+    }
+    file.close();
+    if (stream.status() != QDataStream::Ok || file.error() != QFile::NoError) {
+        QFile::remove(tempFileName);
+        return false;
+    }
+
+    if (QFile::exists(m_fileName) && !QFile::remove(m_fileName))
+        return false;
+    if (!QFile::rename(tempFileName, m_fileName))
+        return false;
+
+#ifdef BOOKMARKSTORE_DEBUG
+    qDebug() << "BookmarkStore::" << __FUNCTION__ << records << "records";
+#endif
+    m_pending.clear();
+    m_records = records;
+    m_needsCompaction = false;
+    return true;
+}
+
+QByteArray BookmarkStore::toData(const BookmarkNode *node)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << qint32(node->type()) << node->title << node->url
+           << node->desc << node->expanded;
+    return data;
+}
+
+bool BookmarkStore::fromData(const QByteArray &data, BookmarkNode *node)
+{
+    QDataStream stream(data);
+    qint32 type;
+    stream >> type >> node->title >> node->url
+           >> node->desc >> node->expanded;
+    if (type < BookmarkNode::Root || type > BookmarkNode::Separator)
+        type = BookmarkNode::Bookmark;
+    node->setType(BookmarkNode::Type(type));
+    return stream.status() == QDataStream::Ok;
+}
+
+QList<quint32> BookmarkStore::childIds(const QByteArray &data)
+{
+    QList<quint32> ids;
+    if (data.isEmpty())
+        return ids;
+    QDataStream stream(data);
+    stream >> ids;
+    if (stream.status() != QDataStream::Ok)
+        return QList<quint32>();
+    return ids;
+}
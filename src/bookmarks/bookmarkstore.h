@@ -0,0 +1,95 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef BOOKMARKSTORE_H
+#define BOOKMARKSTORE_H
+
+#include <qobject.h>
+
+#include <qbytearray.h>
+#include <qhash.h>
+#include <qlist.h>
+#include <qset.h>
+
+class BookmarkNode;
+
+/*
+    Keeps the bookmarks in a binary journal.
+
+    Every node has an id in the store and two kinds of records: one with
+    the title, url, description and expanded state of a node and one with
+    the ids of the children of a folder.  Saving compares the nodes with
+    what was stored last and only appends records for what changed, so
+    renaming a bookmark doesn't rewrite the others.
+
+    The tree returned by load() is built lazily: the children of a folder
+    are only created once they are asked for.  Folders that were never
+    opened are kept as they are on saving.
+
+    Once the records outnumber the entries four to one the journal is
+    replaced by one record per entry that can still be reached.
+ */
+class BookmarkStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    BookmarkStore(QObject *parent = 0);
+
+    QString fileName() const;
+    void setFileName(const QString &fileName);
+    bool exists() const;
+
+    BookmarkNode *load();
+    bool save(BookmarkNode *root);
+
+    bool isLoaded(const BookmarkNode *folder) const;
+    int records() const;
+
+private:
+    enum Operation {
+        NodeChanged = 1,
+        ChildrenChanged = 2
+    };
+
+    void loadFile();
+    void loadChildren(BookmarkNode *folder);
+    void saveNode(BookmarkNode *node);
+    void setEntry(Operation operation, quint32 id, const QByteArray &data);
+    bool apply(const QByteArray &record);
+    bool compact();
+
+    static QByteArray toData(const BookmarkNode *node);
+    static bool fromData(const QByteArray &data, BookmarkNode *node);
+    static QList<quint32> childIds(const QByteArray &data);
+
+    QString m_fileName;
+    QHash<quint32, QByteArray> m_nodes;
+    QHash<quint32, QByteArray> m_children;
+    QSet<quint32> m_unloaded;
+    QList<QByteArray> m_pending;
+    int m_records;
+    quint32 m_nextId;
+    bool m_loaded;
+    bool m_needsCompaction;
+
+    friend class BookmarkNode;
+};
+
+#endif // BOOKMARKSTORE_H
@@ -62,6 +62,7 @@
 
 #include "browserapplication.h"
 
+#include "adblockmanager.h"
 #include "autosaver.h"
 #include "autofillmanager.h"
 #include "bookmarksmanager.h"
@@ -69,9 +70,14 @@
 #include "cookiejar.h"
 #include "downloadmanager.h"
 #include "historymanager.h"
+#include "idlescheduler.h"
 #include "languagemanager.h"
 #include "networkaccessmanager.h"
+#include "recentlyclosedstore.h"
+#include "sessionjournal.h"
+#include "startupprofiler.h"
 #include "tabwidget.h"
+#include "toolbarsearch.h"
 #include "webview.h"
 
 #include <qbuffer.h>
@@ -98,11 +104,24 @@ NetworkAccessManager *BrowserApplication::s_networkAccessManager = 0;
 BookmarksManager *BrowserApplication::s_bookmarksManager = 0;
 LanguageManager *BrowserApplication::s_languageManager = 0;
 AutoFillManager *BrowserApplication::s_autoFillManager = 0;
+IdleScheduler *BrowserApplication::s_idleScheduler = 0;
+RecentlyClosedStore *BrowserApplication::s_recentlyClosedStore = 0;
 
 BrowserApplication::BrowserApplication(int &argc, char **argv)
     : SingleApplication(argc, argv)
+    , m_sessionJournal(0)
     , quitting(false)
 {
+    QStringList options = QCoreApplication::arguments();
+    for (int i = 1; i < options.count(); ++i) {
+        QString argument = options.at(i);
+        if (argument == QLatin1String("--profile-startup"))
+            StartupProfiler::start(QDir::current().absoluteFilePath(QLatin1String("startup-trace.json")));
+        else if (argument.startsWith(QLatin1String("--profile-startup=")))
+            StartupProfiler::start(argument.mid(18));
+    }
+    StartupProfilerSpan span("BrowserApplication");
+
     QCoreApplication::setOrganizationDomain(QLatin1String("arora-browser.org"));
     QCoreApplication::setApplicationName(QLatin1String("Arora"));
     QCoreApplication::setApplicationVersion(QLatin1String("0.10.1"
@@ -112,17 +131,18 @@ BrowserApplication::BrowserApplication(int &argc, char **argv)
     ));
 
 #ifndef AUTOTESTS
-    connect(this, SIGNAL(messageReceived(QLocalSocket *)),
-            this, SLOT(messageReceived(QLocalSocket *)));
+    connect(this, SIGNAL(messageReceived(const QByteArray &, QLocalSocket *)),
+            this, SLOT(messageReceived(const QByteArray &, QLocalSocket *)));
+
+    // The urls are sent together with the request for the window id
+    QList<QByteArray> messages;
+    QStringList urls = argumentUrls(QCoreApplication::arguments());
+    if (!urls.isEmpty())
+        messages.append(urls.join(QLatin1String("\n")).toUtf8());
+    messages.append(QByteArray("aroramessage://getwinid"));
 
-    QStringList args = QCoreApplication::arguments();
-    if (args.count() > 1) {
-        QString message = parseArgumentUrl(args.last());
-        sendMessage(message.toUtf8());
-    }
     // If we could connect to another Arora then exit
-    QString message = QString(QLatin1String("aroramessage://getwinid"));
-    if (sendMessage(message.toUtf8(), 500))
+    if (sendMessages(messages, 500))
         return;
 
 #ifdef BROWSERAPPLICATION_DEBUG
@@ -146,10 +166,16 @@ BrowserApplication::BrowserApplication(int &argc, char **argv)
     QWebSettings::globalSettings()->setFontSize(QWebSettings::DefaultFontSize, 16);
     QWebSettings::globalSettings()->setFontSize(QWebSettings::DefaultFixedFontSize, 16);
 
-    QSettings settings;
-    settings.beginGroup(QLatin1String("sessions"));
-    m_lastSession = settings.value(QLatin1String("lastSession")).toByteArray();
-    settings.endGroup();
+    loadLastSession();
+
+    // Started once the first window is painted
+    IdleScheduler *scheduler = idleScheduler();
+    scheduler->addTask(QLatin1String("history"), this, "loadHistory",
+                       IdleScheduler::HighPriority);
+    scheduler->addTask(QLatin1String("openSearch"), this, "loadOpenSearch",
+                       IdleScheduler::NormalPriority);
+    scheduler->addTask(QLatin1String("adBlock"), this, "loadAdBlock",
+                       IdleScheduler::LowPriority);
 
 #if defined(Q_WS_MAC)
     connect(this, SIGNAL(lastWindowClosed()),
@@ -169,6 +195,9 @@ BrowserApplication::BrowserApplication(int &argc, char **argv)
 BrowserApplication::~BrowserApplication()
 {
     quitting = true;
+    StartupProfiler::save();
+    delete m_sessionJournal;
+    m_sessionJournal = 0;
     delete s_downloadManager;
     qDeleteAll(m_mainWindows);
     delete s_networkAccessManager;
@@ -176,6 +205,8 @@ BrowserApplication::~BrowserApplication()
     delete s_languageManager;
     delete s_historyManager;
     delete s_autoFillManager;
+    delete s_idleScheduler;
+    delete s_recentlyClosedStore;
 }
 
 #if defined(Q_WS_MAC)
@@ -201,7 +232,7 @@ void BrowserApplication::retranslate()
 
 // The only special property of an argument url is that the file's
 // can be local, they don't have to be absolute.
-QString BrowserApplication::parseArgumentUrl(const QString &string) const
+QString BrowserApplication::parseArgumentUrl(const QString &string)
 {
     if (QFile::exists(string)) {
         QFileInfo info(string);
@@ -210,29 +241,51 @@ QString BrowserApplication::parseArgumentUrl(const QString &string) const
     return string;
 }
 
-void BrowserApplication::messageReceived(QLocalSocket *socket)
+/*
+    The urls given in the command line arguments, the first argument
+    is the program.  Options start with a dash, the ones that QApplication
+    knows to take a value are followed by it unless it is given after
+    an '='.
+ */
+QStringList BrowserApplication::argumentUrls(const QStringList &arguments)
+{
+    static const char *valueOptions[] = { "-style", "-stylesheet", "-session",
+        "-graphicssystem", "-display", "-geometry", "-title", "-name",
+        "-font", "-fn", "-background", "-bg", "-foreground", "-fg",
+        "-button", "-btn", "-visual", "-inputstyle", "-im", 0 };
+
+    QStringList urls;
+    for (int i = 1; i < arguments.count(); ++i) {
+        const QString &argument = arguments.at(i);
+        if (!argument.startsWith(QLatin1Char('-'))) {
+            urls.append(parseArgumentUrl(argument));
+            continue;
+        }
+        for (int j = 0; valueOptions[j]; ++j) {
+            if (argument == QLatin1String(valueOptions[j])) {
+                ++i;
+                break;
+            }
+        }
+    }
+    return urls;
+}
+
+void BrowserApplication::messageReceived(const QByteArray &data, QLocalSocket *socket)
 {
-    QString message;
-    QTextStream stream(socket);
-    stream >> message;
+    QString message = QString::fromUtf8(data);
 #ifdef BROWSERAPPLICATION_DEBUG
     qDebug() << "BrowserApplication::" << __FUNCTION__ << message;
 #endif
     if (message.isEmpty())
         return;
 
-    // Got a normal url
+    // Got one or more normal urls, the ones that arrive in a row are
+    // opened together
     if (!message.startsWith(QLatin1String("aroramessage://"))) {
-        QSettings settings;
-        settings.beginGroup(QLatin1String("tabs"));
-        TabWidget::OpenUrlIn tab = TabWidget::OpenUrlIn(settings.value(QLatin1String("openLinksFromAppsIn"), TabWidget::NewSelectedTab).toInt());
-        settings.endGroup();
-        if (QUrl(message) == m_lastAskedUrl
-                && m_lastAskedUrlDateTime.addSecs(10) > QDateTime::currentDateTime()) {
-            qWarning() << "Possible recursive openUrl called, ignoring url:" << m_lastAskedUrl;
-            return;
-        }
-        mainWindow()->tabWidget()->loadString(message, tab);
+        if (m_pendingUrls.isEmpty())
+            QTimer::singleShot(0, this, SLOT(openPendingUrls()));
+        m_pendingUrls += message.split(QLatin1Char('\n'), QString::SkipEmptyParts);
         return;
     }
 
@@ -251,8 +304,7 @@ void BrowserApplication::messageReceived(QLocalSocket *socket)
         qDebug() << "BrowserApplication::" << __FUNCTION__ << "sending win id" << winid << mainWindow()->winId();
 #endif
         QString message = QLatin1String("aroramessage://winid/") + winid;
-        socket->write(message.toUtf8());
-        socket->waitForBytesWritten();
+        writeMessage(socket, message.toUtf8());
         return;
     }
 
@@ -269,6 +321,32 @@ void BrowserApplication::messageReceived(QLocalSocket *socket)
     }
 }
 
+void BrowserApplication::openPendingUrls()
+{
+    QStringList urls = m_pendingUrls;
+    m_pendingUrls.clear();
+    if (urls.isEmpty())
+        return;
+
+    QSettings settings;
+    settings.beginGroup(QLatin1String("tabs"));
+    TabWidget::OpenUrlIn tab = TabWidget::OpenUrlIn(settings.value(QLatin1String("openLinksFromAppsIn"), TabWidget::NewSelectedTab).toInt());
+    settings.endGroup();
+
+    TabWidget *tabWidget = mainWindow()->tabWidget();
+    foreach (const QString &url, urls) {
+        if (QUrl(url) == m_lastAskedUrl
+                && m_lastAskedUrlDateTime.addSecs(10) > QDateTime::currentDateTime()) {
+            qWarning() << "Possible recursive openUrl called, ignoring url:" << m_lastAskedUrl;
+            continue;
+        }
+        tabWidget->loadString(url, tab);
+        // Only the first url can replace the current tab
+        if (tab == TabWidget::CurrentTab)
+            tab = TabWidget::NewTab;
+    }
+}
+
 void BrowserApplication::quitBrowser()
 {
     if (s_downloadManager && !downloadManager()->allowQuit())
@@ -303,12 +381,15 @@ void BrowserApplication::quitBrowser()
  */
 void BrowserApplication::postLaunch()
 {
+    StartupProfiler::begin("postLaunch");
     QDesktopServices::StandardLocation location;
     location = QDesktopServices::CacheLocation;
     QString directory = QDesktopServices::storageLocation(location);
     if (directory.isEmpty())
         directory = QDir::homePath() + QLatin1String("/.") + QCoreApplication::applicationName();
+    StartupProfiler::begin("iconDatabase");
     QWebSettings::setIconDatabasePath(directory);
+    StartupProfiler::end("iconDatabase");
 
     loadSettings();
 
@@ -317,19 +398,18 @@ void BrowserApplication::postLaunch()
         QSettings settings;
         settings.beginGroup(QLatin1String("MainWindow"));
         int startup = settings.value(QLatin1String("startupBehavior")).toInt();
-        QStringList args = QCoreApplication::arguments();
+        QStringList urls = argumentUrls(QCoreApplication::arguments());
 
-        if (args.count() > 1) {
-            QString argumentUrl = parseArgumentUrl(args.last());
-            switch (startup) {
-            case 2: {
+        if (!urls.isEmpty()) {
+            TabWidget::OpenUrlIn tab = TabWidget::CurrentTab;
+            if (startup == 2) {
                 restoreLastSession();
-                mainWindow()->tabWidget()->loadString(argumentUrl, TabWidget::NewSelectedTab);
-                break;
+                tab = TabWidget::NewSelectedTab;
             }
-            default:
-                mainWindow()->tabWidget()->loadString(argumentUrl);
-                break;
+            for (int i = 0; i < urls.count(); ++i) {
+                mainWindow()->tabWidget()->loadString(urls.at(i), tab);
+                if (tab == TabWidget::CurrentTab)
+                    tab = TabWidget::NewTab;
             }
         } else {
             switch (startup) {
@@ -344,11 +424,31 @@ void BrowserApplication::postLaunch()
             }
         }
     }
-    BrowserApplication::historyManager();
+    StartupProfiler::end("postLaunch");
+    StartupProfiler::save();
+}
+
+void BrowserApplication::loadHistory()
+{
+    StartupProfilerSpan span("loadHistory");
+    historyManager()->load();
+}
+
+void BrowserApplication::loadOpenSearch()
+{
+    StartupProfilerSpan span("loadOpenSearch");
+    ToolbarSearch::openSearchManager();
+}
+
+void BrowserApplication::loadAdBlock()
+{
+    StartupProfilerSpan span("loadAdBlock");
+    AdBlockManager::instance()->load();
 }
 
 void BrowserApplication::loadSettings()
 {
+    StartupProfilerSpan span("loadSettings");
     QSettings settings;
     settings.beginGroup(QLatin1String("websettings"));
 
@@ -419,9 +519,54 @@ void BrowserApplication::clean()
 
 static const qint32 BrowserApplicationMagic = 0xec;
 
+/*
+    Read the session the last run left in the session journal, or the
+    one older versions kept in the settings, and start a new journal.
+ */
+void BrowserApplication::loadLastSession()
+{
+    StartupProfilerSpan span("loadLastSession");
+    m_sessionJournal = new SessionJournal(this);
+    m_sessionJournal->setFileName(dataFilePath(QLatin1String("session.dat")));
+    connect(this, SIGNAL(privacyChanged(bool)),
+            m_sessionJournal, SLOT(privacyChanged(bool)));
+
+    if (!m_sessionJournal->exists()) {
+        QSettings settings;
+        settings.beginGroup(QLatin1String("sessions"));
+        m_lastSession = settings.value(QLatin1String("lastSession")).toByteArray();
+        settings.endGroup();
+        m_sessionJournal->clear();
+        return;
+    }
+
+    QList<QPair<QByteArray, QByteArray> > windows = m_sessionJournal->load();
+    m_sessionJournal->clear();
+    if (windows.isEmpty())
+        return;
+
+    int version = 3;
+    QBuffer buffer(&m_lastSession);
+    QDataStream stream(&buffer);
+    buffer.open(QIODevice::WriteOnly);
+
+    stream << qint32(BrowserApplicationMagic);
+    stream << qint32(version);
+
+    stream << qint32(windows.count());
+    for (int i = 0; i < windows.count(); ++i) {
+        stream << windows.at(i).first;
+        stream << windows.at(i).second;
+    }
+}
+
+/*
+    The tabs record themselves in the session journal as they change,
+    only the window states are collected here.
+ */
 void BrowserApplication::saveSession()
 {
-    if (quitting)
+    if (quitting || !m_sessionJournal)
         return;
     QSettings settings;
     settings.beginGroup(QLatin1String("MainWindow"));
@@ -434,22 +579,15 @@ void BrowserApplication::saveSession()
 
     clean();
 
-    settings.beginGroup(QLatin1String("sessions"));
-
-    int version = 2;
-
-    QByteArray data;
-    QBuffer buffer(&data);
-    QDataStream stream(&buffer);
-    buffer.open(QIODevice::WriteOnly);
-
-    stream << qint32(BrowserApplicationMagic);
-    stream << qint32(version);
-
-    stream << qint32(m_mainWindows.count());
     for (int i = 0; i < m_mainWindows.count(); ++i)
-        stream << m_mainWindows.at(i)->saveState();
-    settings.setValue(QLatin1String("lastSession"), data);
+        m_sessionJournal->setWindowState(m_mainWindows.at(i), m_mainWindows.at(i)->saveState(false));
+    if (!m_sessionJournal->flush())
+        return;
+
+    // The session used to be kept in the settings
+    settings.beginGroup(QLatin1String("sessions"));
+    if (settings.contains(QLatin1String("lastSession")))
+        settings.remove(QLatin1String("lastSession"));
     settings.endGroup();
 }
 
@@ -460,6 +598,7 @@ bool BrowserApplication::canRestoreSession() const
 
 bool BrowserApplication::restoreLastSession()
 {
+    StartupProfilerSpan span("restoreLastSession");
     {
         QSettings settings;
         settings.beginGroup(QLatin1String("MainWindow"));
@@ -473,8 +612,9 @@ bool BrowserApplication::restoreLastSession()
         // and in saveSession we will reset this flag back to false
         settings.setValue(QLatin1String("restoring"), true);
     }
-    int version = 2;
+    int version = 3;
     QList<QByteArray> windows;
+    QList<QByteArray> tabs;
     QBuffer buffer(&m_lastSession);
     QDataStream stream(&buffer);
     buffer.open(QIODevice::ReadOnly);
@@ -483,15 +623,20 @@ bool BrowserApplication::restoreLastSession()
     qint32 v;
     stream >> marker;
     stream >> v;
-    if (marker != BrowserApplicationMagic || v != version)
+    if (marker != BrowserApplicationMagic || v < 2 || v > version)
         return false;
 
+    // Version 2 kept the tabs inside the window state
     qint32 windowCount;
     stream >> windowCount;
     for (qint32 i = 0; i < windowCount; ++i) {
         QByteArray windowState;
+        QByteArray tabState;
         stream >> windowState;
+        if (v >= 3)
+            stream >> tabState;
         windows.append(windowState);
+        tabs.append(tabState);
     }
     for (int i = 0; i < windows.count(); ++i) {
         BrowserMainWindow *newWindow = 0;
@@ -501,10 +646,30 @@ bool BrowserApplication::restoreLastSession()
             newWindow = newMainWindow();
         }
         newWindow->restoreState(windows.at(i));
+        if (!tabs.at(i).isEmpty())
+            newWindow->tabWidget()->restoreState(tabs.at(i));
     }
     return true;
 }
 
+void BrowserApplication::openRecentlyClosedWindow(int index)
+{
+    QByteArray state = recentlyClosedStore()->take(RecentlyClosedStore::Window, index);
+    if (state.isEmpty())
+        return;
+
+    QByteArray windowState;
+    QByteArray tabState;
+    QDataStream stream(state);
+    stream >> windowState;
+    stream >> tabState;
+
+    BrowserMainWindow *window = newMainWindow();
+    window->restoreState(windowState);
+    if (!window->tabWidget()->restoreState(tabState))
+        window->goHome();
+}
+
 #if defined(Q_WS_MAC)
 bool BrowserApplication::event(QEvent *event)
 {
@@ -550,10 +715,17 @@ BrowserMainWindow *BrowserApplication::newMainWindow()
 {
     if (!m_mainWindows.isEmpty())
         mainWindow()->m_autoSaver->saveIfNeccessary();
+    StartupProfilerSpan span("newMainWindow");
     BrowserMainWindow *browser = new BrowserMainWindow();
     m_mainWindows.prepend(browser);
     connect(this, SIGNAL(privacyChanged(bool)),
             browser, SLOT(privacyChanged(bool)));
+    if (m_sessionJournal)
+        m_sessionJournal->addWindow(browser);
+    if (m_mainWindows.count() == 1) {
+        StartupProfiler::markFirstPaint(browser);
+        idleScheduler()->startAfterPaint(browser);
+    }
     browser->show();
     return browser;
 }
@@ -596,21 +768,26 @@ NetworkAccessManager *BrowserApplication::networkAccessManager()
 
 HistoryManager *BrowserApplication::historyManager()
 {
-    if (!s_historyManager)
+    if (!s_historyManager) {
+        StartupProfilerSpan span("HistoryManager");
         s_historyManager = new HistoryManager();
+    }
     return s_historyManager;
 }
 
 BookmarksManager *BrowserApplication::bookmarksManager()
 {
-    if (!s_bookmarksManager)
+    if (!s_bookmarksManager) {
+        StartupProfilerSpan span("BookmarksManager");
         s_bookmarksManager = new BookmarksManager;
+    }
     return s_bookmarksManager;
 }
 
 LanguageManager *BrowserApplication::languageManager()
 {
     if (!s_languageManager) {
+        StartupProfilerSpan span("LanguageManager");
         s_languageManager = new LanguageManager();
         s_languageManager->addLocaleDirectory(dataFilePath(QLatin1String("locale")));
         s_languageManager->addLocaleDirectory(qApp->applicationDirPath() + QLatin1String("/src/.qm/locale"));
@@ -630,6 +807,29 @@ AutoFillManager *BrowserApplication::autoFillManager()
     return s_autoFillManager;
 }
 
+/*
+    Initialization that isn't needed to show the first window is
+    added here and run once the browser is idle.
+ */
+IdleScheduler *BrowserApplication::idleScheduler()
+{
+    if (!s_idleScheduler)
+        s_idleScheduler = new IdleScheduler;
+    return s_idleScheduler;
+}
+
+RecentlyClosedStore *BrowserApplication::recentlyClosedStore()
+{
+    if (!s_recentlyClosedStore) {
+        s_recentlyClosedStore = new RecentlyClosedStore;
+        s_recentlyClosedStore->setFileName(dataFilePath(QLatin1String("recentlyclosed.dat")));
+        s_recentlyClosedStore->setPrivate(isPrivate());
+        connect(qApp, SIGNAL(privacyChanged(bool)),
+                s_recentlyClosedStore, SLOT(setPrivate(bool)));
+    }
+    return s_recentlyClosedStore;
+}
+
 QIcon BrowserApplication::icon(const QUrl &url)
 {
     QIcon icon = QWebSettings::iconForUrl(url);
@@ -75,9 +75,12 @@ class BrowserMainWindow;
 class CookieJar;
 class DownloadManager;
 class HistoryManager;
+class IdleScheduler;
 class NetworkAccessManager;
 class LanguageManager;
 class QLocalSocket;
+class RecentlyClosedStore;
+class SessionJournal;
 class BrowserApplication : public SingleApplication
 {
     Q_OBJECT
@@ -104,9 +107,12 @@ public:
     static BookmarksManager *bookmarksManager();
     static LanguageManager *languageManager();
     static AutoFillManager *autoFillManager();
+    static IdleScheduler *idleScheduler();
+    static RecentlyClosedStore *recentlyClosedStore();
 
     static QString installedDataDirectory();
     static QString dataFilePath(const QString &fileName);
+    static QStringList argumentUrls(const QStringList &arguments);
 
     Qt::MouseButtons eventMouseButtons() const;
     Qt::KeyboardModifiers eventKeyboardModifiers() const;
@@ -125,6 +131,7 @@ public:
 public slots:
     BrowserMainWindow *newMainWindow();
     bool restoreLastSession();
+    void openRecentlyClosedWindow(int index = 0);
 #if defined(Q_WS_MAC)
     void lastWindowClosed();
 #endif
@@ -136,8 +143,12 @@ public slots:
 
 private slots:
     void retranslate();
-    void messageReceived(QLocalSocket *socket);
+    void messageReceived(const QByteArray &data, QLocalSocket *socket);
+    void openPendingUrls();
     void postLaunch();
+    void loadHistory();
+    void loadOpenSearch();
+    void loadAdBlock();
     void openUrl(const QUrl &url);
 
 signals:
@@ -145,8 +156,9 @@ signals:
     void privacyChanged(bool isPrivate);
 
 private:
-    QString parseArgumentUrl(const QString &string) const;
+    static QString parseArgumentUrl(const QString &string);
     void clean();
+    void loadLastSession();
 
     static HistoryManager *s_historyManager;
     static DownloadManager *s_downloadManager;
@@ -154,14 +166,18 @@ private:
     static BookmarksManager *s_bookmarksManager;
     static LanguageManager *s_languageManager;
     static AutoFillManager *s_autoFillManager;
+    static IdleScheduler *s_idleScheduler;
+    static RecentlyClosedStore *s_recentlyClosedStore;
 
     QList<QPointer<BrowserMainWindow> > m_mainWindows;
     QByteArray m_lastSession;
+    SessionJournal *m_sessionJournal;
     bool quitting;
 
     Qt::MouseButtons m_eventMouseButtons;
     Qt::KeyboardModifiers m_eventKeyboardModifiers;
 
+    QStringList m_pendingUrls;
     QUrl m_lastAskedUrl;
     QDateTime m_lastAskedUrlDateTime;
 };
@@ -80,11 +80,13 @@
 #include "languagemanager.h"
 #include "networkaccessmanager.h"
 #include "opensearchdialog.h"
+#include "recentlyclosedstore.h"
 #include "settings.h"
 #include "shortcuts.h"
 #include "sourceviewer.h"
 #include "tabbar.h"
 #include "tabwidget.h"
+#include "taskmanagerdialog.h"
 #include "toolbarsearch.h"
 #include "webview.h"
 #include "webviewsearch.h"
@@ -738,10 +740,22 @@ void BrowserMainWindow::setupMenu()
             BrowserApplication::instance(), SLOT(restoreLastSession()));
     m_historyRestoreLastSessionAction->setEnabled(BrowserApplication::instance()->canRestoreSession());
 
+    m_historyRecentlyClosedWindowsMenu = new QMenu(this);
+    connect(m_historyRecentlyClosedWindowsMenu, SIGNAL(aboutToShow()),
+            this, SLOT(aboutToShowRecentWindowsMenu()));
+    connect(m_historyRecentlyClosedWindowsMenu, SIGNAL(triggered(QAction *)),
+            this, SLOT(openRecentlyClosedWindow(QAction *)));
+    m_historyRecentlyClosedWindowsAction = new QAction(this);
+    m_historyRecentlyClosedWindowsAction->setMenu(m_historyRecentlyClosedWindowsMenu);
+    connect(BrowserApplication::recentlyClosedStore(), SIGNAL(changed()),
+            this, SLOT(recentlyClosedChanged()));
+    recentlyClosedChanged();
+
     historyActions.append(m_historyBackAction);
     historyActions.append(m_historyForwardAction);
     historyActions.append(m_historyHomeAction);
     historyActions.append(m_tabWidget->recentlyClosedTabsAction());
+    historyActions.append(m_historyRecentlyClosedWindowsAction);
     historyActions.append(m_historyRestoreLastSessionAction);
     m_historyMenu->setInitialActions(historyActions);
 #if QT_VERSION >= 0x040600 && defined(Q_WS_X11)
@@ -828,6 +842,11 @@ void BrowserMainWindow::setupMenu()
             AdBlockManager::instance(), SLOT(showDialog()));
     m_toolsMenu->addAction(m_adBlockDialogAction);
 
+    m_toolsTaskManagerAction = new QAction(m_toolsMenu);
+    connect(m_toolsTaskManagerAction, SIGNAL(triggered()),
+            this, SLOT(showTaskManager()));
+    m_toolsMenu->addAction(m_toolsTaskManagerAction);
+
     m_toolsMenu->addSeparator();
     m_toolsPreferencesAction = new QAction(m_toolsMenu);
     m_toolsPreferencesAction->setMenuRole(QAction::PreferencesRole);
@@ -969,6 +988,7 @@ void BrowserMainWindow::retranslate()
     m_historyForwardAction->setText(tr("Forward"));
     m_historyHomeAction->setText(tr("Home"));
     m_historyRestoreLastSessionAction->setText(tr("Restore Last Session"));
+    m_historyRecentlyClosedWindowsAction->setText(tr("Recently Closed Windows"));
 
     m_bookmarksMenu->setTitle(tr("&Bookmarks"));
     m_bookmarksShowAllAction->setText(tr("Show All Bookmarks..."));
@@ -989,6 +1009,8 @@ void BrowserMainWindow::retranslate()
     m_toolsSearchManagerAction->setText(tr("Configure Search Engines..."));
     m_adBlockDialogAction->setText(tr("&Ad Block..."));
 	m_adBlockDialogAction->setShortcuts(SHORTCUTS(AdBlock));
+    m_toolsTaskManagerAction->setText(tr("&Task Manager"));
+    m_toolsTaskManagerAction->setShortcuts(SHORTCUTS(ShowTaskManager));
 
     m_helpMenu->setTitle(tr("&Help"));
     m_helpChangeLanguageAction->setText(tr("Switch application language "));
@@ -1034,14 +1056,15 @@ void BrowserMainWindow::setupToolBar()
     m_navigationBar->addAction(m_stopReloadAction);
 
     m_navigationSplitter = new QSplitter(m_navigationBar);
-    m_navigationSplitter->addWidget(m_tabWidget->locationBarStack());
+    m_navigationSplitter->addWidget(m_tabWidget->currentLocationBar());
 
     m_toolbarSearch = new ToolbarSearch(m_navigationBar);
     m_navigationSplitter->addWidget(m_toolbarSearch);
+    QWidget::setTabOrder(m_tabWidget->currentLocationBar(), m_toolbarSearch);
     connect(m_toolbarSearch, SIGNAL(search(const QUrl&, TabWidget::OpenUrlIn)),
             m_tabWidget, SLOT(loadUrl(const QUrl&, TabWidget::OpenUrlIn)));
     m_navigationSplitter->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Maximum);
-    m_tabWidget->locationBarStack()->setMinimumWidth(120);
+    m_tabWidget->currentLocationBar()->setMinimumWidth(120);
     m_navigationSplitter->setCollapsible(0, false);
     m_navigationBar->addWidget(m_navigationSplitter);
     int splitterWidth = m_navigationSplitter->width();
@@ -1304,6 +1327,15 @@ void BrowserMainWindow::closeEvent(QCloseEvent *event)
         }
     }
 
+    // Closing the last window quits, there is nothing to reopen it in
+    if (BrowserApplication::instance()->mainWindows().count() > 1) {
+        QByteArray state;
+        QDataStream stream(&state, QIODevice::WriteOnly);
+        stream << saveState(false);
+        stream << m_tabWidget->saveState();
+        BrowserApplication::recentlyClosedStore()->addWindow(windowTitle(), state);
+    }
+
     event->accept();
 }
 
@@ -1413,6 +1445,11 @@ void BrowserMainWindow::clearPrivateData()
     dialog.exec();
 }
 
+void BrowserMainWindow::showTaskManager()
+{
+    TaskManagerDialog::showDialog();
+}
+
 void BrowserMainWindow::toggleInspector(bool enable)
 {
     QWebSettings::globalSettings()->setAttribute(QWebSettings::DeveloperExtrasEnabled, enable);
@@ -1549,6 +1586,29 @@ void BrowserMainWindow::aboutToShowWindowMenu()
     }
 }
 
+void BrowserMainWindow::aboutToShowRecentWindowsMenu()
+{
+    m_historyRecentlyClosedWindowsMenu->clear();
+    RecentlyClosedStore *store = BrowserApplication::recentlyClosedStore();
+    for (int i = 0; i < store->count(RecentlyClosedStore::Window); ++i) {
+        QAction *action = m_historyRecentlyClosedWindowsMenu->addAction(store->title(RecentlyClosedStore::Window, i));
+        action->setData(i);
+    }
+}
+
+void BrowserMainWindow::openRecentlyClosedWindow(QAction *action)
+{
+    if (!action)
+        return;
+    BrowserApplication::instance()->openRecentlyClosedWindow(action->data().toInt());
+}
+
+void BrowserMainWindow::recentlyClosedChanged()
+{
+    RecentlyClosedStore *store = BrowserApplication::recentlyClosedStore();
+    m_historyRecentlyClosedWindowsAction->setEnabled(store->count(RecentlyClosedStore::Window) > 0);
+}
+
 void BrowserMainWindow::showWindow()
 {
     if (QAction *action = qobject_cast<QAction*>(sender())) {
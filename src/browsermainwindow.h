@@ -148,6 +148,7 @@ private slots:
 
     void webSearch();
     void clearPrivateData();
+    void showTaskManager();
     void toggleInspector(bool enable);
     void aboutApplication();
     void downloadManager();
@@ -157,6 +158,9 @@ private slots:
     void aboutToShowForwardMenu();
     void aboutToShowViewMenu();
     void aboutToShowWindowMenu();
+    void aboutToShowRecentWindowsMenu();
+    void openRecentlyClosedWindow(QAction *action);
+    void recentlyClosedChanged();
     void aboutToShowTextEncodingMenu();
     void openActionUrl(QAction *action);
     void showSearchDialog();
@@ -219,6 +223,8 @@ private:
     QAction *m_historyForwardAction;
     QAction *m_historyHomeAction;
     QAction *m_historyRestoreLastSessionAction;
+    QAction *m_historyRecentlyClosedWindowsAction;
+    QMenu *m_historyRecentlyClosedWindowsMenu;
 
     BookmarksMenuBarMenu *m_bookmarksMenu;
     QAction *m_bookmarksShowAllAction;
@@ -234,6 +240,7 @@ private:
     QAction *m_toolsPreferencesAction;
     QAction *m_toolsSearchManagerAction;
     QAction *m_adBlockDialogAction;
+    QAction *m_toolsTaskManagerAction;
 
     QMenu *m_helpMenu;
     QAction *m_helpChangeLanguageAction;
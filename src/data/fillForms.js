@@ -0,0 +1,23 @@
+(function (forms) {
+    var filled = 0;
+    for (var i = 0; i < forms.length; ++i) {
+        var form = document.forms[forms[i].name];
+        if (!form)
+            continue;
+        var elements = forms[i].elements;
+        for (var j = 0; j < elements.length; ++j) {
+            var e = form.elements[elements[j][0]];
+            if (!e || e.disabled || e.readOnly)
+                continue;
+            var type = e.type;
+            if (!type || type == "hidden" || type == "reset" || type == "submit")
+                continue;
+            if (type == "checkbox")
+                e.checked = elements[j][1];
+            else
+                e.value = elements[j][1];
+            ++filled;
+        }
+    }
+    return filled;
+})
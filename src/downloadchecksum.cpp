@@ -0,0 +1,262 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "downloadchecksum.h"
+
+#include <qlist.h>
+
+#include <ctype.h>
+#include <string.h>
+
+static const quint32 sha256Constants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline quint32 rotateRight(quint32 value, int bits)
+{
+    return (value >> bits) | (value << (32 - bits));
+}
+
+DownloadChecksum::DownloadChecksum(Algorithm algorithm)
+    : m_algorithm(algorithm)
+    , m_md5(0)
+{
+    if (m_algorithm == Md5)
+        m_md5 = new QCryptographicHash(QCryptographicHash::Md5);
+    reset();
+}
+
+DownloadChecksum::~DownloadChecksum()
+{
+    delete m_md5;
+}
+
+DownloadChecksum::Algorithm DownloadChecksum::algorithm() const
+{
+    return m_algorithm;
+}
+
+void DownloadChecksum::reset()
+{
+    if (m_md5) {
+        m_md5->reset();
+        return;
+    }
+    static const quint32 initialState[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(m_state, initialState, sizeof(m_state));
+    m_bufferSize = 0;
+    m_length = 0;
+}
+
+void DownloadChecksum::addData(const char *data, int length)
+{
+    if (length <= 0)
+        return;
+    if (m_md5) {
+        m_md5->addData(data, length);
+        return;
+    }
+
+    const uchar *bytes = reinterpret_cast<const uchar*>(data);
+    m_length += length;
+    if (m_bufferSize > 0) {
+        int count = qMin(64 - m_bufferSize, length);
+        memcpy(m_buffer + m_bufferSize, bytes, count);
+        m_bufferSize += count;
+        bytes += count;
+        length -= count;
+        if (m_bufferSize < 64)
+            return;
+        transform(m_buffer);
+        m_bufferSize = 0;
+    }
+    for (; length >= 64; bytes += 64, length -= 64)
+        transform(bytes);
+    memcpy(m_buffer, bytes, length);
+    m_bufferSize = length;
+}
+
+void DownloadChecksum::addData(const QByteArray &data)
+{
+    addData(data.constData(), data.size());
+}
+
+/*
+    Returns the digest of the data added so far as a hex string.
+ */
+QByteArray DownloadChecksum::result() const
+{
+    if (m_md5)
+        return m_md5->result().toHex();
+
+    // Pad a copy so more data can still be added
+    DownloadChecksum copy(Sha256);
+    memcpy(copy.m_state, m_state, sizeof(m_state));
+    memcpy(copy.m_buffer, m_buffer, sizeof(m_buffer));
+    copy.m_bufferSize = m_bufferSize;
+    copy.m_length = m_length;
+
+    quint64 bits = m_length * 8;
+    uchar padding[72];
+    memset(padding, 0, sizeof(padding));
+    padding[0] = 0x80;
+    int count = (m_bufferSize < 56) ? 56 - m_bufferSize : 120 - m_bufferSize;
+    for (int i = 0; i < 8; ++i)
+        padding[count + i] = uchar(bits >> (56 - 8 * i));
+    copy.addData(reinterpret_cast<const char*>(padding), count + 8);
+
+    QByteArray digest(32, 0);
+    for (int i = 0; i < 8; ++i) {
+        digest[4 * i] = char(copy.m_state[i] >> 24);
+        digest[4 * i + 1] = char(copy.m_state[i] >> 16);
+        digest[4 * i + 2] = char(copy.m_state[i] >> 8);
+        digest[4 * i + 3] = char(copy.m_state[i]);
+    }
+    return digest.toHex();
+}
+
+void DownloadChecksum::transform(const uchar *block)
+{
+    quint32 w[64];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = (quint32(block[4 * i]) << 24) | (quint32(block[4 * i + 1]) << 16)
+               | (quint32(block[4 * i + 2]) << 8) | quint32(block[4 * i + 3]);
+    }
+    for (int i = 16; i < 64; ++i) {
+        quint32 s0 = rotateRight(w[i - 15], 7) ^ rotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        quint32 s1 = rotateRight(w[i - 2], 17) ^ rotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    quint32 a = m_state[0];
+    quint32 b = m_state[1];
+    quint32 c = m_state[2];
+    quint32 d = m_state[3];
+    quint32 e = m_state[4];
+    quint32 f = m_state[5];
+    quint32 g = m_state[6];
+    quint32 h = m_state[7];
+    for (int i = 0; i < 64; ++i) {
+        quint32 s1 = rotateRight(e, 6) ^ rotateRight(e, 11) ^ rotateRight(e, 25);
+        quint32 choice = (e & f) ^ (~e & g);
+        quint32 temp1 = h + s1 + choice + sha256Constants[i] + w[i];
+        quint32 s0 = rotateRight(a, 2) ^ rotateRight(a, 13) ^ rotateRight(a, 22);
+        quint32 majority = (a & b) ^ (a & c) ^ (b & c);
+        quint32 temp2 = s0 + majority;
+        h = g;
+        g = f;
+        f = e;
+        e = d + temp1;
+        d = c;
+        c = b;
+        b = a;
+        a = temp1 + temp2;
+    }
+    m_state[0] += a;
+    m_state[1] += b;
+    m_state[2] += c;
+    m_state[3] += d;
+    m_state[4] += e;
+    m_state[5] += f;
+    m_state[6] += g;
+    m_state[7] += h;
+}
+
+QByteArray DownloadChecksum::hash(const QByteArray &data, Algorithm algorithm)
+{
+    DownloadChecksum checksum(algorithm);
+    checksum.addData(data);
+    return checksum.result();
+}
+
+/*
+    Tells from the length of \a hexDigest which algorithm made it.
+ */
+bool DownloadChecksum::algorithmForDigest(const QByteArray &hexDigest, Algorithm *algorithm)
+{
+    for (int i = 0; i < hexDigest.size(); ++i) {
+        if (!isxdigit(uchar(hexDigest.at(i))))
+            return false;
+    }
+    Algorithm result;
+    if (hexDigest.size() == 32)
+        result = Md5;
+    else if (hexDigest.size() == 64)
+        result = Sha256;
+    else
+        return false;
+    if (algorithm)
+        *algorithm = result;
+    return true;
+}
+
+QString DownloadChecksum::algorithmName(Algorithm algorithm)
+{
+    switch (algorithm) {
+    case Md5:
+        return QLatin1String("MD5");
+    case Sha256:
+        return QLatin1String("SHA-256");
+    }
+    return QString();
+}
+
+/*
+    Finds the SHA-256 digest of \a fileName in the contents of a checksum
+    file as written by sha256sum, a file with only a digest in it is taken
+    as well.  Returns the digest in lower case or an empty array.
+ */
+QByteArray DownloadChecksum::parseChecksumFile(const QByteArray &contents, const QString &fileName)
+{
+    QList<QByteArray> digests;
+    foreach (const QByteArray &line, contents.split('\n')) {
+        QByteArray simplified = line.simplified();
+        if (simplified.isEmpty() || simplified.startsWith('#'))
+            continue;
+        int space = simplified.indexOf(' ');
+        QByteArray digest = simplified.left(space).toLower();
+        Algorithm algorithm;
+        if (!algorithmForDigest(digest, &algorithm) || algorithm != Sha256)
+            continue;
+        if (space == -1) {
+            digests.append(digest);
+            continue;
+        }
+        // "*" marks binary mode
+        QByteArray name = simplified.mid(space + 1);
+        if (name.startsWith('*'))
+            name = name.mid(1);
+        if (QString::fromUtf8(name) == fileName)
+            return digest;
+        digests.append(digest);
+    }
+    if (digests.count() == 1)
+        return digests.first();
+    return QByteArray();
+}
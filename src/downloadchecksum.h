@@ -0,0 +1,67 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#ifndef DOWNLOADCHECKSUM_H
+#define DOWNLOADCHECKSUM_H
+
+#include <qbytearray.h>
+#include <qcryptographichash.h>
+#include <qstring.h>
+
+/*
+    Computes the digest of a download while its data goes by.
+
+    Qt only knows MD5 and SHA-1, so SHA-256 is done here.  Like
+    QCryptographicHash, result() can be called at any time and more data
+    can be added afterwards.
+ */
+class DownloadChecksum
+{
+public:
+    enum Algorithm {
+        Md5,
+        Sha256
+    };
+
+    DownloadChecksum(Algorithm algorithm);
+    ~DownloadChecksum();
+
+    Algorithm algorithm() const;
+    void reset();
+    void addData(const char *data, int length);
+    void addData(const QByteArray &data);
+    QByteArray result() const;
+
+    static QByteArray hash(const QByteArray &data, Algorithm algorithm);
+    static bool algorithmForDigest(const QByteArray &hexDigest, Algorithm *algorithm);
+    static QString algorithmName(Algorithm algorithm);
+    static QByteArray parseChecksumFile(const QByteArray &contents, const QString &fileName);
+
+private:
+    Q_DISABLE_COPY(DownloadChecksum)
+    void transform(const uchar *block);
+
+    Algorithm m_algorithm;
+    QCryptographicHash *m_md5;
+    quint32 m_state[8];
+    uchar m_buffer[64];
+    int m_bufferSize;
+    quint64 m_length;
+};
+
+#endif // DOWNLOADCHECKSUM_H
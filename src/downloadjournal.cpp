@@ -0,0 +1,337 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "downloadjournal.h"
+
+#include <qdatastream.h>
+#include <qfile.h>
+
+#include <qdebug.h>
+
+static const quint32 DownloadJournalMagic = 0xd0a1;
+static const qint32 DownloadJournalVersion = 1;
+
+// Compact once this many records were appended and they
+// outnumber the entries four to one
+#define MINIMUM_RECORDS 256
+
+DownloadJournal::DownloadJournal(QObject *parent)
+    : QObject(parent)
+    , m_records(0)
+    , m_nextId(1)
+    , m_loaded(false)
+    , m_needsCompaction(false)
+{
+}
+
+DownloadJournal::~DownloadJournal()
+{
+    flush();
+}
+
+QString DownloadJournal::fileName() const
+{
+    return m_fileName;
+}
+
+void DownloadJournal::setFileName(const QString &fileName)
+{
+    if (m_fileName == fileName)
+        return;
+    m_fileName = fileName;
+    m_entries.clear();
+    m_pending.clear();
+    m_records = 0;
+    m_nextId = 1;
+    m_loaded = false;
+    m_needsCompaction = false;
+}
+
+bool DownloadJournal::exists() const
+{
+    return QFile::exists(m_fileName)
+        || QFile::exists(m_fileName + QLatin1String(".new"));
+}
+
+bool DownloadJournal::isLoaded() const
+{
+    return m_loaded;
+}
+
+/*
+    Returns the ids of the entries in the order they were added, the
+    journal is read the first time.
+ */
+QList<int> DownloadJournal::entries()
+{
+    load();
+    return m_entries.keys();
+}
+
+DownloadJournal::Entry DownloadJournal::entry(int id)
+{
+    load();
+    Entry entry;
+    fromData(m_entries.value(id), &entry);
+    return entry;
+}
+
+int DownloadJournal::addEntry(const Entry &entry)
+{
+    load();
+    int id = m_nextId;
+    setEntry(id, entry);
+    return id;
+}
+
+void DownloadJournal::setEntry(int id, const Entry &entry)
+{
+    load();
+    QByteArray entryData = toData(entry);
+    QMap<int, QByteArray>::const_iterator it = m_entries.constFind(id);
+    if (it != m_entries.constEnd() && it.value() == entryData)
+        return;
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << quint8(EntryChanged) << qint32(id) << entryData;
+    record(data);
+}
+
+void DownloadJournal::removeEntry(int id)
+{
+    load();
+    if (!m_entries.contains(id))
+        return;
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << quint8(EntryRemoved) << qint32(id);
+    record(data);
+}
+
+/*
+    Removes every entry, the file is removed on the next flush.
+ */
+void DownloadJournal::clear()
+{
+    m_entries.clear();
+    m_pending.clear();
+    m_records = 0;
+    m_loaded = true;
+    m_needsCompaction = true;
+}
+
+void DownloadJournal::load()
+{
+    if (m_loaded)
+        return;
+    m_loaded = true;
+
+    // A compaction was interrupted right before the new file was moved in place
+    QString tempFileName = m_fileName + QLatin1String(".new");
+    if (!QFile::exists(m_fileName) && QFile::exists(tempFileName))
+        QFile::rename(tempFileName, m_fileName);
+
+    QFile file(m_fileName);
+    if (!file.open(QFile::ReadOnly))
+        return;
+
+    QDataStream stream(&file);
+    quint32 magic;
+    qint32 version;
+    stream >> magic;
+    stream >> version;
+    if (magic != DownloadJournalMagic || version != DownloadJournalVersion) {
+        qWarning() << "DownloadJournal: Unknown file format" << m_fileName;
+        m_needsCompaction = true;
+        return;
+    }
+
+    while (!stream.atEnd()) {
+        QByteArray record;
+        stream >> record;
+        if (stream.status() != QDataStream::Ok || !apply(record)) {
+            qWarning() << "DownloadJournal: Ignoring truncated record in" << m_fileName;
+            m_needsCompaction = true;
+            break;
+        }
+        ++m_records;
+    }
+}
+
+void DownloadJournal::record(const QByteArray &data)
+{
+    apply(data);
+    m_pending.append(data);
+}
+
+bool DownloadJournal::apply(const QByteArray &record)
+{
+    QDataStream stream(record);
+    quint8 operation;
+    qint32 id;
+    stream >> operation;
+    stream >> id;
+    if (stream.status() != QDataStream::Ok)
+        return false;
+
+    switch (operation) {
+    case EntryChanged: {
+        QByteArray entryData;
+        stream >> entryData;
+        if (stream.status() != QDataStream::Ok)
+            return false;
+        m_entries.insert(id, entryData);
+        m_nextId = qMax(m_nextId, id + 1);
+        break;
+    }
+    case EntryRemoved:
+        m_entries.remove(id);
+        break;
+    default:
+        qWarning() << "DownloadJournal: Unknown record" << operation;
+        break;
+    }
+    return true;
+}
+
+/*
+    Append the queued records to the journal, or replace the journal
+    with one record per entry once it has grown too much.
+ */
+bool DownloadJournal::flush()
+{
+    if (m_fileName.isEmpty() || !m_loaded)
+        return false;
+
+    int records = m_records + m_pending.count();
+    if (m_needsCompaction
+        || (records > MINIMUM_RECORDS && records > 4 * m_entries.count()))
+        return compact();
+
+    if (m_pending.isEmpty())
+        return true;
+
+    QFile file(m_fileName);
+    bool newFile = !file.exists() || file.size() == 0;
+    if (!file.open(QFile::WriteOnly | QFile::Append)) {
+        qWarning() << "DownloadJournal: Unable to open" << m_fileName << "for writing";
+        return false;
+    }
+
+    QDataStream stream(&file);
+    if (newFile) {
+        stream << DownloadJournalMagic;
+        stream << DownloadJournalVersion;
+    }
+    foreach (const QByteArray &record, m_pending)
+        stream << record;
+    file.close();
+    if (stream.status() != QDataStream::Ok || file.error() != QFile::NoError) {
+        // The last record might be torn, rewrite the file next time
+        qWarning() << "DownloadJournal: Unable to write to" << m_fileName;
+        m_needsCompaction = true;
+        return false;
+    }
+
+    m_records += m_pending.count();
+    m_pending.clear();
+    return true;
+}
+
+/*
+    Replace the journal with one record per entry.  The new file is
+    written next to the journal first so a crash never loses both.
+ */
+bool DownloadJournal::compact()
+{
+    if (m_entries.isEmpty()) {
+        QFile::remove(m_fileName);
+        m_pending.clear();
+        m_records = 0;
+        m_needsCompaction = false;
+        return true;
+    }
+
+    QString tempFileName = m_fileName + QLatin1String(".new");
+    QFile file(tempFileName);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+        qWarning() << "DownloadJournal: Unable to open" << tempFileName << "for writing";
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream << DownloadJournalMagic;
+    stream << DownloadJournalVersion;
+    QMap<int, QByteArray>::const_iterator it = m_entries.constBegin();
+    for (; it != m_entries.constEnd(); ++it) {
+        QByteArray data;
+        QDataStream recordStream(&data, QIODevice::WriteOnly);
+        recordStream << quint8(EntryChanged) << qint32(it.key()) << it.value();
+        stream << data;
+    }
+    file.close();
+    if (stream.status() != QDataStream::Ok || file.error() != QFile::NoError) {
+        QFile::remove(tempFileName);
+        return false;
+    }
+
+    if (QFile::exists(m_fileName) && !QFile::remove(m_fileName))
+        return false;
+    if (!QFile::rename(tempFileName, m_fileName))
+        return false;
+
+    m_pending.clear();
+    m_records = m_entries.count();
+    m_needsCompaction = false;
+    return true;
+}
+
+QByteArray DownloadJournal::toData(const Entry &entry)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << entry.url << entry.fileName << entry.done
+           << entry.bytesReceived << entry.bytesTotal
+           << entry.entityTag << entry.lastModified << entry.acceptRanges
+           << qint32(entry.segments.count());
+    foreach (const Segment &segment, entry.segments)
+        stream << segment.start << segment.position << segment.end;
+    stream << entry.sha256 << entry.md5 << entry.expectedChecksum;
+    return data;
+}
+
+bool DownloadJournal::fromData(const QByteArray &data, Entry *entry)
+{
+    QDataStream stream(data);
+    qint32 segments;
+    stream >> entry->url >> entry->fileName >> entry->done
+           >> entry->bytesReceived >> entry->bytesTotal
+           >> entry->entityTag >> entry->lastModified >> entry->acceptRanges
+           >> segments;
+    for (int i = 0; i < segments && stream.status() == QDataStream::Ok; ++i) {
+        Segment segment;
+        stream >> segment.start >> segment.position >> segment.end;
+        entry->segments.append(segment);
+    }
+    // Not in the entries of older versions
+    if (!stream.atEnd())
+        stream >> entry->sha256 >> entry->md5 >> entry->expectedChecksum;
+    return stream.status() == QDataStream::Ok;
+}
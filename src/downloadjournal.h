@@ -0,0 +1,111 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#ifndef DOWNLOADJOURNAL_H
+#define DOWNLOADJOURNAL_H
+
+#include <qobject.h>
+
+#include <qbytearray.h>
+#include <qlist.h>
+#include <qmap.h>
+#include <qurl.h>
+
+/*
+    Keeps the list of downloads in its own file as a journal.
+
+    Adding, changing or removing a download appends one record, so saving
+    doesn't get slower with the number of downloads.  Besides the url and
+    the file every entry keeps what is needed to resume the download: the
+    bytes received, the validators sent by the server and the map of
+    segments.
+
+    The file is only read once the entries are asked for.  Once the
+    records outnumber the entries four to one the journal is replaced by
+    one record per entry.
+ */
+class DownloadJournal : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Segment {
+        Segment() : start(0), position(0), end(-1) {}
+        qint64 start;
+        qint64 position;
+        qint64 end;
+    };
+
+    struct Entry {
+        Entry() : done(false), bytesReceived(0), bytesTotal(0), acceptRanges(false) {}
+        QUrl url;
+        QString fileName;
+        bool done;
+        qint64 bytesReceived;
+        qint64 bytesTotal;
+        QByteArray entityTag;
+        QByteArray lastModified;
+        bool acceptRanges;
+        QList<Segment> segments;
+        QByteArray sha256;
+        QByteArray md5;
+        QByteArray expectedChecksum;
+    };
+
+    DownloadJournal(QObject *parent = 0);
+    ~DownloadJournal();
+
+    QString fileName() const;
+    void setFileName(const QString &fileName);
+    bool exists() const;
+    bool isLoaded() const;
+
+    QList<int> entries();
+    Entry entry(int id);
+    int addEntry(const Entry &entry);
+    void setEntry(int id, const Entry &entry);
+    void removeEntry(int id);
+    void clear();
+
+public slots:
+    bool flush();
+
+private:
+    enum Operation {
+        EntryChanged = 1,
+        EntryRemoved = 2
+    };
+
+    void load();
+    void record(const QByteArray &record);
+    bool apply(const QByteArray &record);
+    bool compact();
+
+    static QByteArray toData(const Entry &entry);
+    static bool fromData(const QByteArray &data, Entry *entry);
+
+    QString m_fileName;
+    QMap<int, QByteArray> m_entries;
+    QList<QByteArray> m_pending;
+    int m_records;
+    int m_nextId;
+    bool m_loaded;
+    bool m_needsCompaction;
+};
+
+#endif // DOWNLOADJOURNAL_H
@@ -65,6 +65,7 @@
 
 #include "autosaver.h"
 #include "browserapplication.h"
+#include "downloadwriter.h"
 #include "networkaccessmanager.h"
 
 #include <math.h>
@@ -73,6 +74,7 @@
 #include <qfiledialog.h>
 #include <qfileiconprovider.h>
 #include <qheaderview.h>
+#include <qinputdialog.h>
 #include <qmessagebox.h>
 #include <qmetaobject.h>
 #include <qmimedata.h>
@@ -85,20 +87,67 @@
 
 //#define DOWNLOADMANAGER_DEBUG
 
+// Segments smaller than this are not worth an extra connection
+static const qint64 minimumSegmentSize = 1024 * 1024;
+
+// The most that is read from a reply at once
+static const qint64 readChunkSize = 64 * 1024;
+
+// QNetworkAccessManager opens at most six connections to a host, more
+// segments would only wait for one of them
+static const int maximumSegments = 6;
+
+static int segmentCount()
+{
+    QSettings settings;
+    settings.beginGroup(QLatin1String("downloadmanager"));
+    return qBound(1, settings.value(QLatin1String("segments"), 1).toInt(), maximumSegments);
+}
+
 /*!
     DownloadItem is a widget that is displayed in the download manager list.
     It moves the data from the QNetworkReply into the QFile as well
     as update the information/progressbar and report errors.
+
+    When the server accepts byte ranges a stopped or failed download is
+    resumed where it left off, as long as the ETag or Last-Modified date
+    of the file didn't change.  If the downloadmanager/segments setting is
+    larger than one, large files are fetched in that many ranges at once,
+    at most six, each written at its own offset into the preallocated file.
+
+    The download manager decides when an item may run and read from its
+    replies.  A queued item keeps only the request, it is sent once the
+    item is started so waiting downloads don't hold a connection.  A rate
+    limited item only reads its allowance for each update of the manager.
+
+    The SHA-256 and MD5 digests of the file are computed by the writer
+    while the data is written.  They are compared with a checksum the
+    user enters or with the one in a .sha256 file next to the download
+    on the server.
  */
 DownloadItem::DownloadItem(QNetworkReply *reply, bool requestFileName, QWidget *parent)
     : QWidget(parent)
     , m_reply(reply)
+    , m_acceptRanges(false)
+    , m_resuming(false)
+    , m_aborting(false)
+    , m_bytesTotal(0)
+    , m_sessionOffset(0)
+    , m_writer(new DownloadWriter(this))
     , m_requestFileName(requestFileName)
+    , m_keepFileName(false)
     , m_bytesReceived(0)
     , m_startedSaving(false)
     , m_finishedDownloading(false)
     , m_gettingFileName(false)
     , m_canceledFileSelect(false)
+    , m_lastProgressBytes(0)
+    , m_speed(-1)
+    , m_queued(false)
+    , m_priority(NormalPriority)
+    , m_maximumRate(0)
+    , m_readAllowance(-1)
+    , m_checksumReply(0)
 {
     setupUi(this);
     QPalette p = downloadInfoLabel->palette();
@@ -109,6 +158,15 @@ DownloadItem::DownloadItem(QNetworkReply *reply, bool requestFileName, QWidget *
     connect(stopButton, SIGNAL(clicked()), this, SLOT(stop()));
     connect(openButton, SIGNAL(clicked()), this, SLOT(open()));
     connect(tryAgainButton, SIGNAL(clicked()), this, SLOT(tryAgain()));
+    connect(m_writer, SIGNAL(drained()), this, SLOT(downloadReadyRead()));
+    connect(m_writer, SIGNAL(written(int, qint64)), this, SLOT(dataWritten(int, qint64)));
+    connect(m_writer, SIGNAL(error(const QString &)), this, SLOT(writeError(const QString &)));
+    connect(m_writer, SIGNAL(closed()), this, SLOT(writerFinished()));
+
+    QAction *verifyAction = new QAction(tr("Verify Checksum..."), this);
+    connect(verifyAction, SIGNAL(triggered()), this, SLOT(enterChecksum()));
+    addAction(verifyAction);
+    setContextMenuPolicy(Qt::ActionsContextMenu);
 
     if (!requestFileName) {
         QSettings settings;
@@ -126,33 +184,207 @@ void DownloadItem::init()
 
     m_startedSaving = false;
     m_finishedDownloading = false;
+    m_aborting = false;
+    m_sha256.clear();
+    m_md5.clear();
 
     openButton->setEnabled(false);
 
-    // attach to the m_reply
+    // attach to the m_reply, when resuming tryAgain() has set up the segments
     m_url = m_reply->url();
-    m_reply->setParent(this);
-    connect(m_reply, SIGNAL(readyRead()), this, SLOT(downloadReadyRead()));
-    connect(m_reply, SIGNAL(error(QNetworkReply::NetworkError)),
-            this, SLOT(error(QNetworkReply::NetworkError)));
-    connect(m_reply, SIGNAL(downloadProgress(qint64, qint64)),
-            this, SLOT(downloadProgress(qint64, qint64)));
-    connect(m_reply, SIGNAL(metaDataChanged()),
-            this, SLOT(metaDataChanged()));
-    connect(m_reply, SIGNAL(finished()),
-            this, SLOT(finished()));
+    if (!m_resuming) {
+        m_segments.clear();
+        Segment segment;
+        segment.reply = m_reply;
+        m_segments.append(segment);
+        m_bytesTotal = 0;
+    }
+    m_bytesReceived = 0;
+    for (int i = 0; i < m_segments.count(); ++i) {
+        const Segment &segment = m_segments.at(i);
+        m_bytesReceived += segment.position - segment.start;
+        if (segment.reply)
+            connectReply(segment.reply);
+    }
+    m_sessionOffset = m_bytesReceived;
 
     // reset info
     downloadInfoLabel->clear();
     progressBar->setValue(0);
-    getFileName();
+    // A download that was queued got its file name then
+    if (!m_resuming && !m_keepFileName)
+        getFileName();
+    m_keepFileName = false;
 
     // start timer for the download estimation
     m_downloadTime.start();
+    m_lastProgressTime.start();
+    m_lastProgressBytes = m_bytesReceived;
+    m_speed = -1;
 
     if (m_reply->error() != QNetworkReply::NoError) {
         error(m_reply->error());
+        m_segments[segmentIndex(m_reply)].finished = true;
         finished();
+        return;
+    }
+
+    // Replies of unsupported content already have their headers
+    if (m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).isValid())
+        metaDataChanged();
+}
+
+void DownloadItem::connectReply(QNetworkReply *reply)
+{
+    reply->setParent(this);
+    reply->setReadBufferSize(readBufferSize());
+    connect(reply, SIGNAL(readyRead()), this, SLOT(downloadReadyRead()));
+    connect(reply, SIGNAL(error(QNetworkReply::NetworkError)),
+            this, SLOT(error(QNetworkReply::NetworkError)));
+    connect(reply, SIGNAL(metaDataChanged()),
+            this, SLOT(metaDataChanged()));
+    connect(reply, SIGNAL(finished()),
+            this, SLOT(finished()));
+}
+
+bool DownloadItem::isQueued() const
+{
+    return m_queued;
+}
+
+/*
+    Makes the item wait in the queue for \a request, which is only sent
+    once the download manager starts the item.
+ */
+void DownloadItem::setQueuedRequest(const QNetworkRequest &request)
+{
+    m_request = request;
+    m_url = request.url();
+    m_keepFileName = true;
+    // Set first so asking for the file name doesn't open it yet
+    m_queued = true;
+    getFileName();
+    updateInfoLabel();
+}
+
+DownloadItem::Priority DownloadItem::priority() const
+{
+    return m_priority;
+}
+
+/*
+    Queued downloads with a higher priority are started first.
+ */
+void DownloadItem::setPriority(Priority priority)
+{
+    m_priority = priority;
+}
+
+qint64 DownloadItem::maximumRate() const
+{
+    return m_maximumRate;
+}
+
+/*
+    Limits the download to \a bytesPerSecond on top of the limit of the
+    download manager, 0 means no limit.
+ */
+void DownloadItem::setMaximumRate(qint64 bytesPerSecond)
+{
+    m_maximumRate = qMax(qint64(0), bytesPerSecond);
+}
+
+void DownloadItem::setQueued(bool queued)
+{
+    if (m_queued == queued)
+        return;
+    m_queued = queued;
+#ifdef DOWNLOADMANAGER_DEBUG
+    qDebug() << "DownloadItem::" << __FUNCTION__ << queued << m_url;
+#endif
+    if (queued) {
+        releaseReply();
+    } else if (!m_reply && !m_request.url().isEmpty()) {
+        m_reply = BrowserApplication::networkAccessManager()->get(m_request);
+        m_request = QNetworkRequest();
+        init();
+    }
+    updateReadBufferSize();
+    if (!queued) {
+        m_downloadTime.start();
+        if (shouldSplit())
+            split();
+        if (hasBufferedData())
+            downloadReadyRead();
+    }
+    updateInfoLabel();
+}
+
+/*
+    Gives up the reply of a download that has to wait so it doesn't hold
+    a connection, the request is sent again when the download is started.
+    Only GET requests can be sent again, the others stall in the queue.
+ */
+void DownloadItem::releaseReply()
+{
+    if (!m_reply || m_reply->operation() != QNetworkAccessManager::GetOperation
+        || m_segments.count() != 1)
+        return;
+#ifdef DOWNLOADMANAGER_DEBUG
+    qDebug() << "DownloadItem::" << __FUNCTION__ << m_url;
+#endif
+    m_request = m_reply->request();
+    m_reply->disconnect(this);
+    m_reply->abort();
+    m_reply->deleteLater();
+    m_reply = 0;
+    m_segments.clear();
+    m_writer->close();
+    m_keepFileName = !m_output.fileName().isEmpty();
+}
+
+/*
+    Sets how many bytes may be read until the next update of the download
+    manager, -1 means no limit.
+ */
+void DownloadItem::setReadAllowance(qint64 bytes)
+{
+    bool changed = (m_readAllowance == -1) != (bytes == -1);
+    m_readAllowance = bytes;
+    if (changed || bytes > 0)
+        updateReadBufferSize();
+    if (bytes != 0 && hasBufferedData())
+        downloadReadyRead();
+}
+
+bool DownloadItem::hasBufferedData() const
+{
+    for (int i = 0; i < m_segments.count(); ++i) {
+        if (m_segments.at(i).reply && m_segments.at(i).reply->bytesAvailable() > 0)
+            return true;
+    }
+    return false;
+}
+
+qint64 DownloadItem::readBufferSize() const
+{
+    // Small enough for the transfer to stall
+    if (m_queued)
+        return 16 * 1024;
+    // Stop reading from the network while the writer can't keep up
+    qint64 size = m_writer->maximumQueuedBytes();
+    if (m_readAllowance >= 0)
+        size = qBound(qint64(4 * 1024), m_readAllowance, size);
+    return size;
+}
+
+void DownloadItem::updateReadBufferSize()
+{
+    qint64 size = readBufferSize();
+    for (int i = 0; i < m_segments.count(); ++i) {
+        QNetworkReply *reply = m_segments.at(i).reply;
+        if (reply && !m_segments.at(i).finished && reply->readBufferSize() != size)
+            reply->setReadBufferSize(size);
     }
 }
 
@@ -202,7 +434,7 @@ QString DownloadItem::saveFileName(const QString &directory) const
 {
     // Move this function into QNetworkReply to also get file name sent from the server
     QString path;
-    if (m_reply->hasRawHeader("Content-Disposition")) {
+    if (m_reply && m_reply->hasRawHeader("Content-Disposition")) {
         QString value = QLatin1String(m_reply->rawHeader("Content-Disposition"));
         int pos = value.indexOf(QLatin1String("filename="));
         if (pos != -1) {
@@ -243,13 +475,25 @@ QString DownloadItem::saveFileName(const QString &directory) const
 
 void DownloadItem::stop()
 {
+    m_queued = false;
     setUpdatesEnabled(false);
     stopButton->setEnabled(false);
     stopButton->hide();
     tryAgainButton->setEnabled(true);
     tryAgainButton->show();
     setUpdatesEnabled(true);
-    m_reply->abort();
+    for (int i = 0; i < m_segments.count(); ++i) {
+        const Segment &segment = m_segments.at(i);
+        if (segment.reply && !segment.finished)
+            segment.reply->abort();
+    }
+    // Stopped while it was waiting for its request to be sent
+    if (!m_reply && !m_request.url().isEmpty()) {
+        m_request = QNetworkRequest();
+        progressBar->hide();
+        downloadInfoLabel->setText(tr("Stopped"));
+        emit statusChanged();
+    }
 }
 
 void DownloadItem::open()
@@ -270,95 +514,430 @@ void DownloadItem::tryAgain()
     stopButton->setVisible(true);
     progressBar->setVisible(true);
 
-    QNetworkReply *r = BrowserApplication::networkAccessManager()->get(QNetworkRequest(m_url));
+    QList<QNetworkReply*> replies;
     if (m_reply)
-        m_reply->deleteLater();
-    if (m_output.exists())
-        m_output.remove();
-    m_reply = r;
+        replies.append(m_reply);
+    for (int i = 0; i < m_segments.count(); ++i) {
+        if (m_segments.at(i).reply && !replies.contains(m_segments.at(i).reply))
+            replies.append(m_segments.at(i).reply);
+    }
+    // What was received is still written before the file is opened again
+    m_writer->close();
+
+    m_resuming = canResume();
+    if (m_resuming) {
+        m_reply = 0;
+        for (int i = 0; i < m_segments.count(); ++i) {
+            Segment &segment = m_segments[i];
+            segment.reply = 0;
+            segment.finished = (segment.end != -1 && segment.position > segment.end);
+            if (segment.finished)
+                continue;
+            segment.reply = BrowserApplication::networkAccessManager()->get(rangeRequest(segment.position, segment.end));
+            if (!m_reply)
+                m_reply = segment.reply;
+        }
+#ifdef DOWNLOADMANAGER_DEBUG
+        qDebug() << "DownloadItem::" << __FUNCTION__ << "resuming" << m_url << m_bytesReceived;
+#endif
+    } else {
+        if (m_output.exists())
+            m_output.remove();
+        m_reply = BrowserApplication::networkAccessManager()->get(QNetworkRequest(m_url));
+    }
+    foreach (QNetworkReply *reply, replies)
+        reply->deleteLater();
     init();
     emit statusChanged();
 }
 
+/*
+    A download can be resumed when the server accepts byte ranges and
+    gave us something to check that the file didn't change in between.
+ */
+bool DownloadItem::canResume() const
+{
+    if (!m_acceptRanges || validator().isEmpty() || m_segments.isEmpty())
+        return false;
+    // The writer might not have caught up with the positions yet
+    if (m_output.fileName().isEmpty() || !m_output.exists())
+        return false;
+    for (int i = 0; i < m_segments.count(); ++i) {
+        const Segment &segment = m_segments.at(i);
+        if (segment.end == -1 || segment.position <= segment.end)
+            return true;
+    }
+    return false;
+}
+
+QByteArray DownloadItem::validator() const
+{
+    // Weak entity tags can't be used in If-Range
+    if (!m_entityTag.isEmpty() && !m_entityTag.startsWith("W/"))
+        return m_entityTag;
+    return m_lastModified;
+}
+
+QNetworkRequest DownloadItem::rangeRequest(qint64 start, qint64 end) const
+{
+    QNetworkRequest request(m_url);
+    QByteArray range = "bytes=" + QByteArray::number(start) + '-';
+    if (end != -1)
+        range += QByteArray::number(end);
+    request.setRawHeader("Range", range);
+    // The server sends the whole file instead if it changed
+    QByteArray value = validator();
+    if (!value.isEmpty())
+        request.setRawHeader("If-Range", value);
+    return request;
+}
+
+void DownloadItem::readValidators(QNetworkReply *reply)
+{
+    m_entityTag = reply->rawHeader("ETag");
+    m_lastModified = reply->rawHeader("Last-Modified");
+    m_acceptRanges = reply->rawHeader("Accept-Ranges").toLower().contains("bytes");
+}
+
+bool DownloadItem::sameValidators(QNetworkReply *reply) const
+{
+    QByteArray entityTag = reply->rawHeader("ETag");
+    if (!m_entityTag.isEmpty() && !entityTag.isEmpty())
+        return entityTag == m_entityTag;
+    QByteArray lastModified = reply->rawHeader("Last-Modified");
+    if (!m_lastModified.isEmpty() && !lastModified.isEmpty())
+        return lastModified == m_lastModified;
+    return true;
+}
+
+/*
+    Parses a Content-Range header like "bytes 100-199/1000", \a total is
+    set to -1 when the server doesn't know it.
+ */
+bool DownloadItem::parseContentRange(const QByteArray &value, qint64 *start, qint64 *end, qint64 *total)
+{
+    QByteArray range = value.trimmed();
+    if (!range.toLower().startsWith("bytes "))
+        return false;
+    range = range.mid(6).trimmed();
+    int dash = range.indexOf('-');
+    int slash = range.indexOf('/');
+    if (dash == -1 || slash == -1 || slash < dash)
+        return false;
+    bool ok1, ok2, ok3 = true;
+    qint64 first = range.left(dash).trimmed().toLongLong(&ok1);
+    qint64 last = range.mid(dash + 1, slash - dash - 1).trimmed().toLongLong(&ok2);
+    QByteArray length = range.mid(slash + 1).trimmed();
+    qint64 size = (length == "*") ? -1 : length.toLongLong(&ok3);
+    if (!ok1 || !ok2 || !ok3 || first < 0 || last < first || (size != -1 && last >= size))
+        return false;
+    if (start)
+        *start = first;
+    if (end)
+        *end = last;
+    if (total)
+        *total = size;
+    return true;
+}
+
+// Every segment gets its own id, so writes of segments that were replaced are ignored
+DownloadItem::Segment::Segment()
+    : reply(0)
+    , start(0)
+    , position(0)
+    , committed(0)
+    , end(-1)
+    , finished(false)
+{
+    static int nextId = 1;
+    id = nextId++;
+}
+
+int DownloadItem::segmentIndex(QObject *reply) const
+{
+    for (int i = 0; i < m_segments.count(); ++i) {
+        if (m_segments.at(i).reply == reply)
+            return i;
+    }
+    return -1;
+}
+
+bool DownloadItem::shouldSplit() const
+{
+    int segments = segmentCount();
+    if (segments < 2 || m_segments.count() != 1 || m_segments.first().position != 0)
+        return false;
+    // Not before the download was started
+    if (m_queued)
+        return false;
+    if (!m_acceptRanges || validator().isEmpty())
+        return false;
+    return m_bytesTotal >= segments * minimumSegmentSize;
+}
+
+/*
+    Replaces the reply for the whole file with one ranged request per
+    segment.
+ */
+void DownloadItem::split()
+{
+    int segments = segmentCount();
+    qint64 size = m_bytesTotal / segments;
+
+    m_reply->disconnect(this);
+    m_reply->abort();
+    m_reply->deleteLater();
+
+    m_segments.clear();
+    m_bytesReceived = 0;
+    m_sessionOffset = 0;
+    for (int i = 0; i < segments; ++i) {
+        Segment segment;
+        segment.start = i * size;
+        segment.position = segment.start;
+        segment.committed = segment.start;
+        segment.end = (i == segments - 1) ? m_bytesTotal - 1 : (i + 1) * size - 1;
+        segment.reply = BrowserApplication::networkAccessManager()->get(rangeRequest(segment.start, segment.end));
+        connectReply(segment.reply);
+        m_segments.append(segment);
+    }
+    m_reply = m_segments.first().reply;
+    if (m_writer->isOpen())
+        m_writer->resize(m_bytesTotal);
+
+#ifdef DOWNLOADMANAGER_DEBUG
+    qDebug() << "DownloadItem::" << __FUNCTION__ << m_url << segments << m_bytesTotal;
+#endif
+}
+
+/*
+    Drops every segment and continues with \a reply which downloads the
+    whole file from the start.
+ */
+void DownloadItem::restartWith(QNetworkReply *reply)
+{
+#ifdef DOWNLOADMANAGER_DEBUG
+    qDebug() << "DownloadItem::" << __FUNCTION__ << "the file changed, restarting" << m_url;
+#endif
+    for (int i = 0; i < m_segments.count(); ++i) {
+        QNetworkReply *segmentReply = m_segments.at(i).reply;
+        if (!segmentReply || segmentReply == reply)
+            continue;
+        segmentReply->disconnect(this);
+        segmentReply->abort();
+        segmentReply->deleteLater();
+    }
+    m_segments.clear();
+    Segment segment;
+    segment.reply = reply;
+    m_segments.append(segment);
+    m_reply = reply;
+    m_bytesTotal = 0;
+    m_bytesReceived = 0;
+    m_sessionOffset = 0;
+    if (m_writer->isOpen())
+        m_writer->resize(0);
+}
+
 void DownloadItem::downloadReadyRead()
 {
     if (m_requestFileName && m_output.fileName().isEmpty())
         return;
-    if (!m_output.isOpen()) {
+    if (m_queued)
+        return;
+    if (!m_writer->isOpen()) {
+        // stopped or done, don't start over
+        if (!stopButton->isEnabled())
+            return;
         // in case someone else has already put a file there
-        if (!m_requestFileName)
+        if (!m_requestFileName && !m_resuming)
             getFileName();
-        if (!m_output.open(QIODevice::WriteOnly)) {
-            downloadInfoLabel->setText(tr("Error opening output file: %1")
-                    .arg(m_output.errorString()));
-            stop();
-            emit statusChanged();
-            return;
-        }
+        // Failing to open the file is reported by writeError()
+        openOutput();
         emit statusChanged();
     }
-    if (-1 == m_output.write(m_reply->readAll())) {
-        downloadInfoLabel->setText(tr("Error saving: %1")
-                .arg(m_output.errorString()));
-        stopButton->click();
-    } else {
-        m_startedSaving = true;
-        if (m_finishedDownloading)
-            finished();
+
+    // Leave the rest in the replies until the writer has caught up
+    for (int i = 0; i < m_segments.count() && !m_writer->isFull() && m_readAllowance != 0; ++i) {
+        Segment &segment = m_segments[i];
+        if (!segment.reply)
+            continue;
+        while (segment.reply->bytesAvailable() > 0 && !m_writer->isFull() && m_readAllowance != 0) {
+            qint64 size = readChunkSize;
+            if (m_readAllowance > 0)
+                size = qMin(size, m_readAllowance);
+            QByteArray data = segment.reply->read(size);
+            if (m_readAllowance > 0)
+                m_readAllowance -= data.size();
+            if (segment.end != -1 && data.size() > segment.end - segment.position + 1)
+                data.truncate(qMax(qint64(0), segment.end - segment.position + 1));
+            if (data.isEmpty())
+                continue;
+            m_writer->write(segment.position, data, segment.id);
+            segment.position += data.size();
+            m_bytesReceived += data.size();
+        }
     }
+    m_startedSaving = true;
+    if (m_finishedDownloading)
+        finished();
+}
+
+/*
+    Opens the file in the writer, when the size is known it is
+    preallocated by the writer thread.
+ */
+void DownloadItem::openOutput()
+{
+    QIODevice::OpenMode mode = QIODevice::WriteOnly;
+    // Resuming or writing segments at their offsets
+    if (m_segments.count() != 1 || m_segments.first().position != 0)
+        mode = QIODevice::ReadWrite;
+    m_writer->open(m_output.fileName(), mode, bytesTotal());
+}
+
+/*
+    The writer has written the data of a segment up to \a position,
+    only that much is kept in the journal.
+ */
+void DownloadItem::dataWritten(int segmentId, qint64 position)
+{
+    for (int i = 0; i < m_segments.count(); ++i) {
+        Segment &segment = m_segments[i];
+        if (segment.id == segmentId) {
+            segment.committed = qMax(segment.committed, position);
+            return;
+        }
+    }
+}
+
+void DownloadItem::writeError(const QString &errorString)
+{
+    downloadInfoLabel->setText(tr("Error saving: %1").arg(errorString));
+    // What was queued is lost, so start over next time
+    m_acceptRanges = false;
+    m_aborting = true;
+    stopButton->click();
 }
 
 void DownloadItem::error(QNetworkReply::NetworkError)
 {
+    QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
+    if (!reply)
+        reply = m_reply;
+    // The other segments are stopped as well
+    if (m_aborting)
+        return;
+
 #ifdef DOWNLOADMANAGER_DEBUG
-    qDebug() << "DownloadItem::" << __FUNCTION__ << m_reply->errorString() << m_url;
+    qDebug() << "DownloadItem::" << __FUNCTION__ << reply->errorString() << m_url;
 #endif
 
-    downloadInfoLabel->setText(tr("Network Error: %1").arg(m_reply->errorString()));
+    downloadInfoLabel->setText(tr("Network Error: %1").arg(reply->errorString()));
     tryAgainButton->setEnabled(true);
     tryAgainButton->setVisible(true);
+
+    m_aborting = true;
+    for (int i = 0; i < m_segments.count(); ++i) {
+        const Segment &segment = m_segments.at(i);
+        if (segment.reply && segment.reply != reply && !segment.finished)
+            segment.reply->abort();
+    }
 }
 
 void DownloadItem::metaDataChanged()
 {
-    QVariant locationHeader = m_reply->header(QNetworkRequest::LocationHeader);
-    if (locationHeader.isValid()) {
+    QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
+    if (!reply)
+        reply = m_reply;
+    int index = segmentIndex(reply);
+    if (index == -1)
+        return;
+    const Segment &segment = m_segments.at(index);
+    bool ranged = (segment.position != 0 || segment.end != -1);
+
+    QVariant locationHeader = reply->header(QNetworkRequest::LocationHeader);
+    if (locationHeader.isValid() && !ranged) {
         m_url = locationHeader.toUrl();
         m_reply->deleteLater();
         m_reply = BrowserApplication::networkAccessManager()->get(QNetworkRequest(m_url));
+        m_resuming = false;
         init();
         return;
     }
 
-#ifdef DOWNLOADMANAGER_DEBUG
-    qDebug() << "DownloadItem::" << __FUNCTION__ << "not handled.";
-#endif
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (ranged) {
+        qint64 start;
+        qint64 total;
+        if (status == 206
+            && parseContentRange(reply->rawHeader("Content-Range"), &start, 0, &total)
+            && start == segment.position
+            && sameValidators(reply)) {
+            if (m_bytesTotal <= 0)
+                m_bytesTotal = total;
+            return;
+        }
+
+        // The file changed on the server or the range was ignored
+        if (status != 200) {
+            reply = BrowserApplication::networkAccessManager()->get(QNetworkRequest(m_url));
+            connectReply(reply);
+        }
+        restartWith(reply);
+        if (status != 200)
+            return;
+    }
+
+    readValidators(reply);
+    bool ok;
+    qint64 size = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong(&ok);
+    if (ok && size > 0)
+        m_bytesTotal = size;
+    if (shouldSplit())
+        split();
 }
 
-void DownloadItem::downloadProgress(qint64 bytesReceived, qint64 bytesTotal)
+/*
+    Called by the download manager at a fixed rate instead of for every
+    chunk that comes in.  Updates the moving average of the speed and
+    returns the number of bytes received since the last call.
+ */
+qint64 DownloadItem::updateProgress(bool updateWidgets)
 {
-    QTime now = QTime::currentTime();
-    if (m_lastProgressTime.msecsTo(now) < 200)
-        return;
-
-    m_lastProgressTime = now;
+    int elapsed = m_lastProgressTime.restart();
+    qint64 bytes = qMax(qint64(0), m_bytesReceived - m_lastProgressBytes);
+    m_lastProgressBytes = m_bytesReceived;
+    if (elapsed > 0) {
+        double speed = bytes * 1000.0 / elapsed;
+        // Smooth out the bursts of the network and the writer
+        m_speed = (m_speed < 0) ? speed : m_speed + (speed - m_speed) * 0.2;
+    }
 
-    m_bytesReceived = bytesReceived;
-    qint64 currentValue = 0;
-    qint64 totalValue = 0;
-    if (bytesTotal > 0) {
-        currentValue = bytesReceived * 100 / bytesTotal;
+    // Replies only know about their own range
+    qint64 total = this->bytesTotal();
+    int currentValue = 0;
+    int totalValue = 0;
+    if (total > 0) {
+        currentValue = m_bytesReceived * 100 / total;
         totalValue = 100;
     }
-    progressBar->setValue(currentValue);
-    progressBar->setMaximum(totalValue);
-
-    emit progress(currentValue, totalValue);
-    updateInfoLabel();
+    if (progressBar->value() != currentValue || progressBar->maximum() != totalValue) {
+        progressBar->setMaximum(totalValue);
+        progressBar->setValue(currentValue);
+        emit progress(currentValue, totalValue);
+    }
+    if (updateWidgets)
+        updateInfoLabel();
+    return bytes;
 }
 
 qint64 DownloadItem::bytesTotal() const
 {
+    if (m_bytesTotal > 0)
+        return m_bytesTotal;
+    if (!m_reply)
+        return 0;
     return m_reply->header(QNetworkRequest::ContentLengthHeader).toULongLong();
 }
 
@@ -372,7 +951,10 @@ double DownloadItem::remainingTime() const
     if (!downloading())
         return -1.0;
 
-    double timeRemaining = ((double)(bytesTotal() - bytesReceived())) / currentSpeed();
+    double speed = currentSpeed();
+    if (speed <= 0)
+        return -1.0;
+    double timeRemaining = ((double)(bytesTotal() - bytesReceived())) / speed;
 
     // When downloading the eta should never be 0
     if (timeRemaining == 0)
@@ -386,15 +968,20 @@ double DownloadItem::currentSpeed() const
     if (!downloading())
         return -1.0;
 
-    return m_bytesReceived * 1000.0 / m_downloadTime.elapsed();
+    if (m_speed >= 0)
+        return m_speed;
+    int elapsed = m_downloadTime.elapsed();
+    if (elapsed <= 0)
+        return 0;
+    return (m_bytesReceived - m_sessionOffset) * 1000.0 / elapsed;
 }
 
 void DownloadItem::updateInfoLabel()
 {
-    if (m_reply->error() != QNetworkReply::NoError)
+    if (m_reply && m_reply->error() != QNetworkReply::NoError)
         return;
 
-    qint64 bytesTotal = m_reply->header(QNetworkRequest::ContentLengthHeader).toULongLong();
+    qint64 bytesTotal = this->bytesTotal();
     bool running = !downloadedSuccessfully();
 
     // update info label
@@ -402,10 +989,12 @@ void DownloadItem::updateInfoLabel()
     double timeRemaining = remainingTime();
 
     QString info;
-    if (running) {
+    if (m_queued) {
+        info = tr("Queued");
+    } else if (running) {
         QString remaining;
 
-        if (bytesTotal != 0) {
+        if (bytesTotal != 0 && timeRemaining >= 0) {
             remaining = DownloadManager::timeString(timeRemaining);
         }
 
@@ -415,14 +1004,141 @@ void DownloadItem::updateInfoLabel()
             .arg(DownloadManager::dataString((int)speed))
             .arg(remaining);
     } else {
-        if (m_bytesReceived == bytesTotal)
+        if (m_bytesReceived == bytesTotal) {
             info = DownloadManager::dataString(m_output.size());
-        else
+            DownloadChecksum::Algorithm algorithm = DownloadChecksum::Sha256;
+            DownloadChecksum::algorithmForDigest(m_expectedChecksum, &algorithm);
+            QString name = DownloadChecksum::algorithmName(algorithm);
+            switch (verification()) {
+            case Verified:
+                info = tr("%1 - %2 verified").arg(info).arg(name);
+                break;
+            case VerificationFailed:
+                info = tr("%1 - %2 does not match!").arg(info).arg(name);
+                break;
+            case NotVerified:
+                if (!m_sha256.isEmpty())
+                    info = tr("%1 - SHA-256 %2").arg(info).arg(QLatin1String(m_sha256));
+                break;
+            }
+        } else {
             info = tr("%1 of %2 - Stopped")
                 .arg(DownloadManager::dataString(m_bytesReceived))
                 .arg(DownloadManager::dataString(bytesTotal));
+        }
+    }
+    if (downloadInfoLabel->text() != info)
+        downloadInfoLabel->setText(info);
+
+    QString toolTip;
+    if (!m_sha256.isEmpty()) {
+        toolTip = tr("SHA-256: %1\nMD5: %2")
+            .arg(QLatin1String(m_sha256))
+            .arg(QLatin1String(m_md5));
+    }
+    if (downloadInfoLabel->toolTip() != toolTip)
+        downloadInfoLabel->setToolTip(toolTip);
+}
+
+QByteArray DownloadItem::checksum(DownloadChecksum::Algorithm algorithm) const
+{
+    return (algorithm == DownloadChecksum::Sha256) ? m_sha256 : m_md5;
+}
+
+QByteArray DownloadItem::expectedChecksum() const
+{
+    return m_expectedChecksum;
+}
+
+/*
+    Sets the SHA-256 or MD5 digest the file should have, the kind is told
+    from its length.  Returns false if \a hexDigest is neither.
+ */
+bool DownloadItem::setExpectedChecksum(const QByteArray &hexDigest)
+{
+    QByteArray digest = hexDigest.trimmed().toLower();
+    if (!digest.isEmpty() && !DownloadChecksum::algorithmForDigest(digest, 0))
+        return false;
+    if (digest == m_expectedChecksum)
+        return true;
+    m_expectedChecksum = digest;
+    updateInfoLabel();
+    emit statusChanged();
+    return true;
+}
+
+DownloadItem::Verification DownloadItem::verification() const
+{
+    DownloadChecksum::Algorithm algorithm;
+    if (!DownloadChecksum::algorithmForDigest(m_expectedChecksum, &algorithm))
+        return NotVerified;
+    QByteArray digest = checksum(algorithm);
+    if (digest.isEmpty())
+        return NotVerified;
+    return (digest == m_expectedChecksum) ? Verified : VerificationFailed;
+}
+
+void DownloadItem::enterChecksum()
+{
+    bool ok;
+    QString digest = QInputDialog::getText(this, tr("Verify Checksum"),
+                                           tr("SHA-256 or MD5 checksum of %1:").arg(fileNameLabel->text()),
+                                           QLineEdit::Normal, QLatin1String(m_expectedChecksum), &ok);
+    if (!ok)
+        return;
+    if (!setExpectedChecksum(digest.toLatin1())) {
+        QMessageBox::warning(this, tr("Verify Checksum"),
+                             tr("%1 is not a SHA-256 or MD5 checksum.").arg(digest));
     }
-    downloadInfoLabel->setText(info);
+}
+
+/*
+    Looks for the file name with .sha256 appended in the same directory
+    on the server, unless the user already entered a checksum.
+ */
+void DownloadItem::fetchChecksumFile()
+{
+    if (!m_expectedChecksum.isEmpty() || m_checksumReply)
+        return;
+    QString scheme = m_url.scheme();
+    if (scheme != QLatin1String("http") && scheme != QLatin1String("https")
+        && scheme != QLatin1String("ftp"))
+        return;
+    QSettings settings;
+    settings.beginGroup(QLatin1String("downloadmanager"));
+    if (!settings.value(QLatin1String("fetchChecksums"), true).toBool())
+        return;
+
+    QUrl url = m_url;
+    url.setPath(m_url.path() + QLatin1String(".sha256"));
+    url.setEncodedQuery(QByteArray());
+    url.setFragment(QString());
+    m_checksumReply = BrowserApplication::networkAccessManager()->get(QNetworkRequest(url));
+    m_checksumReply->setParent(this);
+    connect(m_checksumReply, SIGNAL(finished()),
+            this, SLOT(checksumFileFinished()));
+}
+
+void DownloadItem::checksumFileFinished()
+{
+    QNetworkReply *reply = m_checksumReply;
+    m_checksumReply = 0;
+    if (!reply)
+        return;
+    reply->deleteLater();
+
+    QVariant status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute);
+    if (reply->error() != QNetworkReply::NoError
+        || (status.isValid() && status.toInt() != 200))
+        return;
+    // A checksum file is small, anything else isn't one
+    QByteArray contents = reply->read(64 * 1024);
+    QByteArray digest = DownloadChecksum::parseChecksumFile(contents, QFileInfo(m_url.path()).fileName());
+#ifdef DOWNLOADMANAGER_DEBUG
+    qDebug() << "DownloadItem::" << __FUNCTION__ << reply->url() << digest;
+#endif
+    if (!digest.isEmpty() && m_expectedChecksum.isEmpty())
+        setExpectedChecksum(digest);
 }
 
 bool DownloadItem::downloading() const
@@ -437,16 +1153,65 @@ bool DownloadItem::downloadedSuccessfully() const
 
 void DownloadItem::finished()
 {
+    int index = segmentIndex(sender());
+    if (index != -1)
+        m_segments[index].finished = true;
+    for (int i = 0; i < m_segments.count(); ++i) {
+        if (m_segments.at(i).reply && !m_segments.at(i).finished)
+            return;
+    }
+
     m_finishedDownloading = true;
     if (!m_startedSaving) {
         return;
     }
+    if (hasBufferedData())
+        return;
+
+    // Done once the writer has written everything
+    m_writer->close(isComplete());
+    if (!m_writer->isBusy())
+        writerFinished();
+}
+
+bool DownloadItem::isComplete() const
+{
+    if (m_aborting)
+        return false;
+    for (int i = 0; i < m_segments.count(); ++i) {
+        const Segment &segment = m_segments.at(i);
+        if (segment.end != -1 && segment.position <= segment.end)
+            return false;
+    }
+    return m_segments.count() != 1 || m_bytesReceived >= m_bytesTotal;
+}
+
+void DownloadItem::writerFinished()
+{
+    if (!m_finishedDownloading || m_writer->isBusy())
+        return;
+
+    updateProgress(false);
     progressBar->hide();
     stopButton->setEnabled(false);
     stopButton->hide();
     openButton->setEnabled(true);
-    m_output.close();
     updateInfoLabel();
+
+    // A segment that ended early is resumed by trying again
+    if (!m_aborting && !isComplete()) {
+        tryAgainButton->setEnabled(true);
+        tryAgainButton->setVisible(true);
+        downloadInfoLabel->setText(tr("%1 of %2 - Stopped")
+            .arg(DownloadManager::dataString(m_bytesReceived))
+            .arg(DownloadManager::dataString(bytesTotal())));
+    } else if (!m_aborting) {
+        m_sha256 = m_writer->checksum(DownloadChecksum::Sha256);
+        m_md5 = m_writer->checksum(DownloadChecksum::Md5);
+        updateInfoLabel();
+        if (!m_sha256.isEmpty())
+            fetchChecksumFile();
+    }
     emit statusChanged();
 }
 
@@ -459,10 +1224,14 @@ void DownloadItem::finished()
 DownloadManager::DownloadManager(QWidget *parent)
     : QDialog(parent)
     , m_autoSaver(new AutoSaver(this))
+    , m_journal(new DownloadJournal(this))
+    , m_downloadsLoaded(false)
     , m_model(new DownloadModel(this))
     , m_manager(BrowserApplication::networkAccessManager())
     , m_iconProvider(0)
     , m_removePolicy(Never)
+    , m_maximumActiveDownloads(3)
+    , m_maximumRate(0)
 {
     setupUi(this);
 
@@ -479,6 +1248,9 @@ DownloadManager::DownloadManager(QWidget *parent)
     downloadsView->setModel(m_model);
     connect(cleanupButton, SIGNAL(clicked()), this, SLOT(cleanup()));
     connect(buttonBox, SIGNAL(rejected()), this, SLOT(close()));
+    m_progressTimer.setInterval(250);
+    connect(&m_progressTimer, SIGNAL(timeout()), this, SLOT(updateProgress()));
+    m_journal->setFileName(BrowserApplication::dataFilePath(QLatin1String("downloads.dat")));
     load();
 }
 
@@ -500,6 +1272,21 @@ int DownloadManager::activeDownloads() const
     return count;
 }
 
+/*
+    The downloads that are reading from the network, without the queued
+    ones.
+ */
+int DownloadManager::runningDownloads() const
+{
+    int count = 0;
+    for (int i = 0; i < m_downloads.count(); ++i) {
+        DownloadItem *item = m_downloads.at(i);
+        if (item->stopButton->isEnabled() && !item->isQueued())
+            ++count;
+    }
+    return count;
+}
+
 bool DownloadManager::allowQuit()
 {
     if (activeDownloads() >= 1) {
@@ -536,6 +1323,20 @@ void DownloadManager::download(const QNetworkRequest &request, bool requestFileN
         return;
     if (externalDownload(request.url()))
         return;
+
+    // Waiting downloads don't send their request yet
+    if (mustQueue()) {
+        DownloadItem *item = new DownloadItem(0, requestFileName, this);
+        item->setQueuedRequest(request);
+        addItem(item);
+        if (item->m_canceledFileSelect)
+            return;
+        if (!isVisible())
+            show();
+        activateWindow();
+        raise();
+        return;
+    }
     handleUnsupportedContent(m_manager->get(request), requestFileName);
 }
 
@@ -571,6 +1372,15 @@ void DownloadManager::handleUnsupportedContent(QNetworkReply *reply, bool reques
 
 void DownloadManager::addItem(DownloadItem *item)
 {
+    // The earlier downloads come first
+    loadDownloads();
+
+    if (item->m_reply && item->stopButton->isEnabled() && mustQueue())
+        item->setQueued(true);
+
+    if (!m_journalIds.contains(item))
+        m_journalIds.insert(item, m_journal->addEntry(journalEntry(item)));
+
     connect(item, SIGNAL(statusChanged()), this, SLOT(updateRow()));
     int row = m_downloads.count();
     m_model->beginInsertRows(QModelIndex(), row, row);
@@ -618,7 +1428,148 @@ void DownloadManager::updateRow(DownloadItem *item)
     if (remove)
         m_model->removeRow(row);
 
-    cleanupButton->setEnabled(m_downloads.count() - activeDownloads() > 0);
+    schedule();
+    int active = activeDownloads();
+    cleanupButton->setEnabled(m_downloads.count() - active > 0);
+    if (active > 0 && !m_progressTimer.isActive()) {
+        m_lastProgressTime.start();
+        m_progressTimer.start();
+    }
+    m_autoSaver->changeOccurred();
+}
+
+/*
+    Updates the progress of every running download and the bandwidth
+    graph four times a second, however fast the data comes in.
+ */
+void DownloadManager::updateProgress()
+{
+    // Downloads that were stopped don't always report it
+    schedule();
+
+    bool visible = isVisible();
+    int running = runningDownloads();
+    qint64 bytes = 0;
+    for (int i = 0; i < m_downloads.count(); ++i) {
+        DownloadItem *item = m_downloads.at(i);
+        if (item->stopButton->isEnabled() && !item->isQueued()) {
+            bytes += item->updateProgress(visible);
+            item->setReadAllowance(readAllowance(item, running));
+        }
+    }
+    int elapsed = m_lastProgressTime.restart();
+    if (elapsed > 0)
+        bandwidthGraph->addSample(bytes * 1000 / elapsed);
+
+    if (activeDownloads() == 0) {
+        m_progressTimer.stop();
+        bandwidthGraph->addSample(0);
+    }
+}
+
+/*
+    The bytes \a item may read until the next update, the rate limit of
+    the manager is shared evenly between the \a running downloads.
+ */
+qint64 DownloadManager::readAllowance(DownloadItem *item, int running) const
+{
+    qint64 interval = m_progressTimer.interval();
+    qint64 allowance = -1;
+    if (m_maximumRate > 0 && running > 0)
+        allowance = qMax(qint64(1), m_maximumRate * interval / 1000 / running);
+    if (item->maximumRate() > 0) {
+        qint64 itemAllowance = qMax(qint64(1), item->maximumRate() * interval / 1000);
+        allowance = (allowance == -1) ? itemAllowance : qMin(allowance, itemAllowance);
+    }
+    return allowance;
+}
+
+/*
+    Returns true if a new download has to wait behind the running or
+    queued downloads.
+ */
+bool DownloadManager::mustQueue() const
+{
+    int running = 0;
+    for (int i = 0; i < m_downloads.count(); ++i) {
+        DownloadItem *item = m_downloads.at(i);
+        if (item->isQueued())
+            return true;
+        if (item->stopButton->isEnabled())
+            ++running;
+    }
+    return running >= m_maximumActiveDownloads;
+}
+
+/*
+    Starts queued downloads, the ones with the highest priority first,
+    until maximumActiveDownloads() are running.
+ */
+void DownloadManager::schedule()
+{
+    // One pass over the list, stable so equal priorities keep their order
+    int running = 0;
+    QList<DownloadItem*> queued;
+    for (int i = 0; i < m_downloads.count(); ++i) {
+        DownloadItem *item = m_downloads.at(i);
+        if (item->isQueued()) {
+            int j = queued.count();
+            while (j > 0 && queued.at(j - 1)->priority() < item->priority())
+                --j;
+            queued.insert(j, item);
+        } else if (item->stopButton->isEnabled()) {
+            ++running;
+        }
+    }
+
+    for (int i = 0; i < queued.count() && running < m_maximumActiveDownloads; ++i) {
+        DownloadItem *next = queued.at(i);
+        ++running;
+        next->setReadAllowance(readAllowance(next, running));
+        next->setQueued(false);
+    }
+}
+
+int DownloadManager::maximumActiveDownloads() const
+{
+    return m_maximumActiveDownloads;
+}
+
+/*
+    Downloads that are added while this many are running wait in a
+    queue, so they don't take the whole connection from the pages.
+ */
+void DownloadManager::setMaximumActiveDownloads(int count)
+{
+    count = qMax(1, count);
+    if (count == m_maximumActiveDownloads)
+        return;
+    m_maximumActiveDownloads = count;
+    m_autoSaver->changeOccurred();
+    schedule();
+}
+
+qint64 DownloadManager::maximumRate() const
+{
+    return m_maximumRate;
+}
+
+/*
+    Limits all downloads together to \a bytesPerSecond, 0 means no limit.
+ */
+void DownloadManager::setMaximumRate(qint64 bytesPerSecond)
+{
+    bytesPerSecond = qMax(qint64(0), bytesPerSecond);
+    if (bytesPerSecond == m_maximumRate)
+        return;
+    m_maximumRate = bytesPerSecond;
+    m_autoSaver->changeOccurred();
+    int running = runningDownloads();
+    for (int i = 0; i < m_downloads.count(); ++i) {
+        DownloadItem *item = m_downloads.at(i);
+        if (item->stopButton->isEnabled() && !item->isQueued())
+            item->setReadAllowance(readAllowance(item, running));
+    }
 }
 
 DownloadManager::RemovePolicy DownloadManager::removePolicy() const
@@ -641,23 +1592,52 @@ void DownloadManager::save() const
     QMetaEnum removePolicyEnum = staticMetaObject.enumerator(staticMetaObject.indexOfEnumerator("RemovePolicy"));
     settings.setValue(QLatin1String("removeDownloadsPolicy"), QLatin1String(removePolicyEnum.valueToKey(m_removePolicy)));
     settings.setValue(QLatin1String("size"), size());
-    if (m_removePolicy == Exit)
+    settings.setValue(QLatin1String("maximumActiveDownloads"), m_maximumActiveDownloads);
+    settings.setValue(QLatin1String("maximumRate"), m_maximumRate);
+    if (!m_downloadsLoaded)
+        return;
+    if (m_removePolicy == Exit) {
+        m_journal->clear();
+        m_journal->flush();
         return;
+    }
 
+    // Only the downloads that changed are written
     for (int i = 0; i < m_downloads.count(); ++i) {
-        QString key = QString(QLatin1String("download_%1_")).arg(i);
-        settings.setValue(key + QLatin1String("url"), m_downloads[i]->m_url);
-        settings.setValue(key + QLatin1String("location"), QFileInfo(m_downloads[i]->m_output).filePath());
-        settings.setValue(key + QLatin1String("done"), m_downloads[i]->downloadedSuccessfully());
+        DownloadItem *item = m_downloads.at(i);
+        m_journal->setEntry(m_journalIds.value(item), journalEntry(item));
     }
-    int i = m_downloads.count();
-    QString key = QString(QLatin1String("download_%1_")).arg(i);
-    while (settings.contains(key + QLatin1String("url"))) {
-        settings.remove(key + QLatin1String("url"));
-        settings.remove(key + QLatin1String("location"));
-        settings.remove(key + QLatin1String("done"));
-        key = QString(QLatin1String("download_%1_")).arg(++i);
+    m_journal->flush();
+}
+
+DownloadJournal::Entry DownloadManager::journalEntry(const DownloadItem *item)
+{
+    DownloadJournal::Entry entry;
+    entry.url = item->m_url;
+    entry.fileName = QFileInfo(item->m_output).filePath();
+    entry.done = item->downloadedSuccessfully();
+    // Imported downloads have no segments
+    if (item->m_segments.isEmpty())
+        entry.bytesReceived = item->m_bytesReceived;
+    entry.bytesTotal = item->m_bytesTotal;
+    entry.entityTag = item->m_entityTag;
+    entry.lastModified = item->m_lastModified;
+    entry.acceptRanges = item->m_acceptRanges;
+    entry.sha256 = item->m_sha256;
+    entry.md5 = item->m_md5;
+    entry.expectedChecksum = item->m_expectedChecksum;
+    // Only what the writer has written can be resumed from, the rest
+    // might still be queued when the browser goes away
+    for (int i = 0; i < item->m_segments.count(); ++i) {
+        const DownloadItem::Segment &itemSegment = item->m_segments.at(i);
+        DownloadJournal::Segment segment;
+        segment.start = itemSegment.start;
+        segment.position = qMax(itemSegment.start, itemSegment.committed);
+        segment.end = itemSegment.end;
+        entry.segments.append(segment);
+        entry.bytesReceived += segment.position - segment.start;
     }
+    return entry;
 }
 
 void DownloadManager::load()
@@ -672,32 +1652,96 @@ void DownloadManager::load()
     m_removePolicy = removePolicyEnum.keyToValue(value) == -1 ?
                         Never :
                         static_cast<RemovePolicy>(removePolicyEnum.keyToValue(value));
+    m_maximumActiveDownloads = qMax(1, settings.value(QLatin1String("maximumActiveDownloads"), 3).toInt());
+    m_maximumRate = qMax(qint64(0), settings.value(QLatin1String("maximumRate"), 0).toLongLong());
+    cleanupButton->setEnabled(false);
+}
 
+/*
+    The downloads of earlier sessions are only read once they are
+    shown or a new download is added.
+ */
+void DownloadManager::loadDownloads()
+{
+    if (m_downloadsLoaded)
+        return;
+    m_downloadsLoaded = true;
+
+    if (!m_journal->exists())
+        importSettings();
+
+    foreach (int id, m_journal->entries()) {
+        DownloadJournal::Entry entry = m_journal->entry(id);
+        if (entry.url.isEmpty() || entry.fileName.isEmpty())
+            continue;
+        DownloadItem *item = new DownloadItem(0, this);
+        item->m_output.setFileName(entry.fileName);
+        item->fileNameLabel->setText(QFileInfo(item->m_output.fileName()).fileName());
+        item->m_url = entry.url;
+        item->m_bytesReceived = entry.bytesReceived;
+        item->m_bytesTotal = entry.bytesTotal;
+        item->m_entityTag = entry.entityTag;
+        item->m_lastModified = entry.lastModified;
+        item->m_acceptRanges = entry.acceptRanges;
+        item->m_sha256 = entry.sha256;
+        item->m_md5 = entry.md5;
+        item->m_expectedChecksum = entry.expectedChecksum;
+        foreach (const DownloadJournal::Segment &segment, entry.segments) {
+            DownloadItem::Segment itemSegment;
+            itemSegment.start = segment.start;
+            itemSegment.position = segment.position;
+            itemSegment.committed = segment.position;
+            itemSegment.end = segment.end;
+            item->m_segments.append(itemSegment);
+        }
+        m_journalIds.insert(item, id);
+        addItem(item);
+        item->stopButton->setVisible(false);
+        item->stopButton->setEnabled(false);
+        item->tryAgainButton->setVisible(!entry.done);
+        item->tryAgainButton->setEnabled(!entry.done);
+        item->progressBar->setVisible(false);
+        if (entry.done && !entry.sha256.isEmpty())
+            item->updateInfoLabel();
+    }
+    cleanupButton->setEnabled(m_downloads.count() - activeDownloads() > 0);
+}
+
+/*
+    Moves the downloads that older versions kept in the settings
+    into the journal.
+ */
+void DownloadManager::importSettings()
+{
+    QSettings settings;
+    settings.beginGroup(QLatin1String("downloadmanager"));
     int i = 0;
     QString key = QString(QLatin1String("download_%1_")).arg(i);
     while (settings.contains(key + QLatin1String("url"))) {
-        QUrl url = settings.value(key + QLatin1String("url")).toUrl();
-        QString fileName = settings.value(key + QLatin1String("location")).toString();
-        bool done = settings.value(key + QLatin1String("done"), true).toBool();
-        if (!url.isEmpty() && !fileName.isEmpty()) {
-            DownloadItem *item = new DownloadItem(0, this);
-            item->m_output.setFileName(fileName);
-            item->fileNameLabel->setText(QFileInfo(item->m_output.fileName()).fileName());
-            item->m_url = url;
-            addItem(item);
-            item->stopButton->setVisible(false);
-            item->stopButton->setEnabled(false);
-            item->tryAgainButton->setVisible(!done);
-            item->tryAgainButton->setEnabled(!done);
-            item->progressBar->setVisible(false);
-        }
+        DownloadJournal::Entry entry;
+        entry.url = settings.value(key + QLatin1String("url")).toUrl();
+        entry.fileName = settings.value(key + QLatin1String("location")).toString();
+        entry.done = settings.value(key + QLatin1String("done"), true).toBool();
+        if (!entry.url.isEmpty() && !entry.fileName.isEmpty())
+            m_journal->addEntry(entry);
+        settings.remove(key + QLatin1String("url"));
+        settings.remove(key + QLatin1String("location"));
+        settings.remove(key + QLatin1String("done"));
         key = QString(QLatin1String("download_%1_")).arg(++i);
     }
-    cleanupButton->setEnabled(m_downloads.count() - activeDownloads() > 0);
+    if (i > 0)
+        m_journal->flush();
+}
+
+void DownloadManager::showEvent(QShowEvent *event)
+{
+    loadDownloads();
+    QDialog::showEvent(event);
 }
 
 void DownloadManager::cleanup()
 {
+    loadDownloads();
     if (m_downloads.isEmpty())
         return;
     m_model->removeRows(0, m_downloads.count());
@@ -797,7 +1841,9 @@ bool DownloadModel::removeRows(int row, int count, const QModelIndex &parent)
         if (m_downloadManager->m_downloads.at(i)->downloadedSuccessfully()
             || m_downloadManager->m_downloads.at(i)->tryAgainButton->isEnabled()) {
             beginRemoveRows(parent, i, i);
-            m_downloadManager->m_downloads.takeAt(i)->deleteLater();
+            DownloadItem *item = m_downloadManager->m_downloads.takeAt(i);
+            m_downloadManager->m_journal->removeEntry(m_downloadManager->m_journalIds.take(item));
+            item->deleteLater();
             endRemoveRows();
         }
     }
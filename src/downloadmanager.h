@@ -67,11 +67,17 @@
 #include "ui_downloads.h"
 #include "ui_downloaditem.h"
 
+#include "downloadchecksum.h"
+#include "downloadjournal.h"
+
 #include <qnetworkreply.h>
 
 #include <qfile.h>
 #include <qdatetime.h>
+#include <qhash.h>
+#include <qtimer.h>
 
+class DownloadWriter;
 class DownloadItem : public QWidget, public Ui_DownloadItem
 {
     Q_OBJECT
@@ -81,19 +87,46 @@ signals:
     void progress(qint64 bytesReceived = 0, qint64 bytesTotal = 0);
 
 public:
+    enum Priority {
+        LowPriority,
+        NormalPriority,
+        HighPriority
+    };
+
+    enum Verification {
+        NotVerified,
+        Verified,
+        VerificationFailed
+    };
+
     DownloadItem(QNetworkReply *reply = 0, bool requestFileName = false, QWidget *parent = 0);
     bool downloading() const;
     bool downloadedSuccessfully() const;
+    bool isQueued() const;
+    void setQueuedRequest(const QNetworkRequest &request);
+
+    Priority priority() const;
+    void setPriority(Priority priority);
+    qint64 maximumRate() const;
+    void setMaximumRate(qint64 bytesPerSecond);
+
+    QByteArray checksum(DownloadChecksum::Algorithm algorithm) const;
+    QByteArray expectedChecksum() const;
+    bool setExpectedChecksum(const QByteArray &hexDigest);
+    Verification verification() const;
 
     qint64 bytesTotal() const;
     qint64 bytesReceived() const;
     double remainingTime() const;
     double currentSpeed() const;
 
+    static bool parseContentRange(const QByteArray &value, qint64 *start, qint64 *end, qint64 *total);
+
     QUrl m_url;
 
     QFile m_output;
     QNetworkReply *m_reply;
+    QNetworkRequest m_request;
 
 private slots:
     void stop();
@@ -102,18 +135,64 @@ private slots:
 
     void downloadReadyRead();
     void error(QNetworkReply::NetworkError code);
-    void downloadProgress(qint64 bytesReceived, qint64 bytesTotal);
     void metaDataChanged();
     void finished();
+    void dataWritten(int segmentId, qint64 position);
+    void writeError(const QString &errorString);
+    void writerFinished();
+    void enterChecksum();
+    void checksumFileFinished();
 
 private:
+    struct Segment {
+        Segment();
+        int id;
+        QNetworkReply *reply;
+        qint64 start;
+        qint64 position;
+        qint64 committed;
+        qint64 end;
+        bool finished;
+    };
+
     void getFileName();
     void init();
+    void connectReply(QNetworkReply *reply);
+    void setQueued(bool queued);
+    void releaseReply();
+    void setReadAllowance(qint64 bytes);
+    qint64 readBufferSize() const;
+    void updateReadBufferSize();
+    bool hasBufferedData() const;
+    qint64 updateProgress(bool updateWidgets);
     void updateInfoLabel();
+    void openOutput();
 
     QString saveFileName(const QString &directory) const;
 
+    int segmentIndex(QObject *reply) const;
+    void readValidators(QNetworkReply *reply);
+    bool sameValidators(QNetworkReply *reply) const;
+    QByteArray validator() const;
+    QNetworkRequest rangeRequest(qint64 start, qint64 end) const;
+    bool canResume() const;
+    bool shouldSplit() const;
+    void split();
+    void restartWith(QNetworkReply *reply);
+    bool isComplete() const;
+    void fetchChecksumFile();
+
+    QList<Segment> m_segments;
+    QByteArray m_entityTag;
+    QByteArray m_lastModified;
+    bool m_acceptRanges;
+    bool m_resuming;
+    bool m_aborting;
+    qint64 m_bytesTotal;
+    qint64 m_sessionOffset;
+    DownloadWriter *m_writer;
     bool m_requestFileName;
+    bool m_keepFileName;
     qint64 m_bytesReceived;
     QTime m_downloadTime;
     bool m_startedSaving;
@@ -121,6 +200,16 @@ private:
     bool m_gettingFileName;
     bool m_canceledFileSelect;
     QTime m_lastProgressTime;
+    qint64 m_lastProgressBytes;
+    double m_speed;
+    bool m_queued;
+    Priority m_priority;
+    qint64 m_maximumRate;
+    qint64 m_readAllowance;
+    QByteArray m_sha256;
+    QByteArray m_md5;
+    QByteArray m_expectedChecksum;
+    QNetworkReply *m_checksumReply;
 
     friend class DownloadManager;
 };
@@ -148,8 +237,14 @@ public:
     DownloadManager(QWidget *parent = 0);
     ~DownloadManager();
     int activeDownloads() const;
+    int runningDownloads() const;
     bool allowQuit();
 
+    int maximumActiveDownloads() const;
+    void setMaximumActiveDownloads(int count);
+    qint64 maximumRate() const;
+    void setMaximumRate(qint64 bytesPerSecond);
+
     RemovePolicy removePolicy() const;
     void setRemovePolicy(RemovePolicy policy);
 
@@ -166,24 +261,42 @@ public slots:
     void handleUnsupportedContent(QNetworkReply *reply, bool requestFileName = false);
     void cleanup();
 
+protected:
+    void showEvent(QShowEvent *event);
+
 private slots:
     void save() const;
     void updateRow(DownloadItem *item);
     void updateRow();
+    void updateProgress();
 
 private:
     void addItem(DownloadItem *item);
     void updateItemCount();
+    bool mustQueue() const;
+    void schedule();
+    qint64 readAllowance(DownloadItem *item, int running) const;
     void load();
+    void loadDownloads();
+    void importSettings();
     bool externalDownload(const QUrl &url);
 
+    static DownloadJournal::Entry journalEntry(const DownloadItem *item);
+
     AutoSaver *m_autoSaver;
+    DownloadJournal *m_journal;
+    QHash<DownloadItem*, int> m_journalIds;
+    bool m_downloadsLoaded;
     DownloadModel *m_model;
     QNetworkAccessManager *m_manager;
     QFileIconProvider *m_iconProvider;
     QList<DownloadItem*> m_downloads;
     RemovePolicy m_removePolicy;
     QString m_downloadDirectory;
+    QTimer m_progressTimer;
+    QTime m_lastProgressTime;
+    int m_maximumActiveDownloads;
+    qint64 m_maximumRate;
 
     friend class DownloadModel;
 };
@@ -0,0 +1,361 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "downloadwriter.h"
+
+#include <qdebug.h>
+
+// #define DOWNLOADWRITER_DEBUG
+
+DownloadWriter::DownloadWriter(QObject *parent)
+    : QThread(parent)
+    , m_queuedBytes(0)
+    , m_maximumQueuedBytes(4 * 1024 * 1024)
+    , m_full(false)
+    , m_open(false)
+    , m_running(false)
+    , m_working(false)
+    , m_session(0)
+    , m_fileSession(0)
+    , m_sha256(DownloadChecksum::Sha256)
+    , m_md5(DownloadChecksum::Md5)
+    , m_hashed(0)
+{
+}
+
+DownloadWriter::~DownloadWriter()
+{
+    close();
+    wait();
+}
+
+qint64 DownloadWriter::maximumQueuedBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maximumQueuedBytes;
+}
+
+void DownloadWriter::setMaximumQueuedBytes(qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maximumQueuedBytes = qMax(qint64(1), bytes);
+}
+
+/*
+    Queues opening \a fileName, when \a size is known the thread makes
+    the file that large before anything is written so the disk doesn't
+    have to grow it while writing.  A file that is still open is closed
+    first.
+
+    Failing to open the file is reported with error().  When the same
+    file is opened again to resume it the digests carry on.
+ */
+void DownloadWriter::open(const QString &fileName, QIODevice::OpenMode mode, qint64 size)
+{
+    close();
+
+    Operation operation(Operation::Open);
+    operation.fileName = fileName;
+    operation.mode = mode;
+    operation.size = size;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_open = true;
+        m_full = false;
+        m_errorString.clear();
+        operation.session = ++m_session;
+    }
+    enqueue(operation);
+}
+
+bool DownloadWriter::isOpen() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_open;
+}
+
+/*
+    Queues closing the file after the data that was queued before,
+    closed() is emitted when that is done.  Doesn't wait for it.
+
+    With \a finishChecksums the whole file is known to be complete and
+    what wasn't hashed yet is read back so checksum() can be asked for.
+ */
+void DownloadWriter::close(bool finishChecksums)
+{
+    Operation operation(Operation::Close);
+    operation.finishChecksums = finishChecksums;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_open)
+            return;
+        m_open = false;
+        operation.session = m_session;
+    }
+    enqueue(operation);
+}
+
+/*
+    Returns true while there are queued operations the thread didn't
+    finish yet.
+ */
+bool DownloadWriter::isBusy() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_working || !m_queue.isEmpty();
+}
+
+QString DownloadWriter::errorString() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_errorString;
+}
+
+/*
+    Queues \a data to be written at \a offset and returns false once the
+    queue is full.  written() is emitted with \a tag once it is written.
+ */
+bool DownloadWriter::write(qint64 offset, const QByteArray &data, int tag)
+{
+    Operation operation(Operation::Write);
+    operation.offset = offset;
+    operation.data = data;
+    operation.tag = tag;
+    enqueue(operation);
+    return !isFull();
+}
+
+void DownloadWriter::resize(qint64 size)
+{
+    Operation operation(Operation::Resize);
+    operation.size = qMax(qint64(0), size);
+    enqueue(operation);
+}
+
+void DownloadWriter::enqueue(Operation &operation)
+{
+    QMutexLocker locker(&m_mutex);
+    if (operation.type == Operation::Write || operation.type == Operation::Resize) {
+        if (!m_open)
+            return;
+        operation.session = m_session;
+    }
+    m_queue.enqueue(operation);
+    m_queuedBytes += operation.data.size();
+    if (m_queuedBytes >= m_maximumQueuedBytes)
+        m_full = true;
+    if (m_running) {
+        m_condition.wakeOne();
+        return;
+    }
+    m_running = true;
+    locker.unlock();
+    // run() may still be returning after it found nothing left to do
+    wait();
+    start();
+}
+
+/*
+    Returns the hex digest of the file after it was closed with
+    close(true), or an empty array.
+ */
+QByteArray DownloadWriter::checksum(DownloadChecksum::Algorithm algorithm) const
+{
+    QMutexLocker locker(&m_mutex);
+    return (algorithm == DownloadChecksum::Sha256) ? m_sha256Result : m_md5Result;
+}
+
+void DownloadWriter::resetChecksums()
+{
+    m_sha256.reset();
+    m_md5.reset();
+    m_hashed = 0;
+}
+
+void DownloadWriter::addToChecksums(const char *data, int length)
+{
+    m_sha256.addData(data, length);
+    m_md5.addData(data, length);
+    m_hashed += length;
+}
+
+// Hashes what was written past the hashed part, in the writer thread
+bool DownloadWriter::finishChecksums()
+{
+    qint64 size = m_file.size();
+    if (m_hashed > size || !m_file.seek(m_hashed))
+        return false;
+    while (m_hashed < size) {
+        QByteArray data = m_file.read(qMin(size - m_hashed, qint64(64 * 1024)));
+        if (data.isEmpty())
+            return false;
+        addToChecksums(data.constData(), data.size());
+    }
+#ifdef DOWNLOADWRITER_DEBUG
+    qDebug() << "DownloadWriter::" << __FUNCTION__ << m_file.fileName() << m_sha256.result();
+#endif
+    return true;
+}
+
+qint64 DownloadWriter::queuedBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_queuedBytes;
+}
+
+bool DownloadWriter::isFull() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_queuedBytes >= m_maximumQueuedBytes;
+}
+
+bool DownloadWriter::openFile(const Operation &operation)
+{
+    if (operation.fileName != m_file.fileName() || !(operation.mode & QIODevice::ReadOnly))
+        resetChecksums();
+    m_file.setFileName(operation.fileName);
+    m_fileSession = operation.session;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_sha256Result.clear();
+        m_md5Result.clear();
+    }
+    if (!m_file.open(operation.mode))
+        return false;
+    if (operation.size > 0 && m_file.size() < operation.size && !m_file.resize(operation.size))
+        qWarning() << "DownloadWriter: Unable to preallocate" << operation.fileName << m_file.errorString();
+    return true;
+}
+
+bool DownloadWriter::writeData(const Operation &operation)
+{
+    // Flushed so written() doesn't claim data that is still in the buffer of the file
+    bool ok = (m_file.pos() == operation.offset || m_file.seek(operation.offset))
+              && m_file.write(operation.data) == operation.data.size()
+              && m_file.flush();
+    // Only data that continues the hashed part can be hashed now
+    qint64 end = operation.offset + operation.data.size();
+    if (ok && operation.offset <= m_hashed && end > m_hashed) {
+        int skip = m_hashed - operation.offset;
+        addToChecksums(operation.data.constData() + skip, operation.data.size() - skip);
+    }
+    return ok;
+}
+
+bool DownloadWriter::resizeFile(qint64 size)
+{
+    // Starting over
+    if (size < m_hashed)
+        resetChecksums();
+    return m_file.resize(size);
+}
+
+void DownloadWriter::closeFile(bool finishChecksums)
+{
+    if (finishChecksums) {
+        bool ok = m_file.flush() && this->finishChecksums();
+        if (!ok)
+            qWarning() << "DownloadWriter: Unable to compute the checksums of" << m_file.fileName() << m_file.errorString();
+        QMutexLocker locker(&m_mutex);
+        if (ok) {
+            m_sha256Result = m_sha256.result();
+            m_md5Result = m_md5.result();
+        }
+    }
+    m_file.close();
+}
+
+void DownloadWriter::run()
+{
+    forever {
+        m_mutex.lock();
+        while (m_queue.isEmpty()) {
+            if (!m_file.isOpen()) {
+                m_running = false;
+                m_mutex.unlock();
+                return;
+            }
+            m_condition.wait(&m_mutex);
+        }
+        Operation operation = m_queue.dequeue();
+        m_working = true;
+        m_mutex.unlock();
+
+        // Whatever is left of a file that failed is dropped
+        bool ok = true;
+        bool wrote = false;
+        bool closed = false;
+        switch (operation.type) {
+        case Operation::Open:
+            ok = openFile(operation);
+            closed = !ok;
+            break;
+        case Operation::Write:
+            if (m_file.isOpen() && operation.session == m_fileSession) {
+                ok = writeData(operation);
+                wrote = ok;
+            }
+            break;
+        case Operation::Resize:
+            if (m_file.isOpen() && operation.session == m_fileSession)
+                ok = resizeFile(operation.size);
+            break;
+        case Operation::Close:
+            closed = m_file.isOpen() && operation.session == m_fileSession;
+            if (closed)
+                closeFile(operation.finishChecksums);
+            break;
+        }
+#ifdef DOWNLOADWRITER_DEBUG
+        qDebug() << "DownloadWriter::" << __FUNCTION__ << operation.type << operation.offset << operation.data.size() << ok;
+#endif
+
+        QString errorString;
+        if (!ok) {
+            errorString = m_file.errorString();
+            if (m_file.isOpen()) {
+                m_file.close();
+                closed = true;
+            }
+        }
+
+        m_mutex.lock();
+        m_working = false;
+        m_queuedBytes -= operation.data.size();
+        if (!ok) {
+            m_errorString = errorString;
+            // The download is stopped, nothing more is written to this file
+            if (operation.session == m_session)
+                m_open = false;
+        }
+        bool drained = m_full && m_queuedBytes <= m_maximumQueuedBytes / 2;
+        if (drained)
+            m_full = false;
+        m_mutex.unlock();
+
+        if (wrote)
+            emit written(operation.tag, operation.offset + operation.data.size());
+        if (!ok)
+            emit error(errorString);
+        if (drained)
+            emit drained();
+        if (closed)
+            emit closed();
+    }
+}
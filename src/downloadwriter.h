@@ -0,0 +1,137 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#ifndef DOWNLOADWRITER_H
+#define DOWNLOADWRITER_H
+
+#include <qthread.h>
+
+#include "downloadchecksum.h"
+
+#include <qfile.h>
+#include <qmutex.h>
+#include <qqueue.h>
+#include <qwaitcondition.h>
+
+/*
+    Writes the data of a download to its file in a thread of its own so
+    a slow disk doesn't block the user interface.
+
+    Opening, preallocating, writing and closing the file are queued and
+    done by the thread in that order, none of them waits for the disk.
+    The thread runs while a file is open or there is something queued.
+
+    Once data was handed to the operating system written() is emitted
+    with the tag that was given to write() and the offset the data ended
+    at, so the caller knows what is safe to resume from.
+
+    Data is handed over in a queue that holds at most maximumQueuedBytes(),
+    once it is full the caller should stop reading from the network until
+    drained() is emitted.  The byte arrays are implicitly shared so they
+    are not copied on the way.
+
+    The SHA-256 and MD5 digests are computed from the data as it is
+    written.  Data that is written past the hashed part, by other segments
+    or in an earlier session, is read back from the file when it is closed
+    with close(true).
+ */
+class DownloadWriter : public QThread
+{
+    Q_OBJECT
+
+signals:
+    void drained();
+    void written(int tag, qint64 position);
+    void error(const QString &errorString);
+    void closed();
+
+public:
+    DownloadWriter(QObject *parent = 0);
+    ~DownloadWriter();
+
+    qint64 maximumQueuedBytes() const;
+    void setMaximumQueuedBytes(qint64 bytes);
+
+    void open(const QString &fileName, QIODevice::OpenMode mode, qint64 size = -1);
+    bool isOpen() const;
+    void close(bool finishChecksums = false);
+    bool isBusy() const;
+    QString errorString() const;
+    QByteArray checksum(DownloadChecksum::Algorithm algorithm) const;
+
+    bool write(qint64 offset, const QByteArray &data, int tag = 0);
+    void resize(qint64 size);
+    qint64 queuedBytes() const;
+    bool isFull() const;
+
+protected:
+    void run();
+
+private:
+    struct Operation {
+        enum Type {
+            Open,
+            Write,
+            Resize,
+            Close
+        };
+        Operation(Type type = Write) : type(type), offset(0), size(-1),
+            mode(QIODevice::NotOpen), finishChecksums(false), tag(0), session(0) {}
+        Type type;
+        qint64 offset;
+        QByteArray data;
+        qint64 size;
+        QString fileName;
+        QIODevice::OpenMode mode;
+        bool finishChecksums;
+        int tag;
+        int session;
+    };
+
+    void enqueue(Operation &operation);
+    bool openFile(const Operation &operation);
+    bool writeData(const Operation &operation);
+    bool resizeFile(qint64 size);
+    void closeFile(bool finishChecksums);
+    void resetChecksums();
+    void addToChecksums(const char *data, int length);
+    bool finishChecksums();
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_condition;
+    QQueue<Operation> m_queue;
+    qint64 m_queuedBytes;
+    qint64 m_maximumQueuedBytes;
+    bool m_full;
+    bool m_open;
+    bool m_running;
+    bool m_working;
+    int m_session;
+    QString m_errorString;
+    QByteArray m_sha256Result;
+    QByteArray m_md5Result;
+
+    // Only used by the thread
+    QFile m_file;
+    int m_fileSession;
+    DownloadChecksum m_sha256;
+    DownloadChecksum m_md5;
+    qint64 m_hashed;
+};
+
+#endif // DOWNLOADWRITER_H
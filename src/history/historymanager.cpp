@@ -95,6 +95,7 @@ HistoryManager::HistoryManager(QObject *parent)
     : QWebHistoryInterface(parent)
     , m_saveTimer(new AutoSaver(this))
     , m_daysToExpire(30)
+    , m_loaded(false)
     , m_historyModel(0)
     , m_historyFilterModel(0)
     , m_historyTreeModel(0)
@@ -109,7 +110,7 @@ HistoryManager::HistoryManager(QObject *parent)
             m_saveTimer, SLOT(changeOccurred()));
     connect(this, SIGNAL(entryRemoved(const HistoryEntry &)),
             m_saveTimer, SLOT(changeOccurred()));
-    load();
+    loadSettings();
 
     m_historyModel = new HistoryModel(this, this);
     m_historyFilterModel = new HistoryFilterModel(m_historyModel, this);
@@ -130,11 +131,19 @@ HistoryManager::~HistoryManager()
 
 QList<HistoryEntry> HistoryManager::history() const
 {
+    if (!m_loaded) {
+        HistoryManager *that = const_cast<HistoryManager*>(this);
+        that->load();
+    }
     return m_history;
 }
 
 bool HistoryManager::historyContains(const QString &url) const
 {
+    if (!m_loaded) {
+        HistoryManager *that = const_cast<HistoryManager*>(this);
+        that->load();
+    }
     return m_historyFilterModel->historyContains(url);
 }
 
@@ -149,6 +158,7 @@ void HistoryManager::addHistoryEntry(const QString &url)
 
 void HistoryManager::setHistory(const QList<HistoryEntry> &history, bool loadedAndSorted)
 {
+    m_loaded = true;
     m_history = history;
 
     // verify that it is sorted by date
@@ -216,6 +226,7 @@ void HistoryManager::addHistoryEntry(const HistoryEntry &item)
     if (globalSettings->testAttribute(QWebSettings::PrivateBrowsingEnabled))
         return;
 
+    load();
     m_history.prepend(item);
     emit entryAdded(item);
     if (m_history.count() == 1)
@@ -224,6 +235,7 @@ void HistoryManager::addHistoryEntry(const HistoryEntry &item)
 
 void HistoryManager::updateHistoryEntry(const QUrl &url, const QString &title)
 {
+    load();
     for (int i = 0; i < m_history.count(); ++i) {
         if (url == m_history.at(i).url) {
             m_history[i].title = atomicString(title);
@@ -238,6 +250,7 @@ void HistoryManager::updateHistoryEntry(const QUrl &url, const QString &title)
 
 void HistoryManager::removeHistoryEntry(const HistoryEntry &item)
 {
+    load();
     m_lastSavedUrl.clear();
     m_history.removeOne(item);
     emit entryRemoved(item);
@@ -245,6 +258,7 @@ void HistoryManager::removeHistoryEntry(const HistoryEntry &item)
 
 void HistoryManager::removeHistoryEntry(const QUrl &url, const QString &title)
 {
+    load();
     for (int i = 0; i < m_history.count(); ++i) {
         if (url == m_history.at(i).url
             && (title.isEmpty() || title == m_history.at(i).title)) {
@@ -270,6 +284,7 @@ void HistoryManager::setDaysToExpire(int limit)
 
 void HistoryManager::clear()
 {
+    m_loaded = true;
     m_history.clear();
     m_atomicStringHash.clear();
     m_lastSavedUrl.clear();
@@ -287,9 +302,15 @@ void HistoryManager::loadSettings()
     m_daysToExpire = settings.value(QLatin1String("historyLimit"), 30).toInt();
 }
 
+/*
+    Reads the history file, this is not done when the manager is created
+    but the first time the history is needed or when the browser is idle.
+ */
 void HistoryManager::load()
 {
-    loadSettings();
+    if (m_loaded)
+        return;
+    m_loaded = true;
 
     QFile historyFile(BrowserApplication::dataFilePath(QLatin1String("history")));
 
@@ -364,6 +385,9 @@ QString HistoryManager::atomicString(const QString &string) {
 
 void HistoryManager::save()
 {
+    // Don't replace the history file before it was read
+    load();
+
     QSettings settings;
     settings.beginGroup(QLatin1String("history"));
     settings.setValue(QLatin1String("historyLimit"), m_daysToExpire);
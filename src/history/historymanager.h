@@ -131,6 +131,7 @@ public:
 
 public slots:
     void clear();
+    void load();
     void loadSettings();
 
 private slots:
@@ -143,12 +144,12 @@ protected:
     void removeHistoryEntry(const HistoryEntry &item);
 
 private:
-    void load();
     QString atomicString(const QString &string);
     void startFrecencyTimer();
 
     AutoSaver *m_saveTimer;
     int m_daysToExpire;
+    bool m_loaded;
     QTimer m_expiredTimer;
     QTimer m_frecencyTimer;
     QHash<QString, int> m_atomicStringHash;
@@ -0,0 +1,188 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "idlescheduler.h"
+
+#include <qcoreapplication.h>
+#include <qdatetime.h>
+#include <qevent.h>
+#include <qmetaobject.h>
+#include <qwidget.h>
+
+#include <qdebug.h>
+
+// #define IDLESCHEDULER_DEBUG
+
+IdleScheduler::IdleScheduler(QObject *parent)
+    : QObject(parent)
+    , m_timeSlice(20)
+    , m_started(false)
+{
+    m_timer.setSingleShot(true);
+    m_timer.setInterval(0);
+    connect(&m_timer, SIGNAL(timeout()),
+            this, SLOT(runTasks()));
+}
+
+/*
+    Adds a task that calls the slot \a member of \a receiver once the
+    scheduler is idle and the tasks in \a dependencies have run.
+
+    A dependency on a task that isn't pending, because it has already
+    run or was never added, is met.  Tasks whose receiver is deleted are
+    dropped.
+ */
+void IdleScheduler::addTask(const QString &name, QObject *receiver, const char *member,
+                            Priority priority, const QStringList &dependencies)
+{
+    if (!receiver || !member)
+        return;
+
+    Task task;
+    task.name = name;
+    task.receiver = receiver;
+    task.member = member;
+    task.priority = priority;
+    task.dependencies = dependencies;
+
+    // Keep the tasks sorted by priority and in the order they were added
+    int i = 0;
+    while (i < m_tasks.count() && m_tasks.at(i).priority <= priority)
+        ++i;
+    m_tasks.insert(i, task);
+
+    if (m_started && !m_timer.isActive())
+        m_timer.start();
+}
+
+bool IdleScheduler::isPending(const QString &name) const
+{
+    if (name.isEmpty())
+        return false;
+    for (int i = 0; i < m_tasks.count(); ++i) {
+        if (m_tasks.at(i).name == name)
+            return true;
+    }
+    return false;
+}
+
+int IdleScheduler::count() const
+{
+    return m_tasks.count();
+}
+
+/*
+    The number of milliseconds tasks are run for before the events
+    that came in in the mean time are handled.
+ */
+int IdleScheduler::timeSlice() const
+{
+    return m_timeSlice;
+}
+
+void IdleScheduler::setTimeSlice(int msecs)
+{
+    m_timeSlice = qMax(0, msecs);
+}
+
+bool IdleScheduler::isStarted() const
+{
+    return m_started;
+}
+
+void IdleScheduler::start()
+{
+    if (m_started)
+        return;
+    m_started = true;
+    if (!m_tasks.isEmpty())
+        m_timer.start();
+}
+
+/*
+    Starts running tasks after \a widget was painted for the first time.
+ */
+void IdleScheduler::startAfterPaint(QWidget *widget)
+{
+    if (m_started)
+        return;
+    if (!widget) {
+        start();
+        return;
+    }
+    widget->installEventFilter(this);
+}
+
+bool IdleScheduler::eventFilter(QObject *object, QEvent *event)
+{
+    if (event->type() == QEvent::Paint) {
+        object->removeEventFilter(this);
+        // Let the paint finish first
+        if (!m_started) {
+            m_started = true;
+            m_timer.start();
+        }
+    }
+    return QObject::eventFilter(object, event);
+}
+
+int IdleScheduler::nextTask()
+{
+    for (int i = 0; i < m_tasks.count(); ++i) {
+        if (!m_tasks.at(i).receiver) {
+            m_tasks.removeAt(i--);
+            continue;
+        }
+        bool ready = true;
+        const QStringList &dependencies = m_tasks.at(i).dependencies;
+        for (int j = 0; j < dependencies.count() && ready; ++j)
+            ready = !isPending(dependencies.at(j));
+        if (ready)
+            return i;
+    }
+
+    // Only tasks that depend on each other are left
+    if (!m_tasks.isEmpty()) {
+        qWarning() << "IdleScheduler: Circular dependency between the tasks, running" << m_tasks.first().name;
+        return 0;
+    }
+    return -1;
+}
+
+void IdleScheduler::runTasks()
+{
+    QTime time;
+    time.start();
+    do {
+        int index = nextTask();
+        if (index == -1)
+            break;
+        Task task = m_tasks.takeAt(index);
+#ifdef IDLESCHEDULER_DEBUG
+        qDebug() << "IdleScheduler::" << __FUNCTION__ << task.name << task.member;
+#endif
+        if (!QMetaObject::invokeMethod(task.receiver, task.member.constData(), Qt::DirectConnection))
+            qWarning() << "IdleScheduler: Unable to call" << task.member << "for the task" << task.name;
+    } while (time.elapsed() < m_timeSlice && !QCoreApplication::hasPendingEvents());
+
+    if (!m_tasks.isEmpty())
+        m_timer.start();
+    else
+        emit finished();
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#ifndef IDLESCHEDULER_H
+#define IDLESCHEDULER_H
+
+#include <qobject.h>
+
+#include <qlist.h>
+#include <qpointer.h>
+#include <qstringlist.h>
+#include <qtimer.h>
+
+class QWidget;
+
+/*
+    Runs tasks that don't have to be done right away once the application
+    is idle, so that they don't delay showing the first window.
+
+    A task is a slot that is called without arguments.  Tasks run in order
+    of their priority, but not before the tasks named as their dependencies
+    have run.  The tasks are run in time slices, between slices the events
+    that came in are handled.
+ */
+class IdleScheduler : public QObject
+{
+    Q_OBJECT
+
+signals:
+    void finished();
+
+public:
+    enum Priority {
+        HighPriority,
+        NormalPriority,
+        LowPriority
+    };
+
+    IdleScheduler(QObject *parent = 0);
+
+    void addTask(const QString &name, QObject *receiver, const char *member,
+                 Priority priority = NormalPriority,
+                 const QStringList &dependencies = QStringList());
+    bool isPending(const QString &name) const;
+    int count() const;
+
+    int timeSlice() const;
+    void setTimeSlice(int msecs);
+
+    bool isStarted() const;
+    void startAfterPaint(QWidget *widget);
+
+public slots:
+    void start();
+
+protected:
+    bool eventFilter(QObject *object, QEvent *event);
+
+private slots:
+    void runTasks();
+
+private:
+    struct Task {
+        QString name;
+        QPointer<QObject> receiver;
+        QByteArray member;
+        Priority priority;
+        QStringList dependencies;
+    };
+
+    int nextTask();
+
+    QList<Task> m_tasks;
+    QTimer m_timer;
+    int m_timeSlice;
+    bool m_started;
+};
+
+#endif // IDLESCHEDULER_H
@@ -66,12 +66,81 @@ LocationBar::LocationBar(QWidget *parent)
 void LocationBar::setWebView(WebView *webView)
 {
     Q_ASSERT(webView);
+    if (m_webView == webView)
+        return;
+
+    if (m_webView) {
+        disconnect(m_webView, SIGNAL(urlChanged(const QUrl &)),
+                   this, SLOT(webViewUrlChanged(const QUrl &)));
+        disconnect(m_webView, SIGNAL(loadProgress(int)),
+                   this, SLOT(update()));
+        if (isModified()) {
+            State state;
+            state.text = text();
+            state.cursorPosition = cursorPosition();
+            state.selectionStart = selectionStart();
+            state.selectionLength = selectedText().length();
+            state.modified = true;
+            m_states.insert(m_webView, state);
+        } else {
+            m_states.remove(m_webView);
+        }
+    }
+
     m_webView = webView;
     m_siteIcon->setWebView(webView);
     connect(webView, SIGNAL(urlChanged(const QUrl &)),
             this, SLOT(webViewUrlChanged(const QUrl &)));
     connect(webView, SIGNAL(loadProgress(int)),
             this, SLOT(update()));
+    watchWebView(webView);
+
+    // Text set before the load started is only kept until the url is known
+    State state = m_states.take(webView);
+    if (state.modified || (!state.text.isEmpty() && webView->url().isEmpty())) {
+        setText(state.text);
+        if (state.selectionLength > 0)
+            setSelection(state.selectionStart, state.selectionLength);
+        else
+            setCursorPosition(state.cursorPosition);
+        setModified(state.modified);
+    } else {
+        setText(QString::fromUtf8(webView->url().toEncoded()));
+        setCursorPosition(0);
+    }
+    update();
+}
+
+/*
+    Sets the text shown for \a webView, right away if it is shown or else
+    once it is.
+ */
+void LocationBar::setWebViewText(WebView *webView, const QString &text)
+{
+    if (!webView)
+        return;
+    if (webView == m_webView) {
+        setText(text);
+        return;
+    }
+    State state;
+    state.text = text;
+    m_states.insert(webView, state);
+    watchWebView(webView);
+}
+
+// Forget the state of web views once they are deleted
+void LocationBar::watchWebView(WebView *webView)
+{
+    disconnect(webView, SIGNAL(destroyed(QObject *)),
+               this, SLOT(webViewDestroyed(QObject *)));
+    connect(webView, SIGNAL(destroyed(QObject *)),
+            this, SLOT(webViewDestroyed(QObject *)));
+}
+
+void LocationBar::webViewDestroyed(QObject *webView)
+{
+    m_states.remove(webView);
 }
 
 WebView *LocationBar::webView() const
@@ -22,12 +22,19 @@
 
 #include "lineedit.h"
 
+#include <qhash.h>
 #include <qpointer.h>
 #include <qurl.h>
 
 class WebView;
 class LocationBarSiteIcon;
 class PrivacyIndicator;
+
+/*
+    One location bar is shared by all the tabs of a window, setWebView()
+    switches it to the tab that is shown.  What was typed into it for
+    the other tabs is kept until they are shown again.
+ */
 class LocationBar : public LineEdit
 {
     Q_OBJECT
@@ -36,6 +43,7 @@ public:
     LocationBar(QWidget *parent = 0);
     void setWebView(WebView *webView);
     WebView *webView() const;
+    void setWebViewText(WebView *webView, const QString &text);
 
 protected:
     void paintEvent(QPaintEvent *event);
@@ -47,9 +55,22 @@ protected:
 
 private slots:
     void webViewUrlChanged(const QUrl &url);
+    void webViewDestroyed(QObject *webView);
 
 private:
+    struct State {
+        State() : cursorPosition(0), selectionStart(0), selectionLength(0), modified(false) {}
+        QString text;
+        int cursorPosition;
+        int selectionStart;
+        int selectionLength;
+        bool modified;
+    };
+
+    void watchWebView(WebView *webView);
+
     QPointer<WebView> m_webView;
+    QHash<QObject*, State> m_states;
 
     LocationBarSiteIcon *m_siteIcon;
     PrivacyIndicator *m_privacyIndicator;
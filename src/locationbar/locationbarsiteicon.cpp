@@ -37,11 +37,18 @@ LocationBarSiteIcon::LocationBarSiteIcon(QWidget *parent)
 
 void LocationBarSiteIcon::setWebView(WebView *webView)
 {
+    if (m_webView) {
+        disconnect(m_webView, SIGNAL(loadFinished(bool)),
+                   this, SLOT(webViewSiteIconChanged()));
+        disconnect(m_webView, SIGNAL(iconChanged()),
+                   this, SLOT(webViewSiteIconChanged()));
+    }
     m_webView = webView;
     connect(webView, SIGNAL(loadFinished(bool)),
             this, SLOT(webViewSiteIconChanged()));
     connect(webView, SIGNAL(iconChanged()),
             this, SLOT(webViewSiteIconChanged()));
+    webViewSiteIconChanged();
 }
 
 void LocationBarSiteIcon::webViewSiteIconChanged()
@@ -75,6 +75,13 @@
 
 static const unsigned int JAR_VERSION = 23;
 
+// Exception rules and hosts are stored in the trie by their labels,
+// "www.foo.com" and ".foo.com" both become "www", "foo", "com" and "foo", "com"
+static QStringList splitDomain(const QString &domain)
+{
+    return domain.split(QLatin1Char('.'), QString::SkipEmptyParts);
+}
+
 QT_BEGIN_NAMESPACE
 QDataStream &operator<<(QDataStream &stream, const QList<QNetworkCookie> &list)
 {
@@ -117,6 +124,7 @@ CookieJar::CookieJar(QObject *parent)
     : NetworkCookieJar(parent)
     , m_loaded(false)
     , m_saveTimer(new AutoSaver(this))
+    , m_store(BrowserApplication::dataFilePath(QLatin1String("cookies.dat")))
     , m_filterTrackingCookies(false)
     , m_acceptCookies(AcceptOnlyFromSitesNavigatedTo)
     , m_isPrivate(false)
@@ -149,10 +157,15 @@ void CookieJar::load()
     if (m_loaded)
         return;
     // load cookies and exceptions
-    qRegisterMetaTypeStreamOperators<QList<QNetworkCookie> >("QList<QNetworkCookie>");
     QSettings cookieSettings(BrowserApplication::dataFilePath(QLatin1String("cookies.ini")), QSettings::IniFormat);
     if (!m_isPrivate) {
-        setAllCookies(qvariant_cast<QList<QNetworkCookie> >(cookieSettings.value(QLatin1String("cookies"))));
+        if (m_store.exists()) {
+            NetworkCookieJar::setAllCookies(m_store.load());
+        } else if (cookieSettings.contains(QLatin1String("cookies"))) {
+            // Cookies saved by older versions, they move to the store on the next save
+            qRegisterMetaTypeStreamOperators<QList<QNetworkCookie> >("QList<QNetworkCookie>");
+            setAllCookies(qvariant_cast<QList<QNetworkCookie> >(cookieSettings.value(QLatin1String("cookies"))));
+        }
     }
     cookieSettings.beginGroup(QLatin1String("Exceptions"));
     m_exceptions_block = cookieSettings.value(QLatin1String("block")).toStringList();
@@ -161,6 +174,7 @@ void CookieJar::load()
     qSort(m_exceptions_block.begin(), m_exceptions_block.end());
     qSort(m_exceptions_allow.begin(), m_exceptions_allow.end());
     qSort(m_exceptions_allowForSession.begin(), m_exceptions_allowForSession.end());
+    compileRules();
 
     loadSettings();
 }
@@ -195,16 +209,20 @@ void CookieJar::save()
 {
     if (!m_loaded || m_isPrivate)
         return;
-    purgeOldCookies();
 
     QSettings cookieSettings(BrowserApplication::dataFilePath(QLatin1String("cookies.ini")), QSettings::IniFormat);
 
-    QList<QNetworkCookie> cookies = allCookies();
-    for (int i = cookies.count() - 1; i >= 0; --i) {
-        if (cookies.at(i).isSessionCookie())
-            cookies.removeAt(i);
+    // Only append what changed since the last save unless the
+    // journal has grown too large or the whole jar was replaced
+    if (m_store.needsCompaction()) {
+        purgeOldCookies();
+        if (m_store.compact(allCookies()))
+            cookieSettings.remove(QLatin1String("cookies"));
+    } else if (!m_store.save()) {
+        qWarning() << "CookieJar: error saving to" << m_store.fileName();
+        m_store.setNeedsCompaction();
     }
-    cookieSettings.setValue(QLatin1String("cookies"), qVariantFromValue<QList<QNetworkCookie> >(cookies));
+
     cookieSettings.beginGroup(QLatin1String("Exceptions"));
     cookieSettings.setValue(QLatin1String("block"), m_exceptions_block);
     cookieSettings.setValue(QLatin1String("allow"), m_exceptions_allow);
@@ -254,10 +272,12 @@ bool CookieJar::setCookiesFromUrl(const QList<QNetworkCookie> &cookieList, const
     if (!m_loaded)
         load();
 
-    QString host = url.host();
-    bool eBlock = isOnDomainList(m_exceptions_block, host);
-    bool eAllow = !eBlock && isOnDomainList(m_exceptions_allow, host);
-    bool eAllowSession = !eBlock && !eAllow && isOnDomainList(m_exceptions_allowForSession, host);
+    QList<CookieRule> rules;
+    if (!m_exceptions.isEmpty())
+        m_exceptions.findDomain(url.host(), rules);
+    bool eBlock = rules.contains(Block);
+    bool eAllow = !eBlock && rules.contains(Allow);
+    bool eAllowSession = !eBlock && !eAllow && rules.contains(AllowForSession);
 
     bool addedCookies = false;
     // pass exceptions
@@ -300,13 +320,15 @@ bool CookieJar::setCookiesFromUrl(const QList<QNetworkCookie> &cookieList, const
                                 cookie.domain() == it->domain() &&
                                 cookie.path() == it->path()) {
                                 // found a match
+                                cookieRemoved(*it);
                                 cookies.erase(it);
                                 break;
                             }
                         }
 
                         cookies += cookie;
-                        setAllCookies(cookies);
+                        NetworkCookieJar::setAllCookies(cookies);
+                        cookieInserted(cookie);
                         addedCookies = true;
                     }
     #if 0
@@ -329,10 +351,29 @@ bool CookieJar::setCookiesFromUrl(const QList<QNetworkCookie> &cookieList, const
     return addedCookies;
 }
 
+void CookieJar::setAllCookies(const QList<QNetworkCookie> &cookieList)
+{
+    NetworkCookieJar::setAllCookies(cookieList);
+    m_store.setNeedsCompaction();
+}
+
+void CookieJar::cookieInserted(const QNetworkCookie &cookie)
+{
+    if (!m_isPrivate)
+        m_store.insert(cookie);
+}
+
+void CookieJar::cookieRemoved(const QNetworkCookie &cookie)
+{
+    if (!m_isPrivate)
+        m_store.remove(cookie);
+}
+
 bool CookieJar::isOnDomainList(const QStringList &rules, const QString &domain)
 {
     // Either the rule matches the domain exactly
-    // or the domain ends with ".rule"
+    // or the domain ends with ".rule".  The jar itself matches against
+    // m_exceptions, which is only rebuilt when the lists change.
     foreach (const QString &rule, rules) {
         if (rule.startsWith(QLatin1String("."))) {
             if (domain.endsWith(rule))
@@ -356,6 +397,31 @@ bool CookieJar::isOnDomainList(const QStringList &rules, const QString &domain)
     return false;
 }
 
+/*
+    Build the trie used for matching hosts against the exception lists so
+    a lookup only costs as much as the host has labels, however many
+    exceptions there are.
+ */
+void CookieJar::compileRules()
+{
+    m_exceptions.clear();
+    foreach (const QString &rule, m_exceptions_block) {
+        QStringList key = splitDomain(rule);
+        if (!key.isEmpty())
+            m_exceptions.insert(key, Block);
+    }
+    foreach (const QString &rule, m_exceptions_allow) {
+        QStringList key = splitDomain(rule);
+        if (!key.isEmpty())
+            m_exceptions.insert(key, Allow);
+    }
+    foreach (const QString &rule, m_exceptions_allowForSession) {
+        QStringList key = splitDomain(rule);
+        if (!key.isEmpty())
+            m_exceptions.insert(key, AllowForSession);
+    }
+}
+
 CookieJar::AcceptPolicy CookieJar::acceptPolicy() const
 {
     if (!m_loaded)
@@ -417,6 +483,7 @@ void CookieJar::setBlockedCookies(const QStringList &list)
         load();
     m_exceptions_block = list;
     qSort(m_exceptions_block.begin(), m_exceptions_block.end());
+    compileRules();
     applyRules();
     m_saveTimer->changeOccurred();
 }
@@ -427,6 +494,7 @@ void CookieJar::setAllowedCookies(const QStringList &list)
         load();
     m_exceptions_allow = list;
     qSort(m_exceptions_allow.begin(), m_exceptions_allow.end());
+    compileRules();
     applyRules();
     m_saveTimer->changeOccurred();
 }
@@ -437,20 +505,25 @@ void CookieJar::setAllowForSessionCookies(const QStringList &list)
         load();
     m_exceptions_allowForSession = list;
     qSort(m_exceptions_allowForSession.begin(), m_exceptions_allowForSession.end());
+    compileRules();
     applyRules();
     m_saveTimer->changeOccurred();
 }
 
 void CookieJar::applyRules()
 {
+    if (m_exceptions.isEmpty())
+        return;
     QList<QNetworkCookie> cookies = allCookies();
     bool changed = false;
     for (int i = cookies.count() - 1; i >= 0; --i) {
         const QNetworkCookie &cookie = cookies.at(i);
-        if (isOnDomainList(m_exceptions_block, cookie.domain())) {
+        QList<CookieRule> rules;
+        m_exceptions.findDomain(cookie.domain(), rules);
+        if (rules.contains(Block)) {
             cookies.removeAt(i);
             changed = true;
-        } else if (isOnDomainList(m_exceptions_allowForSession, cookie.domain())) {
+        } else if (rules.contains(AllowForSession)) {
             const_cast<QNetworkCookie&>(cookie).setExpirationDate(QDateTime());
             changed = true;
         }
@@ -63,7 +63,9 @@
 #ifndef COOKIEJAR_H
 #define COOKIEJAR_H
 
+#include "cookiestore.h"
 #include "networkcookiejar.h"
+#include "trie_p.h"
 
 #include <qstringlist.h>
 
@@ -139,12 +141,18 @@ private slots:
 protected:
     static bool isOnDomainList(const QStringList &rules, const QString &domain);
 
+    void setAllCookies(const QList<QNetworkCookie> &cookieList);
+    void cookieInserted(const QNetworkCookie &cookie);
+    void cookieRemoved(const QNetworkCookie &cookie);
+
 private:
+    void compileRules();
     void applyRules();
     void purgeOldCookies();
     void load();
     bool m_loaded;
     AutoSaver *m_saveTimer;
+    CookieStore m_store;
     bool m_filterTrackingCookies;
 
     AcceptPolicy m_acceptCookies;
@@ -153,6 +161,7 @@ private:
     QStringList m_exceptions_block;
     QStringList m_exceptions_allow;
     QStringList m_exceptions_allowForSession;
+    Trie<CookieRule> m_exceptions;
     bool m_isPrivate;
     int m_sessionLength;
 };
@@ -6,14 +6,16 @@ HEADERS += \
   cookieexceptionsdialog.h \
   cookieexceptionsmodel.h \
   cookiejar.h \
-  cookiemodel.h
+  cookiemodel.h \
+  cookiestore.h
 
 SOURCES += \
   cookiedialog.cpp \
   cookieexceptionsmodel.cpp \
   cookiemodel.cpp \
   cookieexceptionsdialog.cpp \
-  cookiejar.cpp
+  cookiejar.cpp \
+  cookiestore.cpp
 
 FORMS += \
     cookies.ui \
@@ -0,0 +1,268 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include "cookiestore.h"
+
+#include <qdatastream.h>
+#include <qdatetime.h>
+#include <qfile.h>
+#include <qhash.h>
+
+#include <qdebug.h>
+
+static const quint32 CookieStoreMagic = 0xc0c1e5;
+static const qint32 CookieStoreVersion = 1;
+
+// Compact once this many records are superseded and they
+// outnumber the cookies that are still alive
+#define MINIMUM_GARBAGE_RECORDS 256
+
+static QByteArray cookieKey(const QNetworkCookie &cookie)
+{
+    return cookie.domain().toUtf8() + ';' + cookie.path().toUtf8() + ';' + cookie.name();
+}
+
+CookieStore::CookieStore(const QString &fileName)
+    : m_fileName(fileName)
+    , m_pendingRecords(0)
+    , m_records(0)
+    , m_liveCookies(0)
+    , m_needsCompaction(false)
+{
+}
+
+QString CookieStore::fileName() const
+{
+    return m_fileName;
+}
+
+void CookieStore::setFileName(const QString &fileName)
+{
+    m_fileName = fileName;
+}
+
+bool CookieStore::exists() const
+{
+    return QFile::exists(m_fileName)
+        || QFile::exists(m_fileName + QLatin1String(".new"));
+}
+
+/*
+    Replay the journal and return the persistent cookies that have
+    not yet expired.
+ */
+QList<QNetworkCookie> CookieStore::load()
+{
+    m_pending.clear();
+    m_pendingRecords = 0;
+    m_records = 0;
+    m_liveCookies = 0;
+    m_needsCompaction = false;
+
+    // A compaction was interrupted right before the snapshot was moved in place
+    QString tempFileName = m_fileName + QLatin1String(".new");
+    if (!QFile::exists(m_fileName) && QFile::exists(tempFileName))
+        QFile::rename(tempFileName, m_fileName);
+
+    QFile file(m_fileName);
+    if (!file.open(QFile::ReadOnly))
+        return QList<QNetworkCookie>();
+
+    QDataStream stream(&file);
+    quint32 magic;
+    qint32 version;
+    stream >> magic;
+    stream >> version;
+    if (magic != CookieStoreMagic || version != CookieStoreVersion) {
+        qWarning() << "CookieStore: Unknown file format" << m_fileName;
+        m_needsCompaction = true;
+        return QList<QNetworkCookie>();
+    }
+
+    QHash<QByteArray, QNetworkCookie> cookies;
+    while (!stream.atEnd()) {
+        quint8 operation;
+        QByteArray value;
+        stream >> operation;
+        stream >> value;
+        if (stream.status() != QDataStream::Ok) {
+            qWarning() << "CookieStore: Ignoring truncated record in" << m_fileName;
+            m_needsCompaction = true;
+            break;
+        }
+        ++m_records;
+
+        QList<QNetworkCookie> parsed = QNetworkCookie::parseCookies(value);
+        if (parsed.isEmpty()) {
+            qWarning() << "CookieStore: Unable to parse saved cookie:" << value;
+            continue;
+        }
+        const QNetworkCookie &cookie = parsed.first();
+        if (operation == Insert)
+            cookies.insert(cookieKey(cookie), cookie);
+        else if (operation == Remove)
+            cookies.remove(cookieKey(cookie));
+    }
+
+    QList<QNetworkCookie> list;
+    QDateTime now = QDateTime::currentDateTime();
+    QHash<QByteArray, QNetworkCookie>::const_iterator it = cookies.constBegin();
+    for (; it != cookies.constEnd(); ++it) {
+        if (!it.value().isSessionCookie() && it.value().expirationDate() < now)
+            continue;
+        list.append(it.value());
+    }
+    m_liveCookies = list.count();
+    return list;
+}
+
+void CookieStore::insert(const QNetworkCookie &cookie)
+{
+    // Session cookies die with the browser and are never written
+    if (cookie.isSessionCookie())
+        return;
+    appendRecord(Insert, cookie);
+    ++m_liveCookies;
+}
+
+void CookieStore::remove(const QNetworkCookie &cookie)
+{
+    if (cookie.isSessionCookie())
+        return;
+    appendRecord(Remove, cookie);
+    m_liveCookies = qMax(0, m_liveCookies - 1);
+}
+
+void CookieStore::appendRecord(Operation operation, const QNetworkCookie &cookie)
+{
+    if (m_needsCompaction)
+        return;
+    QDataStream stream(&m_pending, QIODevice::WriteOnly | QIODevice::Append);
+    stream << quint8(operation);
+    stream << cookie.toRawForm();
+    ++m_pendingRecords;
+}
+
+/*
+    The whole set of cookies was replaced, the journal can't describe that
+    cheaply so the next save has to be a compaction.
+ */
+void CookieStore::setNeedsCompaction()
+{
+    m_pending.clear();
+    m_pendingRecords = 0;
+    m_needsCompaction = true;
+}
+
+bool CookieStore::hasPendingChanges() const
+{
+    return m_needsCompaction || m_pendingRecords > 0;
+}
+
+bool CookieStore::needsCompaction() const
+{
+    if (m_needsCompaction)
+        return true;
+    int garbage = m_records + m_pendingRecords - m_liveCookies;
+    return garbage > MINIMUM_GARBAGE_RECORDS && garbage > m_liveCookies;
+}
+
+/*
+    Append the buffered changes to the journal.  If that fails the
+    journal is compacted on the next save.
+ */
+bool CookieStore::save()
+{
+    if (m_needsCompaction) {
+        qWarning() << "CookieStore: save() called on a store that needs compaction";
+        return false;
+    }
+    if (m_pendingRecords == 0)
+        return true;
+
+    QFile file(m_fileName);
+    bool newFile = !file.exists() || file.size() == 0;
+    if (!file.open(QFile::WriteOnly | QFile::Append)) {
+        qWarning() << "CookieStore: Unable to open" << m_fileName << "for writing";
+        setNeedsCompaction();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    if (newFile) {
+        stream << CookieStoreMagic;
+        stream << CookieStoreVersion;
+    }
+    qint64 written = file.write(m_pending);
+    file.close();
+    if (written != m_pending.size()
+        || stream.status() != QDataStream::Ok || file.error() != QFile::NoError) {
+        // Part of a record might have been written, rewrite the file next time
+        qWarning() << "CookieStore: Unable to write to" << m_fileName;
+        setNeedsCompaction();
+        return false;
+    }
+
+    m_records += m_pendingRecords;
+    m_pending.clear();
+    m_pendingRecords = 0;
+    return true;
+}
+
+/*
+    Replace the journal with a snapshot of \a cookies.  The snapshot is
+    written next to the journal first so a crash never loses both.
+ */
+bool CookieStore::compact(const QList<QNetworkCookie> &cookies)
+{
+    QString tempFileName = m_fileName + QLatin1String(".new");
+    QFile file(tempFileName);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+        qWarning() << "CookieStore: Unable to open" << tempFileName << "for writing";
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream << CookieStoreMagic;
+    stream << CookieStoreVersion;
+    int records = 0;
+    foreach (const QNetworkCookie &cookie, cookies) {
+        if (cookie.isSessionCookie())
+            continue;
+        stream << quint8(Insert);
+        stream << cookie.toRawForm();
+        ++records;
+    }
+    file.close();
+    if (stream.status() != QDataStream::Ok || file.error() != QFile::NoError) {
+        QFile::remove(tempFileName);
+        return false;
+    }
+
+    if (QFile::exists(m_fileName) && !QFile::remove(m_fileName))
+        return false;
+    if (!QFile::rename(tempFileName, m_fileName))
+        return false;
+
+    m_pending.clear();
+    m_pendingRecords = 0;
+    m_records = records;
+    m_liveCookies = records;
+    m_needsCompaction = false;
+    return true;
+}
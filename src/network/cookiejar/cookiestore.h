@@ -0,0 +1,75 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#ifndef COOKIESTORE_H
+#define COOKIESTORE_H
+
+#include <qbytearray.h>
+#include <qlist.h>
+#include <qnetworkcookie.h>
+#include <qstring.h>
+
+/*
+    Persists cookies as a journal of insert and remove records.
+
+    Changes are buffered in memory and appended to the file by save(), so
+    the cost of saving depends on what changed and not on the size of the
+    jar.  Once the journal holds too many superseded records, or someone
+    replaced the whole jar, compact() writes a fresh snapshot instead.
+
+    A record that was only partially written (for example because of a
+    crash) is ignored on load and the journal is compacted on the next save.
+ */
+class CookieStore
+{
+public:
+    CookieStore(const QString &fileName = QString());
+
+    QString fileName() const;
+    void setFileName(const QString &fileName);
+    bool exists() const;
+
+    QList<QNetworkCookie> load();
+
+    void insert(const QNetworkCookie &cookie);
+    void remove(const QNetworkCookie &cookie);
+    void setNeedsCompaction();
+
+    bool hasPendingChanges() const;
+    bool needsCompaction() const;
+
+    bool save();
+    bool compact(const QList<QNetworkCookie> &cookies);
+
+private:
+    enum Operation {
+        Insert = 1,
+        Remove = 2
+    };
+
+    void appendRecord(Operation operation, const QNetworkCookie &cookie);
+
+    QString m_fileName;
+    QByteArray m_pending;
+    int m_pendingRecords;
+    int m_records;
+    int m_liveCookies;
+    bool m_needsCompaction;
+};
+
+#endif // COOKIESTORE_H
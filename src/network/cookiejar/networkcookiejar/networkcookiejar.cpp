@@ -66,14 +66,17 @@ NetworkCookieJar::~NetworkCookieJar()
     delete d;
 }
 
+// "example.com." is the fully qualified form of "example.com"
+static QString withoutTrailingDot(const QString &host) {
+    int length = host.size();
+    while (length > 0 && host.at(length - 1) == QLatin1Char('.'))
+        --length;
+    return length == host.size() ? host : host.left(length);
+}
+
 static QStringList splitHost(const QString &host) {
-    QStringList parts = host.split(QLatin1Char('.'), QString::KeepEmptyParts);
-    // Remove empty components that are on the start and end
-    while (!parts.isEmpty() && parts.last().isEmpty())
-        parts.removeLast();
-    while (!parts.isEmpty() && parts.first().isEmpty())
-        parts.removeFirst();
-    return parts;
+    // Empty components never become labels, Trie::findDomain() skips them too
+    return withoutTrailingDot(host).split(QLatin1Char('.'), QString::SkipEmptyParts);
 }
 
 inline static bool shorterPaths(const QNetworkCookie &c1, const QNetworkCookie &c2)
@@ -86,55 +89,86 @@ QList<QNetworkCookie> NetworkCookieJar::cookiesForUrl(const QUrl &url) const
 #if defined(NETWORKCOOKIEJAR_DEBUG)
     qDebug() << "NetworkCookieJar::" << __FUNCTION__ << url;
 #endif
-    // Generate split host
-    QString host = url.host();
+    QString host = withoutTrailingDot(url.host());
     if (url.scheme().toLower() == QLatin1String("file"))
         host = QLatin1String("localhost");
-    QStringList urlHost = splitHost(host);
-
-    // Get all the cookies for url
-    QList<QNetworkCookie> cookies = d->tree.find(urlHost);
-    if (urlHost.count() > 2) {
-        int top = 2;
-        if (d->matchesBlacklist(urlHost.last()))
-            top = 3;
-
-        urlHost.removeFirst();
-        while (urlHost.count() >= top) {
-            cookies += d->tree.find(urlHost);
-            urlHost.removeFirst();
-        }
+
+    QDateTime now = QDateTime::currentDateTime().toTimeSpec(Qt::UTC);
+
+    // A page load asks for the cookies of the same few hosts over and over,
+    // reuse the cookies found for the host until one of them expires or
+    // setCookiesFromUrl() changes the host's domains
+    NetworkCookieJarPrivate::HostCookies *hostCookies = d->hostCache.object(host);
+    if (hostCookies && hostCookies->expires.isValid() && now > hostCookies->expires) {
+        d->hostCache.remove(host);
+        hostCookies = 0;
+    }
+    if (!hostCookies) {
+        hostCookies = d->lookupHost(host, now);
+        d->hostCache.insert(host, hostCookies);
     }
 
     // Prevent doing anything expensive in the common case where
     // there are no cookies to check
+    const QList<QNetworkCookie> &cookies = hostCookies->cookies;
     if (cookies.isEmpty())
         return cookies;
 
-    QDateTime now = QDateTime::currentDateTime().toTimeSpec(Qt::UTC);
-    const QString urlPath = d->urlPath(url);
     const bool isSecure = url.scheme().toLower() == QLatin1String("https");
-    QList<QNetworkCookie>::iterator i = cookies.begin();
-    for (; i != cookies.end();) {
+    if (hostCookies->onlyRootPaths && (isSecure || !hostCookies->hasSecure))
+        return cookies;
+
+    QList<QNetworkCookie> matching;
+    const QString urlPath = d->urlPath(url);
+    QList<QNetworkCookie>::const_iterator i = cookies.constBegin();
+    for (; i != cookies.constEnd(); ++i) {
         if (!d->matchingPath(*i, urlPath)) {
 #if defined(NETWORKCOOKIEJAR_DEBUG)
             qDebug() << __FUNCTION__ << "Ignoring cookie, path does not match" << *i << urlPath;
 #endif
-            i = cookies.erase(i);
             continue;
         }
         if (!isSecure && i->isSecure()) {
-            i = cookies.erase(i);
 #if defined(NETWORKCOOKIEJAR_DEBUG)
             qDebug() << __FUNCTION__ << "Ignoring cookie, security mismatch"
                      << *i << !isSecure;
 #endif
             continue;
         }
+        matching.append(*i);
+    }
+#if defined(NETWORKCOOKIEJAR_DEBUG)
+    qDebug() << "NetworkCookieJar::" << __FUNCTION__ << "returning" << matching.count();
+    qDebug() << matching;
+#endif
+    return matching;
+}
+
+/*
+    Collect the live cookies that can be sent to host, shortest paths first,
+    and note what cookiesForUrl() needs to know to skip filtering them.
+ */
+NetworkCookieJarPrivate::HostCookies *NetworkCookieJarPrivate::lookupHost(const QString &host, const QDateTime &now)
+{
+    HostCookies *hostCookies = new HostCookies;
+    QList<QNetworkCookie> &cookies = hostCookies->cookies;
+
+    // Get all the cookies for host, walking the host labels in place.
+    // Parent domains are only searched down to the second level, or the
+    // third when the top level domain hands out second level domains.
+    int top = 2;
+    int lastDot = host.lastIndexOf(QLatin1Char('.'));
+    if (lastDot != -1 && host.count(QLatin1Char('.')) >= 2
+        && matchesBlacklist(host.midRef(lastDot + 1)))
+        top = 3;
+    tree.findDomain(host, cookies, top);
+
+    QList<QNetworkCookie>::iterator i = cookies.begin();
+    for (; i != cookies.end();) {
         if (!i->isSessionCookie() && now > i->expirationDate()) {
             // remove now (expensive short term) because there will
             // probably be many more cookiesForUrl calls for this host
-            d->tree.remove(splitHost(i->domain()), *i);
+            tree.remove(splitHost(i->domain()), *i);
 #if defined(NETWORKCOOKIEJAR_DEBUG)
             qDebug() << __FUNCTION__ << "Ignoring cookie, expiration issue"
                      << *i << now;
@@ -142,23 +176,43 @@ QList<QNetworkCookie> NetworkCookieJar::cookiesForUrl(const QUrl &url) const
             i = cookies.erase(i);
             continue;
         }
+        if (!i->isSessionCookie()
+            && (!hostCookies->expires.isValid() || i->expirationDate() < hostCookies->expires))
+            hostCookies->expires = i->expirationDate();
+        if (i->isSecure())
+            hostCookies->hasSecure = true;
+        if (i->path() != QLatin1String("/"))
+            hostCookies->onlyRootPaths = false;
         ++i;
     }
 
     // shorter paths should go first
     qSort(cookies.begin(), cookies.end(), shorterPaths);
-#if defined(NETWORKCOOKIEJAR_DEBUG)
-    qDebug() << "NetworkCookieJar::" << __FUNCTION__ << "returning" << cookies.count();
-    qDebug() << cookies;
-#endif
-    return cookies;
+    return hostCookies;
+}
+
+/*
+    Forget the cached cookies of every host that domain can set cookies for.
+ */
+void NetworkCookieJarPrivate::invalidateHosts(const QString &domain)
+{
+    QString suffix = domain;
+    if (!suffix.startsWith(QLatin1Char('.')))
+        suffix.prepend(QLatin1Char('.'));
+    QStringRef withoutDot = suffix.midRef(1);
+
+    QList<QString> hosts = hostCache.keys();
+    foreach (const QString &host, hosts) {
+        if (host.endsWith(suffix) || host == withoutDot)
+            hostCache.remove(host);
+    }
 }
 
 static const qint32 NetworkCookieJarMagic = 0xae;
 
 QByteArray NetworkCookieJar::saveState () const
 {
-    int version = 1;
+    int version = 2;
     QByteArray data;
     QDataStream stream(&data, QIODevice::WriteOnly);
 
@@ -170,7 +224,7 @@ QByteArray NetworkCookieJar::saveState () const
 
 bool NetworkCookieJar::restoreState(const QByteArray &state)
 {
-    int version = 1;
+    int version = 2;
     QByteArray sd = state;
     QDataStream stream(&sd, QIODevice::ReadOnly);
     if (stream.atEnd())
@@ -182,6 +236,7 @@ bool NetworkCookieJar::restoreState(const QByteArray &state)
     if (marker != NetworkCookieJarMagic || v != version)
         return false;
     stream >> d->tree;
+    d->hostCache.clear();
     return true;
 }
 
@@ -200,6 +255,7 @@ void NetworkCookieJar::endSession()
         }
         ++i;
     }
+    d->hostCache.clear();
 }
 
 static const int maxCookiePathLength = 1024;
@@ -241,7 +297,7 @@ bool NetworkCookieJar::setCookiesFromUrl(const QList<QNetworkCookie> &cookieList
 #endif
 
         if (cookie.domain().isEmpty()) {
-            QString host = url.host().toLower();
+            QString host = withoutTrailingDot(url.host().toLower());
             if (host.isEmpty())
                 continue;
             cookie.setDomain(host);
@@ -265,15 +321,19 @@ bool NetworkCookieJar::setCookiesFromUrl(const QList<QNetworkCookie> &cookieList
                 cookie.domain() == it->domain() &&
                 cookie.path() == it->path()) {
                 d->tree.remove(urlHost, *it);
+                cookieRemoved(*it);
                 break;
             }
         }
 
+        d->invalidateHosts(domain);
+
         if (alreadyDead)
             continue;
 
         changed = true;
         d->tree.insert(urlHost, cookie);
+        cookieInserted(cookie);
     }
 
     return changed;
@@ -293,12 +353,33 @@ void NetworkCookieJar::setAllCookies(const QList<QNetworkCookie> &cookieList)
     qDebug() << "NetworkCookieJar::" << __FUNCTION__ << cookieList.count();
 #endif
     d->tree.clear();
+    d->hostCache.clear();
     foreach (const QNetworkCookie &cookie, cookieList) {
         QString domain = cookie.domain();
         d->tree.insert(splitHost(domain), cookie);
     }
 }
 
+/*!
+    Called by setCookiesFromUrl() after \a cookie has been stored.
+
+    Subclasses can use this to track changes to the jar without comparing
+    allCookies() snapshots.
+  */
+void NetworkCookieJar::cookieInserted(const QNetworkCookie &cookie)
+{
+    Q_UNUSED(cookie);
+}
+
+/*!
+    Called by setCookiesFromUrl() after \a cookie has been replaced or
+    deleted by a newer cookie.
+  */
+void NetworkCookieJar::cookieRemoved(const QNetworkCookie &cookie)
+{
+    Q_UNUSED(cookie);
+}
+
 QString NetworkCookieJarPrivate::urlPath(const QUrl &url) const
 {
     QString urlPath = url.path();
@@ -316,7 +397,7 @@ bool NetworkCookieJarPrivate::matchingPath(const QNetworkCookie &cookie, const Q
     return urlPath.startsWith(cookiePath);
 }
 
-bool NetworkCookieJarPrivate::matchesBlacklist(const QString &string) const
+bool NetworkCookieJarPrivate::matchesBlacklist(const QStringRef &string) const
 {
     if (!setSecondLevelDomain) {
         // Alternatively to save a little bit of ram we could just
@@ -325,9 +406,20 @@ bool NetworkCookieJarPrivate::matchesBlacklist(const QString &string) const
             secondLevelDomains += QLatin1String(twoLevelDomains[j]);
         setSecondLevelDomain = true;
     }
-    QStringList::const_iterator i =
-         qBinaryFind(secondLevelDomains.constBegin(), secondLevelDomains.constEnd(), string);
-        return (i != secondLevelDomains.constEnd());
+    // Binary search by hand as qBinaryFind can't compare against a QStringRef
+    int low = 0;
+    int high = secondLevelDomains.count() - 1;
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        int comparison = QStringRef::compare(string, secondLevelDomains.at(middle));
+        if (comparison == 0)
+            return true;
+        if (comparison < 0)
+            high = middle - 1;
+        else
+            low = middle + 1;
+    }
+    return false;
 }
 
 bool NetworkCookieJarPrivate::matchingDomain(const QNetworkCookie &cookie, const QUrl &url) const
@@ -348,7 +440,7 @@ bool NetworkCookieJarPrivate::matchingDomain(const QNetworkCookie &cookie, const
     }
 
     // Check for blacklist
-    if (parts.count() == 2 && matchesBlacklist(parts.last()))
+    if (parts.count() == 2 && matchesBlacklist(QStringRef(&parts.last())))
         return false;
 
     QStringList urlParts = url.host().toLower().split(QLatin1Char('.'), QString::SkipEmptyParts);
@@ -58,6 +58,9 @@ protected:
     void setAllCookies(const QList<QNetworkCookie> &cookieList);
     void setSecondLevelDomains(const QStringList &secondLevelDomains);
 
+    virtual void cookieInserted(const QNetworkCookie &cookie);
+    virtual void cookieRemoved(const QNetworkCookie &cookie);
+
 private:
     NetworkCookieJarPrivate *d;
 };
@@ -39,6 +39,9 @@
 
 #include "trie_p.h"
 
+#include <qcache.h>
+#include <qdatetime.h>
+
 QT_BEGIN_NAMESPACE
 QDataStream &operator<<(QDataStream &stream, const QNetworkCookie &cookie)
 {
@@ -61,13 +64,31 @@ class NetworkCookieJarPrivate {
 public:
     NetworkCookieJarPrivate()
         : setSecondLevelDomain(false)
+        , hostCache(64)
     {}
 
+    // The cookies found in the tree for one host
+    struct HostCookies {
+        HostCookies()
+            : onlyRootPaths(true)
+            , hasSecure(false)
+        {}
+
+        QList<QNetworkCookie> cookies;
+        QDateTime expires;
+        bool onlyRootPaths;
+        bool hasSecure;
+    };
+
     Trie<QNetworkCookie> tree;
     mutable bool setSecondLevelDomain;
     mutable QStringList secondLevelDomains;
+    QCache<QString, HostCookies> hostCache;
+
+    HostCookies *lookupHost(const QString &host, const QDateTime &now);
+    void invalidateHosts(const QString &domain);
 
-    bool matchesBlacklist(const QString &string) const;
+    bool matchesBlacklist(const QStringRef &string) const;
     bool matchingDomain(const QNetworkCookie &cookie, const QUrl &url) const;
     QString urlPath(const QUrl &url) const;
     bool matchingPath(const QNetworkCookie &cookie, const QString &urlPath) const;
@@ -34,17 +34,158 @@
  *
  * ***** END LICENSE BLOCK ***** */
 
+
 #ifndef TRIE_H
 #define TRIE_H
 
 //#define TRIE_DEBUG
 
+#include <qdatastream.h>
+#include <qhash.h>
 #include <qstringlist.h>
+#include <qvector.h>
+
+#include <string.h>
 
 #if defined(TRIE_DEBUG)
 #include <qdebug.h>
 #endif
 
+/*
+    Interns the labels used as keys in a Trie.
+
+    Nodes only store the integer id of their label, and a label can be
+    looked up directly from a range of characters in a larger string so
+    walking the trie for a host name does not have to create a QString
+    for every part of it.
+
+    Every node using a label holds a reference to it, a label is freed
+    when its last node is released and its id is handed out again.
+*/
+class TrieLabels {
+public:
+    TrieLabels() : m_count(0), m_used(0) {}
+
+    inline int find(const QChar *data, int length) const {
+        if (m_buckets.isEmpty())
+            return -1;
+        uint h = hash(data, length);
+        int mask = m_buckets.count() - 1;
+        int i = h & mask;
+        while (m_buckets.at(i) != EmptyBucket) {
+            int id = m_buckets.at(i);
+            if (id != FreedBucket && m_hashes.at(id) == h) {
+                const QString &label = m_labels.at(id);
+                if (label.size() == length
+                    && memcmp(label.constData(), data, length * sizeof(QChar)) == 0)
+                    return id;
+            }
+            i = (i + 1) & mask;
+        }
+        return -1;
+    }
+
+    // Returns the id of the label adding a reference to it
+    inline int intern(const QChar *data, int length) {
+        int id = find(data, length);
+        if (id != -1) {
+            ++m_refs[id];
+            return id;
+        }
+        if ((m_used + 1) * 2 > m_buckets.count())
+            rehash(qMax(16, nextSize((m_count + 1) * 2)));
+        uint h = hash(data, length);
+        if (!m_freeIds.isEmpty()) {
+            id = m_freeIds.last();
+            m_freeIds.remove(m_freeIds.count() - 1);
+            m_labels[id] = QString(data, length);
+            m_hashes[id] = h;
+            m_refs[id] = 1;
+        } else {
+            id = m_labels.count();
+            m_labels.append(QString(data, length));
+            m_hashes.append(h);
+            m_refs.append(1);
+        }
+        insertBucket(id, h);
+        ++m_count;
+        return id;
+    }
+
+    // Drops a reference taken by intern(), freeing the label with the last one
+    inline void release(int id) {
+        if (--m_refs[id] > 0)
+            return;
+        int mask = m_buckets.count() - 1;
+        int i = m_hashes.at(id) & mask;
+        while (m_buckets.at(i) != id)
+            i = (i + 1) & mask;
+        // Lookups must keep probing past the bucket
+        m_buckets[i] = FreedBucket;
+        m_labels[id] = QString();
+        m_freeIds.append(id);
+        --m_count;
+    }
+
+    inline const QString &label(int id) const { return m_labels.at(id); }
+    inline int count() const { return m_count; }
+
+    inline void clear() {
+        m_labels.clear();
+        m_hashes.clear();
+        m_refs.clear();
+        m_freeIds.clear();
+        m_buckets.clear();
+        m_count = 0;
+        m_used = 0;
+    }
+
+private:
+    enum { EmptyBucket = -1, FreedBucket = -2 };
+
+    static inline uint hash(const QChar *data, int length) {
+        uint h = 0;
+        for (int i = 0; i < length; ++i)
+            h = 31 * h + data[i].unicode();
+        return h;
+    }
+
+    static inline int nextSize(int size) {
+        int n = 1;
+        while (n < size)
+            n *= 2;
+        return n;
+    }
+
+    inline void insertBucket(int id, uint h) {
+        int mask = m_buckets.count() - 1;
+        int i = h & mask;
+        while (m_buckets.at(i) != EmptyBucket)
+            i = (i + 1) & mask;
+        m_buckets[i] = id;
+        ++m_used;
+    }
+
+    // Rebuilding the buckets also drops the ones left behind by release()
+    inline void rehash(int size) {
+        m_buckets.fill(EmptyBucket, size);
+        m_used = 0;
+        for (int id = 0; id < m_labels.count(); ++id) {
+            if (m_refs.at(id) > 0)
+                insertBucket(id, m_hashes.at(id));
+        }
+    }
+
+    QVector<QString> m_labels;
+    QVector<uint> m_hashes;
+    QVector<int> m_refs;
+    QVector<int> m_freeIds;
+    QVector<int> m_buckets;
+    int m_count;
+    // Buckets that are not empty, freed ones included
+    int m_used;
+};
+
 /*
     A Trie tree (prefix tree) where the lookup takes m in the worst case.
 
@@ -57,8 +198,13 @@
     a
     | \
     x  y
-*/
 
+    The nodes are kept in one contiguous array and address each other by
+    index.  A child is found by hashing its parent index together with the
+    interned id of its label, so a lookup is one hash probe per level and
+    removing a value prunes the emptied nodes, and the labels no other node
+    uses, through their parent links.
+*/
 template<class T>
 class Trie {
 public:
@@ -69,25 +215,44 @@ public:
     void insert(const QStringList &key, const T &value);
     bool remove(const QStringList &key, const T &value);
     QList<T> find(const QStringList &key) const;
+    QList<T> findAlongPath(const QStringList &key) const;
+    void findDomain(const QString &domain, QList<T> &result, int minimumDepth = 1) const;
     QList<T> all() const;
 
     inline bool contains(const QStringList &key) const;
-    inline bool isEmpty() const { return children.isEmpty() && values.isEmpty(); }
+    inline bool isEmpty() const { return m_edges.isEmpty() && m_nodes.at(0).values.isEmpty(); }
 
 private:
-    const Trie<T>* walkTo(const QStringList &key) const;
-    Trie<T>* walkTo(const QStringList &key, bool create = false);
+    struct Node {
+        Node() : parent(-1), label(-1), children(0) {}
+        int parent;
+        int label;
+        int children;
+        QList<T> values;
+    };
+
+    static inline quint64 edge(int parent, int label)
+        { return (quint64(quint32(parent)) << 32) | quint32(label); }
+
+    inline int child(int node, const QChar *data, int length) const;
+    int addChild(int node, const QChar *data, int length);
+    int walkTo(const QStringList &key) const;
+    int walkTo(const QStringList &key, bool create);
+    QStringList keyOf(int node) const;
+    void prune(int node);
 
     template<class T1> friend QDataStream &operator<<(QDataStream &, const Trie<T1>&);
     template<class T1> friend QDataStream &operator>>(QDataStream &, Trie<T1>&);
 
-    QList<T> values;
-    QStringList childrenKeys;
-    QList<Trie<T> > children;
+    QVector<Node> m_nodes;
+    QVector<int> m_freeNodes;
+    QHash<quint64, int> m_edges;
+    TrieLabels m_labels;
 };
 
 template<class T>
 Trie<T>::Trie() {
+    m_nodes.append(Node());
 }
 
 template<class T>
@@ -99,14 +264,16 @@ void Trie<T>::clear() {
 #if defined(TRIE_DEBUG)
     qDebug() << "Trie::" << __FUNCTION__;
 #endif
-    values.clear();
-    childrenKeys.clear();
-    children.clear();
+    m_nodes.clear();
+    m_nodes.append(Node());
+    m_freeNodes.clear();
+    m_edges.clear();
+    m_labels.clear();
 }
 
 template<class T>
 bool Trie<T>::contains(const QStringList &key) const {
-    return walkTo(key);
+    return walkTo(key) != -1;
 }
 
 template<class T>
@@ -114,9 +281,8 @@ void Trie<T>::insert(const QStringList &key, const T &value) {
 #if defined(TRIE_DEBUG)
     qDebug() << "Trie::" << __FUNCTION__ << key << value;
 #endif
-    Trie<T> *node = walkTo(key, true);
-    if (node)
-        node->values.append(value);
+    int node = walkTo(key, true);
+    m_nodes[node].values.append(value);
 }
 
 template<class T>
@@ -124,37 +290,13 @@ bool Trie<T>::remove(const QStringList &key, const T &value) {
 #if defined(TRIE_DEBUG)
     qDebug() << "Trie::" << __FUNCTION__ << key << value;
 #endif
-    Trie<T> *node = walkTo(key, true);
-    if (node) {
-        bool removed = node->values.removeOne(value);
-        if (!removed)
-            return false;
-
-        // A faster implementation of removing nodes up the tree
-        // can be created if profile shows this to be slow
-        QStringList subKey = key;
-        while (node->values.isEmpty()
-               && node->children.isEmpty()
-               && !subKey.isEmpty()) {
-            QString currentLevelKey = subKey.first();
-            QStringList parentKey = subKey.mid(1);
-            Trie<T> *parent = walkTo(parentKey, false);
-            Q_ASSERT(parent);
-            QStringList::iterator iterator;
-            iterator = qBinaryFind(parent->childrenKeys.begin(),
-                                   parent->childrenKeys.end(),
-                                   currentLevelKey);
-            Q_ASSERT(iterator != parent->childrenKeys.end());
-            int index = iterator - parent->childrenKeys.begin();
-            parent->children.removeAt(index);
-            parent->childrenKeys.removeAt(index);
-
-            node = parent;
-            subKey = parentKey;
-        }
-        return removed;
-    }
-    return false;
+    int node = walkTo(key);
+    if (node == -1)
+        return false;
+    if (!m_nodes[node].values.removeOne(value))
+        return false;
+    prune(node);
+    return true;
 }
 
 template<class T>
@@ -162,94 +304,203 @@ QList<T> Trie<T>::find(const QStringList &key) const {
 #if defined(TRIE_DEBUG)
     qDebug() << "Trie::" << __FUNCTION__ << key;
 #endif
-    const Trie<T> *node = walkTo(key);
-    if (node)
-        return node->values;
+    int node = walkTo(key);
+    if (node != -1)
+        return m_nodes.at(node).values;
     return QList<T>();
 }
 
+/*
+    Returns the values of every node passed on the way to key, not counting
+    the root.  With keys being domains this is the values stored for the
+    domain and all of its parent domains, found in a single walk.
+ */
+template<class T>
+QList<T> Trie<T>::findAlongPath(const QStringList &key) const {
+#if defined(TRIE_DEBUG)
+    qDebug() << "Trie::" << __FUNCTION__ << key;
+#endif
+    QList<T> found;
+    int node = 0;
+    for (int depth = key.count() - 1; depth >= 0; --depth) {
+        const QString &currentLevelKey = key.at(depth);
+        node = child(node, currentLevelKey.constData(), currentLevelKey.size());
+        if (node == -1)
+            break;
+        found += m_nodes.at(node).values;
+    }
+    return found;
+}
+
+/*
+    Appends to result the values stored for the dotted name domain, which is
+    split into labels on the fly, and for its parent domains that have at
+    least minimumDepth labels.  Nothing is allocated apart from growing
+    result.
+ */
+template<class T>
+void Trie<T>::findDomain(const QString &domain, QList<T> &result, int minimumDepth) const {
+#if defined(TRIE_DEBUG)
+    qDebug() << "Trie::" << __FUNCTION__ << domain << minimumDepth;
+#endif
+    const QChar *data = domain.constData();
+    const QChar dot = QLatin1Char('.');
+
+    int labels = 0;
+    for (int i = 0; i < domain.size(); ++i) {
+        if (data[i] != dot && (i == 0 || data[i - 1] == dot))
+            ++labels;
+    }
+
+    int node = 0;
+    int depth = 0;
+    int end = domain.size();
+    while (end > 0) {
+        while (end > 0 && data[end - 1] == dot)
+            --end;
+        if (end == 0)
+            break;
+        int start = end;
+        while (start > 0 && data[start - 1] != dot)
+            --start;
+
+        node = child(node, data + start, end - start);
+        if (node == -1)
+            return;
+        ++depth;
+        if (depth >= minimumDepth || depth == labels)
+            result += m_nodes.at(node).values;
+        end = start;
+    }
+}
+
 template<class T>
 QList<T> Trie<T>::all() const {
 #if defined(TRIE_DEBUG)
     qDebug() << "Trie::" << __FUNCTION__;
 #endif
-    QList<T> all = values;
-    for (int i = 0; i < children.count(); ++i)
-        all += children[i].all();
+    // Free nodes have no values so the array can be read straight through
+    QList<T> all;
+    for (int i = 0; i < m_nodes.count(); ++i)
+        all += m_nodes.at(i).values;
     return all;
 }
 
 template<class T>
 QDataStream &operator<<(QDataStream &out, const Trie<T>&trie) {
-    out << trie.values;
-    out << trie.childrenKeys;
-    out << trie.children;
-    Q_ASSERT(trie.childrenKeys.count() == trie.children.count());
+    quint32 count = 0;
+    for (int i = 0; i < trie.m_nodes.count(); ++i) {
+        if (!trie.m_nodes.at(i).values.isEmpty())
+            ++count;
+    }
+    out << count;
+    for (int i = 0; i < trie.m_nodes.count(); ++i) {
+        if (trie.m_nodes.at(i).values.isEmpty())
+            continue;
+        out << trie.keyOf(i);
+        out << trie.m_nodes.at(i).values;
+    }
     return out;
 }
 
 template<class T>
 QDataStream &operator>>(QDataStream &in, Trie<T> &trie) {
     trie.clear();
-    in >> trie.values;
-    in >> trie.childrenKeys;
-    in >> trie.children;
-    Q_ASSERT(trie.childrenKeys.count() == trie.children.count());
+    quint32 count;
+    in >> count;
+    for (quint32 i = 0; i < count && !in.atEnd(); ++i) {
+        QStringList key;
+        QList<T> values;
+        in >> key;
+        in >> values;
+        int node = trie.walkTo(key, true);
+        trie.m_nodes[node].values += values;
+    }
     return in;
 }
 
+template<class T>
+int Trie<T>::child(int node, const QChar *data, int length) const {
+    int label = m_labels.find(data, length);
+    if (label == -1)
+        return -1;
+    return m_edges.value(edge(node, label), -1);
+}
+
+template<class T>
+int Trie<T>::addChild(int node, const QChar *data, int length) {
+    int label = m_labels.intern(data, length);
+    int index;
+    if (!m_freeNodes.isEmpty()) {
+        index = m_freeNodes.last();
+        m_freeNodes.remove(m_freeNodes.count() - 1);
+    } else {
+        index = m_nodes.count();
+        m_nodes.append(Node());
+    }
+    Node &newNode = m_nodes[index];
+    newNode.parent = node;
+    newNode.label = label;
+    ++m_nodes[node].children;
+    m_edges.insert(edge(node, label), index);
+    return index;
+}
+
 // Very fast const walk
 template<class T>
-const Trie<T>* Trie<T>::walkTo(const QStringList &key) const {
-    const Trie<T> *node = this;
-    QStringList::const_iterator childIterator;
-    QStringList::const_iterator begin, end;
-
-    int depth = key.count() - 1;
-    while (depth >= 0) {
-        const QString currentLevelKey = key.at(depth--);
-        begin = node->childrenKeys.constBegin();
-        end = node->childrenKeys.constEnd();
-        childIterator = qBinaryFind(begin, end, currentLevelKey);
-        if (childIterator == end)
-            return 0;
-        node = &node->children.at(childIterator - begin);
+int Trie<T>::walkTo(const QStringList &key) const {
+    int node = 0;
+    for (int depth = key.count() - 1; depth >= 0 && node != -1; --depth) {
+        const QString &currentLevelKey = key.at(depth);
+        node = child(node, currentLevelKey.constData(), currentLevelKey.size());
     }
     return node;
 }
 
 template<class T>
-Trie<T>* Trie<T>::walkTo(const QStringList &key, bool create) {
-    QStringList::iterator iterator;
-    Trie<T> *node = this;
-    QStringList::iterator begin, end;
-    int depth = key.count() - 1;
-    while (depth >= 0) {
-        const QString currentLevelKey = key.at(depth--);
-        begin = node->childrenKeys.begin();
-        end = node->childrenKeys.end();
-        iterator = qBinaryFind(begin, end, currentLevelKey);
+int Trie<T>::walkTo(const QStringList &key, bool create) {
+    int node = 0;
+    for (int depth = key.count() - 1; depth >= 0; --depth) {
+        const QString &currentLevelKey = key.at(depth);
+        int next = child(node, currentLevelKey.constData(), currentLevelKey.size());
 #if defined(TRIE_DEBUG)
-        qDebug() << "\t" << node << key << currentLevelKey << node->childrenKeys;
+        qDebug() << "\t" << node << key << currentLevelKey << next;
 #endif
-        int index = -1;
-        if (iterator == end) {
+        if (next == -1) {
             if (!create)
-                return 0;
-            iterator = qLowerBound(begin,
-                                   end,
-                                   currentLevelKey);
-            index = iterator - begin;
-            node->childrenKeys.insert(iterator, currentLevelKey);
-            node->children.insert(index, Trie<T>());
-        } else {
-            index = iterator - begin;
+                return -1;
+            next = addChild(node, currentLevelKey.constData(), currentLevelKey.size());
         }
-        Q_ASSERT(index >= 0 && index < node->children.count());
-        node = &node->children[index];
+        node = next;
     }
     return node;
 }
 
-#endif
+template<class T>
+QStringList Trie<T>::keyOf(int node) const {
+    QStringList key;
+    while (node > 0) {
+        key.append(m_labels.label(m_nodes.at(node).label));
+        node = m_nodes.at(node).parent;
+    }
+    return key;
+}
 
+// Walk up from node releasing every node that no longer holds anything
+template<class T>
+void Trie<T>::prune(int node) {
+    while (node > 0
+           && m_nodes.at(node).values.isEmpty()
+           && m_nodes.at(node).children == 0) {
+        Node &current = m_nodes[node];
+        int parent = current.parent;
+        m_edges.remove(edge(parent, current.label));
+        m_labels.release(current.label);
+        --m_nodes[parent].children;
+        current = Node();
+        m_freeNodes.append(node);
+        node = parent;
+    }
+}
+
+#endif
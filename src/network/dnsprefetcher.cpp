@@ -0,0 +1,179 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include "dnsprefetcher.h"
+
+#include "browserapplication.h"
+
+#include <qhostaddress.h>
+#include <qhostinfo.h>
+#include <qsettings.h>
+
+#include <qdebug.h>
+
+// #define DNSPREFETCHER_DEBUG
+
+#define MAXIMUM_CACHED_HOSTS 256
+
+DnsPrefetcher::DnsPrefetcher(QObject *parent)
+    : QObject(parent)
+    , m_enabled(true)
+    , m_private(BrowserApplication::isPrivate())
+    , m_timeToLive(60)
+    , m_maximumLookupsPerSecond(8)
+    , m_lookupsInWindow(0)
+{
+    connect(BrowserApplication::instance(), SIGNAL(privacyChanged(bool)),
+            this, SLOT(privacyChanged(bool)));
+    loadSettings();
+}
+
+DnsPrefetcher::~DnsPrefetcher()
+{
+    clear();
+}
+
+void DnsPrefetcher::loadSettings()
+{
+    QSettings settings;
+    settings.beginGroup(QLatin1String("network"));
+    m_enabled = settings.value(QLatin1String("dnsPrefetch"), true).toBool();
+    m_timeToLive = settings.value(QLatin1String("dnsPrefetchTimeToLive"), 60).toInt();
+    m_maximumLookupsPerSecond = settings.value(QLatin1String("dnsPrefetchRate"), 8).toInt();
+    if (!m_enabled)
+        clear();
+}
+
+bool DnsPrefetcher::isEnabled() const
+{
+    return m_enabled && !m_private;
+}
+
+bool DnsPrefetcher::isCached(const QString &host) const
+{
+    QDateTime expires = m_cache.value(host.toLower());
+    return expires.isValid() && expires > QDateTime::currentDateTime();
+}
+
+void DnsPrefetcher::privacyChanged(bool isPrivate)
+{
+    m_private = isPrivate;
+    // Don't leave behind a trace of what was looked at before
+    clear();
+}
+
+void DnsPrefetcher::clear()
+{
+    QHash<int, QString>::const_iterator it = m_pendingLookups.constBegin();
+    for (; it != m_pendingLookups.constEnd(); ++it)
+        QHostInfo::abortHostLookup(it.key());
+    m_pendingLookups.clear();
+    m_cache.clear();
+}
+
+void DnsPrefetcher::prefetch(const QString &url)
+{
+    if (url.isEmpty())
+        return;
+    prefetch(QUrl::fromEncoded(url.toUtf8(), QUrl::TolerantMode));
+}
+
+void DnsPrefetcher::prefetch(const QUrl &url)
+{
+    if (!isEnabled())
+        return;
+
+    QString scheme = url.scheme();
+    if (scheme != QLatin1String("http") && scheme != QLatin1String("https"))
+        return;
+
+    QString host = url.host().toLower();
+    if (host.isEmpty() || isCached(host))
+        return;
+
+    // IP addresses do not need a lookup
+    QHostAddress address;
+    if (address.setAddress(host))
+        return;
+
+    if (!allowLookup())
+        return;
+
+    expireCache();
+    // Remember the host right away so that moving the mouse back
+    // and forth over the same link doesn't queue more lookups
+    m_cache.insert(host, QDateTime::currentDateTime().addSecs(m_timeToLive));
+
+#ifdef DNSPREFETCHER_DEBUG
+    qDebug() << "DnsPrefetcher::" << __FUNCTION__ << host;
+#endif
+    int id = QHostInfo::lookupHost(host, this, SLOT(lookedUp(const QHostInfo &)));
+    m_pendingLookups.insert(id, host);
+}
+
+void DnsPrefetcher::lookedUp(const QHostInfo &hostInfo)
+{
+    if (!m_pendingLookups.contains(hostInfo.lookupId()))
+        return;
+    QString host = m_pendingLookups.take(hostInfo.lookupId());
+
+    if (hostInfo.error() != QHostInfo::NoError) {
+        // Let the next hover try again
+        m_cache.remove(host);
+        return;
+    }
+
+#ifdef DNSPREFETCHER_DEBUG
+    qDebug() << "DnsPrefetcher::" << __FUNCTION__ << hostInfo.hostName() << hostInfo.addresses();
+#endif
+}
+
+bool DnsPrefetcher::allowLookup()
+{
+    if (m_maximumLookupsPerSecond <= 0)
+        return false;
+
+    if (m_rateWindow.isNull() || m_rateWindow.elapsed() > 1000) {
+        m_rateWindow.start();
+        m_lookupsInWindow = 0;
+    }
+
+    if (m_lookupsInWindow >= m_maximumLookupsPerSecond)
+        return false;
+    ++m_lookupsInWindow;
+    return true;
+}
+
+void DnsPrefetcher::expireCache()
+{
+    if (m_cache.count() < MAXIMUM_CACHED_HOSTS)
+        return;
+
+    QDateTime now = QDateTime::currentDateTime();
+    QHash<QString, QDateTime>::iterator it = m_cache.begin();
+    while (it != m_cache.end()) {
+        if (it.value() <= now)
+            it = m_cache.erase(it);
+        else
+            ++it;
+    }
+
+    // Everything is still fresh, make room anyway
+    while (m_cache.count() >= MAXIMUM_CACHED_HOSTS)
+        m_cache.erase(m_cache.begin());
+}
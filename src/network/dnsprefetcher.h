@@ -0,0 +1,77 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#ifndef DNSPREFETCHER_H
+#define DNSPREFETCHER_H
+
+#include <qobject.h>
+
+#include <qdatetime.h>
+#include <qhash.h>
+#include <qurl.h>
+
+class QHostInfo;
+
+/*
+    Resolves the host of a link the user is likely to visit next (a hovered
+    link or a highlighted completion) so that the lookup is already in the
+    resolver cache when the navigation starts.
+
+    Lookups are rate limited, remembered for a short time so the same host is
+    not resolved over and over, and turned off entirely in private browsing.
+    Nothing is sent to the host itself.
+ */
+class DnsPrefetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    DnsPrefetcher(QObject *parent = 0);
+    ~DnsPrefetcher();
+
+    void loadSettings();
+
+    bool isEnabled() const;
+    bool isCached(const QString &host) const;
+
+public slots:
+    void prefetch(const QUrl &url);
+    void prefetch(const QString &url);
+    void clear();
+
+private slots:
+    void lookedUp(const QHostInfo &hostInfo);
+    void privacyChanged(bool isPrivate);
+
+private:
+    bool allowLookup();
+    void expireCache();
+
+    bool m_enabled;
+    bool m_private;
+    int m_timeToLive;
+    int m_maximumLookupsPerSecond;
+
+    QTime m_rateWindow;
+    int m_lookupsInWindow;
+
+    QHash<QString, QDateTime> m_cache;
+    QHash<int, QString> m_pendingLookups;
+};
+
+#endif // DNSPREFETCHER_H
@@ -6,6 +6,7 @@ FORMS += \
     proxy.ui
 
 HEADERS += \
+    dnsprefetcher.h \
     fileaccesshandler.h \
     networkaccessmanager.h \
     networkdiskcache.h \
@@ -13,6 +14,7 @@ HEADERS += \
     schemeaccesshandler.h
 
 SOURCES += \
+    dnsprefetcher.cpp \
     fileaccesshandler.cpp \
     networkaccessmanager.cpp \
     networkdiskcache.cpp \
@@ -70,10 +70,13 @@
 #include "browserapplication.h"
 #include "browsermainwindow.h"
 #include "cookiejar.h"
+#include "dnsprefetcher.h"
 #include "schemeaccesshandler.h"
 #include "fileaccesshandler.h"
 #include "networkproxyfactory.h"
 #include "networkdiskcache.h"
+#include "webpage.h"
+#include "webpageproxy.h"
 #include "ui_passworddialog.h"
 #include "ui_proxy.h"
 
@@ -93,6 +96,7 @@
 NetworkAccessManager::NetworkAccessManager(QObject *parent)
     : NetworkAccessManagerProxy(parent)
     , m_adblockNetwork(0)
+    , m_dnsPrefetcher(0)
 {
     connect(this, SIGNAL(authenticationRequired(QNetworkReply*, QAuthenticator*)),
             SLOT(authenticationRequired(QNetworkReply*, QAuthenticator*)));
@@ -110,6 +114,8 @@ NetworkAccessManager::NetworkAccessManager(QObject *parent)
     setSchemeHandler(QLatin1String("file"), new FileAccessHandler(this));
     setSchemeHandler(QLatin1String("abp"), new AdBlockSchemeAccessHandler(this));
     setCookieJar(new CookieJar);
+
+    m_dnsPrefetcher = new DnsPrefetcher(this);
 }
 
 void NetworkAccessManager::privacyChanged(bool isPrivate)
@@ -131,6 +137,11 @@ void NetworkAccessManager::setSchemeHandler(const QString &scheme, SchemeAccessH
     m_schemeHandlers.insert(scheme, handler);
 }
 
+DnsPrefetcher *NetworkAccessManager::dnsPrefetcher() const
+{
+    return m_dnsPrefetcher;
+}
+
 void NetworkAccessManager::loadSettings()
 {
     QSettings settings;
@@ -193,6 +204,9 @@ void NetworkAccessManager::loadSettings()
             setCache(0);
     }
     settings.endGroup();
+
+    if (m_dnsPrefetcher)
+        m_dnsPrefetcher->loadSettings();
 }
 
 void NetworkAccessManager::authenticationRequired(QNetworkReply *reply, QAuthenticator *auth)
@@ -343,9 +357,14 @@ void NetworkAccessManager::sslErrors(QNetworkReply *reply, const QList<QSslError
 
 QNetworkReply *NetworkAccessManager::createRequest(QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *outgoingData)
 {
+    // Only form submissions of the top level frame can be saved by AutoFill,
+    // uploads and XMLHttpRequests are not tagged by the page
     if (op == PostOperation && outgoingData) {
-        QByteArray outgoingDataByteArray = outgoingData->peek(1024 * 1024);
-        BrowserApplication::autoFillManager()->post(request, outgoingDataByteArray);
+        QVariant type = request.attribute((QNetworkRequest::Attribute)(WebPageProxy::pageAttributeId() + 1));
+        if (type.isValid() && type.toInt() == QWebPage::NavigationTypeFormSubmitted) {
+            QByteArray outgoingDataByteArray = outgoingData->peek(1024 * 1024);
+            BrowserApplication::autoFillManager()->post(request, outgoingDataByteArray);
+        }
     }
 
     QNetworkReply *reply = 0;
@@ -367,11 +386,16 @@ QNetworkReply *NetworkAccessManager::createRequest(QNetworkAccessManager::Operat
         if (!m_adblockNetwork)
             m_adblockNetwork = AdBlockManager::instance()->network();
         reply = m_adblockNetwork->block(req);
-        if (reply)
+        if (reply) {
+            if (WebPage *webPage = WebPage::webPageForRequest(req))
+                webPage->addBlockedRequest();
             return reply;
+        }
     }
 
     reply = QNetworkAccessManager::createRequest(op, req, outgoingData);
+    if (WebPage *webPage = WebPage::webPageForRequest(req))
+        webPage->addRequest(reply);
     emit requestCreated(op, req, reply);
     return reply;
 }
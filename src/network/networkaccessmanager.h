@@ -68,6 +68,7 @@
 #include <qhash.h>
 #include "networkaccessmanagerproxy.h"
 
+class DnsPrefetcher;
 class SchemeAccessHandler;
 
 class AdBlockNetwork;
@@ -81,6 +82,7 @@ signals:
 public:
     NetworkAccessManager(QObject *parent = 0);
     void setSchemeHandler(const QString &scheme, SchemeAccessHandler *handler);
+    DnsPrefetcher *dnsPrefetcher() const;
 
     inline QNetworkReply *createRequestProxy(QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *outgoingData)
     {
@@ -111,6 +113,7 @@ private:
 
     QNetworkCookieJar *m_privateCookieJar;
     AdBlockNetwork *m_adblockNetwork;
+    DnsPrefetcher *m_dnsPrefetcher;
 };
 
 #endif // NETWORKACCESSMANAGER_H
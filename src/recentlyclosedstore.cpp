@@ -0,0 +1,396 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "recentlyclosedstore.h"
+
+#include <qfile.h>
+
+#include <qdebug.h>
+
+// #define RECENTLYCLOSEDSTORE_DEBUG
+
+RecentlyClosedStore::RecentlyClosedStore(QObject *parent)
+    : QObject(parent)
+    , m_maximumInMemory(10)
+    , m_maximumMemoryUsage(2 * 1024 * 1024)
+    , m_maximumCount(100)
+    , m_memoryUsage(0)
+    , m_fileSize(0)
+    , m_deadBytes(0)
+    , m_private(false)
+{
+}
+
+RecentlyClosedStore::~RecentlyClosedStore()
+{
+    removeFile();
+}
+
+QString RecentlyClosedStore::fileName() const
+{
+    return m_fileName;
+}
+
+/*
+    Sets the file the state of older items is moved to, items that would
+    be moved while there is no file are dropped.
+ */
+void RecentlyClosedStore::setFileName(const QString &fileName)
+{
+    if (m_fileName == fileName)
+        return;
+    clear();
+    m_fileName = fileName;
+    // Left behind by a crash
+    removeFile();
+}
+
+/*
+    The number of the newest items whose state is kept in memory.
+ */
+int RecentlyClosedStore::maximumInMemory() const
+{
+    return m_maximumInMemory;
+}
+
+void RecentlyClosedStore::setMaximumInMemory(int count)
+{
+    m_maximumInMemory = qMax(1, count);
+    spill();
+}
+
+/*
+    The number of bytes the state kept in memory may use, the newest
+    item is always kept in memory.
+ */
+int RecentlyClosedStore::maximumMemoryUsage() const
+{
+    return m_maximumMemoryUsage;
+}
+
+void RecentlyClosedStore::setMaximumMemoryUsage(int bytes)
+{
+    m_maximumMemoryUsage = qMax(0, bytes);
+    spill();
+}
+
+int RecentlyClosedStore::maximumCount() const
+{
+    return m_maximumCount;
+}
+
+void RecentlyClosedStore::setMaximumCount(int count)
+{
+    m_maximumCount = qMax(1, count);
+    bool removed = false;
+    while (m_items.count() > m_maximumCount) {
+        drop(m_items.takeLast());
+        removed = true;
+    }
+    if (removed) {
+        compact();
+        emit changed();
+    }
+}
+
+/*
+    While private browsing nothing is written to the file and older
+    items are dropped instead.
+ */
+bool RecentlyClosedStore::isPrivate() const
+{
+    return m_private;
+}
+
+void RecentlyClosedStore::setPrivate(bool isPrivate)
+{
+    m_private = isPrivate;
+}
+
+void RecentlyClosedStore::addTab(const QUrl &url, const QString &title, const QByteArray &historyState)
+{
+    Item item;
+    item.type = Tab;
+    item.url = url;
+    item.title = title;
+    item.state = historyState;
+    add(item);
+}
+
+void RecentlyClosedStore::addWindow(const QString &title, const QByteArray &state)
+{
+    Item item;
+    item.type = Window;
+    item.title = title;
+    item.state = state;
+    add(item);
+}
+
+void RecentlyClosedStore::add(const Item &item)
+{
+    m_items.prepend(item);
+    m_memoryUsage += item.state.size();
+    spill();
+    while (m_items.count() > m_maximumCount)
+        drop(m_items.takeLast());
+    compact();
+    emit changed();
+}
+
+int RecentlyClosedStore::count(Type type) const
+{
+    int count = 0;
+    for (int i = 0; i < m_items.count(); ++i) {
+        if (m_items.at(i).type == type)
+            ++count;
+    }
+    return count;
+}
+
+int RecentlyClosedStore::indexOf(Type type, int index) const
+{
+    if (index < 0)
+        return -1;
+    for (int i = 0; i < m_items.count(); ++i) {
+        if (m_items.at(i).type != type)
+            continue;
+        if (index == 0)
+            return i;
+        --index;
+    }
+    return -1;
+}
+
+QUrl RecentlyClosedStore::url(Type type, int index) const
+{
+    int i = indexOf(type, index);
+    if (i == -1)
+        return QUrl();
+    return m_items.at(i).url;
+}
+
+QString RecentlyClosedStore::title(Type type, int index) const
+{
+    int i = indexOf(type, index);
+    if (i == -1)
+        return QString();
+    return m_items.at(i).title;
+}
+
+/*
+    Removes the \a index newest item of \a type and returns its state.
+ */
+QByteArray RecentlyClosedStore::take(Type type, int index, QUrl *url)
+{
+    int i = indexOf(type, index);
+    if (i == -1)
+        return QByteArray();
+
+    Item item = m_items.takeAt(i);
+    QByteArray state = (item.offset == -1) ? item.state : read(item);
+    drop(item);
+    compact();
+    if (url)
+        *url = item.url;
+    emit changed();
+    return state;
+}
+
+int RecentlyClosedStore::inMemoryCount() const
+{
+    int count = 0;
+    for (int i = 0; i < m_items.count(); ++i) {
+        if (m_items.at(i).offset == -1)
+            ++count;
+    }
+    return count;
+}
+
+int RecentlyClosedStore::memoryUsage() const
+{
+    return m_memoryUsage;
+}
+
+void RecentlyClosedStore::clear()
+{
+    bool wasEmpty = m_items.isEmpty();
+    m_items.clear();
+    m_memoryUsage = 0;
+    removeFile();
+    if (!wasEmpty)
+        emit changed();
+}
+
+// Moves the state of the items after the newest ones to the file
+void RecentlyClosedStore::spill()
+{
+    int inMemory = 0;
+    int bytes = 0;
+    for (int i = 0; i < m_items.count(); ++i) {
+        Item &item = m_items[i];
+        if (item.offset != -1)
+            continue;
+        int size = item.state.size();
+        if (inMemory < m_maximumInMemory
+            && (inMemory == 0 || bytes + size <= m_maximumMemoryUsage)) {
+            ++inMemory;
+            bytes += size;
+            continue;
+        }
+        if (!write(item)) {
+            m_items.removeAt(i--);
+            m_memoryUsage -= size;
+            continue;
+        }
+        m_memoryUsage -= size;
+    }
+}
+
+bool RecentlyClosedStore::write(Item &item)
+{
+    if (m_fileName.isEmpty() || m_private)
+        return false;
+
+    QFile file(m_fileName);
+    if (!file.open(QFile::WriteOnly | QFile::Append)) {
+        qWarning() << "RecentlyClosedStore: Unable to open" << m_fileName << file.errorString();
+        return false;
+    }
+    QByteArray data = qCompress(item.state);
+    if (file.write(data) != data.size()) {
+        qWarning() << "RecentlyClosedStore: Unable to write to" << m_fileName << file.errorString();
+        file.resize(m_fileSize);
+        return false;
+    }
+#ifdef RECENTLYCLOSEDSTORE_DEBUG
+    qDebug() << "RecentlyClosedStore::" << __FUNCTION__ << item.url << item.state.size() << data.size();
+#endif
+    item.offset = m_fileSize;
+    item.size = data.size();
+    item.state = QByteArray();
+    m_fileSize += data.size();
+    return true;
+}
+
+QByteArray RecentlyClosedStore::read(const Item &item)
+{
+    QFile file(m_fileName);
+    if (!file.open(QFile::ReadOnly) || !file.seek(item.offset)) {
+        qWarning() << "RecentlyClosedStore: Unable to read from" << m_fileName << file.errorString();
+        return QByteArray();
+    }
+    QByteArray data = file.read(item.size);
+    if (data.size() != item.size)
+        return QByteArray();
+    return qUncompress(data);
+}
+
+// Forgets an item that was taken out of the list
+void RecentlyClosedStore::drop(const Item &item)
+{
+    if (item.offset == -1)
+        m_memoryUsage -= item.state.size();
+    else
+        m_deadBytes += item.size;
+}
+
+/*
+    Rewrites the file without the items that were dropped once they take
+    up most of it.
+ */
+void RecentlyClosedStore::compact()
+{
+    if (m_fileSize == 0)
+        return;
+
+    bool spilled = false;
+    for (int i = 0; i < m_items.count() && !spilled; ++i)
+        spilled = (m_items.at(i).offset != -1);
+    if (!spilled) {
+        removeFile();
+        return;
+    }
+
+    if (m_deadBytes < 64 * 1024 || m_deadBytes * 2 < m_fileSize)
+        return;
+
+    QFile file(m_fileName);
+    QFile newFile(m_fileName + QLatin1String(".new"));
+    if (!file.open(QFile::ReadOnly) || !newFile.open(QFile::WriteOnly | QFile::Truncate)) {
+        qWarning() << "RecentlyClosedStore: Unable to compact" << m_fileName;
+        return;
+    }
+
+    QList<qint64> offsets;
+    qint64 size = 0;
+    bool failed = false;
+    for (int i = 0; i < m_items.count(); ++i) {
+        const Item &item = m_items.at(i);
+        offsets.append(-1);
+        if (item.offset == -1)
+            continue;
+        QByteArray data;
+        if (file.seek(item.offset))
+            data = file.read(item.size);
+        if (data.size() != item.size || newFile.write(data) != data.size()) {
+            failed = true;
+            break;
+        }
+        offsets[i] = size;
+        size += data.size();
+    }
+    file.close();
+    newFile.close();
+
+    if (failed || newFile.error() != QFile::NoError) {
+        qWarning() << "RecentlyClosedStore: Unable to compact" << m_fileName;
+        newFile.remove();
+        return;
+    }
+    if (!file.remove()) {
+        qWarning() << "RecentlyClosedStore: Unable to replace" << m_fileName << file.errorString();
+        newFile.remove();
+        return;
+    }
+    if (!newFile.rename(m_fileName)) {
+        // The spilled states went with the old file
+        qWarning() << "RecentlyClosedStore: Unable to replace" << m_fileName << newFile.errorString();
+        newFile.remove();
+        removeFile();
+        return;
+    }
+    for (int i = 0; i < m_items.count(); ++i) {
+        if (m_items.at(i).offset != -1)
+            m_items[i].offset = offsets.at(i);
+    }
+    m_fileSize = size;
+    m_deadBytes = 0;
+}
+
+void RecentlyClosedStore::removeFile()
+{
+    for (int i = m_items.count() - 1; i >= 0; --i) {
+        if (m_items.at(i).offset != -1)
+            m_items.removeAt(i);
+    }
+    m_fileSize = 0;
+    m_deadBytes = 0;
+    if (!m_fileName.isEmpty() && QFile::exists(m_fileName))
+        QFile::remove(m_fileName);
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#ifndef RECENTLYCLOSEDSTORE_H
+#define RECENTLYCLOSEDSTORE_H
+
+#include <qobject.h>
+
+#include <qbytearray.h>
+#include <qlist.h>
+#include <qurl.h>
+
+/*
+    Keeps the state of recently closed tabs and windows so they can be
+    reopened.
+
+    Only the state of the newest items is kept in memory, the state of
+    older items is compressed and moved to a file which is used as a ring:
+    once it holds maximumCount() items the oldest one is dropped.  The url
+    and title of every item stay in memory for showing them in menus.
+
+    The file only lives as long as the store.
+ */
+class RecentlyClosedStore : public QObject
+{
+    Q_OBJECT
+
+signals:
+    void changed();
+
+public:
+    enum Type {
+        Tab,
+        Window
+    };
+
+    RecentlyClosedStore(QObject *parent = 0);
+    ~RecentlyClosedStore();
+
+    QString fileName() const;
+    void setFileName(const QString &fileName);
+
+    int maximumInMemory() const;
+    void setMaximumInMemory(int count);
+    int maximumMemoryUsage() const;
+    void setMaximumMemoryUsage(int bytes);
+    int maximumCount() const;
+    void setMaximumCount(int count);
+
+    void addTab(const QUrl &url, const QString &title, const QByteArray &historyState);
+    void addWindow(const QString &title, const QByteArray &state);
+
+    int count(Type type) const;
+    QUrl url(Type type, int index) const;
+    QString title(Type type, int index) const;
+    QByteArray take(Type type, int index = 0, QUrl *url = 0);
+
+    int inMemoryCount() const;
+    int memoryUsage() const;
+
+    bool isPrivate() const;
+
+public slots:
+    void setPrivate(bool isPrivate);
+    void clear();
+
+private:
+    struct Item {
+        Item() : type(Tab), offset(-1), size(0) {}
+        Type type;
+        QUrl url;
+        QString title;
+        QByteArray state;
+        qint64 offset;
+        int size;
+    };
+
+    void add(const Item &item);
+    int indexOf(Type type, int index) const;
+    void spill();
+    bool write(Item &item);
+    QByteArray read(const Item &item);
+    void drop(const Item &item);
+    void compact();
+    void removeFile();
+
+    QString m_fileName;
+    QList<Item> m_items;
+    int m_maximumInMemory;
+    int m_maximumMemoryUsage;
+    int m_maximumCount;
+    int m_memoryUsage;
+    qint64 m_fileSize;
+    qint64 m_deadBytes;
+    bool m_private;
+};
+
+#endif // RECENTLYCLOSEDSTORE_H
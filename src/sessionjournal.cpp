@@ -0,0 +1,590 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#include "sessionjournal.h"
+
+#include "browserapplication.h"
+#include "browsermainwindow.h"
+#include "tabwidget.h"
+
+#include <qdatastream.h>
+#include <qfile.h>
+#include <qurl.h>
+
+#include <qdebug.h>
+
+static const quint32 SessionJournalMagic = 0x5e55;
+static const qint32 SessionJournalVersion = 1;
+
+// Records are written at most this long after the event
+#define FLUSH_DELAY 1000
+
+// Compact once this many records were appended and they
+// outnumber the records of a snapshot four to one
+#define MINIMUM_RECORDS 512
+
+SessionJournal::SessionJournal(QObject *parent)
+    : QObject(parent)
+    , m_nextWindowId(1)
+    , m_closingWindow(0)
+    , m_records(0)
+    , m_needsCompaction(false)
+{
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(FLUSH_DELAY);
+    connect(&m_flushTimer, SIGNAL(timeout()),
+            this, SLOT(flush()));
+}
+
+SessionJournal::~SessionJournal()
+{
+    flush();
+}
+
+QString SessionJournal::fileName() const
+{
+    return m_fileName;
+}
+
+void SessionJournal::setFileName(const QString &fileName)
+{
+    m_fileName = fileName;
+}
+
+bool SessionJournal::exists() const
+{
+    return QFile::exists(m_fileName)
+        || QFile::exists(m_fileName + QLatin1String(".new"));
+}
+
+/*
+    Replay the journal and return the state of each window it describes
+    paired with the state of its tab widget.
+ */
+QList<QPair<QByteArray, QByteArray> > SessionJournal::load()
+{
+    m_windows.clear();
+    m_pending.clear();
+    m_records = 0;
+    m_needsCompaction = false;
+
+    // A compaction was interrupted right before the snapshot was moved in place
+    QString tempFileName = m_fileName + QLatin1String(".new");
+    if (!QFile::exists(m_fileName) && QFile::exists(tempFileName))
+        QFile::rename(tempFileName, m_fileName);
+
+    QList<QPair<QByteArray, QByteArray> > windows;
+    QFile file(m_fileName);
+    if (!file.open(QFile::ReadOnly))
+        return windows;
+
+    QDataStream stream(&file);
+    quint32 magic;
+    qint32 version;
+    stream >> magic;
+    stream >> version;
+    if (magic != SessionJournalMagic || version != SessionJournalVersion) {
+        qWarning() << "SessionJournal: Unknown file format" << m_fileName;
+        m_needsCompaction = true;
+        return windows;
+    }
+
+    while (!stream.atEnd()) {
+        QByteArray record;
+        stream >> record;
+        if (stream.status() != QDataStream::Ok || !apply(record)) {
+            qWarning() << "SessionJournal: Ignoring truncated record in" << m_fileName;
+            m_needsCompaction = true;
+            break;
+        }
+        ++m_records;
+    }
+
+    QMap<int, Window>::const_iterator it = m_windows.constBegin();
+    for (; it != m_windows.constEnd(); ++it) {
+        const Window &window = it.value();
+        if (window.tabs.isEmpty())
+            continue;
+        QStringList urls;
+        QStringList titles;
+        QList<QByteArray> historyStates;
+        foreach (const Tab &tab, window.tabs) {
+            urls.append(tab.url);
+            titles.append(tab.title);
+            historyStates.append(tab.historyState);
+        }
+        QByteArray tabState = TabWidget::saveState(urls, window.currentTab, historyStates, titles);
+        windows.append(qMakePair(window.state, tabState));
+    }
+    return windows;
+}
+
+/*
+    Forget the loaded session, the next flush starts the journal
+    over with the windows added since.
+ */
+void SessionJournal::clear()
+{
+    m_windows.clear();
+    m_pending.clear();
+    m_records = 0;
+    m_needsCompaction = true;
+}
+
+void SessionJournal::addWindow(BrowserMainWindow *window)
+{
+    int id = m_nextWindowId++;
+    TabWidget *tabWidget = window->tabWidget();
+    m_windowIds.insert(window, id);
+    m_windowIds.insert(tabWidget, id);
+    m_windowObjects.insert(id, window);
+
+    connect(window, SIGNAL(destroyed(QObject *)),
+            this, SLOT(windowDestroyed(QObject *)));
+    connect(tabWidget, SIGNAL(tabOpened(int)),
+            this, SLOT(tabOpened(int)));
+    connect(tabWidget, SIGNAL(tabClosed(int)),
+            this, SLOT(tabClosed(int)));
+    connect(tabWidget, SIGNAL(tabMoved(int, int)),
+            this, SLOT(tabMoved(int, int)));
+    connect(tabWidget, SIGNAL(tabChanged(int)),
+            this, SLOT(tabChanged(int)));
+    connect(tabWidget, SIGNAL(currentChanged(int)),
+            this, SLOT(currentChanged(int)));
+
+    if (!isRecording())
+        return;
+
+    // The last window closed stays in the session unless another one replaces it
+    if (m_closingWindow) {
+        QByteArray closedData;
+        QDataStream closedStream(&closedData, QIODevice::WriteOnly);
+        closedStream << quint8(WindowClosed) << qint32(m_closingWindow);
+        record(closedData);
+        m_closingWindow = 0;
+    }
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << quint8(WindowOpened) << qint32(id);
+    record(data);
+    for (int i = 0; i < tabWidget->count(); ++i) {
+        QByteArray tabData;
+        QDataStream tabStream(&tabData, QIODevice::WriteOnly);
+        tabStream << quint8(TabOpened) << qint32(id) << qint32(i);
+        record(tabData);
+        recordTab(id, tabWidget, i);
+    }
+}
+
+void SessionJournal::setWindowState(BrowserMainWindow *window, const QByteArray &state)
+{
+    int id = windowId(window);
+    if (!id || !isRecording())
+        return;
+    if (m_windows.value(id).state == state)
+        return;
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << quint8(WindowState) << qint32(id) << state;
+    record(data);
+}
+
+void SessionJournal::tabOpened(int index)
+{
+    int id = windowId(sender());
+    if (!id || !isRecording())
+        return;
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << quint8(TabOpened) << qint32(id) << qint32(index);
+    record(data);
+}
+
+void SessionJournal::tabClosed(int index)
+{
+    int id = windowId(sender());
+    if (!id || !isRecording())
+        return;
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << quint8(TabClosed) << qint32(id) << qint32(index);
+    record(data);
+}
+
+void SessionJournal::tabMoved(int fromIndex, int toIndex)
+{
+    int id = windowId(sender());
+    if (!id || !isRecording())
+        return;
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << quint8(TabMoved) << qint32(id) << qint32(fromIndex) << qint32(toIndex);
+    record(data);
+}
+
+void SessionJournal::tabChanged(int index)
+{
+    int id = windowId(sender());
+    if (!id || !isRecording())
+        return;
+    recordTab(id, qobject_cast<TabWidget*>(sender()), index);
+}
+
+void SessionJournal::currentChanged(int index)
+{
+    int id = windowId(sender());
+    if (!id || !isRecording() || index < 0)
+        return;
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << quint8(CurrentTab) << qint32(id) << qint32(index);
+    record(data);
+}
+
+void SessionJournal::windowDestroyed(QObject *window)
+{
+    int id = windowId(window);
+    if (!id)
+        return;
+    QHash<QObject*, int>::iterator it = m_windowIds.begin();
+    while (it != m_windowIds.end()) {
+        if (it.value() == id)
+            it = m_windowIds.erase(it);
+        else
+            ++it;
+    }
+    m_windowObjects.remove(id);
+
+    if (!isRecording())
+        return;
+    if (m_windowObjects.isEmpty()) {
+        m_closingWindow = id;
+        flush();
+        return;
+    }
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << quint8(WindowClosed) << qint32(id);
+    record(data);
+}
+
+/*
+    Nothing was recorded while browsing privately, start over from
+    the windows as they are now.
+ */
+void SessionJournal::privacyChanged(bool isPrivate)
+{
+    if (isPrivate)
+        return;
+    snapshot();
+    m_flushTimer.start();
+}
+
+int SessionJournal::windowId(QObject *object) const
+{
+    return m_windowIds.value(object, 0);
+}
+
+bool SessionJournal::isRecording() const
+{
+    return !BrowserApplication::isPrivate();
+}
+
+void SessionJournal::recordTab(int id, TabWidget *tabWidget, int index)
+{
+    if (!tabWidget)
+        return;
+    QUrl url;
+    QString title;
+    QByteArray historyState;
+    tabWidget->tabState(index, &url, &title, &historyState);
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << quint8(TabChanged) << qint32(id) << qint32(index);
+    stream << QString::fromUtf8(url.toEncoded()) << title << historyState;
+    record(data);
+}
+
+/*
+    Apply the record to the session and queue it for the next flush.
+ */
+void SessionJournal::record(const QByteArray &data)
+{
+    apply(data);
+    if (!m_flushTimer.isActive())
+        m_flushTimer.start();
+
+    // A compaction writes the whole session anyway
+    if (m_needsCompaction)
+        return;
+
+    // Only the last state of a tab or window matters, a page load
+    // changes the url, title and history one after the other
+    if (!m_pending.isEmpty()) {
+        const QByteArray &last = m_pending.last();
+        int keyLength = 0;
+        switch (quint8(data.at(0))) {
+        case TabChanged:
+            keyLength = sizeof(quint8) + 2 * sizeof(qint32);
+            break;
+        case WindowState:
+        case CurrentTab:
+            keyLength = sizeof(quint8) + sizeof(qint32);
+            break;
+        default:
+            break;
+        }
+        if (keyLength && last.left(keyLength) == data.left(keyLength)) {
+            m_pending.last() = data;
+            return;
+        }
+    }
+    m_pending.append(data);
+}
+
+bool SessionJournal::apply(const QByteArray &record)
+{
+    QDataStream stream(record);
+    quint8 operation;
+    qint32 id;
+    stream >> operation;
+    stream >> id;
+    if (stream.status() != QDataStream::Ok)
+        return false;
+
+    if (operation == WindowOpened) {
+        m_windows.insert(id, Window());
+        return true;
+    }
+    if (operation == WindowClosed) {
+        m_windows.remove(id);
+        return true;
+    }
+    if (!m_windows.contains(id))
+        return true;
+
+    Window &window = m_windows[id];
+    switch (operation) {
+    case WindowState:
+        stream >> window.state;
+        break;
+    case TabOpened: {
+        qint32 index;
+        stream >> index;
+        if (index < 0 || index > window.tabs.count())
+            index = window.tabs.count();
+        window.tabs.insert(index, Tab());
+        break;
+    }
+    case TabClosed: {
+        qint32 index;
+        stream >> index;
+        if (index >= 0 && index < window.tabs.count())
+            window.tabs.removeAt(index);
+        break;
+    }
+    case TabMoved: {
+        qint32 fromIndex;
+        qint32 toIndex;
+        stream >> fromIndex;
+        stream >> toIndex;
+        if (fromIndex >= 0 && fromIndex < window.tabs.count()
+            && toIndex >= 0 && toIndex < window.tabs.count())
+            window.tabs.move(fromIndex, toIndex);
+        break;
+    }
+    case TabChanged: {
+        qint32 index;
+        Tab tab;
+        stream >> index;
+        stream >> tab.url;
+        stream >> tab.title;
+        stream >> tab.historyState;
+        if (index >= 0 && index < window.tabs.count())
+            window.tabs[index] = tab;
+        break;
+    }
+    case CurrentTab: {
+        qint32 index;
+        stream >> index;
+        window.currentTab = index;
+        break;
+    }
+    default:
+        qWarning() << "SessionJournal: Unknown record" << operation;
+        break;
+    }
+    return stream.status() == QDataStream::Ok;
+}
+
+/*
+    Rebuild the session from the windows that are open right now.
+ */
+void SessionJournal::snapshot()
+{
+    m_windows.clear();
+    m_pending.clear();
+    m_needsCompaction = true;
+    m_closingWindow = 0;
+
+    QMap<int, QPointer<BrowserMainWindow> >::const_iterator it = m_windowObjects.constBegin();
+    for (; it != m_windowObjects.constEnd(); ++it) {
+        BrowserMainWindow *window = it.value();
+        if (!window)
+            continue;
+        TabWidget *tabWidget = window->tabWidget();
+        Window &state = m_windows[it.key()];
+        state.state = window->saveState(false);
+        state.currentTab = tabWidget->currentIndex();
+        for (int i = 0; i < tabWidget->count(); ++i) {
+            QUrl url;
+            Tab tab;
+            tabWidget->tabState(i, &url, &tab.title, &tab.historyState);
+            tab.url = QString::fromUtf8(url.toEncoded());
+            state.tabs.append(tab);
+        }
+    }
+}
+
+/*
+    Append the queued records to the journal, or replace the journal
+    with a snapshot once it has grown too much.
+ */
+bool SessionJournal::flush()
+{
+    m_flushTimer.stop();
+    if (m_fileName.isEmpty())
+        return false;
+
+    int snapshotRecords = 0;
+    foreach (const Window &window, m_windows)
+        snapshotRecords += 3 + 2 * window.tabs.count();
+    int records = m_records + m_pending.count();
+    if (m_needsCompaction
+        || (records > MINIMUM_RECORDS && records > 4 * snapshotRecords))
+        return compact();
+
+    if (m_pending.isEmpty())
+        return true;
+
+    QFile file(m_fileName);
+    bool newFile = !file.exists() || file.size() == 0;
+    if (!file.open(QFile::WriteOnly | QFile::Append)) {
+        qWarning() << "SessionJournal: Unable to open" << m_fileName << "for writing";
+        m_pending.clear();
+        m_needsCompaction = true;
+        return false;
+    }
+
+    QDataStream stream(&file);
+    if (newFile) {
+        stream << SessionJournalMagic;
+        stream << SessionJournalVersion;
+    }
+    foreach (const QByteArray &record, m_pending)
+        stream << record;
+    file.close();
+    if (stream.status() != QDataStream::Ok || file.error() != QFile::NoError) {
+        // Part of a record might have been written, rewrite the file next time
+        qWarning() << "SessionJournal: Unable to write to" << m_fileName;
+        m_pending.clear();
+        m_needsCompaction = true;
+        return false;
+    }
+
+    m_records += m_pending.count();
+    m_pending.clear();
+    return true;
+}
+
+/*
+    Replace the journal with the records that recreate the current session.
+    The snapshot is written next to the journal first so a crash never
+    loses both.
+ */
+bool SessionJournal::compact()
+{
+    QString tempFileName = m_fileName + QLatin1String(".new");
+    QFile file(tempFileName);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+        qWarning() << "SessionJournal: Unable to open" << tempFileName << "for writing";
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream << SessionJournalMagic;
+    stream << SessionJournalVersion;
+    int records = 0;
+    QMap<int, Window>::const_iterator it = m_windows.constBegin();
+    for (; it != m_windows.constEnd(); ++it) {
+        qint32 id = it.key();
+        const Window &window = it.value();
+        {
+            QByteArray data;
+            QDataStream recordStream(&data, QIODevice::WriteOnly);
+            recordStream << quint8(WindowOpened) << id;
+            stream << data;
+        }
+        {
+            QByteArray data;
+            QDataStream recordStream(&data, QIODevice::WriteOnly);
+            recordStream << quint8(WindowState) << id << window.state;
+            stream << data;
+        }
+        for (int i = 0; i < window.tabs.count(); ++i) {
+            const Tab &tab = window.tabs.at(i);
+            {
+                QByteArray data;
+                QDataStream recordStream(&data, QIODevice::WriteOnly);
+                recordStream << quint8(TabOpened) << id << qint32(i);
+                stream << data;
+            }
+            {
+                QByteArray data;
+                QDataStream recordStream(&data, QIODevice::WriteOnly);
+                recordStream << quint8(TabChanged) << id << qint32(i)
+                             << tab.url << tab.title << tab.historyState;
+                stream << data;
+            }
+        }
+        {
+            QByteArray data;
+            QDataStream recordStream(&data, QIODevice::WriteOnly);
+            recordStream << quint8(CurrentTab) << id << qint32(window.currentTab);
+            stream << data;
+        }
+        records += 3 + 2 * window.tabs.count();
+    }
+    file.close();
+    if (stream.status() != QDataStream::Ok || file.error() != QFile::NoError) {
+        QFile::remove(tempFileName);
+        return false;
+    }
+
+    if (QFile::exists(m_fileName) && !QFile::remove(m_fileName))
+        return false;
+    if (!QFile::rename(tempFileName, m_fileName))
+        return false;
+
+    m_pending.clear();
+    m_records = records;
+    m_needsCompaction = false;
+    return true;
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#ifndef SESSIONJOURNAL_H
+#define SESSIONJOURNAL_H
+
+#include <qobject.h>
+
+#include <qbytearray.h>
+#include <qhash.h>
+#include <qlist.h>
+#include <qmap.h>
+#include <qpair.h>
+#include <qpointer.h>
+#include <qstringlist.h>
+#include <qtimer.h>
+
+class BrowserMainWindow;
+class TabWidget;
+
+/*
+    Keeps the session in its own file as a journal of window and tab events.
+
+    Opening, closing, moving and navigating a tab appends one record that
+    only describes that tab, so saving doesn't get slower with the number
+    of open tabs.  Records are buffered for at most a second before they are
+    written.  Once enough records have been appended the journal is replaced
+    by a snapshot of the session it describes.
+
+    A record that was only partially written (for example because of a
+    crash) is ignored on load and the journal is compacted on the next flush.
+ */
+class SessionJournal : public QObject
+{
+    Q_OBJECT
+
+public:
+    SessionJournal(QObject *parent = 0);
+    ~SessionJournal();
+
+    QString fileName() const;
+    void setFileName(const QString &fileName);
+    bool exists() const;
+
+    QList<QPair<QByteArray, QByteArray> > load();
+    void clear();
+
+    void addWindow(BrowserMainWindow *window);
+    void setWindowState(BrowserMainWindow *window, const QByteArray &state);
+
+public slots:
+    bool flush();
+
+private slots:
+    void tabOpened(int index);
+    void tabClosed(int index);
+    void tabMoved(int fromIndex, int toIndex);
+    void tabChanged(int index);
+    void currentChanged(int index);
+    void windowDestroyed(QObject *window);
+    void privacyChanged(bool isPrivate);
+
+private:
+    enum Operation {
+        WindowOpened = 1,
+        WindowClosed = 2,
+        WindowState = 3,
+        TabOpened = 4,
+        TabClosed = 5,
+        TabMoved = 6,
+        TabChanged = 7,
+        CurrentTab = 8
+    };
+
+    struct Tab {
+        QString url;
+        QString title;
+        QByteArray historyState;
+    };
+
+    struct Window {
+        Window() : currentTab(0) {}
+        QByteArray state;
+        QList<Tab> tabs;
+        int currentTab;
+    };
+
+    int windowId(QObject *object) const;
+    bool isRecording() const;
+    void record(const QByteArray &record);
+    bool apply(const QByteArray &record);
+    void recordTab(int id, TabWidget *tabWidget, int index);
+    void snapshot();
+    bool compact();
+
+    QString m_fileName;
+    QMap<int, Window> m_windows;
+    QHash<QObject*, int> m_windowIds;
+    QMap<int, QPointer<BrowserMainWindow> > m_windowObjects;
+    int m_nextWindowId;
+    int m_closingWindow;
+
+    QList<QByteArray> m_pending;
+    int m_records;
+    bool m_needsCompaction;
+    QTimer m_flushTimer;
+};
+
+#endif // SESSIONJOURNAL_H
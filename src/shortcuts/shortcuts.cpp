@@ -86,6 +86,7 @@ QString Shortcuts::shortcutName(Action action)
     case WebSearch:             return QLatin1String("WebSearch");
     case ClearPrivateData:      return QLatin1String("ClearPrivateData");
     case ShowNetworkMonitor:    return QLatin1String("ShowNetworkMonitor");
+    case ShowTaskManager:       return QLatin1String("ShowTaskManager");
     case EnableWebInspector:    return QLatin1String("EnableWebInspector");
 	case AdBlock:               return QLatin1String("AdBlock");
     case SwitchAppLanguage:     return QLatin1String("SwitchAppLanguage");
@@ -335,6 +336,7 @@ void Shortcuts::createDefaultSchemes()
 
     scheme.insert(WebSearch, QKeySequence(tr("Ctrl+K", "Web Search")));
     scheme.insert(ClearPrivateData, QKeySequence(tr("Ctrl+Shift+Delete", "Clear Private Data")));
+    scheme.insert(ShowTaskManager, QKeySequence(tr("Shift+Esc", "Task Manager")));
 
     // No default shortcuts for:
     //
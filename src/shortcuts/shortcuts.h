@@ -76,6 +76,7 @@ public:
         WebSearch,          // Tools
         ClearPrivateData,
         ShowNetworkMonitor,
+        ShowTaskManager,
         EnableWebInspector,
 		AdBlock,
         SwitchAppLanguage,  // Help
@@ -39,22 +39,31 @@ HEADERS += \
     autosaver.h \
     autofilldialog.h \
     autofillmanager.h \
+    bandwidthgraph.h \
     browserapplication.h \
     browsermainwindow.h \
     clearprivatedata.h \
     clearbutton.h \
+    downloadchecksum.h \
+    downloadjournal.h \
     downloadmanager.h \
+    downloadwriter.h \
+    idlescheduler.h \
     modelmenu.h \
     modeltoolbar.h \
     plaintexteditsearch.h \
+    recentlyclosedstore.h \
     searchbar.h \
     searchbutton.h \
     searchlineedit.h \
+    sessionjournal.h \
     settings.h \
     sourcehighlighter.h \
     sourceviewer.h \
+    startupprofiler.h \
     tabbar.h \
     tabwidget.h \
+    taskmanagerdialog.h \
     toolbarsearch.h \
     webactionmapper.h \
     webpage.h \
@@ -67,22 +76,31 @@ SOURCES += \
     autosaver.cpp \
     autofilldialog.cpp \
     autofillmanager.cpp \
+    bandwidthgraph.cpp \
     browserapplication.cpp \
     browsermainwindow.cpp \
     clearprivatedata.cpp \
     clearbutton.cpp \
+    downloadchecksum.cpp \
+    downloadjournal.cpp \
     downloadmanager.cpp \
+    downloadwriter.cpp \
+    idlescheduler.cpp \
     modelmenu.cpp \
     modeltoolbar.cpp \
     plaintexteditsearch.cpp \
+    recentlyclosedstore.cpp \
     searchbar.cpp \
     searchbutton.cpp \
     searchlineedit.cpp \
+    sessionjournal.cpp \
     settings.cpp \
     sourcehighlighter.cpp \
     sourceviewer.cpp \
+    startupprofiler.cpp \
     tabbar.cpp \
     tabwidget.cpp \
+    taskmanagerdialog.cpp \
     toolbarsearch.cpp \
     webactionmapper.cpp \
     webpage.cpp \
@@ -0,0 +1,199 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "startupprofiler.h"
+
+#include <qcoreapplication.h>
+#include <qevent.h>
+#include <qfile.h>
+#include <qlist.h>
+#include <qtextstream.h>
+#include <qwidget.h>
+
+#if QT_VERSION >= 0x040800
+#include <qelapsedtimer.h>
+#else
+#include <qdatetime.h>
+#endif
+
+#include <qdebug.h>
+
+namespace {
+
+struct Event {
+    const char *name;
+    char phase;
+    qint64 timestamp;
+};
+
+struct Profile {
+    Profile() : enabled(false), reported(false) {}
+
+    qint64 now() const
+    {
+#if QT_VERSION >= 0x040800
+        return timer.nsecsElapsed() / 1000;
+#else
+        return qint64(timer.elapsed()) * 1000;
+#endif
+    }
+
+    bool enabled;
+    bool reported;
+    QString fileName;
+    QList<Event> events;
+#if QT_VERSION >= 0x040800
+    QElapsedTimer timer;
+#else
+    QTime timer;
+#endif
+};
+
+Profile *profile()
+{
+    static Profile profile;
+    return &profile;
+}
+
+void record(const char *name, char phase)
+{
+    Profile *p = profile();
+    if (!p->enabled)
+        return;
+    Event event;
+    event.name = name;
+    event.phase = phase;
+    event.timestamp = p->now();
+    p->events.append(event);
+}
+
+// Marks the first paint event of a widget and removes itself
+class FirstPaintFilter : public QObject
+{
+public:
+    FirstPaintFilter(QObject *parent)
+        : QObject(parent)
+    {
+    }
+
+protected:
+    bool eventFilter(QObject *object, QEvent *event)
+    {
+        if (event->type() == QEvent::Paint) {
+            StartupProfiler::mark("firstPaint");
+            object->removeEventFilter(this);
+            deleteLater();
+        }
+        return false;
+    }
+};
+
+QString escaped(const char *name)
+{
+    QString string = QString::fromLatin1(name);
+    string.replace(QLatin1Char('\\'), QLatin1String("\\\\"));
+    string.replace(QLatin1Char('"'), QLatin1String("\\\""));
+    return string;
+}
+
+}
+
+void StartupProfiler::start(const QString &fileName)
+{
+    Profile *p = profile();
+    if (p->enabled)
+        return;
+    p->enabled = true;
+    p->fileName = fileName;
+    p->timer.start();
+}
+
+bool StartupProfiler::isEnabled()
+{
+    return profile()->enabled;
+}
+
+void StartupProfiler::begin(const char *name)
+{
+    record(name, 'B');
+}
+
+void StartupProfiler::end(const char *name)
+{
+    record(name, 'E');
+}
+
+void StartupProfiler::mark(const char *name)
+{
+    record(name, 'i');
+}
+
+void StartupProfiler::markFirstPaint(QWidget *widget)
+{
+    if (!widget || !isEnabled())
+        return;
+    widget->installEventFilter(new FirstPaintFilter(widget));
+}
+
+/*
+    Writes the phases recorded so far, phases that are still running
+    are left open and shown up to the end of the trace.
+ */
+bool StartupProfiler::save()
+{
+    Profile *p = profile();
+    if (!p->enabled)
+        return false;
+
+    QFile file(p->fileName);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+        qWarning() << "StartupProfiler: Unable to open" << p->fileName << "to save the trace";
+        return false;
+    }
+
+    qint64 pid = QCoreApplication::applicationPid();
+    QTextStream stream(&file);
+    stream << "{\"traceEvents\":[";
+    for (int i = 0; i < p->events.count(); ++i) {
+        const Event &event = p->events.at(i);
+        if (i > 0)
+            stream << ",";
+        stream << "\n{\"name\":\"" << escaped(event.name) << "\""
+               << ",\"cat\":\"startup\""
+               << ",\"ph\":\"" << event.phase << "\""
+               << ",\"ts\":" << event.timestamp
+               << ",\"pid\":" << pid
+               << ",\"tid\":0";
+        if (event.phase == 'i')
+            stream << ",\"s\":\"p\"";
+        stream << "}";
+    }
+    stream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    stream.flush();
+
+    if (file.error() != QFile::NoError) {
+        qWarning() << "StartupProfiler: Unable to write the trace to" << p->fileName;
+        return false;
+    }
+    if (!p->reported) {
+        p->reported = true;
+        qWarning() << "StartupProfiler: Trace written to" << p->fileName;
+    }
+    return true;
+}
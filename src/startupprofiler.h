@@ -0,0 +1,68 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#ifndef STARTUPPROFILER_H
+#define STARTUPPROFILER_H
+
+#include <qstring.h>
+
+class QWidget;
+
+/*
+    Records how long the phases of the startup take when Arora is started
+    with --profile-startup and writes them to a file in the Chrome trace
+    event format, which can be loaded into chrome://tracing.
+
+    When profiling is not enabled recording a phase does nothing.
+ */
+class StartupProfiler
+{
+public:
+    static void start(const QString &fileName);
+    static bool isEnabled();
+
+    static void begin(const char *name);
+    static void end(const char *name);
+    static void mark(const char *name);
+    static void markFirstPaint(QWidget *widget);
+
+    static bool save();
+};
+
+/*
+    Records the phase it is named after until it goes out of scope.
+ */
+class StartupProfilerSpan
+{
+public:
+    StartupProfilerSpan(const char *name)
+        : m_name(name)
+    {
+        StartupProfiler::begin(m_name);
+    }
+
+    ~StartupProfilerSpan()
+    {
+        StartupProfiler::end(m_name);
+    }
+
+private:
+    const char *m_name;
+};
+
+#endif // STARTUPPROFILER_H
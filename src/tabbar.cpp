@@ -70,6 +70,8 @@
 #include <qevent.h>
 #include <qmenu.h>
 #include <qstyle.h>
+#include <qstyleoption.h>
+#include <qstylepainter.h>
 #include <qurl.h>
 
 #include <qdebug.h>
@@ -89,6 +91,8 @@ TabBar::TabBar(QWidget *parent)
     : QTabBar(parent)
     , m_viewTabBarAction(0)
     , m_showTabBarWhenOneTab(true)
+    , m_manyTabsThreshold(50)
+    , m_mousePressed(false)
 {
     setContextMenuPolicy(Qt::CustomContextMenu);
     setAcceptDrops(true);
@@ -135,6 +139,79 @@ QTabBar::ButtonPosition TabBar::freeSide()
     return side;
 }
 
+/*
+    The number of tabs from which on all tabs have the same size and only
+    the visible ones are painted, 0 turns this off.
+ */
+int TabBar::manyTabsThreshold() const
+{
+    return m_manyTabsThreshold;
+}
+
+void TabBar::setManyTabsThreshold(int count)
+{
+    count = qMax(0, count);
+    if (m_manyTabsThreshold == count)
+        return;
+    m_manyTabsThreshold = count;
+    m_uniformTabSize = QSize();
+    // relayout the tabs
+    setElideMode(elideMode());
+}
+
+bool TabBar::hasManyTabs() const
+{
+    if (m_manyTabsThreshold <= 0 || count() < m_manyTabsThreshold)
+        return false;
+    switch (shape()) {
+    case QTabBar::RoundedWest:
+    case QTabBar::RoundedEast:
+    case QTabBar::TriangularWest:
+    case QTabBar::TriangularEast:
+        return false;
+    default:
+        return true;
+    }
+}
+
+/*
+    Returns the first tab that can be seen, the tabs are expected to be
+    laid out from left to right.
+ */
+int TabBar::firstVisibleTab() const
+{
+    int first = -1;
+    int low = 0;
+    int high = count() - 1;
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        if (tabRect(middle).right() >= 0) {
+            first = middle;
+            high = middle - 1;
+        } else {
+            low = middle + 1;
+        }
+    }
+    return first;
+}
+
+int TabBar::lastVisibleTab() const
+{
+    int last = -1;
+    int low = 0;
+    int high = count() - 1;
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        if (tabRect(middle).left() < width()) {
+            last = middle;
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return last;
+}
+
 void TabBar::updateViewToolBarAction()
 {
     bool show = showTabBarWhenOneTab();
@@ -229,6 +306,11 @@ void TabBar::mouseDoubleClickEvent(QMouseEvent *event)
 
 void TabBar::mouseReleaseEvent(QMouseEvent *event)
 {
+    if (event->button() == Qt::LeftButton) {
+        m_mousePressed = false;
+        m_mouseReleaseTime.start();
+    }
+
     if (event->button() == Qt::MidButton) {
         int index = tabAt(event->pos());
         if (index != -1) {
@@ -246,8 +328,10 @@ void TabBar::mouseReleaseEvent(QMouseEvent *event)
 
 void TabBar::mousePressEvent(QMouseEvent *event)
 {
-    if (event->button() == Qt::LeftButton)
+    if (event->button() == Qt::LeftButton) {
         m_dragStartPos = event->pos();
+        m_mousePressed = true;
+    }
     QTabBar::mousePressEvent(event);
 }
 
@@ -309,9 +393,105 @@ void TabBar::dropEvent(QDropEvent *event)
 
 QSize TabBar::tabSizeHint(int index) const
 {
-    QSize sizeHint = QTabBar::tabSizeHint(index);
     QFontMetrics fm = fontMetrics();
-    return sizeHint.boundedTo(QSize(fm.width(QLatin1Char('M')) * 18, sizeHint.height()));
+    int maximumWidth = fm.width(QLatin1Char('M')) * 18;
+    if (hasManyTabs()) {
+        // Every tab is laid out again when one is added or removed,
+        // don't measure all the titles each time
+        if (!m_uniformTabSize.isValid())
+            m_uniformTabSize = QSize(maximumWidth, QTabBar::tabSizeHint(index).height());
+        return m_uniformTabSize;
+    }
+    QSize sizeHint = QTabBar::tabSizeHint(index);
+    return sizeHint.boundedTo(QSize(maximumWidth, sizeHint.height()));
+}
+
+// QTabBar paints tabs that are being dragged with an offset, leave that to it
+bool TabBar::paintVisibleTabsOnly() const
+{
+    if (!hasManyTabs() || layoutDirection() == Qt::RightToLeft)
+        return false;
+    if (m_mousePressed)
+        return false;
+    // dropped tabs slide into place
+    return !m_mouseReleaseTime.isValid() || m_mouseReleaseTime.elapsed() > 500;
+}
+
+/*
+    Paints like QTabBar::paintEvent() but without preparing the style
+    options of every tab.
+ */
+void TabBar::paintEvent(QPaintEvent *event)
+{
+    if (!paintVisibleTabsOnly()) {
+        QTabBar::paintEvent(event);
+        return;
+    }
+
+    QStylePainter painter(this);
+    int selected = currentIndex();
+    int first = firstVisibleTab();
+    int last = lastVisibleTab();
+
+    if (drawBase()) {
+        QStyleOptionTabBarBaseV2 baseOption;
+        baseOption.init(this);
+        baseOption.shape = shape();
+        baseOption.documentMode = documentMode();
+        QStyleOptionTab overlapOption;
+        overlapOption.shape = shape();
+        int overlap = style()->pixelMetric(QStyle::PM_TabBarBaseOverlap, &overlapOption, this);
+        if (parentWidget() && overlap > 0) {
+            if (shape() == QTabBar::RoundedSouth || shape() == QTabBar::TriangularSouth)
+                baseOption.rect.setRect(0, 0, width(), overlap);
+            else
+                baseOption.rect.setRect(0, height() - overlap, width(), overlap);
+        }
+        baseOption.tabBarRect = tabRect(0) | tabRect(count() - 1);
+        baseOption.selectedTabRect = tabRect(selected);
+        painter.drawPrimitive(QStyle::PE_FrameTabBarBase, baseOption);
+    }
+
+    if (first == -1 || last == -1)
+        return;
+
+    for (int i = first; i <= last; ++i) {
+        if (i == selected)
+            continue;
+        QStyleOptionTabV3 option;
+        initStyleOption(&option, i);
+        if (!option.rect.intersects(event->rect()))
+            continue;
+        painter.drawControl(QStyle::CE_TabBarTab, option);
+    }
+
+    // The selected tab is drawn last so it overlaps its neighbors
+    if (selected >= first && selected <= last) {
+        QStyleOptionTabV3 option;
+        initStyleOption(&option, selected);
+        painter.drawControl(QStyle::CE_TabBarTab, option);
+    }
+
+    if (tabRect(first).left() < 0) {
+        QStyleOptionTab cutOption;
+        initStyleOption(&cutOption, first);
+        cutOption.rect = rect();
+        cutOption.rect = style()->subElementRect(QStyle::SE_TabBarTearIndicator, &cutOption, this);
+        painter.drawPrimitive(QStyle::PE_IndicatorTabTear, cutOption);
+    }
+}
+
+void TabBar::changeEvent(QEvent *event)
+{
+    switch (event->type()) {
+    case QEvent::FontChange:
+    case QEvent::StyleChange:
+        m_uniformTabSize = QSize();
+        break;
+    default:
+        break;
+    }
+    QTabBar::changeEvent(event);
 }
 
 void TabBar::reloadTab()
@@ -331,6 +511,8 @@ void TabBar::tabInserted(int position)
 void TabBar::tabRemoved(int position)
 {
     Q_UNUSED(position);
+    if (!hasManyTabs())
+        m_uniformTabSize = QSize();
     updateVisibility();
 }
 
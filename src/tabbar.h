@@ -67,8 +67,14 @@
 
 #include "tabwidget.h"
 
+#include <qdatetime.h>
+
 /*
     Tab bar with a few more features such as a context menu and shortcuts
+
+    Once there are manyTabsThreshold() tabs all tabs get the same size so
+    laying them out doesn't measure every title, and only the tabs that
+    can be seen are painted.
  */
 class TabBar : public QTabBar
 {
@@ -91,6 +97,12 @@ public:
     QAction *viewTabBarAction() const;
     QTabBar::ButtonPosition freeSide();
 
+    int manyTabsThreshold() const;
+    void setManyTabsThreshold(int count);
+    bool hasManyTabs() const;
+    int firstVisibleTab() const;
+    int lastVisibleTab() const;
+
 protected:
     void mouseDoubleClickEvent(QMouseEvent *event);
     void mouseReleaseEvent(QMouseEvent *event);
@@ -101,6 +113,8 @@ protected:
     QSize tabSizeHint(int index) const;
     void tabInserted(int position);
     void tabRemoved(int position);
+    void paintEvent(QPaintEvent *event);
+    void changeEvent(QEvent *event);
 
 private slots:
     void selectTabAction();
@@ -114,11 +128,16 @@ private slots:
 
 private:
     void updateVisibility();
+    bool paintVisibleTabsOnly() const;
     friend class TabWidget;
 
     QPoint m_dragStartPos;
     QAction *m_viewTabBarAction;
     bool m_showTabBarWhenOneTab;
+    int m_manyTabsThreshold;
+    mutable QSize m_uniformTabSize;
+    bool m_mousePressed;
+    QTime m_mouseReleaseTime;
 };
 
 
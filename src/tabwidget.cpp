@@ -68,12 +68,15 @@
 #include "bookmarksmodel.h"
 #include "browserapplication.h"
 #include "browsermainwindow.h"
+#include "dnsprefetcher.h"
 #include "history.h"
 #include "historycompleter.h"
 #include "historymanager.h"
 #include "locationbar.h"
+#include "networkaccessmanager.h"
 #include "opensearchengine.h"
 #include "opensearchmanager.h"
+#include "recentlyclosedstore.h"
 #include "tabbar.h"
 #include "toolbarsearch.h"
 #include "shortcuts.h"
@@ -86,12 +89,13 @@
 #include <qdir.h>
 #include <qevent.h>
 #include <qlistview.h>
+#include <qmap.h>
 #include <qmenu.h>
 #include <qmessagebox.h>
 #include <qmovie.h>
 #include <qsettings.h>
-#include <qstackedwidget.h>
 #include <qstyle.h>
+#include <qtimer.h>
 #include <qtoolbutton.h>
 #include <qwebhistory.h>
 
@@ -109,8 +113,12 @@ TabWidget::TabWidget(QWidget *parent)
     , m_previousTabAction(0)
     , m_recentlyClosedTabsMenu(0)
     , m_swappedDelayedWidget(false)
+    , m_hibernateTimer(0)
+    , m_hibernateAfter(0)
+    , m_maximumLiveTabs(0)
+    , m_hibernationCount(0)
     , m_lineEditCompleter(0)
-    , m_locationBars(0)
+    , m_locationBar(0)
     , m_tabBar(new TabBar(this))
     , addTabButton(0)
     , closeTabButton(0)
@@ -172,7 +180,9 @@ TabWidget::TabWidget(QWidget *parent)
             this, SLOT(aboutToShowRecentTriggeredAction(QAction *)));
     m_recentlyClosedTabsAction = new QAction(this);
     m_recentlyClosedTabsAction->setMenu(m_recentlyClosedTabsMenu);
-    m_recentlyClosedTabsAction->setEnabled(false);
+    connect(BrowserApplication::recentlyClosedStore(), SIGNAL(changed()),
+            this, SLOT(recentlyClosedChanged()));
+    recentlyClosedChanged();
 
 #ifndef Q_WS_MAC // can't seem to figure out the background color :(
     addTabButton = new QToolButton(this);
@@ -186,7 +196,30 @@ TabWidget::TabWidget(QWidget *parent)
     connect(this, SIGNAL(currentChanged(int)),
             this, SLOT(currentChanged(int)));
 
-    m_locationBars = new QStackedWidget(this);
+    m_locationBar = new LocationBar(this);
+    HistoryCompletionModel *completionModel = new HistoryCompletionModel(this);
+    completionModel->setSourceModel(BrowserApplication::historyManager()->historyFilterModel());
+    m_lineEditCompleter = new HistoryCompleter(completionModel, this);
+    connect(m_lineEditCompleter, SIGNAL(activated(const QString &)),
+            this, SLOT(loadString(const QString &)));
+    connect(m_lineEditCompleter, SIGNAL(highlighted(const QString &)),
+            BrowserApplication::networkAccessManager()->dnsPrefetcher(), SLOT(prefetch(const QString &)));
+    // Should this be in Qt by default?
+    QAbstractItemView *popup = m_lineEditCompleter->popup();
+    QListView *listView = qobject_cast<QListView*>(popup);
+    if (listView) {
+        // Urls are always LeftToRight
+        listView->setLayoutDirection(Qt::LeftToRight);
+        listView->setUniformItemSizes(true);
+    }
+    m_locationBar->setCompleter(m_lineEditCompleter);
+    connect(m_locationBar, SIGNAL(returnPressed()),
+            this, SLOT(lineEditReturnPressed()));
+
+    m_hibernateTimer = new QTimer(this);
+    m_hibernateTimer->setInterval(60 * 1000);
+    connect(m_hibernateTimer, SIGNAL(timeout()),
+            this, SLOT(hibernateTabs()));
 
     connect(BrowserApplication::historyManager(), SIGNAL(historyCleared()),
         this, SLOT(historyCleared()));
@@ -198,20 +231,18 @@ TabWidget::TabWidget(QWidget *parent)
 
 void TabWidget::historyCleared()
 {
-    m_recentlyClosedTabs.clear();
-    m_recentlyClosedTabsAction->setEnabled(false);
+    BrowserApplication::recentlyClosedStore()->clear();
 }
 
 void TabWidget::clear()
 {
-    // clear the recently closed tabs
-    m_recentlyClosedTabs.clear();
-    m_recentlyClosedTabsAction->setEnabled(false);
+    // clear the recently closed tabs and windows
+    BrowserApplication::recentlyClosedStore()->clear();
     // clear the line edit history
-    for (int i = 0; i < m_locationBars->count(); ++i) {
-        QLineEdit *qLineEdit = locationBar(i);
-        qLineEdit->setText(qLineEdit->text());
-        webViewSearch(i)->clear();
+    m_locationBar->setText(m_locationBar->text());
+    for (int i = 0; i < count(); ++i) {
+        if (WebViewSearch *search = webViewSearch(i))
+            search->clear();
     }
 }
 
@@ -230,9 +261,7 @@ void TabWidget::reloadTab(int index)
 
 void TabWidget::moveTab(int fromIndex, int toIndex)
 {
-    QWidget *lineEdit = m_locationBars->widget(fromIndex);
-    m_locationBars->removeWidget(lineEdit);
-    m_locationBars->insertWidget(toIndex, lineEdit);
+    emit tabMoved(fromIndex, toIndex);
 }
 
 void TabWidget::addWebAction(QAction *action, QWebPage::WebAction webAction)
@@ -244,14 +273,22 @@ void TabWidget::addWebAction(QAction *action, QWebPage::WebAction webAction)
 
 void TabWidget::currentChanged(int index)
 {
+    if (m_delayedTabs.contains(widget(index))) {
+        // create the WebView once the tab bar is done switching tabs
+        QTimer::singleShot(0, this, SLOT(restoreCurrentTab()));
+        return;
+    }
+
     WebView *webView = this->webView(index);
     if (!webView)
         return;
 
-    Q_ASSERT(m_locationBars->count() == count());
-
-    WebView *oldWebView = this->webView(m_locationBars->currentIndex());
+    QDateTime now = QDateTime::currentDateTime();
+    WebView *oldWebView = m_locationBar->webView();
     if (oldWebView) {
+        int oldIndex = webViewIndex(oldWebView);
+        if (oldIndex != -1)
+            m_tabActivity[widget(oldIndex)] = now;
         disconnect(oldWebView, SIGNAL(statusBarMessage(const QString&)),
                    this, SIGNAL(showStatusBarMessage(const QString&)));
         disconnect(oldWebView->page(), SIGNAL(linkHovered(const QString&, const QString&, const QString&)),
@@ -266,20 +303,24 @@ void TabWidget::currentChanged(int index)
             this, SIGNAL(linkHovered(const QString&)));
     connect(webView, SIGNAL(loadProgress(int)),
             this, SIGNAL(loadProgress(int)));
+    m_tabActivity[widget(index)] = now;
 
     for (int i = 0; i < m_actions.count(); ++i) {
         WebActionMapper *mapper = m_actions[i];
         mapper->updateCurrent(webView->page());
     }
     emit setCurrentTitle(webView->title());
-    m_locationBars->setCurrentIndex(index);
+    m_locationBar->setWebView(webView);
     emit loadProgress(webView->progress());
     emit showStatusBarMessage(webView->lastStatusBarText());
     if (webView->url().isEmpty() && webView->hasFocus()) {
-        m_locationBars->currentWidget()->setFocus();
+        m_locationBar->setFocus();
     } else if (!webView->url().isEmpty()) {
         webView->setFocus();
     }
+
+    if (m_maximumLiveTabs > 0)
+        QTimer::singleShot(0, this, SLOT(hibernateTabs()));
 }
 
 QAction *TabWidget::newTabAction() const
@@ -312,61 +353,75 @@ QAction *TabWidget::previousTabAction() const
     return m_previousTabAction;
 }
 
-QWidget *TabWidget::locationBarStack() const
-{
-    return m_locationBars;
-}
-
+/*
+    The location bar is shared by all tabs and shows the current one.
+ */
 QLineEdit *TabWidget::currentLocationBar() const
 {
-    return locationBar(m_locationBars->currentIndex());
+    return m_locationBar;
 }
 
-WebView *TabWidget::currentWebView() const
+/*
+    Returns the WebView of the current tab, creating it if the tab
+    does not have one yet.
+ */
+WebView *TabWidget::currentWebView()
 {
-    return webView(currentIndex());
+    return ensureWebView(currentIndex());
 }
 
-QLineEdit *TabWidget::locationBar(int index) const
+/*
+    Returns the WebView of the tab at index or 0 when the tab does not
+    have one yet, see ensureWebView().
+ */
+WebView *TabWidget::webView(int index) const
 {
-    return qobject_cast<LocationBar*>(m_locationBars->widget(index));
+    if (WebViewWithSearch *webViewWithSearch = qobject_cast<WebViewWithSearch*>(widget(index)))
+        return webViewWithSearch->m_webView;
+    return 0;
 }
 
-WebView *TabWidget::webView(int index) const
+/*
+    Returns the WebView of the tab at index, creating the WebView
+    of a background tab that is current or of the first tab.
+ */
+WebView *TabWidget::ensureWebView(int index)
 {
     QWidget *widget = this->widget(index);
     if (WebViewWithSearch *webViewWithSearch = qobject_cast<WebViewWithSearch*>(widget)) {
         return webViewWithSearch->m_webView;
+    } else if (m_delayedTabs.contains(widget)) {
+        // background tabs are only created once they are shown
+        if (index == currentIndex())
+            return restoreDelayedTab(index);
     } else if (widget) {
         // optimization to delay creating the first webview
         if (count() == 1) {
-            TabWidget *that = const_cast<TabWidget*>(this);
-            that->setUpdatesEnabled(false);
-            LocationBar *currentLocationBar = qobject_cast<LocationBar*>(m_locationBars->widget(0));
-            bool giveBackFocus = currentLocationBar->hasFocus();
-            m_locationBars->removeWidget(currentLocationBar);
-            m_locationBars->addWidget(new QWidget());
-            that->newTab();
-            that->closeTab(0);
-            QWidget *newEmptyLineEdit = m_locationBars->widget(0);
-            m_locationBars->removeWidget(newEmptyLineEdit);
-            newEmptyLineEdit->deleteLater();
-            m_locationBars->addWidget(currentLocationBar);
-            currentLocationBar->setWebView(currentWebView());
+            setUpdatesEnabled(false);
+            // keep what was typed before there was a WebView
+            bool giveBackFocus = m_locationBar->hasFocus();
+            bool modified = m_locationBar->isModified();
+            QString text = m_locationBar->text();
+            newTab();
+            closeTab(0);
+            if (modified) {
+                m_locationBar->setText(text);
+                m_locationBar->setModified(true);
+            }
             if (giveBackFocus)
-                currentLocationBar->setFocus();
-            that->setUpdatesEnabled(true);
-            that->m_swappedDelayedWidget = true;
+                m_locationBar->setFocus();
+            setUpdatesEnabled(true);
+            m_swappedDelayedWidget = true;
             return currentWebView();
         }
     }
     return 0;
 }
 
-WebViewSearch *TabWidget::webViewSearch(int index) const
+WebViewSearch *TabWidget::webViewSearch(int index)
 {
     // so the optimization can be performed
-    webView(index);
+    ensureWebView(index);
 
     QWidget *widget = this->widget(index);
     if (WebViewWithSearch *webViewWithSearch = qobject_cast<WebViewWithSearch*>(widget)) {
@@ -394,32 +449,6 @@ void TabWidget::newTab()
 
 WebView *TabWidget::makeNewTab(bool makeCurrent)
 {
-    // line edit
-    LocationBar *locationBar = new LocationBar;
-    if (!m_lineEditCompleter) {
-        HistoryCompletionModel *completionModel = new HistoryCompletionModel(this);
-        completionModel->setSourceModel(BrowserApplication::historyManager()->historyFilterModel());
-        m_lineEditCompleter = new HistoryCompleter(completionModel, this);
-        connect(m_lineEditCompleter, SIGNAL(activated(const QString &)),
-                this, SLOT(loadString(const QString &)));
-        // Should this be in Qt by default?
-        QAbstractItemView *popup = m_lineEditCompleter->popup();
-        QListView *listView = qobject_cast<QListView*>(popup);
-        if (listView) {
-            // Urls are always LeftToRight
-            listView->setLayoutDirection(Qt::LeftToRight);
-            listView->setUniformItemSizes(true);
-        }
-    }
-    locationBar->setCompleter(m_lineEditCompleter);
-    connect(locationBar, SIGNAL(returnPressed()), this, SLOT(lineEditReturnPressed()));
-    m_locationBars->addWidget(locationBar);
-    m_locationBars->setSizePolicy(locationBar->sizePolicy());
-
-#ifndef AUTOTESTS
-    QWidget::setTabOrder(locationBar, qFindChild<ToolbarSearch*>(BrowserMainWindow::parentWindow(this)));
-#endif
-
     // optimization to delay creating the more expensive WebView, history, etc
     if (count() == 0) {
         QWidget *emptyWidget = new QWidget;
@@ -429,15 +458,29 @@ WebView *TabWidget::makeNewTab(bool makeCurrent)
         emptyWidget->setAutoFillBackground(true);
         disconnect(this, SIGNAL(currentChanged(int)),
                    this, SLOT(currentChanged(int)));
-        addTab(emptyWidget, tr("Untitled"));
+        int index = addTab(emptyWidget, tr("Untitled"));
         connect(this, SIGNAL(currentChanged(int)),
                 this, SLOT(currentChanged(int)));
+        emit tabOpened(index);
         return 0;
     }
 
-    // webview
+    WebViewWithSearch *webViewWithSearch = makeWebView();
+    m_tabActivity[webViewWithSearch] = QDateTime::currentDateTime();
+    int index = addTab(webViewWithSearch, tr("Untitled"));
+    emit tabOpened(index);
+    if (makeCurrent)
+        setCurrentWidget(webViewWithSearch);
+
+    if (count() == 1)
+        currentChanged(currentIndex());
+    emit tabsChanged();
+    return webViewWithSearch->m_webView;
+}
+
+WebViewWithSearch *TabWidget::makeWebView()
+{
     WebView *webView = new WebView;
-    locationBar->setWebView(webView);
     connect(webView, SIGNAL(loadStarted()),
             this, SLOT(webViewLoadStarted()));
     connect(webView, SIGNAL(loadProgress(int)),
@@ -465,23 +508,203 @@ WebView *TabWidget::makeNewTab(bool makeCurrent)
     connect(webView->page(), SIGNAL(toolBarVisibilityChangeRequested(bool)),
             this, SLOT(toolBarVisibilityChangeRequestedCheck(bool)));
 
-    WebViewWithSearch *webViewWithSearch = new WebViewWithSearch(webView, this);
-    addTab(webViewWithSearch, tr("Untitled"));
-    if (makeCurrent)
-        setCurrentWidget(webViewWithSearch);
-
     // webview actions
     for (int i = 0; i < m_actions.count(); ++i) {
         WebActionMapper *mapper = m_actions[i];
         mapper->addChild(webView->page()->action(mapper->webAction()));
     }
 
-    if (count() == 1)
-        currentChanged(currentIndex());
+    return new WebViewWithSearch(webView, this);
+}
+
+/*
+    Insert a tab at index that only shows the title and icon of url, the WebView
+    is created and its history restored when the tab is first activated.
+ */
+int TabWidget::makeDelayedTab(const QUrl &url, const QString &title, const QByteArray &historyState, int index)
+{
+    QWidget *emptyWidget = new QWidget;
+    QPalette p = emptyWidget->palette();
+    p.setColor(QPalette::Window, palette().color(QPalette::Base));
+    emptyWidget->setPalette(p);
+    emptyWidget->setAutoFillBackground(true);
+
+    DelayedTab delayedTab;
+    delayedTab.url = url;
+    delayedTab.title = title;
+    delayedTab.historyState = historyState;
+    m_delayedTabs.insert(emptyWidget, delayedTab);
+
+    QString tabTitle = title;
+    if (tabTitle.isEmpty())
+        tabTitle = QString::fromUtf8(url.toEncoded());
+    tabTitle.replace(QLatin1Char('&'), QLatin1String("&&"));
+    index = insertTab(index, emptyWidget, tabTitle);
+    setTabToolTip(index, tabTitle);
+    m_tabBar->setTabData(index, url);
+    m_tabBar->setTabTextColor(index, palette().color(QPalette::Disabled, QPalette::WindowText));
+#if !defined(Q_WS_MAC)
+    QIcon icon = BrowserApplication::instance()->icon(url);
+    animationLabel(index, false)->setPixmap(icon.pixmap(16, 16));
+#endif
+
     emit tabsChanged();
+    return index;
+}
+
+/*
+    Swap the placeholder at index for a real WebView and load it.
+ */
+WebView *TabWidget::restoreDelayedTab(int index)
+{
+    QWidget *emptyWidget = widget(index);
+    if (!m_delayedTabs.contains(emptyWidget))
+        return 0;
+    DelayedTab delayedTab = m_delayedTabs.take(emptyWidget);
+
+    WebViewWithSearch *webViewWithSearch = makeWebView();
+    m_locationBar->setWebViewText(webViewWithSearch->m_webView, QString::fromUtf8(delayedTab.url.toEncoded()));
+
+    bool current = (index == currentIndex());
+    QString text = tabText(index);
+    QString toolTip = tabToolTip(index);
+    setUpdatesEnabled(false);
+    disconnect(this, SIGNAL(currentChanged(int)),
+               this, SLOT(currentChanged(int)));
+    removeTab(index);
+    insertTab(index, webViewWithSearch, text);
+    setTabToolTip(index, toolTip);
+    m_tabBar->setTabData(index, delayedTab.url);
+    if (current)
+        setCurrentIndex(index);
+    connect(this, SIGNAL(currentChanged(int)),
+            this, SLOT(currentChanged(int)));
+    setUpdatesEnabled(true);
+    emptyWidget->deleteLater();
+
+    WebView *webView = webViewWithSearch->m_webView;
+#if QT_VERSION >= 0x040600
+    if (!delayedTab.historyState.isEmpty())
+        webView->history()->restoreState(delayedTab.historyState);
+    else
+#endif
+    if (!delayedTab.url.isEmpty())
+        webView->loadUrl(delayedTab.url);
+    if (current)
+        currentChanged(index);
     return webView;
 }
 
+void TabWidget::restoreCurrentTab()
+{
+    restoreDelayedTab(currentIndex());
+}
+
+/*
+    Replace the WebView of the background tab at index with a placeholder
+    that keeps its url, title and history until it is activated again.
+ */
+bool TabWidget::hibernateTab(int index)
+{
+    if (index < 0 || index >= count() || index == currentIndex())
+        return false;
+    WebViewWithSearch *webViewWithSearch = qobject_cast<WebViewWithSearch*>(widget(index));
+    if (!webViewWithSearch)
+        return false;
+
+    // Don't throw away anything the user would miss
+    WebView *webView = webViewWithSearch->m_webView;
+    if (webView->url().isEmpty()
+        || webView->isModified()
+        || webView->progress() != 0)
+        return false;
+
+    QUrl url = webView->url();
+    QString title = webView->title();
+    QByteArray historyState;
+#if QT_VERSION >= 0x040600
+    if (webView->history()->count() != 0)
+        historyState = webView->history()->saveState();
+#endif
+
+    int current = currentIndex();
+    setUpdatesEnabled(false);
+    disconnect(this, SIGNAL(currentChanged(int)),
+               this, SLOT(currentChanged(int)));
+    m_tabActivity.remove(webViewWithSearch);
+    removeTab(index);
+    webViewWithSearch->setParent(0);
+    webViewWithSearch->deleteLater();
+
+    makeDelayedTab(url, title, historyState, index);
+    setCurrentIndex(current);
+    connect(this, SIGNAL(currentChanged(int)),
+            this, SLOT(currentChanged(int)));
+    setUpdatesEnabled(true);
+    ++m_hibernationCount;
+    return true;
+}
+
+/*
+    Hibernate the background tabs that have not been shown for the
+    hibernateAfter minutes and, least recently shown first, those over
+    the maximumLiveTabs budget.
+ */
+void TabWidget::hibernateTabs()
+{
+    QDateTime now = QDateTime::currentDateTime();
+    int liveTabs = 0;
+    QMultiMap<QDateTime, QWidget*> backgroundTabs;
+    for (int i = 0; i < count(); ++i) {
+        QWidget *tab = widget(i);
+        if (!qobject_cast<WebViewWithSearch*>(tab))
+            continue;
+        ++liveTabs;
+        if (i != currentIndex())
+            backgroundTabs.insert(m_tabActivity.value(tab), tab);
+    }
+
+    QMultiMap<QDateTime, QWidget*>::const_iterator it = backgroundTabs.constBegin();
+    for (; it != backgroundTabs.constEnd(); ++it) {
+        bool expired = m_hibernateAfter > 0
+                       && it.key().secsTo(now) >= m_hibernateAfter * 60;
+        bool overBudget = m_maximumLiveTabs > 0 && liveTabs > m_maximumLiveTabs;
+        if (!expired && !overBudget)
+            break;
+        if (hibernateTab(indexOf(it.value())))
+            --liveTabs;
+    }
+}
+
+/*
+    The number of tabs that currently have no WebView,
+    both hibernated tabs and restored tabs that were never shown.
+ */
+int TabWidget::hibernatedTabCount() const
+{
+    return m_delayedTabs.count();
+}
+
+/*
+    The number of times a tab has been hibernated.
+ */
+int TabWidget::hibernationCount() const
+{
+    return m_hibernationCount;
+}
+
+/*
+    Returns what the page in the tab at \a index used, hibernated tabs and
+    tabs that were not shown yet have no page and use nothing.
+ */
+WebPageResourceUsage TabWidget::resourceUsage(int index) const
+{
+    QWidget *widget = this->widget(index);
+    if (WebViewWithSearch *webViewWithSearch = qobject_cast<WebViewWithSearch*>(widget))
+        return webViewWithSearch->m_webView->webPage()->resourceUsage();
+    return WebPageResourceUsage();
+}
+
 void TabWidget::geometryChangeRequestedCheck(const QRect &geometry)
 {
     if (count() == 1)
@@ -527,12 +750,19 @@ void TabWidget::bookmarkTabs()
         return;
 
     for (int i = 0; i < count(); ++i) {
-        WebView *tab = webView(i);
-        if (!tab)
+        QString title;
+        QString url;
+        if (WebView *tab = webView(i)) {
+            title = tab->title();
+            url = QString::fromUtf8(tab->url().toEncoded());
+        } else if (m_delayedTabs.contains(widget(i))) {
+            const DelayedTab &delayedTab = m_delayedTabs[widget(i)];
+            title = delayedTab.title;
+            url = QString::fromUtf8(delayedTab.url.toEncoded());
+        } else {
             continue;
+        }
 
-        QString title = tab->title();
-        QString url = QString::fromUtf8(tab->url().toEncoded());
         BookmarkNode *bookmark = new BookmarkNode(BookmarkNode::Bookmark);
         bookmark->url = url;
         bookmark->title = title;
@@ -548,7 +778,7 @@ void TabWidget::lineEditReturnPressed()
             tab = NewSelectedTab;
 
         loadString(lineEdit->text(), tab);
-        if (m_locationBars->currentWidget() == lineEdit)
+        if (currentWebView())
             currentWebView()->setFocus();
     }
 }
@@ -585,7 +815,11 @@ void TabWidget::cloneTab(int index)
         index = currentIndex();
     if (index < 0 || index >= count())
         return;
-    QUrl url = webView(index)->url();
+    QUrl url;
+    if (WebView *tab = webView(index))
+        url = tab->url();
+    else
+        url = m_delayedTabs.value(widget(index)).url;
     WebView *tab = makeNewTab();
     tab->loadUrl(url);
 }
@@ -617,24 +851,21 @@ void TabWidget::closeTab(int index)
         }
         hasFocus = tab->hasFocus();
 
-        m_recentlyClosedTabsAction->setEnabled(true);
-        m_recentlyClosedTabs.prepend(tab->url());
 #if QT_VERSION >= 0x040600
-        m_recentlyClosedTabsHistory.prepend(tab->history()->saveState());
+        addRecentlyClosedTab(tab->url(), tab->title(), tab->history()->saveState());
 #else
-        m_recentlyClosedTabsHistory.prepend(QByteArray());
+        addRecentlyClosedTab(tab->url(), tab->title(), QByteArray());
 #endif
-        if (m_recentlyClosedTabs.size() >= TabWidget::m_recentlyClosedTabsSize)
-            m_recentlyClosedTabs.removeLast();
+    } else if (m_delayedTabs.contains(widget(index))) {
+        DelayedTab delayedTab = m_delayedTabs.take(widget(index));
+        addRecentlyClosedTab(delayedTab.url, delayedTab.title, delayedTab.historyState);
     }
-    QWidget *lineEdit = m_locationBars->widget(index);
-    m_locationBars->removeWidget(lineEdit);
-    lineEdit->deleteLater();
-
     QWidget *webViewWithSearch = widget(index);
+    m_tabActivity.remove(webViewWithSearch);
     removeTab(index);
     webViewWithSearch->setParent(0);
     webViewWithSearch->deleteLater();
+    emit tabClosed(index);
 
     emit tabsChanged();
     if (hasFocus && count() > 0 && currentWebView())
@@ -643,6 +874,17 @@ void TabWidget::closeTab(int index)
         emit lastTabClosed();
 }
 
+void TabWidget::addRecentlyClosedTab(const QUrl &url, const QString &title, const QByteArray &historyState)
+{
+    BrowserApplication::recentlyClosedStore()->addTab(url, title, historyState);
+}
+
+void TabWidget::recentlyClosedChanged()
+{
+    RecentlyClosedStore *store = BrowserApplication::recentlyClosedStore();
+    m_recentlyClosedTabsAction->setEnabled(store->count(RecentlyClosedStore::Tab) > 0);
+}
+
 QLabel *TabWidget::animationLabel(int index, bool addMovie)
 {
     if (-1 == index)
@@ -711,6 +953,10 @@ void TabWidget::webViewLoadFinished(bool ok)
     }
     webViewIconChanged();
 
+    // the history has its final state now
+    if (-1 != index)
+        emit tabChanged(index);
+
     if (index != currentIndex())
         return;
 
@@ -748,6 +994,7 @@ void TabWidget::webViewTitleChanged(const QString &title)
     tabTitle.replace(QLatin1Char('&'), QLatin1String("&&"));
     setTabText(index, tabTitle);
     setTabToolTip(index, tabTitle);
+    emit tabChanged(index);
     if (currentIndex() == index)
         emit setCurrentTitle(title);
     BrowserApplication::historyManager()->updateHistoryEntry(webView->url(), title);
@@ -760,36 +1007,43 @@ void TabWidget::webViewUrlChanged(const QUrl &url)
     if (-1 == index)
         return;
     m_tabBar->setTabData(index, url);
+    emit tabChanged(index);
     emit tabsChanged();
 }
 
 void TabWidget::openLastTab()
 {
-    if (m_recentlyClosedTabs.isEmpty())
+    openRecentlyClosedTab(0);
+}
+
+void TabWidget::openRecentlyClosedTab(int index)
+{
+    RecentlyClosedStore *store = BrowserApplication::recentlyClosedStore();
+    if (index < 0 || index >= store->count(RecentlyClosedStore::Tab))
         return;
-    QUrl url = m_recentlyClosedTabs.takeFirst();
-    QByteArray historyState = m_recentlyClosedTabsHistory.takeFirst();
+    QUrl url;
+    QByteArray historyState = store->take(RecentlyClosedStore::Tab, index, &url);
 #if QT_VERSION >= 0x040600
-    createTab(historyState, NewTab);
-#else
-    loadUrl(url, NewTab);
+    if (!historyState.isEmpty()) {
+        createTab(historyState, NewTab);
+        return;
+    }
 #endif
-    m_recentlyClosedTabsAction->setEnabled(!m_recentlyClosedTabs.isEmpty());
+    loadUrl(url, NewTab);
 }
 
 void TabWidget::aboutToShowRecentTabsMenu()
 {
     m_recentlyClosedTabsMenu->clear();
-    for (int i = 0; i < m_recentlyClosedTabs.count(); ++i) {
+    RecentlyClosedStore *store = BrowserApplication::recentlyClosedStore();
+    for (int i = 0; i < store->count(RecentlyClosedStore::Tab); ++i) {
         QAction *action = new QAction(m_recentlyClosedTabsMenu);
-#if QT_VERSION >= 0x040600
-        action->setData(m_recentlyClosedTabsHistory.at(i));
-#else
-        action->setData(m_recentlyClosedTabs.at(i));
-#endif
-        QIcon icon = BrowserApplication::instance()->icon(m_recentlyClosedTabs.at(i));
+        QUrl url = store->url(RecentlyClosedStore::Tab, i);
+        QString title = store->title(RecentlyClosedStore::Tab, i);
+        action->setData(i);
+        QIcon icon = BrowserApplication::instance()->icon(url);
         action->setIcon(icon);
-        action->setText(m_recentlyClosedTabs.at(i).toString());
+        action->setText(title.isEmpty() ? url.toString() : title);
         m_recentlyClosedTabsMenu->addAction(action);
     }
 }
@@ -799,13 +1053,7 @@ void TabWidget::aboutToShowRecentTriggeredAction(QAction *action)
     if (!action)
         return;
 
-#if QT_VERSION >= 0x040600
-    QByteArray historyState = action->data().toByteArray();
-    createTab(historyState, NewTab);
-#else
-    QUrl url = action->data().toUrl();
-    loadUrl(url, NewTab);
-#endif
+    openRecentlyClosedTab(action->data().toInt());
 }
 
 void TabWidget::retranslate()
@@ -915,6 +1163,14 @@ void TabWidget::loadSettings()
         setCornerWidget(0, newTabButtonInRightCorner ? Qt::TopLeftCorner : Qt::TopRightCorner);
     }
     m_tabBar->setTabsClosable(!oneCloseButton);
+    m_tabBar->setManyTabsThreshold(settings.value(QLatin1String("manyTabsThreshold"), 50).toInt());
+
+    m_hibernateAfter = settings.value(QLatin1String("hibernateAfter"), 0).toInt();
+    m_maximumLiveTabs = settings.value(QLatin1String("maximumLiveTabs"), 0).toInt();
+    if (m_hibernateAfter > 0 || m_maximumLiveTabs > 0)
+        m_hibernateTimer->start();
+    else
+        m_hibernateTimer->stop();
 }
 
 /*
@@ -964,7 +1220,7 @@ void TabWidget::loadUrl(const QUrl &url, OpenUrlIn tab, const QString &title)
         return;
     WebView *webView = getView(tab, currentWebView());
     if (webView) {
-        locationBar(webViewIndex(webView))->setText(QString::fromUtf8(url.toEncoded()));
+        m_locationBar->setWebViewText(webView, QString::fromUtf8(url.toEncoded()));
         webView->loadUrl(url, title);
     }
 }
@@ -1038,46 +1294,78 @@ static const qint32 TabWidgetMagic = 0xaa;
 
 QByteArray TabWidget::saveState() const
 {
-    int version = 1;
+    QStringList tabs;
+    QList<QByteArray> tabsHistory;
+    QStringList tabsTitles;
+    for (int i = 0; i < count(); ++i) {
+        QUrl url;
+        QString title;
+        QByteArray historyState;
+        if (m_swappedDelayedWidget || m_delayedTabs.contains(widget(i)))
+            tabState(i, &url, &title, &historyState);
+        tabs.append(QString::fromUtf8(url.toEncoded()));
+        tabsHistory.append(historyState);
+        tabsTitles.append(title);
+    }
+    return saveState(tabs, currentIndex(), tabsHistory, tabsTitles);
+}
+
+/*
+    Encode the state of a tab widget holding the tabs described by the
+    lists, in the format restoreState() understands.
+ */
+QByteArray TabWidget::saveState(const QStringList &urls, int currentIndex,
+                                const QList<QByteArray> &historyStates, const QStringList &titles)
+{
+    int version = 2;
     QByteArray data;
     QDataStream stream(&data, QIODevice::WriteOnly);
 
     stream << qint32(TabWidgetMagic);
     stream << qint32(version);
 
-    QStringList tabs;
-    QList<QByteArray> tabsHistory;
-    for (int i = 0; i < count(); ++i) {
-        if (!m_swappedDelayedWidget) {
-            tabs.append(QString::null);
-            tabsHistory.append(QByteArray());
-            continue;
-        }
-        if (WebView *tab = webView(i)) {
-            tabs.append(QString::fromUtf8(tab->url().toEncoded()));
+    stream << urls;
+    stream << currentIndex;
+    stream << historyStates;
+    stream << titles;
+
+    return data;
+}
+
+/*
+    The url, title and history of the tab at index, without creating
+    a WebView for tabs that don't have one yet.
+ */
+void TabWidget::tabState(int index, QUrl *url, QString *title, QByteArray *historyState) const
+{
+    QWidget *widget = this->widget(index);
+    if (WebViewWithSearch *webViewWithSearch = qobject_cast<WebViewWithSearch*>(widget)) {
+        WebView *tab = webViewWithSearch->m_webView;
+        *url = tab->url();
+        *title = tab->title();
 #if QT_VERSION >= 0x040600
-            if (tab->history()->count() != 0)
-                tabsHistory.append(tab->history()->saveState());
-            else
-                tabsHistory.append(QByteArray());
+        if (tab->history()->count() != 0)
+            *historyState = tab->history()->saveState();
+        else
+            *historyState = QByteArray();
 #else
-            tabsHistory.append(QByteArray());
+        *historyState = QByteArray();
 #endif
-        } else {
-            tabs.append(QString::null);
-            tabsHistory.append(QByteArray());
-        }
+    } else if (m_delayedTabs.contains(widget)) {
+        const DelayedTab &delayedTab = m_delayedTabs[widget];
+        *url = delayedTab.url;
+        *title = delayedTab.title;
+        *historyState = delayedTab.historyState;
+    } else {
+        *url = QUrl();
+        *title = QString();
+        *historyState = QByteArray();
     }
-    stream << tabs;
-    stream << currentIndex();
-    stream << tabsHistory;
-
-    return data;
 }
 
 bool TabWidget::restoreState(const QByteArray &state)
 {
-    int version = 1;
+    int version = 2;
     QByteArray sd = state;
     QDataStream stream(&sd, QIODevice::ReadOnly);
     if (stream.atEnd())
@@ -1087,7 +1375,7 @@ bool TabWidget::restoreState(const QByteArray &state)
     qint32 v;
     stream >> marker;
     stream >> v;
-    if (marker != TabWidgetMagic || v != version)
+    if (marker != TabWidgetMagic || v < 1 || v > version)
         return false;
 
     QStringList openTabs;
@@ -1095,25 +1383,35 @@ bool TabWidget::restoreState(const QByteArray &state)
 
     int currentTab;
     stream >> currentTab;
-    setCurrentIndex(currentTab);
     QList<QByteArray> tabHistory;
     stream >> tabHistory;
-
+    QStringList tabTitles;
+    if (v >= 2)
+        stream >> tabTitles;
+
+    // Every tab starts out as a placeholder, only the one that ends up
+    // current is loaded, replacing the blank tab of a new window
+    QWidget *blankTab = 0;
+    if (!m_delayedTabs.contains(currentWidget())) {
+        WebView *view = webView(currentIndex());
+        if (!view || view->url() == QUrl())
+            blankTab = currentWidget();
+    }
+    int selectTab = -1;
     for (int i = 0; i < openTabs.count(); ++i) {
         QUrl url = QUrl::fromEncoded(openTabs.at(i).toUtf8());
-        TabWidget::OpenUrlIn tab = i == 0 && currentWebView()->url() == QUrl() ? CurrentTab : NewTab;
-#if QT_VERSION >= 0x040600
-        QByteArray historyState = tabHistory.value(i);
-        if (!historyState.isEmpty()) {
-            createTab(historyState, tab);
-        } else {
-#endif
-            if (WebView *webView = getView(tab, currentWebView()))
-                webView->loadUrl(url);
-#if QT_VERSION >= 0x040600
-        }
-#endif
-
+        int index = makeDelayedTab(url, tabTitles.value(i), tabHistory.value(i));
+        emit tabOpened(index);
+        emit tabChanged(index);
+        if (i == currentTab || selectTab == -1)
+            selectTab = index;
+    }
+    if (selectTab != -1) {
+        QWidget *select = widget(selectTab);
+        if (blankTab)
+            closeTab(indexOf(blankTab));
+        setCurrentWidget(select);
+        m_swappedDelayedWidget = true;
     }
     return true;
 }
@@ -65,6 +65,8 @@
 
 #include <qtabwidget.h>
 
+#include <qdatetime.h>
+#include <qhash.h>
 #include <qwebpage.h>
 #include <qurl.h>
 
@@ -73,21 +75,34 @@ class QCompleter;
 class QLabel;
 class QLineEdit;
 class QMenu;
-class QStackedWidget;
+class QTimer;
 QT_END_NAMESPACE
 
 class BrowserMainWindow;
+class LocationBar;
 class TabBar;
 class WebView;
 class WebActionMapper;
+class WebPageResourceUsage;
 class WebViewSearch;
+class WebViewWithSearch;
 class QToolButton;
 
 /*!
-    TabWidget that contains WebViews and a stack widget of associated line edits.
+    TabWidget that contains WebViews and the location bar they share.
 
     Connects up the current tab's signals to this class's signal and uses WebActionMapper
     to proxy the actions.
+
+    Tabs restored in the background only hold their url, title and history
+    until they are first activated, webView() returns 0 for them until then
+    while currentWebView() and ensureWebView() create the current one.
+    Background tabs that have not been shown for a while, or the least recently
+    shown ones when there are too many live tabs, are hibernated back into
+    that state.
+
+    The requests of the pages in the tabs are counted by the pages, see
+    resourceUsage().
  */
 class TabWidget : public QTabWidget
 {
@@ -98,6 +113,12 @@ signals:
     void tabsChanged();
     void lastTabClosed();
 
+    // session signals
+    void tabOpened(int index);
+    void tabClosed(int index);
+    void tabMoved(int fromIndex, int toIndex);
+    void tabChanged(int index);
+
     // current tab signals
     void setCurrentTitle(const QString &url);
     void showStatusBarMessage(const QString &message);
@@ -133,17 +154,25 @@ public:
     QAction *nextTabAction() const;
     QAction *previousTabAction() const;
 
-    QWidget *locationBarStack() const;
     QLineEdit *currentLocationBar() const;
-    WebView *currentWebView() const;
+    WebView *currentWebView();
     WebView *webView(int index) const;
-    WebViewSearch *webViewSearch(int index) const;
-    QLineEdit *locationBar(int index) const;
+    WebView *ensureWebView(int index);
+    WebViewSearch *webViewSearch(int index);
     int webViewIndex(WebView *webView) const;
     WebView *makeNewTab(bool makeCurrent = false);
 
     QByteArray saveState() const;
     bool restoreState(const QByteArray &state);
+    static QByteArray saveState(const QStringList &urls, int currentIndex,
+                                const QList<QByteArray> &historyStates, const QStringList &titles);
+    void tabState(int index, QUrl *url, QString *title, QByteArray *historyState) const;
+
+    bool hibernateTab(int index);
+    int hibernatedTabCount() const;
+    int hibernationCount() const;
+
+    WebPageResourceUsage resourceUsage(int index) const;
 
     static OpenUrlIn modifyWithUserBehavior(OpenUrlIn tab);
     WebView *getView(OpenUrlIn tab, WebView *currentView);
@@ -168,9 +197,12 @@ public slots:
 
 private slots:
     void currentChanged(int index);
+    void restoreCurrentTab();
+    void hibernateTabs();
     void openLastTab();
     void aboutToShowRecentTabsMenu();
     void aboutToShowRecentTriggeredAction(QAction *action);
+    void recentlyClosedChanged();
     void webViewLoadStarted();
     void webViewLoadProgress(int progress);
     void webViewLoadFinished(bool ok);
@@ -190,6 +222,17 @@ private:
     static QUrl guessUrlFromString(const QString &url);
     QLabel *animationLabel(int index, bool addMovie);
     void retranslate();
+    WebViewWithSearch *makeWebView();
+    int makeDelayedTab(const QUrl &url, const QString &title, const QByteArray &historyState, int index = -1);
+    WebView *restoreDelayedTab(int index);
+    void addRecentlyClosedTab(const QUrl &url, const QString &title, const QByteArray &historyState);
+    void openRecentlyClosedTab(int index);
+
+    struct DelayedTab {
+        QUrl url;
+        QString title;
+        QByteArray historyState;
+    };
 
     QAction *m_recentlyClosedTabsAction;
     QAction *m_newTabAction;
@@ -199,14 +242,17 @@ private:
     QAction *m_previousTabAction;
 
     QMenu *m_recentlyClosedTabsMenu;
-    static const int m_recentlyClosedTabsSize = 10;
-    QList<QUrl> m_recentlyClosedTabs;
-    QList<QByteArray> m_recentlyClosedTabsHistory;
     QList<WebActionMapper*> m_actions;
     bool m_swappedDelayedWidget;
+    QHash<QWidget*, DelayedTab> m_delayedTabs;
+    QHash<QWidget*, QDateTime> m_tabActivity;
+    QTimer *m_hibernateTimer;
+    int m_hibernateAfter;
+    int m_maximumLiveTabs;
+    int m_hibernationCount;
 
     QCompleter *m_lineEditCompleter;
-    QStackedWidget *m_locationBars;
+    LocationBar *m_locationBar;
     TabBar *m_tabBar;
     QToolButton *addTabButton;
     QToolButton *closeTabButton;
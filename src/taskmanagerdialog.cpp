@@ -0,0 +1,162 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "taskmanagerdialog.h"
+
+#include "browserapplication.h"
+#include "browsermainwindow.h"
+#include "downloadmanager.h"
+#include "tabwidget.h"
+#include "webpage.h"
+
+#include <qdialogbuttonbox.h>
+#include <qheaderview.h>
+#include <qlayout.h>
+#include <qpointer.h>
+#include <qpushbutton.h>
+#include <qtimer.h>
+#include <qtreewidget.h>
+
+enum Column {
+    PageColumn,
+    RequestsColumn,
+    BlockedColumn,
+    ReceivedColumn,
+    LoadTimeColumn,
+    MemoryColumn,
+    ColumnCount
+};
+
+TaskManagerDialog::TaskManagerDialog(QWidget *parent)
+    : QDialog(parent)
+{
+    setWindowTitle(tr("Task Manager"));
+    resize(640, 360);
+
+    QVBoxLayout *layout = new QVBoxLayout();
+
+    m_tree = new QTreeWidget;
+    m_tree->setRootIsDecorated(false);
+    m_tree->setUniformRowHeights(true);
+    m_tree->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    m_tree->setColumnCount(ColumnCount);
+    m_tree->setHeaderLabels(QStringList()
+                            << tr("Page")
+                            << tr("Requests")
+                            << tr("Blocked")
+                            << tr("Received")
+                            << tr("Load Time")
+                            << tr("Memory"));
+    m_tree->header()->setStretchLastSection(false);
+    m_tree->header()->setResizeMode(PageColumn, QHeaderView::Stretch);
+    connect(m_tree, SIGNAL(itemSelectionChanged()),
+            this, SLOT(updateButtons()));
+    layout->addWidget(m_tree);
+
+    m_closeTabsButton = new QPushButton(tr("&Close Tabs"));
+    connect(m_closeTabsButton, SIGNAL(clicked()),
+            this, SLOT(closeSelectedTabs()));
+    QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Close);
+    buttonBox->addButton(m_closeTabsButton, QDialogButtonBox::ActionRole);
+    connect(buttonBox, SIGNAL(rejected()), this, SLOT(reject()));
+    layout->addWidget(buttonBox);
+
+    setLayout(layout);
+
+    m_refreshTimer = new QTimer(this);
+    m_refreshTimer->setInterval(1000);
+    connect(m_refreshTimer, SIGNAL(timeout()),
+            this, SLOT(refresh()));
+    m_refreshTimer->start();
+
+    refresh();
+}
+
+TaskManagerDialog *TaskManagerDialog::showDialog()
+{
+    static QPointer<TaskManagerDialog> dialog;
+    if (!dialog) {
+        dialog = new TaskManagerDialog;
+        dialog->setAttribute(Qt::WA_DeleteOnClose, true);
+    }
+    dialog->show();
+    dialog->raise();
+    dialog->activateWindow();
+    return dialog;
+}
+
+void TaskManagerDialog::refresh()
+{
+    // Rows are identified by the widget of their tab so the selection
+    // is kept when tabs move
+    QList<void*> selected;
+    foreach (QTreeWidgetItem *item, m_tree->selectedItems())
+        selected.append(item->data(0, Qt::UserRole).value<void*>());
+
+    int row = 0;
+    QList<BrowserMainWindow*> mainWindows = BrowserApplication::instance()->mainWindows();
+    for (int i = 0; i < mainWindows.count(); ++i) {
+        TabWidget *tabWidget = mainWindows.at(i)->tabWidget();
+        for (int j = 0; j < tabWidget->count(); ++j) {
+            QTreeWidgetItem *item = m_tree->topLevelItem(row);
+            if (!item)
+                item = new QTreeWidgetItem(m_tree);
+            ++row;
+
+            void *widget = tabWidget->widget(j);
+            WebPageResourceUsage usage = tabWidget->resourceUsage(j);
+            item->setData(0, Qt::UserRole, qVariantFromValue(widget));
+            item->setText(PageColumn, tabWidget->tabText(j));
+            item->setIcon(PageColumn, tabWidget->tabIcon(j));
+            item->setText(RequestsColumn, QString::number(usage.requests));
+            item->setText(BlockedColumn, QString::number(usage.blockedRequests));
+            item->setText(ReceivedColumn, DownloadManager::dataString(usage.bytesReceived));
+            item->setText(LoadTimeColumn, tr("%1 s").arg(usage.lastLoadTime / 1000.0, 0, 'f', 2));
+            item->setText(MemoryColumn, DownloadManager::dataString(usage.memoryUsage));
+            for (int k = RequestsColumn; k < ColumnCount; ++k)
+                item->setTextAlignment(k, Qt::AlignRight | Qt::AlignVCenter);
+            item->setSelected(selected.contains(widget));
+        }
+    }
+    while (m_tree->topLevelItemCount() > row)
+        delete m_tree->takeTopLevelItem(row);
+    updateButtons();
+}
+
+void TaskManagerDialog::closeSelectedTabs()
+{
+    QList<void*> selected;
+    foreach (QTreeWidgetItem *item, m_tree->selectedItems())
+        selected.append(item->data(0, Qt::UserRole).value<void*>());
+
+    QList<BrowserMainWindow*> mainWindows = BrowserApplication::instance()->mainWindows();
+    for (int i = 0; i < mainWindows.count(); ++i) {
+        TabWidget *tabWidget = mainWindows.at(i)->tabWidget();
+        for (int j = tabWidget->count() - 1; j >= 0; --j) {
+            if (selected.contains(tabWidget->widget(j)))
+                tabWidget->closeTab(j);
+        }
+    }
+    refresh();
+}
+
+void TaskManagerDialog::updateButtons()
+{
+    m_closeTabsButton->setEnabled(!m_tree->selectedItems().isEmpty());
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright 2009 Benjamin C. Meyer <ben@meyerhome.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+#ifndef TASKMANAGERDIALOG_H
+#define TASKMANAGERDIALOG_H
+
+#include <qdialog.h>
+
+class QPushButton;
+class QTimer;
+class QTreeWidget;
+
+/*
+    Lists the tabs of all windows with what their pages use, see
+    TabWidget::resourceUsage().
+ */
+class TaskManagerDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    TaskManagerDialog(QWidget *parent = 0);
+
+    static TaskManagerDialog *showDialog();
+
+public slots:
+    void refresh();
+
+private slots:
+    void closeSelectedTabs();
+    void updateButtons();
+
+private:
+    QTreeWidget *m_tree;
+    QPushButton *m_closeTabsButton;
+    QTimer *m_refreshTimer;
+};
+
+#endif // TASKMANAGERDIALOG_H
@@ -66,6 +66,7 @@
 #include "autosaver.h"
 #include "browserapplication.h"
 #include "browsermainwindow.h"
+#include "idlescheduler.h"
 #include "networkaccessmanager.h"
 #include "opensearchengine.h"
 #include "opensearchengineaction.h"
@@ -75,8 +76,10 @@
 #include "webview.h"
 
 #include <qabstractitemview.h>
+#include <qbuffer.h>
 #include <qcompleter.h>
 #include <qcoreapplication.h>
+#include <qimage.h>
 #include <qmenu.h>
 #include <qsettings.h>
 #include <qstandarditemmodel.h>
@@ -101,9 +104,6 @@ ToolbarSearch::ToolbarSearch(QWidget *parent)
     , m_suggestTimer(0)
     , m_completer(0)
 {
-    connect(openSearchManager(), SIGNAL(currentEngineChanged()),
-            this, SLOT(currentEngineChanged()));
-
     m_completer = new QCompleter(this);
     m_completer->setModel(m_model);
     m_completer->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
@@ -118,6 +118,40 @@ ToolbarSearch::ToolbarSearch(QWidget *parent)
 
     load();
 
+    // Reading the search engines can wait until the window is shown,
+    // until then show the engine that was current last time
+    if (s_openSearchManager) {
+        setupOpenSearch();
+    } else {
+        showLastEngine();
+        BrowserApplication::idleScheduler()->addTask(QString(), this, "setupOpenSearch",
+            IdleScheduler::HighPriority, QStringList() << QLatin1String("openSearch"));
+    }
+}
+
+/*
+    Show the name and icon of the current engine without reading the
+    OpenSearch descriptions, the name is the one OpenSearchManager saves
+    and the icon the one saved by engineImageChanged().
+ */
+void ToolbarSearch::showLastEngine()
+{
+    QSettings settings;
+    settings.beginGroup(QLatin1String("openSearch"));
+    m_currentEngine = settings.value(QLatin1String("engine"), QLatin1String("Google")).toString();
+    setInactiveText(m_currentEngine);
+    settings.endGroup();
+
+    settings.beginGroup(QLatin1String("toolbarsearch"));
+    QImage image = QImage::fromData(settings.value(QLatin1String("engineImage")).toByteArray());
+    if (!image.isNull())
+        searchButton()->setImage(image);
+}
+
+void ToolbarSearch::setupOpenSearch()
+{
+    connect(openSearchManager(), SIGNAL(currentEngineChanged()),
+            this, SLOT(currentEngineChanged()));
     currentEngineChanged();
 }
 
@@ -146,10 +180,49 @@ void ToolbarSearch::currentEngineChanged()
                 this, SLOT(newSuggestions(const QStringList &)));
     }
 
+    if (openSearchManager()->engineExists(m_currentEngine)) {
+        OpenSearchEngine *oldEngine = openSearchManager()->engine(m_currentEngine);
+        disconnect(oldEngine, SIGNAL(imageChanged()),
+                   this, SLOT(engineImageChanged()));
+    }
+    connect(newEngine, SIGNAL(imageChanged()),
+            this, SLOT(engineImageChanged()));
+
+    bool sameEngine = (m_currentEngine == newEngine->name());
     setInactiveText(newEngine->name());
     m_currentEngine = newEngine->name();
     m_suggestions.clear();
     setupList();
+
+    // Keep the icon shown by showLastEngine() while the image is fetched
+    if (sameEngine && newEngine->image().isNull())
+        return;
+    engineImageChanged();
+}
+
+void ToolbarSearch::engineImageChanged()
+{
+    OpenSearchEngine *engine = openSearchManager()->currentEngine();
+    if (!engine)
+        return;
+
+    // The image is fetched when it is first asked for
+    QImage image = engine->image();
+    if (image.isNull()) {
+        searchButton()->setImage(QImage());
+        return;
+    }
+    image = image.scaled(16, 16, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    searchButton()->setImage(image);
+
+    // Kept for showLastEngine() on the next start
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "PNG");
+    QSettings settings;
+    settings.beginGroup(QLatin1String("toolbarsearch"));
+    settings.setValue(QLatin1String("engineImage"), data);
 }
 
 void ToolbarSearch::completerActivated(const QModelIndex &index)
@@ -92,7 +92,9 @@ public slots:
     void searchNow();
 
 private slots:
+    void setupOpenSearch();
     void currentEngineChanged();
+    void engineImageChanged();
     void save();
     void textEdited(const QString &);
     void newSuggestions(const QStringList &suggestions);
@@ -109,6 +111,7 @@ protected:
 
 private:
     void load();
+    void showLastEngine();
     void setupList();
     void retranslate();
 
@@ -28,10 +28,11 @@
 
 #include "singleapplication.h"
 
+#include <qdatetime.h>
 #include <qdir.h>
+#include <qendian.h>
 #include <qlocalserver.h>
 #include <qlocalsocket.h>
-#include <qtextstream.h>
 #include <qfile.h>
 
 #ifndef Q_OS_WIN
@@ -48,31 +49,70 @@ SingleApplication::SingleApplication(int &argc, char **argv)
 {
 }
 
+// Larger messages are not from us
+static const quint32 MaximumMessageSize = 1024 * 1024;
+
 bool SingleApplication::sendMessage(const QByteArray &message, int waitMsecsForReply)
+{
+    return sendMessages(QList<QByteArray>() << message, waitMsecsForReply);
+}
+
+/*
+    Sends \a messages to the running instance in one go and waits at most
+    \a waitMsecsForReply for a reply, which is emitted with messageReceived().
+
+    Returns false if there is no running instance.
+ */
+bool SingleApplication::sendMessages(const QList<QByteArray> &messages, int waitMsecsForReply)
 {
 #ifdef SINGALAPPLICATION_DEBUG
-    qDebug() << "SingleApplication::" << __FUNCTION__ << message << waitMsecsForReply;
+    qDebug() << "SingleApplication::" << __FUNCTION__ << messages << waitMsecsForReply;
 #endif
     QLocalSocket socket;
     socket.connectToServer(serverName());
     if (!socket.waitForConnected(500))
         return false;
-    socket.write(message);
+
+    for (int i = 0; i < messages.count(); ++i)
+        writeMessage(&socket, messages.at(i));
     socket.flush();
-    socket.waitForBytesWritten();
-    bool success = true;
+    while (socket.bytesToWrite() > 0) {
+        if (!socket.waitForBytesWritten(500))
+            break;
+    }
     if (socket.error() != QLocalSocket::UnknownSocketError) {
 #ifdef SINGALAPPLICATION_DEBUG
         qDebug() << "SingleApplication::" << __FUNCTION__ << socket.errorString();
 #endif
-        success = false;
+        return false;
     }
-    if (success) {
-        socket.waitForReadyRead(waitMsecsForReply);
-        if (socket.bytesAvailable() > 0)
-            emit messageReceived(&socket);
+
+    QTime time;
+    time.start();
+    QByteArray reply;
+    while (waitMsecsForReply > 0) {
+        if (readMessage(&socket, &reply)) {
+            emit messageReceived(reply, &socket);
+            break;
+        }
+        int remaining = waitMsecsForReply - time.elapsed();
+        if (remaining <= 0 || !socket.waitForReadyRead(remaining))
+            break;
     }
-    return success;
+    return true;
+}
+
+/*
+    Writes \a message to \a socket without waiting for it to be sent.
+ */
+void SingleApplication::writeMessage(QLocalSocket *socket, const QByteArray &message)
+{
+    if (!socket)
+        return;
+    uchar header[4];
+    qToBigEndian<quint32>(message.size(), header);
+    socket->write(reinterpret_cast<const char*>(header), 4);
+    socket->write(message);
 }
 
 bool SingleApplication::startSingleServer()
@@ -126,12 +166,57 @@ bool SingleApplication::isRunning() const
 
 void SingleApplication::newConnection()
 {
-    QLocalSocket *socket = m_localServer->nextPendingConnection();
+    while (m_localServer->hasPendingConnections()) {
+        QLocalSocket *socket = m_localServer->nextPendingConnection();
+        if (!socket)
+            return;
+        connect(socket, SIGNAL(readyRead()),
+                this, SLOT(readMessages()));
+        connect(socket, SIGNAL(disconnected()),
+                socket, SLOT(deleteLater()));
+        readMessages(socket);
+    }
+}
+
+void SingleApplication::readMessages()
+{
+    readMessages(qobject_cast<QLocalSocket*>(sender()));
+}
+
+void SingleApplication::readMessages(QLocalSocket *socket)
+{
     if (!socket)
         return;
-    socket->waitForReadyRead();
-    emit messageReceived(socket);
-    delete socket;
+    QByteArray message;
+    while (readMessage(socket, &message)) {
+#ifdef SINGALAPPLICATION_DEBUG
+        qDebug() << "SingleApplication::" << __FUNCTION__ << message;
+#endif
+        emit messageReceived(message, socket);
+    }
+    if (socket->bytesAvailable() >= 4) {
+        QByteArray header = socket->peek(4);
+        if (qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(header.constData())) > MaximumMessageSize) {
+            qWarning() << "SingleApplication: Dropping a connection with an invalid message";
+            socket->abort();
+        }
+    }
+}
+
+/*
+    Takes the next message from \a socket if all of it has arrived.
+ */
+bool SingleApplication::readMessage(QLocalSocket *socket, QByteArray *message)
+{
+    if (socket->bytesAvailable() < 4)
+        return false;
+    QByteArray header = socket->peek(4);
+    quint32 size = qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(header.constData()));
+    if (size > MaximumMessageSize || socket->bytesAvailable() < qint64(4 + size))
+        return false;
+    socket->read(4);
+    *message = socket->read(size);
+    return true;
 }
 
 QString SingleApplication::serverName() const
@@ -34,6 +34,11 @@
 /*
     QApplication subclass that should be used when you only want one
     instant of the application to exist at a time.
+
+    Messages are sent to the running instance over a local socket, each
+    prefixed with its length, so several can be sent over one connection.
+    The running instance reads them as they arrive and never waits for
+    the other instance.
 */
 class QLocalServer;
 class QLocalSocket;
@@ -42,19 +47,24 @@ class SingleApplication : public QApplication
     Q_OBJECT
 
 signals:
-    void messageReceived(QLocalSocket *socket);
+    void messageReceived(const QByteArray &message, QLocalSocket *socket);
 
 public:
     SingleApplication(int &argc, char **argv);
 
     bool sendMessage(const QByteArray &message, int waitMsecsForReply = 0);
+    bool sendMessages(const QList<QByteArray> &messages, int waitMsecsForReply = 0);
+    static void writeMessage(QLocalSocket *socket, const QByteArray &message);
     bool startSingleServer();
     bool isRunning() const;
 
 private slots:
     void newConnection();
+    void readMessages();
 
 private:
+    void readMessages(QLocalSocket *socket);
+    static bool readMessage(QLocalSocket *socket, QByteArray *message);
     QString serverName() const;
     QLocalServer *m_localServer;
 
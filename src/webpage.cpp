@@ -21,6 +21,7 @@
 #include "webpage.h"
 
 #include "browserapplication.h"
+#include "dnsprefetcher.h"
 #include "downloadmanager.h"
 #include "historymanager.h"
 #include "networkaccessmanager.h"
@@ -44,6 +45,7 @@
 #endif
 
 WebPluginFactory *WebPage::s_webPluginFactory = 0;
+QSet<WebPageProxy*> WebPage::s_webPages;
 QString WebPage::s_userAgent;
 
 JavaScriptExternalObject::JavaScriptExternalObject(QObject *parent)
@@ -95,6 +97,17 @@ QString JavaScriptAroraObject::searchUrl(const QString &string) const
     return QString::fromUtf8(ToolbarSearch::openSearchManager()->currentEngine()->searchUrl(string).toEncoded());
 }
 
+WebPageResourceUsage::WebPageResourceUsage()
+    : requests(0)
+    , blockedRequests(0)
+    , bytesReceived(0)
+    , loads(0)
+    , lastLoadTime(0)
+    , totalLoadTime(0)
+    , memoryUsage(0)
+{
+}
+
 WebPage::WebPage(QObject *parent)
     : WebPageProxy(parent)
     , m_openTargetBlankLinksIn(TabWidget::NewWindow)
@@ -110,12 +123,20 @@ WebPage::WebPage(QObject *parent)
             this, SLOT(handleUnsupportedContent(QNetworkReply *)));
     connect(this, SIGNAL(frameCreated(QWebFrame *)),
             this, SLOT(addExternalBinding(QWebFrame *)));
+    connect(this, SIGNAL(linkHovered(const QString &, const QString &, const QString &)),
+            BrowserApplication::networkAccessManager()->dnsPrefetcher(), SLOT(prefetch(const QString &)));
+    connect(this, SIGNAL(loadStarted()),
+            this, SLOT(startLoadTimer()));
+    connect(this, SIGNAL(loadFinished(bool)),
+            this, SLOT(stopLoadTimer()));
     addExternalBinding(mainFrame());
     loadSettings();
+    s_webPages.insert(this);
 }
 
 WebPage::~WebPage()
 {
+    s_webPages.remove(this);
     setNetworkAccessManager(0);
 }
 
@@ -189,6 +210,83 @@ QList<WebPageLinkedResource> WebPage::linkedResources(const QString &relation)
     return resources;
 }
 
+WebPageResourceUsage WebPage::resourceUsage() const
+{
+    WebPageResourceUsage usage = m_resourceUsage;
+    if (m_loadTime.isValid())
+        usage.lastLoadTime = m_loadTime.elapsed();
+
+    // QtWebKit has no per page memory statistics, estimate it from what the
+    // current page was made of and what is needed to paint it
+    QSize size = viewportSize();
+    usage.memoryUsage = totalBytes() + qint64(size.width()) * size.height() * 4;
+    return usage;
+}
+
+/*
+    Returns the page that made \a request or 0 if it was not made by a
+    page or the page was deleted since.
+ */
+WebPage *WebPage::webPageForRequest(const QNetworkRequest &request)
+{
+    QVariant v = request.attribute((QNetworkRequest::Attribute)(pageAttributeId()));
+    WebPageProxy *page = static_cast<WebPageProxy*>(v.value<void*>());
+    if (!page || !s_webPages.contains(page))
+        return 0;
+    return static_cast<WebPage*>(page);
+}
+
+/*
+    Counts the request of \a reply and the bytes it receives.
+ */
+void WebPage::addRequest(QNetworkReply *reply)
+{
+    ++m_resourceUsage.requests;
+    if (!reply)
+        return;
+    m_replyBytes[reply] = 0;
+    connect(reply, SIGNAL(downloadProgress(qint64, qint64)),
+            this, SLOT(replyDownloadProgress(qint64, qint64)));
+    connect(reply, SIGNAL(destroyed(QObject *)),
+            this, SLOT(replyDestroyed(QObject *)));
+}
+
+void WebPage::addBlockedRequest()
+{
+    ++m_resourceUsage.blockedRequests;
+}
+
+void WebPage::replyDownloadProgress(qint64 bytesReceived, qint64 bytesTotal)
+{
+    Q_UNUSED(bytesTotal);
+    QHash<QObject*, qint64>::iterator it = m_replyBytes.find(sender());
+    if (it == m_replyBytes.end() || bytesReceived <= it.value())
+        return;
+    m_resourceUsage.bytesReceived += bytesReceived - it.value();
+    it.value() = bytesReceived;
+}
+
+void WebPage::replyDestroyed(QObject *reply)
+{
+    m_replyBytes.remove(reply);
+}
+
+void WebPage::startLoadTimer()
+{
+    m_loadTime.start();
+}
+
+void WebPage::stopLoadTimer()
+{
+    if (!m_loadTime.isValid())
+        return;
+    int elapsed = m_loadTime.elapsed();
+    m_loadTime = QTime();
+    ++m_resourceUsage.loads;
+    m_resourceUsage.lastLoadTime = elapsed;
+    m_resourceUsage.totalLoadTime += elapsed;
+}
+
 void WebPage::populateNetworkRequest(QNetworkRequest &request)
 {
     if (request == lastRequest) {
@@ -235,8 +333,13 @@ QString WebPage::userAgentForUrl(const QUrl &url) const
 bool WebPage::acceptNavigationRequest(QWebFrame *frame, const QNetworkRequest &request,
                                       NavigationType type)
 {
-    lastRequest = request;
-    lastRequestType = type;
+    // Only navigations of the top level frame are tagged
+    if (frame && frame == mainFrame()) {
+        lastRequest = request;
+        lastRequestType = type;
+    } else {
+        lastRequest = QNetworkRequest();
+    }
 
     QString scheme = request.url().scheme();
     if (scheme == QLatin1String("mailto")
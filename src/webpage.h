@@ -23,8 +23,11 @@
 #include "webpageproxy.h"
 #include "tabwidget.h"
 
+#include <qdatetime.h>
+#include <qhash.h>
 #include <qlist.h>
 #include <qnetworkrequest.h>
+#include <qset.h>
 
 class WebPageLinkedResource
 {
@@ -35,6 +38,22 @@ public:
     QString title;
 };
 
+/*
+    What a page used since it was created, memoryUsage is an estimate.
+ */
+class WebPageResourceUsage
+{
+public:
+    WebPageResourceUsage();
+    int requests;
+    int blockedRequests;
+    qint64 bytesReceived;
+    int loads;
+    int lastLoadTime;
+    qint64 totalLoadTime;
+    qint64 memoryUsage;
+};
+
 class OpenSearchEngine;
 class QNetworkReply;
 class WebPluginFactory;
@@ -81,6 +100,11 @@ public:
     static WebPluginFactory *webPluginFactory();
     QList<WebPageLinkedResource> linkedResources(const QString &relation = QString());
 
+    static WebPage *webPageForRequest(const QNetworkRequest &request);
+    WebPageResourceUsage resourceUsage() const;
+    void addRequest(QNetworkReply *reply);
+    void addBlockedRequest();
+
 protected:
     QString userAgentForUrl(const QUrl &url) const;
     bool acceptNavigationRequest(QWebFrame *frame, const QNetworkRequest &request,
@@ -92,10 +116,17 @@ protected slots:
     void handleUnsupportedContent(QNetworkReply *reply);
     void addExternalBinding(QWebFrame *frame = 0);
 
+private slots:
+    void startLoadTimer();
+    void stopLoadTimer();
+    void replyDownloadProgress(qint64 bytesReceived, qint64 bytesTotal);
+    void replyDestroyed(QObject *reply);
+
 protected:
     void populateNetworkRequest(QNetworkRequest &request);
     static QString s_userAgent;
     static WebPluginFactory *s_webPluginFactory;
+    static QSet<WebPageProxy*> s_webPages;
     TabWidget::OpenUrlIn m_openTargetBlankLinksIn;
     QUrl m_requestedUrl;
     JavaScriptExternalObject *m_javaScriptExternalObject;
@@ -105,6 +136,10 @@ private:
     QNetworkRequest lastRequest;
     QWebPage::NavigationType lastRequestType;
 
+    WebPageResourceUsage m_resourceUsage;
+    QHash<QObject*, qint64> m_replyBytes;
+    QTime m_loadTime;
+
 };
 
 #endif // WEBPAGE_H